@@ -34,18 +34,89 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "gpk-catalog.h"
+#include "gpk-category-tree.h"
 #include "gpk-common.h"
 #include "gpk-common.h"
+#include "gpk-dependency-graph.h"
 #include "gpk-dialog.h"
 #include "gpk-enum.h"
 #include "gpk-error.h"
+#include "gpk-name-index.h"
+#include "gpk-package-model.h"
+#include "gpk-result-cache.h"
+#include "gpk-scheduler.h"
 #include "gpk-task.h"
+#include "gpk-trigram-index.h"
 #include "gpk-debug.h"
 
+/* how often packages streamed from a running search are added to the view */
+#define GPK_APPLICATION_SEARCH_FLUSH_INTERVAL	16 /* ms */
+
+/* the most packages added in one flush, so we never block a frame for long */
+#define GPK_APPLICATION_SEARCH_FLUSH_MAX	250
+
+/* how long the user has to stop typing before we search */
+#define GPK_APPLICATION_SEARCH_DEBOUNCE		250 /* ms */
+
+/* shorter text matches too much to be worth searching for as it is typed */
+#define GPK_APPLICATION_SEARCH_MIN_LENGTH	3
+
+/* rebuild the package catalog if it was written longer ago than this */
+#define GPK_APPLICATION_CATALOG_MAX_AGE		(24 * 60 * 60) /* s */
+
+/* packages to get the details of in each transaction for the details index */
+#define GPK_APPLICATION_DETAILS_INDEX_BATCH	250
+
+/* write the details index to disk after this many transactions */
+#define GPK_APPLICATION_DETAILS_INDEX_SAVE	20
+
+/* wait before getting a failed batch again, twice as long each time */
+#define GPK_APPLICATION_DETAILS_INDEX_RETRY	5 /* s */
+
+/* searches go to the daemon after the index fails this many times */
+#define GPK_APPLICATION_DETAILS_INDEX_TRIES	5
+
+/* how long scrolling has to stop before getting details of the new rows */
+#define GPK_APPLICATION_DETAILS_PREFETCH_DELAY	150 /* ms */
+
+/* rows after the last visible one to get the details of */
+#define GPK_APPLICATION_DETAILS_LOOKAHEAD	50
+
+/* the most package details to get in one transaction */
+#define GPK_APPLICATION_DETAILS_BATCH_MAX	100
+
+/* forget all the details when there are more than this */
+#define GPK_APPLICATION_DETAILS_CACHE_MAX	5000
+
+/* how many typing mistakes a suggested package name can correct */
+#define GPK_APPLICATION_SUGGEST_DISTANCE	2
+
+/* the most package names suggested when a search finds nothing */
+#define GPK_APPLICATION_SUGGEST_MAX		3
+
+/* packages added to "All packages" each time the view nears the end */
+#define GPK_APPLICATION_ALL_PACKAGES_PAGE	200
+
+/* pages of "All packages" kept before the ones scrolled well past are dropped */
+#define GPK_APPLICATION_ALL_PACKAGES_WINDOW	10
+
+/* the most packages to ask about in one dependency query */
+#define GPK_APPLICATION_DEPENDENCY_BATCH_MAX	200
+
+/* the most transactions we have running at once, one is kept for the user
+ * and searches can also use the ones taken by background work */
+#define GPK_APPLICATION_MAX_TRANSACTIONS	3
+
+/* what the backend could do last time, so the window is ready before it answers */
+#define GPK_APPLICATION_STARTUP_CACHE_VERSION	1
+#define GPK_APPLICATION_STARTUP_CACHE_FORMAT	"(uttta{ss})"
+
 typedef enum {
 	GPK_SEARCH_NAME,
 	GPK_SEARCH_DETAILS,
 	GPK_SEARCH_FILE,
+	GPK_SEARCH_ALL,		/* all of the above at the same time */
 	GPK_SEARCH_UNKNOWN
 } GpkSearchType;
 
@@ -68,47 +139,76 @@ typedef struct {
 	gboolean		 has_package;
 	gboolean		 search_in_progress;
 	GCancellable		*cancellable;
+	GHashTable		*search_seen;
+	GHashTable		*search_matches;	/* package_id:GpkPackageMatch bitfield */
+	guint			 search_parts;		/* still running for GPK_SEARCH_ALL */
+	GPtrArray		*search_pending;
+	guint			 search_flush_id;
+	guint			 search_timeout_id;
+	GCancellable		*search_cancellable;
 	gchar			*homepage_url;
 	gchar			*search_group;
 	gchar			*search_text;
+	gchar			*search_text_narrow;
 	GHashTable		*repos;
-	GpkActionMode		 action;
 	GpkSearchMode		 search_mode;
 	GpkSearchType		 search_type;
 	GtkApplication		*application;
 	GSettings		*settings;
 	GtkBuilder		*builder;
-	GtkListStore		*packages_store;
+	GpkPackageModel		*packages_store;
+	GpkResultCache		*result_cache;
+	GpkScheduler		*scheduler;
+	GpkDependencyGraph	*dependency_graph;
+	GpkCategoryTree		*categories;
+	gboolean		 categories_shown;
+	GpkCatalog		*catalog;
+	gboolean		 catalog_stale;
+	gboolean		 catalog_rebuilding;
+	gboolean		 catalog_rebuild_again;
+	gboolean		 all_packages_paged;	/* shown from the catalog */
+	guint			 all_packages_start;	/* the pages in the model */
+	guint			 all_packages_shown;
+	gint			 all_packages_sort_id;	/* put back after paging */
+	GtkSortType		 all_packages_sort_order;
+	PkClient		*catalog_client;
+	GpkTrigramIndex		*details_index;
+	GPtrArray		*details_index_pending;
+	guint			 details_index_batches;
+	gboolean		 details_index_complete;
+	gboolean		 details_index_running;
+	gboolean		 details_index_again;
+	guint			 details_index_failures;
+	guint			 details_index_retry_id;
+	GpkNameIndex		*name_index;		/* NULL until built from the catalog */
+	GCancellable		*name_index_cancellable;
 	GtkTreeStore		*groups_store;
 	guint			 details_event_id;
+	guint			 details_prefetch_id;
+	GHashTable		*details_cache;
+	GHashTable		*details_requested;
+	gchar			*details_selected;
 	guint			 status_id;
-	PkBitfield		 filters_current;
+	PkBitfield		 filters_supported;
 	PkBitfield		 groups;
 	PkBitfield		 roles;
 	PkControl		*control;
 	PkPackageSack		*package_sack;
+	GHashTable		*package_queued;	/* GpkPackageAtom, the same as package_sack */
+	guint			 plan_step;		/* of the queue being applied */
+	guint			 plan_steps;		/* or 0 if not applying */
 	PkStatusEnum		 status_last;
 	PkTask			*task;
+	gboolean		 startup_warm;		/* shown from the startup cache */
+	gboolean		 startup_interactive;
+	gboolean		 startup_painted;
+	guint			 startup_pending;	/* replies until the cache can be saved */
+	gboolean		 startup_failed;	/* so what we have is not saved */
+	GTimer			*startup_timer;		/* only for --benchmark-startup */
+	gboolean		 profile_first_row;	/* only reported once */
+	gchar			*profile_search;	/* from --search, until it is run */
 } GpkApplicationPrivate;
 
-enum {
-	GPK_STATE_INSTALLED,
-	GPK_STATE_IN_LIST,
-	GPK_STATE_COLLECTION,
-	GPK_STATE_UNKNOWN
-};
-
-enum {
-	PACKAGES_COLUMN_IMAGE,
-	PACKAGES_COLUMN_STATE,  /* state of the item */
-	PACKAGES_COLUMN_CHECKBOX,  /* what we show in the checkbox */
-	PACKAGES_COLUMN_CHECKBOX_VISIBLE, /* visible */
-	PACKAGES_COLUMN_TEXT,
-	PACKAGES_COLUMN_ID,
-	PACKAGES_COLUMN_SUMMARY,
-	PACKAGES_COLUMN_LAST
-};
-
 enum {
 	GROUPS_COLUMN_ICON,
 	GROUPS_COLUMN_NAME,
@@ -119,9 +219,14 @@ enum {
 };
 
 static void gpk_application_perform_search (GpkApplicationPrivate *priv);
-
-static void gpk_application_get_requires_cb (PkClient *client, GAsyncResult *res, GpkApplicationPrivate *priv);
-static void gpk_application_get_depends_cb (PkClient *client, GAsyncResult *res, GpkApplicationPrivate *priv);
+static void gpk_application_catalog_rebuild (GpkApplicationPrivate *priv);
+static void gpk_application_details_index_update (GpkApplicationPrivate *priv);
+static void gpk_application_details_index_next (GpkApplicationPrivate *priv);
+static void gpk_application_details_schedule_prefetch (GpkApplicationPrivate *priv);
+static gboolean gpk_application_dependencies_expand_cb (GtkTreeView *treeview, GtkTreeIter *iter, GtkTreePath *path, GpkApplicationPrivate *priv);
+static gboolean gpk_application_activate_suggestion (GpkApplicationPrivate *priv, GtkTreeIter *iter);
+static void gpk_application_find_cb (GtkWidget *button_widget, GpkApplicationPrivate *priv);
+static void gpk_application_all_packages_reload (GpkApplicationPrivate *priv);
 
 static gboolean
 _g_strzero (const gchar *text)
@@ -133,52 +238,6 @@ _g_strzero (const gchar *text)
 	return FALSE;
 }
 
-static const gchar *
-gpk_application_state_get_icon (PkBitfield state)
-{
-	if (state == 0)
-		return gpk_info_enum_to_icon_name (PK_INFO_ENUM_AVAILABLE);
-
-	if (state == pk_bitfield_value (GPK_STATE_INSTALLED))
-		return gpk_info_enum_to_icon_name (PK_INFO_ENUM_INSTALLED);
-
-	if (state == pk_bitfield_value (GPK_STATE_IN_LIST))
-		return gpk_info_enum_to_icon_name (PK_INFO_ENUM_INSTALLING);
-
-	if (state == pk_bitfield_from_enums (GPK_STATE_INSTALLED, GPK_STATE_IN_LIST, -1))
-		return gpk_info_enum_to_icon_name (PK_INFO_ENUM_REMOVING);
-
-	if (state == pk_bitfield_value (GPK_STATE_COLLECTION))
-		return gpk_info_enum_to_icon_name (PK_INFO_ENUM_COLLECTION_AVAILABLE);
-
-	if (state == pk_bitfield_from_enums (GPK_STATE_INSTALLED, GPK_STATE_COLLECTION, -1))
-		return gpk_info_enum_to_icon_name (PK_INFO_ENUM_COLLECTION_INSTALLED);
-
-	if (state == pk_bitfield_from_enums (GPK_STATE_IN_LIST, GPK_STATE_INSTALLED, GPK_STATE_COLLECTION, -1))
-		return gpk_info_enum_to_icon_name (PK_INFO_ENUM_REMOVING); // need new icon
-
-	if (state == pk_bitfield_from_enums (GPK_STATE_IN_LIST, GPK_STATE_COLLECTION, -1))
-		return gpk_info_enum_to_icon_name (PK_INFO_ENUM_INSTALLING); // need new icon
-
-	return NULL;
-}
-
-static gboolean
-gpk_application_state_get_checkbox (PkBitfield state)
-{
-	PkBitfield state_local;
-
-	/* remove any we don't care about */
-	state_local = state;
-	pk_bitfield_remove (state_local, GPK_STATE_COLLECTION);
-
-	/* installed or in array */
-	if (state_local == pk_bitfield_value (GPK_STATE_INSTALLED) ||
-	    state_local == pk_bitfield_value (GPK_STATE_IN_LIST))
-		return TRUE;
-	return FALSE;
-}
-
 static void
 gpk_application_set_text_buffer (GtkWidget *widget, const gchar *text)
 {
@@ -210,71 +269,45 @@ gpk_application_allow_remove (GpkApplicationPrivate *priv, gboolean allow)
 	gtk_widget_set_visible (widget, allow);
 }
 
-static void
-gpk_application_packages_checkbox_invert (GpkApplicationPrivate *priv)
+/* the row the details are shown for, which is the focused row if more
+ * than one is selected */
+static gboolean
+gpk_application_get_selected_iter (GpkApplicationPrivate *priv, GtkTreeIter *iter)
 {
 	GtkTreeView *treeview;
 	GtkTreeModel *model;
-	GtkTreeIter iter;
 	GtkTreeSelection *selection;
-	PkBitfield state;
-	gboolean ret;
-	g_autofree gchar *package_id = NULL;
+	GtkTreePath *path = NULL;
+	GList *rows;
+	gboolean ret = FALSE;
 
-	/* get the selection and add */
 	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
 	selection = gtk_tree_view_get_selection (treeview);
-	ret = gtk_tree_selection_get_selected (selection, &model, &iter);
-	if (!ret) {
-		g_warning ("no selection");
-		return;
+	model = gtk_tree_view_get_model (treeview);
+	gtk_tree_view_get_cursor (treeview, &path, NULL);
+	if (path != NULL && gtk_tree_selection_path_is_selected (selection, path)) {
+		ret = gtk_tree_model_get_iter (model, iter, path);
+	} else {
+		rows = gtk_tree_selection_get_selected_rows (selection, NULL);
+		if (rows != NULL)
+			ret = gtk_tree_model_get_iter (model, iter, rows->data);
+		g_list_free_full (rows, (GDestroyNotify) gtk_tree_path_free);
 	}
-
-	gtk_tree_model_get (model, &iter,
-			    PACKAGES_COLUMN_STATE, &state,
-			    PACKAGES_COLUMN_ID, &package_id,
-			    -1);
-
-	/* do something with the value */
-	pk_bitfield_invert (state, GPK_STATE_IN_LIST);
-
-	/* set new value */
-	gtk_list_store_set (GTK_LIST_STORE (model), &iter,
-			    PACKAGES_COLUMN_STATE, state,
-			    PACKAGES_COLUMN_CHECKBOX, gpk_application_state_get_checkbox (state),
-			    PACKAGES_COLUMN_IMAGE, gpk_application_state_get_icon (state),
-			    -1);
-}
-
-static gboolean
-gpk_application_get_checkbox_enable (GpkApplicationPrivate *priv, PkBitfield state)
-{
-	gboolean enable_installed = TRUE;
-	gboolean enable_available = TRUE;
-
-	if (priv->action == GPK_ACTION_INSTALL)
-		enable_installed = FALSE;
-	else if (priv->action == GPK_ACTION_REMOVE)
-		enable_available = FALSE;
-
-	if (pk_bitfield_contain (state, GPK_STATE_INSTALLED))
-		return enable_installed;
-	return enable_available;
+	if (path != NULL)
+		gtk_tree_path_free (path);
+	return ret;
 }
 
 static gboolean
 gpk_application_get_selected_package (GpkApplicationPrivate *priv, gchar **package_id, gchar **summary)
 {
-	GtkTreeView *treeview;
 	GtkTreeModel *model;
 	GtkTreeIter iter;
-	GtkTreeSelection *selection;
 	gboolean ret;
 
 	/* get the selection and add */
-	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
-	selection = gtk_tree_view_get_selection (treeview);
-	ret = gtk_tree_selection_get_selected (selection, &model, &iter);
+	model = GTK_TREE_MODEL (priv->packages_store);
+	ret = gpk_application_get_selected_iter (priv, &iter);
 	if (!ret) {
 		g_warning ("no selection");
 		return FALSE;
@@ -283,12 +316,12 @@ gpk_application_get_selected_package (GpkApplicationPrivate *priv, gchar **packa
 	/* get data */
 	if (summary == NULL) {
 		gtk_tree_model_get (model, &iter,
-				    PACKAGES_COLUMN_ID, package_id,
+				    GPK_PACKAGE_MODEL_COLUMN_ID, package_id,
 				    -1);
 	} else {
 		gtk_tree_model_get (model, &iter,
-				    PACKAGES_COLUMN_ID, package_id,
-				    PACKAGES_COLUMN_SUMMARY, summary,
+				    GPK_PACKAGE_MODEL_COLUMN_ID, package_id,
+				    GPK_PACKAGE_MODEL_COLUMN_SUMMARY, summary,
 				    -1);
 	}
 	return TRUE;
@@ -342,12 +375,6 @@ static void
 gpk_application_change_queue_status (GpkApplicationPrivate *priv)
 {
 	GtkWidget *widget;
-	GtkTreeView *treeview;
-	gboolean valid;
-	GtkTreeIter iter;
-	GtkTreeModel *model;
-	PkBitfield state;
-	gboolean enabled;
 
 	/* show and hide the action widgets */
 	if (pk_package_sack_get_size (priv->package_sack) > 0) {
@@ -357,100 +384,187 @@ gpk_application_change_queue_status (GpkApplicationPrivate *priv)
 		gtk_widget_show (widget);
 		gpk_application_group_add_selected (priv);
 	} else {
-		priv->action = GPK_ACTION_NONE;
 		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_apply"));
 		gtk_widget_hide (widget);
 		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_clear"));
 		gtk_widget_hide (widget);
 		gpk_application_group_remove_selected (priv);
 	}
+}
 
-	/* correct the enabled state */
-	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
-	model = gtk_tree_view_get_model (treeview);
-	valid = gtk_tree_model_get_iter_first (model, &iter);
+static gboolean
+gpk_application_queue_contains (GpkApplicationPrivate *priv, const gchar *package_id)
+{
+	GpkPackageAtom *atom = gpk_package_atom_lookup (package_id);
+	return atom != NULL && g_hash_table_contains (priv->package_queued, atom);
+}
 
-	/* for all current items, reset the state if in the array */
-	while (valid) {
-		g_autofree gchar *package_id = NULL;
-		gtk_tree_model_get (model, &iter,
-				    PACKAGES_COLUMN_STATE, &state,
-				    PACKAGES_COLUMN_ID, &package_id,
-				    -1);
+static void
+gpk_application_queue_add (GpkApplicationPrivate *priv, PkPackage *package)
+{
+	GpkPackageAtom *atom;
 
-		/* we never show the checkbox for the search helper */
-		if (package_id == NULL) {
-			enabled = FALSE;
-		} else {
-			enabled = gpk_application_get_checkbox_enable (priv, state);
-		}
+	pk_package_sack_add_package (priv->package_sack, package);
+	atom = gpk_package_atom_intern (pk_package_get_id (package));
+	if (atom != NULL)
+		g_hash_table_add (priv->package_queued, atom);
+}
 
-		/* set visible */
-		gtk_list_store_set (GTK_LIST_STORE (model), &iter, PACKAGES_COLUMN_CHECKBOX_VISIBLE, enabled, -1);
-		valid = gtk_tree_model_iter_next (model, &iter);
-	}
+static void
+gpk_application_queue_remove (GpkApplicationPrivate *priv, const gchar *package_id)
+{
+	GpkPackageAtom *atom = gpk_package_atom_lookup (package_id);
+
+	pk_package_sack_remove_package_by_id (priv->package_sack, package_id);
+	if (atom != NULL)
+		g_hash_table_remove (priv->package_queued, atom);
+}
+
+static void
+gpk_application_queue_clear (GpkApplicationPrivate *priv)
+{
+	pk_package_sack_clear (priv->package_sack);
+	g_hash_table_remove_all (priv->package_queued);
 }
 
+/**
+ * gpk_application_queue_row:
+ *
+ * Adds the package in a row to the queue for @action, or takes it out if
+ * it was queued for the other action. The queue can hold both installs and
+ * removes, and only the row itself is updated.
+ *
+ * Return value: %TRUE if the queue changed
+ **/
 static gboolean
-gpk_application_install (GpkApplicationPrivate *priv)
+gpk_application_queue_row (GpkApplicationPrivate *priv, GtkTreeIter *iter, GpkActionMode action)
 {
-	gboolean ret;
-	g_autofree gchar *package_id_selected = NULL;
-	g_autofree gchar *summary_selected = NULL;
-	g_autoptr(PkPackage) package = NULL;
+	PkBitfield state;
+	PkPackage *package;
+	const gchar *package_id;
+	gboolean installed;
+	g_autoptr(PkPackage) queued = NULL;
 
-	/* get selection */
-	ret = gpk_application_get_selected_package (priv, &package_id_selected, &summary_selected);
-	if (!ret) {
-		g_warning ("no package selected");
-		goto out;
+	/* check we aren't a help line */
+	package = gpk_package_model_get_package (priv->packages_store, iter);
+	if (package == NULL)
+		return FALSE;
+	package_id = pk_package_get_id (package);
+	state = gpk_package_model_get_state (priv->packages_store, iter);
+
+	/* already added, or changed mind */
+	installed = pk_bitfield_contain (state, GPK_PACKAGE_STATE_INSTALLED);
+	if (pk_bitfield_contain (state, GPK_PACKAGE_STATE_IN_LIST)) {
+		if (installed == (action == GPK_ACTION_REMOVE))
+			return FALSE;
+		g_debug ("removed %s from package array", package_id);
+		gpk_application_queue_remove (priv, package_id);
+		pk_bitfield_remove (state, GPK_PACKAGE_STATE_IN_LIST);
+		gpk_package_model_set_state (priv->packages_store, iter, state);
+		return TRUE;
 	}
 
-	/* changed mind, or wrong mode */
-	if (priv->action == GPK_ACTION_REMOVE) {
-		ret = pk_package_sack_remove_package_by_id (priv->package_sack, package_id_selected);
-		if (ret) {
-			g_debug ("removed %s from package array", package_id_selected);
+	/* nothing to do */
+	if (installed != (action == GPK_ACTION_REMOVE))
+		return FALSE;
+
+	/* add to array */
+	queued = pk_package_new ();
+	pk_package_set_id (queued, package_id, NULL);
+	g_object_set (queued,
+		      "info", installed ? PK_INFO_ENUM_INSTALLED : PK_INFO_ENUM_AVAILABLE,
+		      "summary", pk_package_get_summary (package),
+		      NULL);
+	gpk_application_queue_add (priv, queued);
+	pk_bitfield_add (state, GPK_PACKAGE_STATE_IN_LIST);
+	gpk_package_model_set_state (priv->packages_store, iter, state);
+	return TRUE;
+}
 
-			/* correct buttons */
-			gpk_application_allow_install (priv, FALSE);
-			gpk_application_allow_remove (priv, TRUE);
-			gpk_application_packages_checkbox_invert (priv);
-			ret = TRUE;
-			goto out;
-		}
-		g_warning ("wrong mode and not in array");
-		ret = FALSE;
-		goto out;
-	}
+/* only show each button if it would do something to a selected row */
+static void
+gpk_application_update_buttons (GpkApplicationPrivate *priv)
+{
+	GtkTreeView *treeview;
+	GtkTreeSelection *selection;
+	GtkTreeIter iter;
+	GList *l;
+	GList *rows;
+	PkBitfield state;
+	gboolean show_install = FALSE;
+	gboolean show_remove = FALSE;
 
-	/* already added */
-	package = pk_package_sack_find_by_id (priv->package_sack, package_id_selected);
-	if (package != NULL) {
-		g_warning ("already added");
-		goto out;
+	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
+	selection = gtk_tree_view_get_selection (treeview);
+	rows = gtk_tree_selection_get_selected_rows (selection, NULL);
+	for (l = rows; l != NULL && !(show_install && show_remove); l = l->next) {
+		if (!gtk_tree_model_get_iter (GTK_TREE_MODEL (priv->packages_store), &iter, l->data))
+			continue;
+		if (gpk_package_model_get_package (priv->packages_store, &iter) == NULL)
+			continue;
+		state = gpk_package_model_get_state (priv->packages_store, &iter);
+		if (state == 0 ||
+		    state == pk_bitfield_from_enums (GPK_PACKAGE_STATE_INSTALLED, GPK_PACKAGE_STATE_IN_LIST, -1))
+			show_install = TRUE;
+		if (state == pk_bitfield_value (GPK_PACKAGE_STATE_INSTALLED) ||
+		    state == pk_bitfield_value (GPK_PACKAGE_STATE_IN_LIST))
+			show_remove = TRUE;
 	}
+	g_list_free_full (rows, (GDestroyNotify) gtk_tree_path_free);
 
-	/* set mode */
-	priv->action = GPK_ACTION_INSTALL;
+	gpk_application_allow_install (priv, show_install);
+	gpk_application_allow_remove (priv, show_remove);
+}
 
-	/* add to array */
-	package = pk_package_new ();
-	pk_package_set_id (package, package_id_selected, NULL);
-	g_object_set (package,
-		      "info", PK_INFO_ENUM_AVAILABLE,
-		      "summary", summary_selected,
-		      NULL);
-	pk_package_sack_add_package (priv->package_sack, package);
+/**
+ * gpk_application_queue_rows:
+ * @all: %TRUE for every result, %FALSE for the selected rows
+ *
+ * Queues many packages at once; the queue status is only updated at the end.
+ **/
+static void
+gpk_application_queue_rows (GpkApplicationPrivate *priv, GpkActionMode action, gboolean all)
+{
+	GtkTreeView *treeview;
+	GtkTreeModel *model;
+	GtkTreeSelection *selection;
+	GtkTreeIter iter;
+	GList *l;
+	GList *rows;
+	gboolean valid;
+	guint changed = 0;
+
+	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
+	model = GTK_TREE_MODEL (priv->packages_store);
+	if (all) {
+		valid = gtk_tree_model_get_iter_first (model, &iter);
+		while (valid) {
+			if (gpk_application_queue_row (priv, &iter, action))
+				changed++;
+			valid = gtk_tree_model_iter_next (model, &iter);
+		}
+	} else {
+		selection = gtk_tree_view_get_selection (treeview);
+		rows = gtk_tree_selection_get_selected_rows (selection, NULL);
+		for (l = rows; l != NULL; l = l->next) {
+			if (!gtk_tree_model_get_iter (model, &iter, l->data))
+				continue;
+			if (gpk_application_queue_row (priv, &iter, action))
+				changed++;
+		}
+		g_list_free_full (rows, (GDestroyNotify) gtk_tree_path_free);
+	}
+	g_debug ("changed %u packages in the queue", changed);
 
-	/* correct buttons */
-	gpk_application_allow_install (priv, FALSE);
-	gpk_application_allow_remove (priv, TRUE);
-	gpk_application_packages_checkbox_invert (priv);
-out:
 	/* add the selected group if there are any packages in the queue */
 	gpk_application_change_queue_status (priv);
-	return ret;
+	gpk_application_update_buttons (priv);
+}
+
+static void
+gpk_application_install (GpkApplicationPrivate *priv)
+{
+	gpk_application_queue_rows (priv, GPK_ACTION_INSTALL, FALSE);
 }
 
 static void
@@ -459,23 +573,42 @@ gpk_application_menu_homepage_cb (GtkAction *action, GpkApplicationPrivate *priv
 	gtk_show_uri (NULL, priv->homepage_url, GDK_CURRENT_TIME, NULL);
 }
 
-static gint
-gpk_application_strcmp_indirect (gchar **a, gchar **b)
+/* a request about one package, which might not be selected by the time
+ * the daemon replies */
+typedef struct {
+	GpkApplicationPrivate	*priv;
+	gchar			**package_ids;
+} GpkApplicationPackageRequest;
+
+static GpkApplicationPackageRequest *
+gpk_application_package_request_new (GpkApplicationPrivate *priv, const gchar *package_id)
 {
-	return strcmp (*a, *b);
+	GpkApplicationPackageRequest *request;
+	request = g_new0 (GpkApplicationPackageRequest, 1);
+	request->priv = priv;
+	request->package_ids = pk_package_ids_from_id (package_id);
+	return request;
 }
 
 static void
-gpk_application_get_files_cb (PkClient *client, GAsyncResult *res, GpkApplicationPrivate *priv)
+gpk_application_package_request_free (GpkApplicationPackageRequest *request)
 {
-	gboolean ret;
+	g_strfreev (request->package_ids);
+	g_free (request);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GpkApplicationPackageRequest, gpk_application_package_request_free)
+
+static void
+gpk_application_get_files_cb (PkClient *client, GAsyncResult *res, GpkApplicationPackageRequest *request_tmp)
+{
+	g_autoptr(GpkApplicationPackageRequest) request = request_tmp;
+	GpkApplicationPrivate *priv = request->priv;
 	g_auto(GStrv) files = NULL;
-	g_autofree gchar *package_id_selected = NULL;
 	g_auto(GStrv) split = NULL;
 	g_autofree gchar *title = NULL;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GPtrArray) array = NULL;
-	g_autoptr(GPtrArray) array_sort = NULL;
 	GtkWidget *dialog;
 	GtkWindow *window;
 	g_autoptr(PkError) error_code = NULL;
@@ -511,33 +644,22 @@ gpk_application_get_files_cb (PkClient *client, GAsyncResult *res, GpkApplicatio
 	/* assume only one option */
 	item = g_ptr_array_index (array, 0);
 
-	/* get selection */
-	ret = gpk_application_get_selected_package (priv, &package_id_selected, NULL);
-	if (!ret) {
-		g_warning ("no package selected");
-		return;
-	}
-
 	/* get data */
 	g_object_get (item,
 		      "files", &files,
 		      NULL);
 
-	/* convert to pointer array */
-	array_sort = pk_strv_to_ptr_array (files);
-	g_ptr_array_sort (array_sort, (GCompareFunc) gpk_application_strcmp_indirect);
-
 	/* title */
-	split = pk_package_id_split (package_id_selected);
+	split = pk_package_id_split (request->package_ids[0]);
 	/* TRANSLATORS: title: how many files are installed by the application */
 	title = g_strdup_printf (ngettext ("%u file installed by %s",
 					   "%u files installed by %s",
-					   array_sort->len), array_sort->len, split[PK_PACKAGE_ID_NAME]);
+					   g_strv_length (files)), g_strv_length (files), split[PK_PACKAGE_ID_NAME]);
 
 	window = GTK_WINDOW (gtk_builder_get_object (priv->builder, "window_manager"));
 	dialog = gtk_message_dialog_new (window, GTK_DIALOG_DESTROY_WITH_PARENT,
 					 GTK_MESSAGE_INFO, GTK_BUTTONS_OK, "%s", title);
-	gpk_dialog_embed_file_list_widget (GTK_DIALOG (dialog), array_sort);
+	gpk_dialog_embed_file_list_widget (GTK_DIALOG (dialog), files);
 	gtk_window_set_resizable (GTK_WINDOW (dialog), TRUE);
 	gtk_window_set_default_size (GTK_WINDOW (dialog), 600, 250);
 
@@ -569,12 +691,42 @@ gpk_application_status_changed_timeout_cb (GpkApplicationPrivate *priv)
 	return FALSE;
 }
 
+static void
+gpk_application_progress_finished (GpkApplicationPrivate *priv)
+{
+	GtkWidget *widget;
+
+	/* re-enable UI */
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "treeview_packages"));
+	gtk_widget_set_sensitive (widget, TRUE);
+
+	/* hide the cancel button */
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_cancel"));
+	gtk_widget_hide (widget);
+
+	/* make apply button sensitive */
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_apply"));
+	gtk_widget_set_sensitive (widget, TRUE);
+
+	/* we've not yet shown, so don't bother */
+	if (priv->status_id > 0) {
+		g_source_remove (priv->status_id);
+		priv->status_id = 0;
+	}
+
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "headerbar"));
+	gtk_header_bar_set_subtitle (GTK_HEADER_BAR(widget), NULL);
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "progressbar_progress"));
+	gtk_widget_hide (widget);
+}
+
 static void
 gpk_application_progress_cb (PkProgress *progress, PkProgressType type, GpkApplicationPrivate *priv)
 {
 	PkStatusEnum status;
 	gint percentage;
 	gboolean allow_cancel;
+	gdouble fraction;
 	GtkWidget *widget;
 
 	g_object_get (progress,
@@ -587,28 +739,9 @@ gpk_application_progress_cb (PkProgress *progress, PkProgressType type, GpkAppli
 		g_debug ("now %s", pk_status_enum_to_string (status));
 
 		if (status == PK_STATUS_ENUM_FINISHED) {
-			/* re-enable UI */
-			widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "treeview_packages"));
-			gtk_widget_set_sensitive (widget, TRUE);
-
-			/* hide the cancel button */
-			widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_cancel"));
-			gtk_widget_hide (widget);
-
-			/* make apply button sensitive */
-			widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_apply"));
-			gtk_widget_set_sensitive (widget, TRUE);
-
-			/* we've not yet shown, so don't bother */
-			if (priv->status_id > 0) {
-				g_source_remove (priv->status_id);
-				priv->status_id = 0;
-			}
-
-			widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "headerbar"));
-			gtk_header_bar_set_subtitle (GTK_HEADER_BAR(widget), NULL);
-			widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "progressbar_progress"));
-			gtk_widget_hide (widget);
+			/* the queue being applied is done when the last one is */
+			if (priv->plan_steps == 0)
+				gpk_application_progress_finished (priv);
 			return;
 		}
 
@@ -630,7 +763,12 @@ gpk_application_progress_cb (PkProgress *progress, PkProgressType type, GpkAppli
 	} else if (type == PK_PROGRESS_TYPE_PERCENTAGE) {
 		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "progressbar_progress"));
 		if (percentage > 0) {
-			gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (widget), (gfloat) percentage / 100.0f);
+			fraction = (gdouble) percentage / 100.0;
+
+			/* show how far through the whole queue we are */
+			if (priv->plan_steps > 0)
+				fraction = (priv->plan_step + fraction) / priv->plan_steps;
+			gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (widget), fraction);
 		} else {
 			gtk_widget_hide (widget);
 		}
@@ -641,11 +779,21 @@ gpk_application_progress_cb (PkProgress *progress, PkProgressType type, GpkAppli
 	}
 }
 
+static void
+gpk_application_get_files_start (GCancellable *cancellable,
+				 GAsyncReadyCallback callback, gpointer callback_data,
+				 GpkApplicationPackageRequest *request)
+{
+	pk_client_get_files_async (PK_CLIENT (request->priv->task), request->package_ids, cancellable,
+				   (PkProgressCallback) gpk_application_progress_cb, request->priv,
+				   callback, callback_data);
+}
+
 static void
 gpk_application_menu_files_cb (GtkAction *action, GpkApplicationPrivate *priv)
 {
 	gboolean ret;
-	g_auto(GStrv) package_ids = NULL;
+	GpkApplicationPackageRequest *request;
 	g_autofree gchar *package_id_selected = NULL;
 
 	/* get selection */
@@ -655,72 +803,115 @@ gpk_application_menu_files_cb (GtkAction *action, GpkApplicationPrivate *priv)
 		return;
 	}
 
-	/* ensure new action succeeds */
-	g_cancellable_reset (priv->cancellable);
-
-	/* set correct view */
-	package_ids = pk_package_ids_from_id (package_id_selected);
-	pk_client_get_files_async (PK_CLIENT (priv->task), package_ids, priv->cancellable,
-				   (PkProgressCallback) gpk_application_progress_cb, priv,
-				   (GAsyncReadyCallback) gpk_application_get_files_cb, priv);
+	/* replaces any files request for the previous selection */
+	request = gpk_application_package_request_new (priv, package_id_selected);
+	gpk_scheduler_push (priv->scheduler, GPK_SCHEDULER_KIND_FILES,
+			    (GpkSchedulerFunc) gpk_application_get_files_start,
+			    (GAsyncReadyCallback) gpk_application_get_files_cb,
+			    request, (GDestroyNotify) gpk_application_package_request_free);
 }
 
-static gboolean
+static void
 gpk_application_remove (GpkApplicationPrivate *priv)
 {
-	gboolean ret;
-	g_autofree gchar *package_id_selected = NULL;
-	g_autofree gchar *summary_selected = NULL;
-	g_autoptr(PkPackage) package = NULL;
+	gpk_application_queue_rows (priv, GPK_ACTION_REMOVE, FALSE);
+}
 
-	/* get selection */
-	ret = gpk_application_get_selected_package (priv, &package_id_selected, &summary_selected);
-	if (!ret) {
-		g_warning ("no package selected");
-		goto out;
-	}
+static void
+gpk_application_menu_install_selected_cb (GtkMenuItem *item, GpkApplicationPrivate *priv)
+{
+	gpk_application_queue_rows (priv, GPK_ACTION_INSTALL, FALSE);
+}
 
-	/* changed mind, or wrong mode */
-	if (priv->action == GPK_ACTION_INSTALL) {
-		ret = pk_package_sack_remove_package_by_id (priv->package_sack, package_id_selected);
-		if (ret) {
-			g_debug ("removed %s from package array", package_id_selected);
+static void
+gpk_application_menu_remove_selected_cb (GtkMenuItem *item, GpkApplicationPrivate *priv)
+{
+	gpk_application_queue_rows (priv, GPK_ACTION_REMOVE, FALSE);
+}
 
-			/* correct buttons */
-			gpk_application_allow_install (priv, TRUE);
-			gpk_application_allow_remove (priv, FALSE);
-			gpk_application_packages_checkbox_invert (priv);
-			ret = TRUE;
-			goto out;
-		}
-		g_warning ("wrong mode and not in array");
-		ret = FALSE;
-		goto out;
-	}
+static void
+gpk_application_menu_install_all_cb (GtkMenuItem *item, GpkApplicationPrivate *priv)
+{
+	gpk_application_queue_rows (priv, GPK_ACTION_INSTALL, TRUE);
+}
 
-	/* already added */
-	ret = (pk_package_sack_find_by_id (priv->package_sack, package_id_selected) == NULL);
-	if (!ret) {
-		g_warning ("already added");
-		goto out;
+static void
+gpk_application_menu_remove_all_cb (GtkMenuItem *item, GpkApplicationPrivate *priv)
+{
+	gpk_application_queue_rows (priv, GPK_ACTION_REMOVE, TRUE);
+}
+
+static gboolean
+gpk_application_packages_button_press_cb (GtkTreeView *treeview, GdkEventButton *event, GpkApplicationPrivate *priv)
+{
+	GtkMenu *menu;
+	GtkTreePath *path = NULL;
+	GtkTreeSelection *selection;
+	GtkWidget *item;
+
+	/* a suggested search is run with a single click */
+	if (event->type == GDK_BUTTON_PRESS && event->button == 1) {
+		GtkTreeIter iter;
+		gboolean ret = FALSE;
+		if (!gtk_tree_view_get_path_at_pos (treeview, (gint) event->x, (gint) event->y,
+						    &path, NULL, NULL, NULL))
+			return FALSE;
+		if (gtk_tree_model_get_iter (GTK_TREE_MODEL (priv->packages_store), &iter, path))
+			ret = gpk_application_activate_suggestion (priv, &iter);
+		gtk_tree_path_free (path);
+		return ret;
 	}
 
-	priv->action = GPK_ACTION_REMOVE;
-	package = pk_package_new ();
-	pk_package_set_id (package, package_id_selected, NULL);
-	g_object_set (package,
-		      "info", PK_INFO_ENUM_INSTALLED,
-		      "summary", summary_selected,
-		      NULL);
-	pk_package_sack_add_package (priv->package_sack, package);
+	/* only respond to right button */
+	if (event->type != GDK_BUTTON_PRESS || event->button != 3)
+		return FALSE;
+	if (!priv->has_package)
+		return FALSE;
 
-	/* correct buttons */
-	gpk_application_allow_install (priv, TRUE);
-	gpk_application_allow_remove (priv, FALSE);
-	gpk_application_packages_checkbox_invert (priv);
-out:
-	/* add the selected group if there are any packages in the queue */
-	gpk_application_change_queue_status (priv);
+	/* keep a multiple selection if the click was inside it */
+	selection = gtk_tree_view_get_selection (treeview);
+	if (gtk_tree_view_get_path_at_pos (treeview, (gint) event->x, (gint) event->y,
+					   &path, NULL, NULL, NULL)) {
+		if (!gtk_tree_selection_path_is_selected (selection, path)) {
+			gtk_tree_selection_unselect_all (selection);
+			gtk_tree_selection_select_path (selection, path);
+		}
+		gtk_tree_path_free (path);
+	}
+
+	menu = GTK_MENU (gtk_menu_new ());
+
+	/* TRANSLATORS: context menu item for the package list */
+	item = gtk_menu_item_new_with_mnemonic (_("_Install Selected"));
+	gtk_widget_set_sensitive (item, gtk_tree_selection_count_selected_rows (selection) > 0);
+	g_signal_connect (G_OBJECT (item), "activate",
+			  G_CALLBACK (gpk_application_menu_install_selected_cb), priv);
+	gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
+
+	/* TRANSLATORS: context menu item for the package list */
+	item = gtk_menu_item_new_with_mnemonic (_("_Remove Selected"));
+	gtk_widget_set_sensitive (item, gtk_tree_selection_count_selected_rows (selection) > 0);
+	g_signal_connect (G_OBJECT (item), "activate",
+			  G_CALLBACK (gpk_application_menu_remove_selected_cb), priv);
+	gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
+
+	gtk_menu_shell_append (GTK_MENU_SHELL (menu), gtk_separator_menu_item_new ());
+
+	/* TRANSLATORS: context menu item for the package list, for every package shown */
+	item = gtk_menu_item_new_with_mnemonic (_("Install _All Results"));
+	g_signal_connect (G_OBJECT (item), "activate",
+			  G_CALLBACK (gpk_application_menu_install_all_cb), priv);
+	gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
+
+	/* TRANSLATORS: context menu item for the package list, for every package shown */
+	item = gtk_menu_item_new_with_mnemonic (_("Remove A_ll Results"));
+	g_signal_connect (G_OBJECT (item), "activate",
+			  G_CALLBACK (gpk_application_menu_remove_all_cb), priv);
+	gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
+
+	gtk_widget_show_all (GTK_WIDGET (menu));
+	gtk_menu_popup (menu, NULL, NULL, NULL, NULL,
+			event->button, event->time);
 	return TRUE;
 }
 
@@ -736,140 +927,341 @@ gpk_application_menu_remove_cb (GtkAction *action, GpkApplicationPrivate *priv)
 	gpk_application_remove (priv);
 }
 
+typedef struct {
+	GpkApplicationPrivate		*priv;
+	GpkDependencyGraphDirection	 direction;
+	gchar				*package_id;
+	GHashTable			*found;		/* package_id */
+	GPtrArray			*closure;	/* of PkPackage, in the order found */
+	GQueue				 frontier;	/* of package_id, still to ask about */
+	gchar				**package_ids;	/* being asked about */
+} GpkApplicationDependencies;
+
 static void
-gpk_application_get_requires_cb (PkClient *client, GAsyncResult *res, GpkApplicationPrivate *priv)
+gpk_application_dependencies_free (GpkApplicationDependencies *deps)
 {
-	g_autoptr(PkResults) results = NULL;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(PkError) error_code = NULL;
-	g_autoptr(GPtrArray) array = NULL;
-	GtkWindow *window;
-	g_autofree gchar *name = NULL;
-	g_autofree gchar *title = NULL;
-	g_autofree gchar *message = NULL;
-	g_auto(GStrv) package_ids = NULL;
-	GtkWidget *dialog;
-	g_autofree gchar *package_id_selected = NULL;
-	gboolean ret;
+	g_free (deps->package_id);
+	g_hash_table_unref (deps->found);
+	g_ptr_array_unref (deps->closure);
+	g_queue_foreach (&deps->frontier, (GFunc) g_free, NULL);
+	g_queue_clear (&deps->frontier);
+	g_strfreev (deps->package_ids);
+	g_free (deps);
+}
 
-	/* get the results */
-	results = pk_client_generic_finish (client, res, &error);
-	if (results == NULL) {
-		g_warning ("failed to get requires: %s", error->message);
-		return;
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GpkApplicationDependencies, gpk_application_dependencies_free)
+
+static void
+gpk_application_dependencies_query (GpkApplicationPrivate *priv,
+				    GpkDependencyGraphDirection direction,
+				    gchar **package_ids,
+				    GCancellable *cancellable,
+				    GAsyncReadyCallback callback,
+				    gpointer callback_data)
+{
+	/* one level at a time, so each package can be remembered */
+	if (direction == GPK_DEPENDENCY_GRAPH_DEPENDS) {
+		pk_client_depends_on_async (PK_CLIENT (priv->task),
+					    pk_bitfield_value (PK_FILTER_ENUM_NONE),
+					    package_ids, FALSE, cancellable,
+					    (PkProgressCallback) gpk_application_progress_cb, priv,
+					    callback, callback_data);
+	} else {
+		pk_client_required_by_async (PK_CLIENT (priv->task),
+					     pk_bitfield_value (PK_FILTER_ENUM_NONE),
+					     package_ids, FALSE, cancellable,
+					     (PkProgressCallback) gpk_application_progress_cb, priv,
+					     callback, callback_data);
 	}
+}
 
-	/* check error code */
-	error_code = pk_results_get_error_code (results);
-	if (error_code != NULL) {
-		g_warning ("failed to get requires: %s, %s", pk_error_enum_to_string (pk_error_get_code (error_code)), pk_error_get_details (error_code));
+static void
+gpk_application_dependencies_start (GCancellable *cancellable,
+				    GAsyncReadyCallback callback, gpointer callback_data,
+				    GpkApplicationDependencies *deps)
+{
+	gpk_application_dependencies_query (deps->priv, deps->direction, deps->package_ids,
+					    cancellable, callback, callback_data);
+}
 
-		/* if obvious message, don't tell the user */
-		if (pk_error_get_code (error_code) != PK_ERROR_ENUM_TRANSACTION_CANCELLED) {
-			window = GTK_WINDOW (gtk_builder_get_object (priv->builder, "window_manager"));
-			gpk_error_dialog_modal (window, gpk_error_enum_to_localised_text (pk_error_get_code (error_code)),
-						gpk_error_enum_to_localised_message (pk_error_get_code (error_code)), pk_error_get_details (error_code));
-		}
-		return;
-	}
+static void
+gpk_application_dependencies_add (GpkApplicationDependencies *deps, GPtrArray *packages)
+{
+	PkPackage *package;
+	PkInfoEnum info;
+	const gchar *package_id;
+	guint i;
 
-	/* get selection */
-	ret = gpk_application_get_selected_package (priv, &package_id_selected, NULL);
-	if (!ret) {
-		g_warning ("no package selected");
-		return;
+	for (i = 0; i < packages->len; i++) {
+		package = g_ptr_array_index (packages, i);
+		package_id = pk_package_get_id (package);
+		if (g_strcmp0 (package_id, deps->package_id) == 0 ||
+		    g_hash_table_contains (deps->found, package_id))
+			continue;
+		g_hash_table_add (deps->found, g_strdup (package_id));
+		g_ptr_array_add (deps->closure, g_object_ref (package));
+
+		/* what an installed package needs is already installed, and
+		 * packages that are not installed cannot be broken */
+		info = pk_package_get_info (package);
+		if (deps->direction == GPK_DEPENDENCY_GRAPH_DEPENDS && info == PK_INFO_ENUM_INSTALLED)
+			continue;
+		if (deps->direction == GPK_DEPENDENCY_GRAPH_REQUIRED_BY && info != PK_INFO_ENUM_INSTALLED)
+			continue;
+		g_queue_push_tail (&deps->frontier, g_strdup (package_id));
 	}
+}
 
-	/* get data */
-	array = pk_results_get_package_array (results);
+static void
+gpk_application_dependencies_show (GpkApplicationDependencies *deps)
+{
+	GpkApplicationPrivate *priv = deps->priv;
+	GtkTreeView *treeview;
+	GtkWidget *dialog;
+	GtkWindow *window;
+	guint direct = 0;
+	guint missing = 0;
+	guint64 size;
+	g_autofree gchar *extra = NULL;
+	g_autofree gchar *message = NULL;
+	g_autofree gchar *name = NULL;
+	g_autofree gchar *title = NULL;
+	g_autoptr(GPtrArray) edges = NULL;
+	g_auto(GStrv) package_ids = NULL;
+	GPtrArray *closure = deps->closure;
+
+	edges = gpk_dependency_graph_get_edges (priv->dependency_graph, deps->direction, deps->package_id);
+	if (edges == NULL)
+		edges = g_ptr_array_ref (closure);
 
 	/* empty array */
 	window = GTK_WINDOW (gtk_builder_get_object (priv->builder, "window_manager"));
-	if (array->len == 0) {
-		gpk_error_dialog_modal (window,
-					/* TRANSLATORS: no packages returned */
-					_("No packages"),
-					/* TRANSLATORS: this package is not required by any others */
-					_("No other packages require this package"), NULL);
+	if (closure->len == 0) {
+		if (deps->direction == GPK_DEPENDENCY_GRAPH_DEPENDS) {
+			gpk_error_dialog_modal (window,
+						/* TRANSLATORS: no packages returned */
+						_("No packages"),
+						/* TRANSLATORS: this package does not depend on any others */
+						_("This package does not depend on any others"), NULL);
+		} else {
+			gpk_error_dialog_modal (window,
+						/* TRANSLATORS: no packages returned */
+						_("No packages"),
+						/* TRANSLATORS: this package is not required by any others */
+						_("No other packages require this package"), NULL);
+		}
 		return;
 	}
 
-	package_ids = pk_package_ids_from_id (package_id_selected);
+	package_ids = pk_package_ids_from_id (deps->package_id);
 	name = gpk_dialog_package_id_name_join_locale (package_ids);
-	/* TRANSLATORS: title: how many packages require this package */
-	title = g_strdup_printf (ngettext ("%u package requires %s",
-					   "%u packages require %s",
-					   array->len), array->len, name);
-
-	/* TRANSLATORS: show a array of packages for the package */
-	message = g_strdup_printf (ngettext ("Packages listed below require %s to function correctly.",
-					     "Packages listed below require %s to function correctly.",
-					     array->len), name);
+	if (deps->direction == GPK_DEPENDENCY_GRAPH_DEPENDS) {
+		/* TRANSLATORS: title: show the number of other packages we depend on */
+		title = g_strdup_printf (ngettext ("%u additional package is required for %s",
+						   "%u additional packages are required for %s",
+						   closure->len), closure->len, name);
+
+		/* TRANSLATORS: message: show the array of dependent packages for this package */
+		message = g_strdup_printf (ngettext ("Packages listed below are required for %s to function correctly.",
+						     "Packages listed below are required for %s to function correctly.",
+						     closure->len), name);
+
+		/* only from what we already know */
+		size = gpk_dependency_graph_get_download_size (priv->dependency_graph, deps->package_id, &missing);
+		if (size > 0) {
+			g_autofree gchar *size_text = g_format_size (size);
+			/* TRANSLATORS: the total size of the packages that are not installed yet */
+			extra = g_strdup_printf (_("The additional download size is %s."), size_text);
+		}
+	} else {
+		/* TRANSLATORS: title: how many packages require this package */
+		title = g_strdup_printf (ngettext ("%u package requires %s",
+						   "%u packages require %s",
+						   closure->len), closure->len, name);
+
+		/* TRANSLATORS: show a array of packages for the package */
+		message = g_strdup_printf (ngettext ("Packages listed below require %s to function correctly.",
+						     "Packages listed below require %s to function correctly.",
+						     closure->len), name);
+
+		gpk_dependency_graph_get_fan_out (priv->dependency_graph, deps->package_id, &direct);
+		/* TRANSLATORS: how many of the packages need this one without going through another */
+		extra = g_strdup_printf (ngettext ("%u of them requires it directly.",
+						   "%u of them require it directly.",
+						   direct), direct);
+	}
+	if (extra != NULL) {
+		gchar *tmp = g_strdup_printf ("%s\n\n%s", message, extra);
+		g_free (message);
+		message = tmp;
+	}
 
 	dialog = gtk_message_dialog_new (window, GTK_DIALOG_DESTROY_WITH_PARENT,
 					 GTK_MESSAGE_INFO, GTK_BUTTONS_OK, "%s", title);
 	gtk_window_set_resizable (GTK_WINDOW (dialog), TRUE);
 	gtk_message_dialog_format_secondary_markup (GTK_MESSAGE_DIALOG (dialog), "%s", message);
-	gpk_dialog_embed_package_list_widget (GTK_DIALOG (dialog), array);
+
+	/* the direct links, each of which can be expanded */
+	treeview = gpk_dialog_embed_package_tree_widget (GTK_DIALOG (dialog), edges);
+	g_object_set_data (G_OBJECT (treeview), "gpk-direction", GUINT_TO_POINTER (deps->direction));
+	g_signal_connect (treeview, "test-expand-row",
+			  G_CALLBACK (gpk_application_dependencies_expand_cb), priv);
 
 	gtk_dialog_run (GTK_DIALOG (dialog));
 	gtk_widget_destroy (GTK_WIDGET (dialog));
 }
 
 static void
-gpk_application_menu_requires_cb (GtkAction *action, GpkApplicationPrivate *priv)
+gpk_application_dependencies_details_start (GCancellable *cancellable,
+					    GAsyncReadyCallback callback, gpointer callback_data,
+					    GpkApplicationDependencies *deps)
 {
-	gboolean ret;
-	g_auto(GStrv) package_ids = NULL;
-	g_autofree gchar *package_id_selected = NULL;
+	pk_client_get_details_async (PK_CLIENT (deps->priv->task), deps->package_ids, cancellable,
+				     (PkProgressCallback) gpk_application_progress_cb, deps->priv,
+				     callback, callback_data);
+}
 
-	/* get selection */
-	ret = gpk_application_get_selected_package (priv, &package_id_selected, NULL);
-	if (!ret) {
-		g_warning ("no package selected");
+static void
+gpk_application_dependencies_details_cb (PkClient *client, GAsyncResult *res, GpkApplicationDependencies *deps_tmp)
+{
+	g_autoptr(GpkApplicationDependencies) deps = deps_tmp;
+	GpkApplicationPrivate *priv = deps->priv;
+	g_autoptr(PkResults) results = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	PkDetails *item;
+	guint i;
+
+	/* the dialog is still useful without the sizes, unless it was
+	 * replaced by a newer one */
+	results = pk_client_generic_finish (client, res, &error);
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
 		return;
+	if (results == NULL) {
+		g_warning ("failed to get details: %s", error->message);
+	} else {
+		array = pk_results_get_details_array (results);
+		for (i = 0; i < array->len; i++) {
+			item = g_ptr_array_index (array, i);
+			gpk_dependency_graph_set_size (priv->dependency_graph,
+						       pk_details_get_package_id (item),
+						       pk_details_get_size (item));
+		}
 	}
+	gpk_application_dependencies_show (deps);
+}
 
-	/* ensure new action succeeds */
-	g_cancellable_reset (priv->cancellable);
+static void
+gpk_application_dependencies_get_sizes (GpkApplicationDependencies *deps_tmp)
+{
+	g_autoptr(GpkApplicationDependencies) deps = deps_tmp;
+	GpkApplicationPrivate *priv = deps->priv;
+	PkDetails *details;
+	PkPackage *package;
+	const gchar *package_id;
+	guint i;
+	g_autoptr(GPtrArray) package_ids = NULL;
 
-	/* get the requires */
-	package_ids = pk_package_ids_from_id (package_id_selected);
+	/* only installing needs the download size */
+	if (deps->direction != GPK_DEPENDENCY_GRAPH_DEPENDS) {
+		gpk_application_dependencies_show (deps);
+		return;
+	}
+
+	/* use the details we already have */
+	package_ids = g_ptr_array_new_with_free_func (g_free);
+	for (i = 0; i < deps->closure->len; i++) {
+		package = g_ptr_array_index (deps->closure, i);
+		package_id = pk_package_get_id (package);
+		if (pk_package_get_info (package) == PK_INFO_ENUM_INSTALLED ||
+		    gpk_dependency_graph_get_size (priv->dependency_graph, package_id, NULL))
+			continue;
+		details = g_hash_table_lookup (priv->details_cache, package_id);
+		if (details != NULL) {
+			gpk_dependency_graph_set_size (priv->dependency_graph, package_id,
+						       pk_details_get_size (details));
+			continue;
+		}
+		g_ptr_array_add (package_ids, g_strdup (package_id));
+	}
+	if (package_ids->len == 0) {
+		gpk_application_dependencies_show (deps);
+		return;
+	}
+
+	/* one transaction for the rest */
+	g_ptr_array_add (package_ids, NULL);
+	g_strfreev (deps->package_ids);
+	deps->package_ids = (gchar **) g_ptr_array_free (g_steal_pointer (&package_ids), FALSE);
+	gpk_scheduler_push (priv->scheduler, GPK_SCHEDULER_KIND_GRAPH,
+			    (GpkSchedulerFunc) gpk_application_dependencies_details_start,
+			    (GAsyncReadyCallback) gpk_application_dependencies_details_cb,
+			    g_steal_pointer (&deps), (GDestroyNotify) gpk_application_dependencies_free);
+}
+
+static void gpk_application_dependencies_cb (PkClient *client, GAsyncResult *res, GpkApplicationDependencies *deps_tmp);
+
+static void
+gpk_application_dependencies_next (GpkApplicationDependencies *deps)
+{
+	GpkApplicationPrivate *priv = deps->priv;
+	g_autoptr(GPtrArray) package_ids = NULL;
+
+	/* ask about the packages we do not know about yet, a batch at a time */
+	package_ids = g_ptr_array_new_with_free_func (g_free);
+	while (!g_queue_is_empty (&deps->frontier) &&
+	       package_ids->len < GPK_APPLICATION_DEPENDENCY_BATCH_MAX) {
+		g_autofree gchar *package_id = g_queue_pop_head (&deps->frontier);
+		g_autoptr(GPtrArray) edges = NULL;
+		edges = gpk_dependency_graph_get_edges (priv->dependency_graph,
+							deps->direction, package_id);
+		if (edges != NULL)
+			gpk_application_dependencies_add (deps, edges);
+		else
+			g_ptr_array_add (package_ids, g_steal_pointer (&package_id));
+	}
 
-	pk_client_depends_on_async (PK_CLIENT (priv->task),
-				    pk_bitfield_value (PK_FILTER_ENUM_NONE),
-				    package_ids, TRUE, priv->cancellable,
-				    (PkProgressCallback) gpk_application_progress_cb, priv,
-				    (GAsyncReadyCallback) gpk_application_get_depends_cb, priv);
+	/* found everything */
+	if (package_ids->len == 0) {
+		gpk_dependency_graph_set_closure (priv->dependency_graph, deps->direction,
+						  deps->package_id, deps->closure);
+		gpk_application_dependencies_get_sizes (deps);
+		return;
+	}
+
+	g_ptr_array_add (package_ids, NULL);
+	g_strfreev (deps->package_ids);
+	deps->package_ids = (gchar **) g_ptr_array_free (g_steal_pointer (&package_ids), FALSE);
+	gpk_scheduler_push (priv->scheduler,
+			    deps->direction == GPK_DEPENDENCY_GRAPH_DEPENDS ?
+				GPK_SCHEDULER_KIND_DEPENDS : GPK_SCHEDULER_KIND_REQUIRES,
+			    (GpkSchedulerFunc) gpk_application_dependencies_start,
+			    (GAsyncReadyCallback) gpk_application_dependencies_cb,
+			    deps, (GDestroyNotify) gpk_application_dependencies_free);
 }
 
 static void
-gpk_application_get_depends_cb (PkClient *client, GAsyncResult *res, GpkApplicationPrivate *priv)
+gpk_application_dependencies_cb (PkClient *client, GAsyncResult *res, GpkApplicationDependencies *deps_tmp)
 {
+	g_autoptr(GpkApplicationDependencies) deps = deps_tmp;
+	GpkApplicationPrivate *priv = deps->priv;
 	g_autoptr(PkResults) results = NULL;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(PkError) error_code = NULL;
 	g_autoptr(GPtrArray) array = NULL;
 	GtkWindow *window;
-	g_autofree gchar *name = NULL;
-	g_autofree gchar *title = NULL;
-	g_autofree gchar *message = NULL;
-	g_auto(GStrv) package_ids = NULL;
-	GtkWidget *dialog;
-	g_autofree gchar *package_id_selected = NULL;
-	gboolean ret;
 
 	/* get the results */
 	results = pk_client_generic_finish (client, res, &error);
 	if (results == NULL) {
-		g_warning ("failed to get depends: %s", error->message);
+		g_warning ("failed to get dependencies: %s", error->message);
 		return;
 	}
 
 	/* check error code */
 	error_code = pk_results_get_error_code (results);
 	if (error_code != NULL) {
-		g_warning ("failed to get depends: %s, %s", pk_error_enum_to_string (pk_error_get_code (error_code)), pk_error_get_details (error_code));
+		g_warning ("failed to get dependencies: %s, %s", pk_error_enum_to_string (pk_error_get_code (error_code)), pk_error_get_details (error_code));
 
 		/* if obvious message, don't tell the user */
 		if (pk_error_get_code (error_code) != PK_ERROR_ENUM_TRANSACTION_CANCELLED) {
@@ -880,54 +1272,178 @@ gpk_application_get_depends_cb (PkClient *client, GAsyncResult *res, GpkApplicat
 		return;
 	}
 
-	/* get data */
+	/* the backend does not say which package needed what, so the
+	 * links are only known when one package was asked about */
 	array = pk_results_get_package_array (results);
+	if (g_strv_length (deps->package_ids) == 1) {
+		gpk_dependency_graph_set_edges (priv->dependency_graph, deps->direction,
+						deps->package_ids[0], array);
+	}
+	gpk_application_dependencies_add (deps, array);
+	gpk_application_dependencies_next (g_steal_pointer (&deps));
+}
 
-	/* get selection */
-	ret = gpk_application_get_selected_package (priv, &package_id_selected, NULL);
-	if (!ret) {
-		g_warning ("no package selected");
+static void
+gpk_application_dependencies_explore (GpkApplicationPrivate *priv,
+				      const gchar *package_id,
+				      GpkDependencyGraphDirection direction)
+{
+	GpkApplicationDependencies *deps;
+	guint i;
+	g_autoptr(GPtrArray) closure = NULL;
+
+	/* the latest selection wins, including the sizes for an older one */
+	gpk_scheduler_cancel (priv->scheduler,
+			      direction == GPK_DEPENDENCY_GRAPH_DEPENDS ?
+				GPK_SCHEDULER_KIND_DEPENDS : GPK_SCHEDULER_KIND_REQUIRES);
+	gpk_scheduler_cancel (priv->scheduler, GPK_SCHEDULER_KIND_GRAPH);
+
+	deps = g_new0 (GpkApplicationDependencies, 1);
+	deps->priv = priv;
+	deps->direction = direction;
+	deps->package_id = g_strdup (package_id);
+	deps->found = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	deps->closure = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_queue_init (&deps->frontier);
+
+	/* asked before, so no need for the daemon */
+	closure = gpk_dependency_graph_get_closure (priv->dependency_graph, direction, package_id);
+	if (closure != NULL) {
+		for (i = 0; i < closure->len; i++)
+			g_ptr_array_add (deps->closure, g_object_ref (g_ptr_array_index (closure, i)));
+		gpk_application_dependencies_get_sizes (deps);
 		return;
 	}
+	g_queue_push_tail (&deps->frontier, g_strdup (package_id));
+	gpk_application_dependencies_next (deps);
+}
 
-	/* empty array */
-	window = GTK_WINDOW (gtk_builder_get_object (priv->builder, "window_manager"));
-	if (array->len == 0) {
-		gpk_error_dialog_modal (window,
-					/* TRANSLATORS: no packages returned */
-					_("No packages"),
-					/* TRANSLATORS: this package does not depend on any others */
-					_("This package does not depend on any others"), NULL);
+typedef struct {
+	GpkApplicationPrivate		*priv;
+	GpkDependencyGraphDirection	 direction;
+	gchar				**package_ids;
+	GtkTreeView			*treeview;
+	GtkTreeRowReference		*row;
+} GpkApplicationDependencyRow;
+
+static void
+gpk_application_dependency_row_free (GpkApplicationDependencyRow *row)
+{
+	g_strfreev (row->package_ids);
+	g_object_unref (row->treeview);
+	gtk_tree_row_reference_free (row->row);
+	g_free (row);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GpkApplicationDependencyRow, gpk_application_dependency_row_free)
+
+static void
+gpk_application_dependency_row_start (GCancellable *cancellable,
+				      GAsyncReadyCallback callback, gpointer callback_data,
+				      GpkApplicationDependencyRow *row)
+{
+	gpk_application_dependencies_query (row->priv, row->direction, row->package_ids,
+					    cancellable, callback, callback_data);
+}
+
+static void
+gpk_application_dependency_row_cb (PkClient *client, GAsyncResult *res, GpkApplicationDependencyRow *row_tmp)
+{
+	g_autoptr(GpkApplicationDependencyRow) row = row_tmp;
+	GpkApplicationPrivate *priv = row->priv;
+	GtkTreeIter iter;
+	GtkTreePath *path;
+	g_autoptr(PkResults) results = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(PkError) error_code = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+
+	/* get the results */
+	results = pk_client_generic_finish (client, res, &error);
+	if (results == NULL) {
+		g_warning ("failed to get dependencies: %s", error->message);
+	} else {
+		error_code = pk_results_get_error_code (results);
+		if (error_code != NULL)
+			g_warning ("failed to get dependencies: %s, %s", pk_error_enum_to_string (pk_error_get_code (error_code)), pk_error_get_details (error_code));
+		else
+			array = pk_results_get_package_array (results);
+	}
+
+	/* on failure the placeholder is taken away, as nothing will replace it */
+	if (array != NULL) {
+		gpk_dependency_graph_set_edges (priv->dependency_graph, row->direction,
+						row->package_ids[0], array);
+	} else {
+		array = g_ptr_array_new ();
+	}
+
+	/* the dialog might have been closed */
+	if (!gtk_tree_row_reference_valid (row->row))
 		return;
+	path = gtk_tree_row_reference_get_path (row->row);
+	if (gtk_tree_model_get_iter (gtk_tree_view_get_model (row->treeview), &iter, path))
+		gpk_dialog_package_tree_set_children (row->treeview, &iter, array);
+	gtk_tree_path_free (path);
+}
+
+static gboolean
+gpk_application_dependencies_expand_cb (GtkTreeView *treeview, GtkTreeIter *iter,
+					GtkTreePath *path, GpkApplicationPrivate *priv)
+{
+	GpkApplicationDependencyRow *row;
+	GpkDependencyGraphDirection direction;
+	g_autofree gchar *package_id = NULL;
+	g_autoptr(GPtrArray) edges = NULL;
+
+	if (gpk_dialog_package_tree_get_loaded (treeview, iter))
+		return FALSE;
+
+	/* we might have found this out already */
+	direction = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (treeview), "gpk-direction"));
+	package_id = gpk_dialog_package_tree_get_package_id (treeview, iter);
+	edges = gpk_dependency_graph_get_edges (priv->dependency_graph, direction, package_id);
+	if (edges != NULL) {
+		gpk_dialog_package_tree_set_children (treeview, iter, edges);
+		return FALSE;
 	}
 
-	package_ids = pk_package_ids_from_id (package_id_selected);
-	name = gpk_dialog_package_id_name_join_locale (package_ids);
-	/* TRANSLATORS: title: show the number of other packages we depend on */
-	title = g_strdup_printf (ngettext ("%u additional package is required for %s",
-					   "%u additional packages are required for %s",
-					   array->len), array->len, name);
+	/* expand now, showing the placeholder until we know */
+	row = g_new0 (GpkApplicationDependencyRow, 1);
+	row->priv = priv;
+	row->direction = direction;
+	row->package_ids = pk_package_ids_from_id (package_id);
+	row->treeview = g_object_ref (treeview);
+	row->row = gtk_tree_row_reference_new (gtk_tree_view_get_model (treeview), path);
+	gpk_scheduler_push (priv->scheduler, GPK_SCHEDULER_KIND_GRAPH,
+			    (GpkSchedulerFunc) gpk_application_dependency_row_start,
+			    (GAsyncReadyCallback) gpk_application_dependency_row_cb,
+			    row, (GDestroyNotify) gpk_application_dependency_row_free);
+	return FALSE;
+}
 
-	/* TRANSLATORS: message: show the array of dependent packages for this package */
-	message = g_strdup_printf (ngettext ("Packages listed below are required for %s to function correctly.",
-					     "Packages listed below are required for %s to function correctly.",
-					     array->len), name);
+static void
+gpk_application_menu_requires_cb (GtkAction *action, GpkApplicationPrivate *priv)
+{
+	gboolean ret;
+	g_autofree gchar *package_id_selected = NULL;
 
-	dialog = gtk_message_dialog_new (window, GTK_DIALOG_DESTROY_WITH_PARENT,
-					 GTK_MESSAGE_INFO, GTK_BUTTONS_OK, "%s", title);
-	gtk_window_set_resizable (GTK_WINDOW (dialog), TRUE);
-	gtk_message_dialog_format_secondary_markup (GTK_MESSAGE_DIALOG (dialog), "%s", message);
-	gpk_dialog_embed_package_list_widget (GTK_DIALOG (dialog), array);
+	/* get selection */
+	ret = gpk_application_get_selected_package (priv, &package_id_selected, NULL);
+	if (!ret) {
+		g_warning ("no package selected");
+		return;
+	}
 
-	gtk_dialog_run (GTK_DIALOG (dialog));
-	gtk_widget_destroy (GTK_WIDGET (dialog));
+	/* get the requires */
+	gpk_application_dependencies_explore (priv, package_id_selected,
+					      GPK_DEPENDENCY_GRAPH_DEPENDS);
 }
 
 static void
 gpk_application_menu_depends_cb (GtkAction *_action, GpkApplicationPrivate *priv)
 {
 	gboolean ret;
-	g_auto(GStrv) package_ids = NULL;
 	g_autofree gchar *package_id_selected = NULL;
 
 	/* get selection */
@@ -937,17 +1453,9 @@ gpk_application_menu_depends_cb (GtkAction *_action, GpkApplicationPrivate *priv
 		return;
 	}
 
-	/* ensure new action succeeds */
-	g_cancellable_reset (priv->cancellable);
-
 	/* get the depends */
-	package_ids = pk_package_ids_from_id (package_id_selected);
-
-	pk_client_required_by_async (PK_CLIENT (priv->task),
-				     pk_bitfield_value (PK_FILTER_ENUM_NONE),
-				     package_ids, TRUE, priv->cancellable,
-				     (PkProgressCallback) gpk_application_progress_cb, priv,
-				     (GAsyncReadyCallback) gpk_application_get_requires_cb, priv);
+	gpk_application_dependencies_explore (priv, package_id_selected,
+					      GPK_DEPENDENCY_GRAPH_REQUIRED_BY);
 }
 
 static const gchar *
@@ -1002,75 +1510,334 @@ gpk_application_clear_details (GpkApplicationPrivate *priv)
 }
 
 static void
-gpk_application_clear_packages (GpkApplicationPrivate *priv)
+gpk_application_update_facet_counts (GpkApplicationPrivate *priv)
 {
-	/* clear existing array */
-	priv->has_package = FALSE;
-	gtk_list_store_clear (priv->packages_store);
+	GtkWidget *widget;
+	guint installed;
+	guint available;
+	g_autofree gchar *text = NULL;
+
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_facets"));
+	gpk_package_model_get_facet_counts (priv->packages_store, &installed, &available);
+	if (installed == 0 && available == 0) {
+		gtk_widget_hide (widget);
+		return;
+	}
+	/* TRANSLATORS: how many of the packages shown are installed, and how many are not */
+	text = g_strdup_printf (_("%'u installed, %'u available"), installed, available);
+	gtk_label_set_label (GTK_LABEL (widget), text);
+	gtk_widget_show (widget);
 }
 
+/* the results are narrowed locally, rather than by searching again */
 static void
-gpk_application_add_item_to_results (GpkApplicationPrivate *priv, PkPackage *item)
+gpk_application_update_facets (GpkApplicationPrivate *priv)
 {
-	GtkTreeIter iter;
-	g_autofree gchar *text = NULL;
-	gboolean in_queue;
-	gboolean installed;
-	gboolean enabled;
-	PkBitfield state = 0;
-	static guint package_cnt = 0;
+	PkBitfield facets = 0;
+
+	if (g_settings_get_boolean (priv->settings, GPK_SETTINGS_FILTER_NEWEST))
+		pk_bitfield_add (facets, PK_FILTER_ENUM_NEWEST);
+	if (g_settings_get_boolean (priv->settings, GPK_SETTINGS_FILTER_ARCH))
+		pk_bitfield_add (facets, PK_FILTER_ENUM_ARCH);
+	if (g_settings_get_boolean (priv->settings, GPK_SETTINGS_FILTER_BASENAME))
+		pk_bitfield_add (facets, PK_FILTER_ENUM_BASENAME);
+	gpk_package_model_set_facets (priv->packages_store, facets);
+	gpk_application_update_facet_counts (priv);
+}
+
+/* the pages are in the order of the catalog, and sorting by a column would
+ * only reorder the few that happen to be loaded */
+static void
+gpk_application_all_packages_set_sortable (GpkApplicationPrivate *priv, gboolean sortable)
+{
+	GList *columns;
+	GList *l;
+	GtkTreeSortable *store = GTK_TREE_SORTABLE (priv->packages_store);
+	GtkTreeView *treeview;
+	GtkTreeViewColumn *column;
+
+	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
+	columns = gtk_tree_view_get_columns (treeview);
+	for (l = columns; l != NULL; l = l->next) {
+		column = GTK_TREE_VIEW_COLUMN (l->data);
+		if (gtk_tree_view_column_get_sort_column_id (column) >= 0)
+			gtk_tree_view_column_set_clickable (column, sortable);
+	}
+	g_list_free (columns);
+
+	if (sortable) {
+		gtk_tree_sortable_set_sort_column_id (store,
+						      priv->all_packages_sort_id,
+						      priv->all_packages_sort_order);
+		return;
+	}
+	gtk_tree_sortable_get_sort_column_id (store,
+					      &priv->all_packages_sort_id,
+					      &priv->all_packages_sort_order);
+	gtk_tree_sortable_set_sort_column_id (store,
+					      GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID,
+					      GTK_SORT_ASCENDING);
+}
+
+static void
+gpk_application_clear_packages (GpkApplicationPrivate *priv)
+{
+	/* clear existing array */
+	priv->has_package = FALSE;
+	gpk_package_model_clear (priv->packages_store);
+	gpk_application_update_facet_counts (priv);
+
+	/* drop anything still waiting from the last search */
+	if (priv->search_flush_id > 0) {
+		g_source_remove (priv->search_flush_id);
+		priv->search_flush_id = 0;
+	}
+	g_ptr_array_set_size (priv->search_pending, 0);
+	g_hash_table_remove_all (priv->search_seen);
+	g_hash_table_remove_all (priv->search_matches);
+	g_clear_pointer (&priv->search_text_narrow, g_free);
+	g_clear_pointer (&priv->details_selected, g_free);
+	if (priv->all_packages_paged)
+		gpk_application_all_packages_set_sortable (priv, TRUE);
+	priv->all_packages_paged = FALSE;
+	priv->all_packages_start = 0;
+	priv->all_packages_shown = 0;
+}
+
+static void
+gpk_application_add_item_to_results (GpkApplicationPrivate *priv, PkPackage *item)
+{
+	gboolean in_queue;
+	gboolean installed;
+	PkBitfield state = 0;
+	PkDetails *details;
 	PkInfoEnum info;
-	g_autofree gchar *package_id = NULL;
-	g_autofree gchar *summary = NULL;
-	GtkWidget *widget;
+	const gchar *package_id;
 
 	/* get data */
-	g_object_get (item,
-		      "info", &info,
-		      "package-id", &package_id,
-		      "summary", &summary,
-		      NULL);
+	info = pk_package_get_info (item);
+	package_id = pk_package_get_id (item);
 
 	/* mark as got so we don't warn */
 	priv->has_package = TRUE;
 
 	/* are we in the package array? */
-	in_queue = (pk_package_sack_find_by_id (priv->package_sack, package_id) != NULL);
+	in_queue = gpk_application_queue_contains (priv, package_id);
 	installed = (info == PK_INFO_ENUM_INSTALLED) || (info == PK_INFO_ENUM_COLLECTION_INSTALLED);
 
 	if (installed)
-		pk_bitfield_add (state, GPK_STATE_INSTALLED);
+		pk_bitfield_add (state, GPK_PACKAGE_STATE_INSTALLED);
 	if (in_queue)
-		pk_bitfield_add (state, GPK_STATE_IN_LIST);
+		pk_bitfield_add (state, GPK_PACKAGE_STATE_IN_LIST);
 
 	/* special icon */
 	if (info == PK_INFO_ENUM_COLLECTION_INSTALLED || info == PK_INFO_ENUM_COLLECTION_AVAILABLE)
-		pk_bitfield_add (state, GPK_STATE_COLLECTION);
-
-	/* use two lines */
-	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "window_manager"));
-	text = gpk_package_id_format_twoline (gtk_widget_get_style_context (widget),
-					      package_id,
-					      summary);
-
-	/* can we modify this? */
-	enabled = gpk_application_get_checkbox_enable (priv, state);
-
-	gtk_list_store_append (priv->packages_store, &iter);
-	gtk_list_store_set (priv->packages_store, &iter,
-			    PACKAGES_COLUMN_STATE, state,
-			    PACKAGES_COLUMN_CHECKBOX, gpk_application_state_get_checkbox (state),
-			    PACKAGES_COLUMN_CHECKBOX_VISIBLE, enabled,
-			    PACKAGES_COLUMN_TEXT, text,
-			    PACKAGES_COLUMN_SUMMARY, summary,
-			    PACKAGES_COLUMN_ID, package_id,
-			    PACKAGES_COLUMN_IMAGE, gpk_application_state_get_icon (state),
-			    -1);
+		pk_bitfield_add (state, GPK_PACKAGE_STATE_COLLECTION);
+
+	/* the text is only formatted when the row is drawn */
+	gpk_package_model_add_package (priv->packages_store, item, state);
+	if (!priv->profile_first_row) {
+		priv->profile_first_row = TRUE;
+		gpk_profile_mark ("first-row");
+	}
+	gpk_package_model_set_match (priv->packages_store, package_id,
+				     GPOINTER_TO_UINT (g_hash_table_lookup (priv->search_matches, package_id)));
+
+	/* the size is only known from the details */
+	details = g_hash_table_lookup (priv->details_cache, package_id);
+	if (details != NULL)
+		gpk_package_model_set_size (priv->packages_store, package_id,
+					    pk_details_get_size (details));
+}
+
+static guint
+gpk_application_search_flush (GpkApplicationPrivate *priv, guint max_items)
+{
+	guint i;
+	guint len;
+	PkPackage *item;
+
+	/* add the oldest packages first */
+	len = MIN (priv->search_pending->len, max_items);
+	for (i = 0; i < len; i++) {
+		item = g_ptr_array_index (priv->search_pending, i);
+		gpk_application_add_item_to_results (priv, item);
+	}
+	g_ptr_array_remove_range (priv->search_pending, 0, len);
+	if (len > 0)
+		gpk_application_update_facet_counts (priv);
+	return priv->search_pending->len;
+}
+
+static gboolean
+gpk_application_search_flush_cb (GpkApplicationPrivate *priv)
+{
+	/* keep going until the backlog is empty */
+	if (gpk_application_search_flush (priv, GPK_APPLICATION_SEARCH_FLUSH_MAX) > 0)
+		return TRUE;
+	priv->search_flush_id = 0;
+	return FALSE;
+}
+
+static void
+gpk_application_search_queue_package (GpkApplicationPrivate *priv, PkPackage *package)
+{
+	const gchar *package_id;
+
+	/* a cancelled search can still emit a few packages */
+	if (package == NULL || g_cancellable_is_cancelled (priv->search_cancellable))
+		return;
+
+	/* already shown */
+	package_id = pk_package_get_id (package);
+	if (g_hash_table_contains (priv->search_seen, package_id))
+		return;
+	g_hash_table_add (priv->search_seen, g_strdup (package_id));
+	g_ptr_array_add (priv->search_pending, g_object_ref (package));
+
+	/* add in batches, rather than one row at a time */
+	if (priv->search_flush_id > 0)
+		return;
+	priv->search_flush_id =
+		g_timeout_add (GPK_APPLICATION_SEARCH_FLUSH_INTERVAL,
+			       (GSourceFunc) gpk_application_search_flush_cb, priv);
+	g_source_set_name_by_id (priv->search_flush_id,
+				 "[GpkApplication] search-flush");
+}
+
+static void
+gpk_application_search_queue_match (GpkApplicationPrivate *priv, PkPackage *package, GpkSearchType type)
+{
+	PkBitfield match;
+	const gchar *package_id;
+
+	if (package == NULL || g_cancellable_is_cancelled (priv->search_cancellable))
+		return;
+
+	/* the first search to find it adds the row, the others tag it; the
+	 * search types are in the same order as GpkPackageMatch */
+	package_id = pk_package_get_id (package);
+	match = GPOINTER_TO_UINT (g_hash_table_lookup (priv->search_matches, package_id));
+	if (pk_bitfield_contain (match, type))
+		return;
+	pk_bitfield_add (match, type);
+	g_hash_table_insert (priv->search_matches, g_strdup (package_id), GUINT_TO_POINTER (match));
+	if (g_hash_table_contains (priv->search_seen, package_id))
+		gpk_package_model_set_match (priv->packages_store, package_id, match);
+	else
+		gpk_application_search_queue_package (priv, package);
+}
+
+typedef struct {
+	GpkApplicationPrivate	*priv;
+	GCancellable		*cancellable;
+	gchar			*cache_key;
+	GpkSearchMode		 mode;
+	GpkSearchType		 type;
+	PkBitfield		 filters;
+	gchar			**values;
+	gboolean		 is_part;	/* one of the searches for GPK_SEARCH_ALL */
+} GpkApplicationSearch;
+
+static gchar *
+gpk_application_search_get_cache_key (GpkApplicationPrivate *priv, GpkSearchType type)
+{
+	const gchar *term;
+
+	if (priv->search_mode == GPK_MODE_NAME_DETAILS_FILE)
+		term = priv->search_text;
+	else if (priv->search_mode == GPK_MODE_GROUP)
+		term = priv->search_group;
+	else if (priv->search_mode == GPK_MODE_ALL_PACKAGES)
+		term = "";
+	else
+		return NULL;
+	return g_strdup_printf ("%u;%u;%s",
+				priv->search_mode, type, term);
+}
+
+static GpkApplicationSearch *
+gpk_application_search_new (GpkApplicationPrivate *priv)
+{
+	GpkApplicationSearch *search;
+
+	/* copied, as the search might be queued behind others */
+	search = g_new0 (GpkApplicationSearch, 1);
+	search->priv = priv;
+	search->cache_key = gpk_application_search_get_cache_key (priv, priv->search_type);
+	search->mode = priv->search_mode;
+	search->type = priv->search_type;
+	/* the facets are applied locally, so the daemon is asked for everything */
+	search->filters = pk_bitfield_value (PK_FILTER_ENUM_NONE);
+	if (priv->search_mode == GPK_MODE_NAME_DETAILS_FILE)
+		search->values = g_strsplit (priv->search_text, " ", -1);
+	else if (priv->search_mode == GPK_MODE_GROUP)
+		search->values = g_strsplit (priv->search_group, " ", -1);
+	return search;
+}
+
+static void
+gpk_application_search_free (GpkApplicationSearch *search)
+{
+	if (search->cancellable != NULL)
+		g_object_unref (search->cancellable);
+	g_free (search->cache_key);
+	g_strfreev (search->values);
+	g_free (search);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GpkApplicationSearch, gpk_application_search_free)
+
+static void
+gpk_application_search_progress_cb (PkProgress *progress, PkProgressType type, GpkApplicationSearch *search)
+{
+	g_autoptr(PkPackage) package = NULL;
+
+	/* show results as soon as the daemon emits them */
+	if (type == PK_PROGRESS_TYPE_PACKAGE) {
+		if (g_cancellable_is_cancelled (search->cancellable))
+			return;
+
+		/* every package is paged from the catalog when it is done */
+		if (search->mode == GPK_MODE_ALL_PACKAGES)
+			return;
+		g_object_get (progress,
+			      "package", &package,
+			      NULL);
+		if (search->is_part)
+			gpk_application_search_queue_match (search->priv, package, search->type);
+		else
+			gpk_application_search_queue_package (search->priv, package);
+		return;
+	}
+	gpk_application_progress_cb (progress, type, search->priv);
+}
+
+static void
+gpk_application_suggest_names (GpkApplicationPrivate *priv)
+{
+	guint i;
+	g_auto(GStrv) names = NULL;
+
+	/* a mistyped file name is not close to a package name */
+	if (priv->name_index == NULL ||
+	    priv->search_mode != GPK_MODE_NAME_DETAILS_FILE ||
+	    priv->search_type == GPK_SEARCH_FILE ||
+	    priv->search_text == NULL ||
+	    strchr (priv->search_text, ' ') != NULL)
+		return;
 
-	/* only process every n events else we re-order too many times */
-	if (package_cnt++ % 200 == 0) {
-		while (gtk_events_pending ())
-			gtk_main_iteration ();
+	names = gpk_name_index_search (priv->name_index, priv->search_text,
+				       GPK_APPLICATION_SUGGEST_DISTANCE,
+				       GPK_APPLICATION_SUGGEST_MAX);
+	for (i = 0; names[i] != NULL; i++) {
+		g_autofree gchar *escaped = NULL;
+		g_autofree gchar *text = NULL;
+		escaped = g_markup_escape_text (names[i], -1);
+		/* TRANSLATORS: a package name close to what was searched for, which
+		 * is searched for when clicked */
+		text = g_strdup_printf (_("Did you mean <b>%s</b>?"), escaped);
+		gpk_package_model_add_suggestion (priv->packages_store, "edit-find", text, names[i]);
 	}
 }
 
@@ -1080,9 +1847,7 @@ gpk_application_suggest_better_search (GpkApplicationPrivate *priv)
 	const gchar *message = NULL;
 	/* TRANSLATORS: no results were found for this search */
 	const gchar *title = _("No results were found.");
-	GtkTreeIter iter;
 	g_autofree gchar *text = NULL;
-	PkBitfield state = 0;
 
 	if (priv->search_mode == GPK_MODE_GROUP ||
 	    priv->search_mode == GPK_MODE_ALL_PACKAGES) {
@@ -1102,22 +1867,8 @@ gpk_application_suggest_better_search (GpkApplicationPrivate *priv)
 	}
 
 	text = g_strdup_printf ("%s\n%s", title, message);
-	gtk_list_store_append (priv->packages_store, &iter);
-	gtk_list_store_set (priv->packages_store, &iter,
-			    PACKAGES_COLUMN_STATE, state,
-			    PACKAGES_COLUMN_CHECKBOX, FALSE,
-			    PACKAGES_COLUMN_CHECKBOX_VISIBLE, FALSE,
-			    PACKAGES_COLUMN_TEXT, text,
-			    PACKAGES_COLUMN_IMAGE, "system-search",
-			    PACKAGES_COLUMN_ID, NULL,
-			    -1);
-}
-
-static gboolean
-gpk_application_perform_search_idle_cb (GpkApplicationPrivate *priv)
-{
-	gpk_application_perform_search (priv);
-	return FALSE;
+	gpk_package_model_add_message (priv->packages_store, "system-search", text);
+	gpk_application_suggest_names (priv);
 }
 
 /**
@@ -1127,143 +1878,1162 @@ gpk_application_perform_search_idle_cb (GpkApplicationPrivate *priv)
  * results we cancel the search and start getting the package details.
  **/
 static void
-gpk_application_select_exact_match (GpkApplicationPrivate *priv, const gchar *text)
+gpk_application_select_exact_match (GpkApplicationPrivate *priv)
 {
 	GtkTreeView *treeview;
-	gboolean valid;
 	GtkTreeIter iter;
 	GtkTreePath *path;
-	GtkTreeModel *model;
-	GtkTreeSelection *selection = NULL;
+	GtkTreeSelection *selection;
+
+	/* no exact match, the model scored the rows as they were added */
+	if (!gpk_package_model_find_exact_match (priv->packages_store, &iter))
+		return;
 
-	/* get the first iter in the array */
+	/* select and scroll */
 	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
-	model = gtk_tree_view_get_model (treeview);
-	valid = gtk_tree_model_get_iter_first (model, &iter);
+	selection = gtk_tree_view_get_selection (treeview);
+	gtk_tree_selection_select_iter (selection, &iter);
+	path = gtk_tree_model_get_path (GTK_TREE_MODEL (priv->packages_store), &iter);
+	gtk_tree_view_scroll_to_cell (treeview, path, NULL, FALSE, 0.5f, 0.5f);
+	gtk_tree_path_free (path);
+}
 
-	/* for all items in treeview */
-	while (valid) {
-		g_autofree gchar *package_id = NULL;
-		gtk_tree_model_get (model, &iter, PACKAGES_COLUMN_ID, &package_id, -1);
-		if (package_id != NULL) {
-			g_auto(GStrv) split = NULL;
-			/* exact match, so select and scroll */
-			split = pk_package_id_split (package_id);
-			if (g_strcmp0 (split[PK_PACKAGE_ID_NAME], text) == 0) {
-				selection = gtk_tree_view_get_selection (treeview);
-				gtk_tree_selection_select_iter (selection, &iter);
-				path = gtk_tree_model_get_path (model, &iter);
-				gtk_tree_view_scroll_to_cell (treeview, path, NULL, FALSE, 0.5f, 0.5f);
-				gtk_tree_path_free (path);
-			}
-
-			/* no point continuing for a second match */
-			if (selection != NULL)
-				break;
-		}
-		valid = gtk_tree_model_iter_next (model, &iter);
-	}
+static void
+gpk_application_set_button_find_sensitivity (GpkApplicationPrivate *priv)
+{
+	GtkWidget *widget;
+
+	/* only sensitive if not in the middle of a search, unless typing
+	 * is what replaces the search that is running */
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "entry_text"));
+	gtk_widget_set_sensitive (widget, !priv->search_in_progress ||
+				  g_settings_get_boolean (priv->settings, GPK_SETTINGS_SEARCH_AS_YOU_TYPE));
 }
 
 static void
-gpk_application_cancel_cb (GtkWidget *button_widget, GpkApplicationPrivate *priv)
+gpk_application_search_done (GpkApplicationPrivate *priv)
 {
-	g_cancellable_cancel (priv->cancellable);
+	GtkWidget *widget;
 
-	/* switch buttons around */
-	priv->search_mode = GPK_MODE_UNKNOWN;
+	/* nothing more is coming */
+	if (priv->search_flush_id > 0) {
+		g_source_remove (priv->search_flush_id);
+		priv->search_flush_id = 0;
+	}
+	g_ptr_array_set_size (priv->search_pending, 0);
+
+	/* mark find button sensitive */
+	priv->search_in_progress = FALSE;
+	gpk_application_set_button_find_sensitivity (priv);
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "scrolledwindow_groups"));
+	gtk_widget_set_sensitive (widget, TRUE);
 }
 
 static void
-gpk_application_set_button_find_sensitivity (GpkApplicationPrivate *priv)
+gpk_application_search_finished (GpkApplicationPrivate *priv)
 {
 	GtkWidget *widget;
 
-	/* only sensitive if not in the middle of a search */
+	/* were there no entries found? */
+	if (!priv->has_package)
+		gpk_application_suggest_better_search (priv);
+	gpk_application_update_facet_counts (priv);
+
+	/* if there is an exact match, select it */
+	gpk_application_select_exact_match (priv);
+
+	/* a longer name can be found in these results without the daemon */
+	if (priv->search_mode == GPK_MODE_NAME_DETAILS_FILE &&
+	    priv->search_type == GPK_SEARCH_NAME) {
+		g_free (priv->search_text_narrow);
+		priv->search_text_narrow = g_strdup (priv->search_text);
+	}
+
+	/* focus back to the text extry */
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "entry_text"));
+	gtk_widget_grab_focus (widget);
+
+	/* reset UI */
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "treeview_groups"));
+	gtk_widget_set_sensitive (widget, TRUE);
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "textview_description"));
+	gtk_widget_set_sensitive (widget, TRUE);
 	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "entry_text"));
-	gtk_widget_set_sensitive (widget, !priv->search_in_progress);
+	gtk_widget_set_sensitive (widget, TRUE);
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_apply"));
+	gtk_widget_set_sensitive (widget, TRUE);
+
+	/* get the details of the rows that are now shown */
+	gpk_application_details_schedule_prefetch (priv);
+	gpk_profile_mark ("complete");
+}
+
+static PkRoleEnum
+gpk_application_search_type_to_role (GpkSearchType type)
+{
+	if (type == GPK_SEARCH_NAME)
+		return PK_ROLE_ENUM_SEARCH_NAME;
+	if (type == GPK_SEARCH_DETAILS)
+		return PK_ROLE_ENUM_SEARCH_DETAILS;
+	if (type == GPK_SEARCH_FILE)
+		return PK_ROLE_ENUM_SEARCH_FILE;
+	return PK_ROLE_ENUM_UNKNOWN;
+}
+
+static gboolean
+gpk_application_search_from_cache_all (GpkApplicationPrivate *priv)
+{
+	GPtrArray *parts[GPK_SEARCH_ALL] = { NULL };
+	GpkSearchType type;
+	PkBitfield match;
+	PkPackage *item;
+	const gchar *package_id;
+	gboolean ret = FALSE;
+	guint found = 0;
+	guint i;
+	g_autoptr(GPtrArray) packages = NULL;
+
+	/* each part is cached on its own, so every one that would be
+	 * searched for is needed */
+	for (type = GPK_SEARCH_NAME; type < GPK_SEARCH_ALL; type++) {
+		g_autofree gchar *key = NULL;
+		if (!pk_bitfield_contain (priv->roles, gpk_application_search_type_to_role (type)))
+			continue;
+		key = gpk_application_search_get_cache_key (priv, type);
+		parts[type] = gpk_result_cache_lookup (priv->result_cache, key);
+		if (parts[type] == NULL)
+			goto out;
+		found++;
+	}
+	if (found == 0)
+		goto out;
+
+	/* merge them in the same way as when they were streamed */
+	g_debug ("using cached results for every search type");
+	packages = g_ptr_array_new ();
+	for (type = GPK_SEARCH_NAME; type < GPK_SEARCH_ALL; type++) {
+		if (parts[type] == NULL)
+			continue;
+		for (i = 0; i < parts[type]->len; i++) {
+			item = g_ptr_array_index (parts[type], i);
+			package_id = pk_package_get_id (item);
+			match = GPOINTER_TO_UINT (g_hash_table_lookup (priv->search_matches, package_id));
+			if (match == 0)
+				g_ptr_array_add (packages, item);
+			pk_bitfield_add (match, type);
+			g_hash_table_insert (priv->search_matches, g_strdup (package_id),
+					     GUINT_TO_POINTER (match));
+		}
+	}
+	for (i = 0; i < packages->len; i++) {
+		item = g_ptr_array_index (packages, i);
+		g_hash_table_add (priv->search_seen, g_strdup (pk_package_get_id (item)));
+		gpk_application_add_item_to_results (priv, item);
+	}
+	gpk_application_search_finished (priv);
+	ret = TRUE;
+out:
+	for (type = GPK_SEARCH_NAME; type < GPK_SEARCH_ALL; type++) {
+		if (parts[type] != NULL)
+			g_ptr_array_unref (parts[type]);
+	}
+	return ret;
+}
+
+static gboolean
+gpk_application_search_from_cache (GpkApplicationPrivate *priv)
+{
+	PkPackage *item;
+	guint i;
+	g_autofree gchar *key = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+
+	if (priv->search_mode == GPK_MODE_NAME_DETAILS_FILE &&
+	    priv->search_type == GPK_SEARCH_ALL)
+		return gpk_application_search_from_cache_all (priv);
+	key = gpk_application_search_get_cache_key (priv, priv->search_type);
+	if (key == NULL)
+		return FALSE;
+	array = gpk_result_cache_lookup (priv->result_cache, key);
+	if (array == NULL)
+		return FALSE;
+
+	g_debug ("using cached results for %s", key);
+	for (i = 0; i < array->len; i++) {
+		item = g_ptr_array_index (array, i);
+		gpk_application_add_item_to_results (priv, item);
+	}
+	gpk_application_search_finished (priv);
+	return TRUE;
+}
+
+static gchar *
+gpk_application_get_cache_filename (const gchar *basename)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+				 "gnome-packagekit", basename, NULL);
+}
+
+static void
+gpk_application_details_index_save (GpkApplicationPrivate *priv)
+{
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *filename = NULL;
+
+	filename = gpk_application_get_cache_filename ("details-index");
+	if (!gpk_trigram_index_save (priv->details_index, filename, &error))
+		g_warning ("failed to save details index: %s", error->message);
+}
+
+static gboolean
+gpk_application_details_index_retry_cb (GpkApplicationPrivate *priv)
+{
+	priv->details_index_retry_id = 0;
+	gpk_application_details_index_next (priv);
+	return G_SOURCE_REMOVE;
+}
+
+/* the batch stays pending, and until it is done searches use the daemon */
+static void
+gpk_application_details_index_failed (GpkApplicationPrivate *priv)
+{
+	guint delay;
+
+	if (++priv->details_index_failures >= GPK_APPLICATION_DETAILS_INDEX_TRIES) {
+		g_warning ("giving up on the details index after %u failures",
+			   priv->details_index_failures);
+		return;
+	}
+	delay = GPK_APPLICATION_DETAILS_INDEX_RETRY << (priv->details_index_failures - 1);
+	g_debug ("getting the details again in %us", delay);
+	priv->details_index_retry_id =
+		g_timeout_add_seconds (delay, (GSourceFunc) gpk_application_details_index_retry_cb, priv);
 }
 
 static void
-gpk_application_search_cb (PkClient *client, GAsyncResult *res, GpkApplicationPrivate *priv)
+gpk_application_details_index_get_details_cb (PkClient *client, GAsyncResult *res, GpkApplicationPrivate *priv)
 {
 	g_autoptr(PkResults) results = NULL;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(PkError) error_code = NULL;
 	g_autoptr(GPtrArray) array = NULL;
-	PkPackage *item;
+	g_autoptr(GHashTable) descriptions = NULL;
+	PkDetails *item;
+	PkPackage *package;
+	gchar *package_id;
+	gchar *description;
 	guint i;
-	GtkWidget *widget;
-	GtkWindow *window;
+	guint len;
 
 	/* get the results */
+	priv->details_index_running = FALSE;
 	results = pk_client_generic_finish (client, res, &error);
+
+	/* the catalog changed while we were waiting */
+	if (priv->details_index_again) {
+		priv->details_index_again = FALSE;
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			gpk_application_details_index_update (priv);
+		return;
+	}
 	if (results == NULL) {
-		g_warning ("failed to search: %s", error->message);
-		goto out;
+		g_warning ("failed to get details: %s", error->message);
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			gpk_application_details_index_failed (priv);
+		return;
 	}
 
-	/* check error code */
+	/* check error code, this is never shown to the user */
 	error_code = pk_results_get_error_code (results);
 	if (error_code != NULL) {
-		g_warning ("failed to search: %s, %s", pk_error_enum_to_string (pk_error_get_code (error_code)), pk_error_get_details (error_code));
-
-		/* if obvious message, don't tell the user */
-		if (pk_error_get_code (error_code) != PK_ERROR_ENUM_TRANSACTION_CANCELLED) {
-			window = GTK_WINDOW (gtk_builder_get_object (priv->builder, "window_manager"));
-			gpk_error_dialog_modal (window, gpk_error_enum_to_localised_text (pk_error_get_code (error_code)),
-						gpk_error_enum_to_localised_message (pk_error_get_code (error_code)), pk_error_get_details (error_code));
-		}
-		goto out;
+		g_warning ("failed to get details: %s, %s", pk_error_enum_to_string (pk_error_get_code (error_code)), pk_error_get_details (error_code));
+		gpk_application_details_index_failed (priv);
+		return;
 	}
+	priv->details_index_failures = 0;
 
-	/* get data */
-	array = pk_results_get_package_array (results);
+	descriptions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	array = pk_results_get_details_array (results);
 	for (i = 0; i < array->len; i++) {
 		item = g_ptr_array_index (array, i);
-		gpk_application_add_item_to_results (priv, item);
+		g_object_get (item,
+			      "package-id", &package_id,
+			      "description", &description,
+			      NULL);
+		g_hash_table_insert (descriptions, package_id, description);
 	}
 
-	/* were there no entries found? */
-	if (!priv->has_package)
-		gpk_application_suggest_better_search (priv);
+	/* add the whole batch, even packages the backend had nothing for */
+	len = MIN (priv->details_index_pending->len, GPK_APPLICATION_DETAILS_INDEX_BATCH);
+	for (i = 0; i < len; i++) {
+		package = g_ptr_array_index (priv->details_index_pending, i);
+		gpk_trigram_index_add (priv->details_index,
+				       pk_package_get_id (package),
+				       pk_package_get_summary (package),
+				       g_hash_table_lookup (descriptions, pk_package_get_id (package)));
+	}
+	g_ptr_array_remove_range (priv->details_index_pending, 0, len);
 
-	/* if there is an exact match, select it */
-	gpk_application_select_exact_match (priv, priv->search_text);
+	/* save now and then in case we are closed */
+	if (++priv->details_index_batches % GPK_APPLICATION_DETAILS_INDEX_SAVE == 0 ||
+	    priv->details_index_pending->len == 0)
+		gpk_application_details_index_save (priv);
+	gpk_application_details_index_next (priv);
+}
+
+static void
+gpk_application_details_index_start (GCancellable *cancellable,
+				     GAsyncReadyCallback callback, gpointer callback_data,
+				     GpkApplicationPrivate *priv)
+{
+	PkPackage *package;
+	guint i;
+	guint len;
+	g_auto(GStrv) package_ids = NULL;
+
+	/* a quiet transaction, the user did not ask for this */
+	len = MIN (priv->details_index_pending->len, GPK_APPLICATION_DETAILS_INDEX_BATCH);
+	package_ids = g_new0 (gchar *, len + 1);
+	for (i = 0; i < len; i++) {
+		package = g_ptr_array_index (priv->details_index_pending, i);
+		package_ids[i] = g_strdup (pk_package_get_id (package));
+	}
+	pk_client_get_details_async (priv->catalog_client, package_ids, cancellable,
+				     NULL, NULL,
+				     callback, callback_data);
+}
+
+static void
+gpk_application_details_index_next (GpkApplicationPrivate *priv)
+{
+	if (priv->details_index_pending->len == 0) {
+		g_debug ("details index has %u packages",
+			 gpk_trigram_index_get_size (priv->details_index));
+		priv->details_index_complete = TRUE;
+		return;
+	}
+
+	/* only runs when nothing the user asked for is waiting */
+	priv->details_index_running = TRUE;
+	gpk_scheduler_push (priv->scheduler, GPK_SCHEDULER_KIND_INDEX,
+			    (GpkSchedulerFunc) gpk_application_details_index_start,
+			    (GAsyncReadyCallback) gpk_application_details_index_get_details_cb,
+			    priv, NULL);
+}
+
+static void
+gpk_application_details_index_update (GpkApplicationPrivate *priv)
+{
+	PkPackage *package;
+	guint i;
+	g_autoptr(GHashTable) package_ids = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+
+	/* a new catalog, or turning the index off, starts again */
+	if (priv->details_index_retry_id != 0) {
+		g_source_remove (priv->details_index_retry_id);
+		priv->details_index_retry_id = 0;
+	}
+	priv->details_index_failures = 0;
+
+	/* optional, as this gets the details of every package */
+	if (!g_settings_get_boolean (priv->settings, GPK_SETTINGS_DETAILS_INDEX) ||
+	    !pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_GET_DETAILS))
+		return;
+	if (priv->details_index_running) {
+		priv->details_index_again = TRUE;
+		return;
+	}
+
+	/* forget packages that have gone, and find the ones we are missing */
+	packages = gpk_catalog_get_packages (priv->catalog);
+	package_ids = g_hash_table_new (g_str_hash, g_str_equal);
+	g_ptr_array_set_size (priv->details_index_pending, 0);
+	for (i = 0; i < packages->len; i++) {
+		package = g_ptr_array_index (packages, i);
+		g_hash_table_add (package_ids, (gpointer) pk_package_get_id (package));
+		if (!gpk_trigram_index_contains (priv->details_index, pk_package_get_id (package)))
+			g_ptr_array_add (priv->details_index_pending, g_object_ref (package));
+	}
+	gpk_trigram_index_prune (priv->details_index, package_ids);
+	g_debug ("details index is missing %u packages", priv->details_index_pending->len);
+	priv->details_index_complete = FALSE;
+	priv->details_index_batches = 0;
+	gpk_application_details_index_next (priv);
+}
+
+static gboolean
+gpk_application_search_from_details_index (GpkApplicationPrivate *priv)
+{
+	PkPackage *item;
+	guint i;
+	g_auto(GStrv) searches = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+
+	if (priv->search_mode != GPK_MODE_NAME_DETAILS_FILE ||
+	    priv->search_type != GPK_SEARCH_DETAILS ||
+	    _g_strzero (priv->search_text))
+		return FALSE;
+
+	/* only when every package in the catalog is in the index */
+	if (!priv->details_index_complete || priv->catalog_stale ||
+	    gpk_catalog_get_filters (priv->catalog) != pk_bitfield_value (PK_FILTER_ENUM_NONE))
+		return FALSE;
+
+	searches = g_strsplit (priv->search_text, " ", -1);
+	array = gpk_trigram_index_search (priv->details_index, searches);
+	g_debug ("found %u packages for %s in the details index", array->len, priv->search_text);
+	for (i = 0; i < array->len; i++) {
+		item = g_ptr_array_index (array, i);
+		gpk_application_add_item_to_results (priv, item);
+	}
+	gpk_application_search_finished (priv);
+	return TRUE;
+}
+
+static void
+gpk_application_name_index_cb (GObject *source, GAsyncResult *res, GpkApplicationPrivate *priv)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GpkNameIndex) name_index = NULL;
+
+	name_index = gpk_name_index_new_finish (res, &error);
+	if (name_index == NULL) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("failed to build name index: %s", error->message);
+		return;
+	}
+	g_debug ("name index built with %u names",
+		 gpk_name_index_get_size (name_index));
+	if (priv->name_index != NULL)
+		g_object_unref (priv->name_index);
+	priv->name_index = g_steal_pointer (&name_index);
+}
+
+static void
+gpk_application_name_index_update (GpkApplicationPrivate *priv)
+{
+	g_auto(GStrv) names = NULL;
+
+	/* the old index is good enough until the new one is ready */
+	if (priv->name_index_cancellable != NULL) {
+		g_cancellable_cancel (priv->name_index_cancellable);
+		g_object_unref (priv->name_index_cancellable);
+	}
+	priv->name_index_cancellable = g_cancellable_new ();
+	names = gpk_catalog_get_names (priv->catalog);
+	gpk_name_index_new_async (names, priv->name_index_cancellable,
+				  (GAsyncReadyCallback) gpk_application_name_index_cb,
+				  priv);
+}
+
+static gboolean
+gpk_application_catalog_replace (GpkApplicationPrivate *priv, GPtrArray *array, PkBitfield filters)
+{
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *filename = NULL;
+
+	/* replace the catalog on disk, then use the new one */
+	filename = gpk_application_get_cache_filename ("catalog");
+	if (!gpk_catalog_write (filename, array, filters, &error)) {
+		g_warning ("failed to write catalog: %s", error->message);
+		return FALSE;
+	}
+	if (!gpk_catalog_load (priv->catalog, filename, &error)) {
+		g_warning ("failed to load catalog: %s", error->message);
+		return FALSE;
+	}
+	priv->catalog_stale = FALSE;
+	g_debug ("catalog rebuilt with %u packages", array->len);
+	gpk_application_details_index_update (priv);
+	gpk_application_name_index_update (priv);
+
+	/* the pages already shown came from the old catalog */
+	if (priv->all_packages_paged)
+		gpk_application_all_packages_reload (priv);
+	return TRUE;
+}
+
+/* the search from --search is profiled rather than starting up */
+static void
+gpk_application_catalog_ready (GpkApplicationPrivate *priv)
+{
+	GtkEntry *entry;
+	g_autofree gchar *text = NULL;
+
+	if (priv->profile_search == NULL) {
+		gpk_profile_mark ("complete");
+		return;
+	}
+	text = g_steal_pointer (&priv->profile_search);
+	g_debug ("searching for %s", text);
+	entry = GTK_ENTRY (gtk_builder_get_object (priv->builder, "entry_text"));
+	gtk_entry_set_text (entry, text);
+	gpk_application_find_cb (NULL, priv);
+}
+
+static void
+gpk_application_catalog_get_packages_cb (PkClient *client, GAsyncResult *res, GpkApplicationPrivate *priv)
+{
+	g_autoptr(PkResults) results = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(PkError) error_code = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+
+	/* get the results */
+	priv->catalog_rebuilding = FALSE;
+	results = pk_client_generic_finish (client, res, &error);
+
+	/* something changed while we were getting the packages, so get
+	 * them again even if this failed */
+	if (priv->catalog_rebuild_again) {
+		priv->catalog_rebuild_again = FALSE;
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			gpk_application_catalog_rebuild (priv);
+		return;
+	}
+	if (results == NULL) {
+		g_warning ("failed to get packages: %s", error->message);
+		return;
+	}
+
+	/* check error code, this is never shown to the user */
+	error_code = pk_results_get_error_code (results);
+	if (error_code != NULL) {
+		g_warning ("failed to get packages: %s, %s", pk_error_enum_to_string (pk_error_get_code (error_code)), pk_error_get_details (error_code));
+		return;
+	}
+
+	array = pk_results_get_package_array (results);
+	gpk_application_catalog_replace (priv, array, pk_bitfield_value (PK_FILTER_ENUM_NONE));
+	gpk_application_catalog_ready (priv);
+}
+
+static void
+gpk_application_catalog_start (GCancellable *cancellable,
+			       GAsyncReadyCallback callback, gpointer callback_data,
+			       GpkApplicationPrivate *priv)
+{
+	/* a quiet transaction, the user did not ask for this */
+	pk_client_get_packages_async (priv->catalog_client,
+				      pk_bitfield_value (PK_FILTER_ENUM_NONE), cancellable,
+				      NULL, NULL,
+				      callback, callback_data);
+}
+
+static void
+gpk_application_catalog_rebuild (GpkApplicationPrivate *priv)
+{
+	if (!pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_GET_PACKAGES))
+		return;
+
+	/* only ever get the packages once at a time */
+	if (priv->catalog_rebuilding) {
+		priv->catalog_rebuild_again = TRUE;
+		return;
+	}
+
+	priv->catalog_rebuilding = TRUE;
+	gpk_scheduler_push (priv->scheduler, GPK_SCHEDULER_KIND_INDEX,
+			    (GpkSchedulerFunc) gpk_application_catalog_start,
+			    (GAsyncReadyCallback) gpk_application_catalog_get_packages_cb,
+			    priv, NULL);
+}
+
+static void
+gpk_application_catalog_setup (GpkApplicationPrivate *priv)
+{
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *filename = NULL;
+
+	/* load what was written last time, and refresh if it is old */
+	filename = gpk_application_get_cache_filename ("catalog");
+	if (!gpk_catalog_load (priv->catalog, filename, &error)) {
+		g_debug ("no catalog: %s", error->message);
+		priv->catalog_stale = TRUE;
+	} else {
+		if (gpk_catalog_get_age (priv->catalog) > GPK_APPLICATION_CATALOG_MAX_AGE) {
+			g_debug ("catalog is too old");
+			priv->catalog_stale = TRUE;
+		}
+		gpk_application_name_index_update (priv);
+	}
+
+	/* the details index is checked against the catalog when it is ready */
+	if (g_settings_get_boolean (priv->settings, GPK_SETTINGS_DETAILS_INDEX)) {
+		g_autofree gchar *index_filename = NULL;
+		g_autoptr(GError) error_local = NULL;
+		index_filename = gpk_application_get_cache_filename ("details-index");
+		if (!gpk_trigram_index_load (priv->details_index, index_filename, &error_local))
+			g_debug ("no details index: %s", error_local->message);
+	}
+	if (priv->catalog_stale) {
+		gpk_application_catalog_rebuild (priv);
+	} else {
+		gpk_application_details_index_update (priv);
+		gpk_application_catalog_ready (priv);
+	}
+}
+
+/* the package at the top of the view, which is kept there as pages come and go */
+static gchar *
+gpk_application_all_packages_get_anchor (GpkApplicationPrivate *priv)
+{
+	GtkTreeIter iter;
+	GtkTreePath *path;
+	GtkTreeView *treeview;
+	gchar *package_id = NULL;
+
+	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
+	if (!gtk_tree_view_get_visible_range (treeview, &path, NULL))
+		return NULL;
+	if (gtk_tree_model_get_iter (GTK_TREE_MODEL (priv->packages_store), &iter, path)) {
+		gtk_tree_model_get (GTK_TREE_MODEL (priv->packages_store), &iter,
+				    GPK_PACKAGE_MODEL_COLUMN_ID, &package_id,
+				    -1);
+	}
+	gtk_tree_path_free (path);
+	return package_id;
+}
+
+/* the row the anchor is in now, or -1 if it is not shown */
+static gint
+gpk_application_all_packages_get_row (GpkApplicationPrivate *priv, const gchar *package_id)
+{
+	GtkTreeIter iter;
+	GtkTreePath *path;
+	gint row;
+
+	if (package_id == NULL ||
+	    !gpk_package_model_find_by_id (priv->packages_store, package_id, &iter))
+		return -1;
+	path = gtk_tree_model_get_path (GTK_TREE_MODEL (priv->packages_store), &iter);
+	row = gtk_tree_path_get_indices (path)[0];
+	gtk_tree_path_free (path);
+	return row;
+}
+
+static void
+gpk_application_all_packages_set_anchor (GpkApplicationPrivate *priv, const gchar *package_id)
+{
+	GtkTreePath *path;
+	GtkTreeView *treeview;
+	gint row;
+
+	row = gpk_application_all_packages_get_row (priv, package_id);
+	if (row < 0)
+		return;
+	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
+	path = gtk_tree_path_new_from_indices (row, -1);
+	gtk_tree_view_scroll_to_cell (treeview, path, NULL, TRUE, 0.0f, 0.0f);
+	gtk_tree_path_free (path);
+}
+
+static GPtrArray *
+gpk_application_all_packages_get_selected (GpkApplicationPrivate *priv)
+{
+	GList *l;
+	GList *rows;
+	GPtrArray *package_ids;
+	GtkTreeIter iter;
+	GtkTreeModel *model = GTK_TREE_MODEL (priv->packages_store);
+	GtkTreeView *treeview;
+	gchar *package_id;
+
+	package_ids = g_ptr_array_new_with_free_func (g_free);
+	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
+	rows = gtk_tree_selection_get_selected_rows (gtk_tree_view_get_selection (treeview), NULL);
+	for (l = rows; l != NULL; l = l->next) {
+		if (!gtk_tree_model_get_iter (model, &iter, l->data))
+			continue;
+		package_id = NULL;
+		gtk_tree_model_get (model, &iter,
+				    GPK_PACKAGE_MODEL_COLUMN_ID, &package_id,
+				    -1);
+		if (package_id != NULL)
+			g_ptr_array_add (package_ids, package_id);
+	}
+	g_list_free_full (rows, (GDestroyNotify) gtk_tree_path_free);
+	return package_ids;
+}
+
+/* selects and scrolls to what was there before the model was filled again */
+static void
+gpk_application_all_packages_restore (GpkApplicationPrivate *priv,
+				      const gchar *anchor,
+				      GPtrArray *selected)
+{
+	GtkTreeIter iter;
+	GtkTreeSelection *selection;
+	GtkTreeView *treeview;
+	guint i;
+
+	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
+	selection = gtk_tree_view_get_selection (treeview);
+	for (i = 0; i < selected->len; i++) {
+		if (gpk_package_model_find_by_id (priv->packages_store,
+						  g_ptr_array_index (selected, i), &iter))
+			gtk_tree_selection_select_iter (selection, &iter);
+	}
+	gpk_application_all_packages_set_anchor (priv, anchor);
+	gpk_application_update_facet_counts (priv);
+}
+
+/* adds the next page to the end, returning %TRUE if any rows can be seen */
+static gboolean
+gpk_application_all_packages_add_page (GpkApplicationPrivate *priv)
+{
+	PkPackage *item;
+	guint i;
+	guint size;
+	g_autoptr(GPtrArray) array = NULL;
+
+	size = gpk_package_model_get_size (priv->packages_store);
+	array = gpk_catalog_get_page (priv->catalog, priv->all_packages_shown,
+				      GPK_APPLICATION_ALL_PACKAGES_PAGE);
+	priv->all_packages_shown = MIN (priv->all_packages_shown + GPK_APPLICATION_ALL_PACKAGES_PAGE,
+					gpk_catalog_get_size (priv->catalog));
+	for (i = 0; i < array->len; i++) {
+		item = g_ptr_array_index (array, i);
+		gpk_application_add_item_to_results (priv, item);
+	}
+	return gpk_package_model_get_size (priv->packages_store) > size;
+}
+
+static gboolean
+gpk_application_all_packages_keep_cb (PkPackage *package, gpointer user_data)
+{
+	GHashTable *dropped = (GHashTable *) user_data;
+	return package == NULL || !g_hash_table_contains (dropped, pk_package_get_id (package));
+}
+
+/* removes the rows of the page at @start from the model */
+static void
+gpk_application_all_packages_drop (GpkApplicationPrivate *priv, guint start)
+{
+	PkPackage *item;
+	guint i;
+	g_autoptr(GHashTable) dropped = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+
+	array = gpk_catalog_get_page (priv->catalog, start, GPK_APPLICATION_ALL_PACKAGES_PAGE);
+	dropped = g_hash_table_new (g_str_hash, g_str_equal);
+	for (i = 0; i < array->len; i++) {
+		item = g_ptr_array_index (array, i);
+		g_hash_table_add (dropped, (gpointer) pk_package_get_id (item));
+	}
+	gpk_package_model_retain (priv->packages_store,
+				  gpk_application_all_packages_keep_cb,
+				  dropped);
+}
+
+static guint
+gpk_application_all_packages_get_pages (GpkApplicationPrivate *priv)
+{
+	return (priv->all_packages_shown - priv->all_packages_start +
+		GPK_APPLICATION_ALL_PACKAGES_PAGE - 1) / GPK_APPLICATION_ALL_PACKAGES_PAGE;
+}
+
+/* fills the model with the pages from @start up to @end, as the model can
+ * only add rows after the ones it already has */
+static void
+gpk_application_all_packages_load (GpkApplicationPrivate *priv, guint start, guint end)
+{
+	gpk_package_model_clear (priv->packages_store);
+	priv->all_packages_start = start;
+	priv->all_packages_shown = start;
+	end = MIN (end, gpk_catalog_get_size (priv->catalog));
+	while (priv->all_packages_shown < end)
+		gpk_application_all_packages_add_page (priv);
+}
+
+/**
+ * gpk_application_all_packages_page:
+ *
+ * Adds the next page of "All packages" from the catalog, so only the rows
+ * the user has scrolled to are ever created, and drops the pages that
+ * have been scrolled well past.
+ *
+ * Return value: %TRUE if any rows were added
+ **/
+static gboolean
+gpk_application_all_packages_page (GpkApplicationPrivate *priv)
+{
+	gboolean dropped = FALSE;
+	gboolean ret = FALSE;
+	gint row;
+	g_autofree gchar *anchor = NULL;
+
+	if (!priv->all_packages_paged)
+		return FALSE;
+
+	/* keep going if the facets hide a whole page */
+	while (!ret && priv->all_packages_shown < gpk_catalog_get_size (priv->catalog))
+		ret = gpk_application_all_packages_add_page (priv);
+
+	/* a page has no more rows than this, so a page of rows is still
+	 * left above the view to scroll back into */
+	anchor = gpk_application_all_packages_get_anchor (priv);
+	row = gpk_application_all_packages_get_row (priv, anchor);
+	while (gpk_application_all_packages_get_pages (priv) > GPK_APPLICATION_ALL_PACKAGES_WINDOW &&
+	       row >= 2 * GPK_APPLICATION_ALL_PACKAGES_PAGE) {
+		gpk_application_all_packages_drop (priv, priv->all_packages_start);
+		priv->all_packages_start += GPK_APPLICATION_ALL_PACKAGES_PAGE;
+		row = gpk_application_all_packages_get_row (priv, anchor);
+		dropped = TRUE;
+	}
+	if (dropped)
+		gpk_application_all_packages_set_anchor (priv, anchor);
+	gpk_application_update_facet_counts (priv);
+	return ret;
+}
+
+/**
+ * gpk_application_all_packages_page_back:
+ *
+ * Loads the pages that were dropped on the way down again as the view is
+ * scrolled back up, and drops the ones now well below it.
+ **/
+static void
+gpk_application_all_packages_page_back (GpkApplicationPrivate *priv)
+{
+	guint last;
+	g_autofree gchar *anchor = NULL;
+	g_autoptr(GPtrArray) selected = NULL;
+
+	if (!priv->all_packages_paged || priv->all_packages_start == 0)
+		return;
+
+	/* keep going if the facets hide a whole page */
+	anchor = gpk_application_all_packages_get_anchor (priv);
+	selected = gpk_application_all_packages_get_selected (priv);
+	do {
+		gpk_application_all_packages_load (priv,
+						   priv->all_packages_start - GPK_APPLICATION_ALL_PACKAGES_PAGE,
+						   priv->all_packages_shown);
+	} while (priv->all_packages_start > 0 &&
+		 gpk_application_all_packages_get_row (priv, anchor) == 0);
+
+	/* leave more than a page of rows below the view */
+	while (gpk_application_all_packages_get_pages (priv) > GPK_APPLICATION_ALL_PACKAGES_WINDOW &&
+	       (gint) gpk_package_model_get_size (priv->packages_store) -
+	       gpk_application_all_packages_get_row (priv, anchor) >= 3 * GPK_APPLICATION_ALL_PACKAGES_PAGE) {
+		last = priv->all_packages_start +
+		       (gpk_application_all_packages_get_pages (priv) - 1) * GPK_APPLICATION_ALL_PACKAGES_PAGE;
+		gpk_application_all_packages_drop (priv, last);
+		priv->all_packages_shown = last;
+	}
+	gpk_application_all_packages_restore (priv, anchor, selected);
+}
+
+/* the catalog was replaced, so the same pages are loaded from the new one */
+static void
+gpk_application_all_packages_reload (GpkApplicationPrivate *priv)
+{
+	guint start;
+	g_autofree gchar *anchor = NULL;
+	g_autoptr(GPtrArray) selected = NULL;
+
+	anchor = gpk_application_all_packages_get_anchor (priv);
+	selected = gpk_application_all_packages_get_selected (priv);
+	start = MIN (priv->all_packages_start, gpk_catalog_get_size (priv->catalog));
+	start -= start % GPK_APPLICATION_ALL_PACKAGES_PAGE;
+	gpk_application_all_packages_load (priv, start,
+					   MAX (priv->all_packages_shown,
+						start + GPK_APPLICATION_ALL_PACKAGES_PAGE));
+	gpk_application_all_packages_restore (priv, anchor, selected);
+}
+
+static void
+gpk_application_all_packages_show (GpkApplicationPrivate *priv)
+{
+	g_debug ("paging %u packages from the catalog", gpk_catalog_get_size (priv->catalog));
+	if (!priv->all_packages_paged)
+		gpk_application_all_packages_set_sortable (priv, FALSE);
+	priv->all_packages_paged = TRUE;
+	priv->all_packages_start = 0;
+	priv->all_packages_shown = 0;
+	gpk_application_all_packages_page (priv);
+	gpk_application_search_finished (priv);
+}
+
+static gboolean
+gpk_application_search_from_catalog (GpkApplicationPrivate *priv)
+{
+	PkPackage *item;
+	guint i;
+	g_auto(GStrv) searches = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+
+	/* every package is in the catalog, if it is up to date */
+	if (priv->search_mode == GPK_MODE_ALL_PACKAGES) {
+		if (priv->catalog_stale || gpk_catalog_get_age (priv->catalog) < 0 ||
+		    gpk_catalog_get_filters (priv->catalog) != pk_bitfield_value (PK_FILTER_ENUM_NONE))
+			return FALSE;
+		gpk_application_all_packages_show (priv);
+		return TRUE;
+	}
+
+	/* the catalog only has names */
+	if (priv->search_mode != GPK_MODE_NAME_DETAILS_FILE ||
+	    priv->search_type != GPK_SEARCH_NAME ||
+	    _g_strzero (priv->search_text))
+		return FALSE;
+
+	/* missing, or the daemon knows better */
+	if (priv->catalog_stale || gpk_catalog_get_age (priv->catalog) < 0)
+		return FALSE;
+	if (gpk_catalog_get_filters (priv->catalog) != pk_bitfield_value (PK_FILTER_ENUM_NONE)) {
+		if (!priv->catalog_rebuilding)
+			gpk_application_catalog_rebuild (priv);
+		return FALSE;
+	}
+
+	searches = g_strsplit (priv->search_text, " ", -1);
+	array = gpk_catalog_search_names (priv->catalog, searches);
+	g_debug ("found %u packages for %s in the catalog", array->len, priv->search_text);
+	for (i = 0; i < array->len; i++) {
+		item = g_ptr_array_index (array, i);
+		gpk_application_add_item_to_results (priv, item);
+	}
+	gpk_application_search_finished (priv);
+	return TRUE;
+}
+
+static void
+gpk_application_invalidate_results (GpkApplicationPrivate *priv)
+{
+	/* anything we remember could now be out of date */
+	g_debug ("invalidating cached results");
+	gpk_result_cache_invalidate (priv->result_cache);
+	g_hash_table_remove_all (priv->details_cache);
+	gpk_dependency_graph_invalidate (priv->dependency_graph);
+	priv->catalog_stale = TRUE;
+	gpk_application_catalog_rebuild (priv);
+}
+
+static void
+gpk_application_cancel_cb (GtkWidget *button_widget, GpkApplicationPrivate *priv)
+{
+	g_cancellable_cancel (priv->cancellable);
+	gpk_scheduler_cancel (priv->scheduler, GPK_SCHEDULER_KIND_DETAILS);
+	gpk_scheduler_cancel (priv->scheduler, GPK_SCHEDULER_KIND_FILES);
+	gpk_scheduler_cancel (priv->scheduler, GPK_SCHEDULER_KIND_DEPENDS);
+	gpk_scheduler_cancel (priv->scheduler, GPK_SCHEDULER_KIND_REQUIRES);
+
+	/* the search callback ignores cancelled searches, so tidy up here */
+	if (priv->search_in_progress) {
+		gpk_scheduler_cancel (priv->scheduler, GPK_SCHEDULER_KIND_SEARCH);
+		gpk_application_search_done (priv);
+	}
+
+	/* switch buttons around */
+	priv->search_mode = GPK_MODE_UNKNOWN;
+}
+
+static void
+gpk_application_search_cb (PkClient *client, GAsyncResult *res, GpkApplicationSearch *search_tmp)
+{
+	g_autoptr(GpkApplicationSearch) search = search_tmp;
+	GpkApplicationPrivate *priv = search->priv;
+	g_autoptr(PkResults) results = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(PkError) error_code = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	PkPackage *item;
+	guint i;
+	GtkWindow *window;
+
+	/* get the results */
+	results = pk_client_generic_finish (client, res, &error);
+
+	/* replaced by a newer search, which now owns the UI */
+	if (g_cancellable_is_cancelled (search->cancellable)) {
+		g_debug ("ignoring superseded search");
+		return;
+	}
+	if (results == NULL) {
+		g_warning ("failed to search: %s", error->message);
+		goto out;
+	}
+
+	/* check error code */
+	error_code = pk_results_get_error_code (results);
+	if (error_code != NULL) {
+		g_warning ("failed to search: %s, %s", pk_error_enum_to_string (pk_error_get_code (error_code)), pk_error_get_details (error_code));
+
+		/* if obvious message, don't tell the user */
+		if (pk_error_get_code (error_code) != PK_ERROR_ENUM_TRANSACTION_CANCELLED) {
+			window = GTK_WINDOW (gtk_builder_get_object (priv->builder, "window_manager"));
+			gpk_error_dialog_modal (window, gpk_error_enum_to_localised_text (pk_error_get_code (error_code)),
+						gpk_error_enum_to_localised_message (pk_error_get_code (error_code)), pk_error_get_details (error_code));
+		}
+		goto out;
+	}
+
+	/* far too many to add at once, so keep them compact and page them in */
+	array = pk_results_get_package_array (results);
+	if (search->mode == GPK_MODE_ALL_PACKAGES) {
+		if (gpk_application_catalog_replace (priv, array, search->filters))
+			gpk_application_all_packages_show (priv);
+		else
+			gpk_application_search_finished (priv);
+		goto out;
+	}
+
+	/* add anything that was not streamed while the search was running */
+	for (i = 0; i < array->len; i++) {
+		item = g_ptr_array_index (array, i);
+		gpk_application_search_queue_package (priv, item);
+	}
+	gpk_application_search_flush (priv, G_MAXUINT);
+
+	/* paint straight away when this is asked for again */
+	if (search->cache_key != NULL)
+		gpk_result_cache_insert (priv->result_cache, search->cache_key, array);
+	gpk_application_search_finished (priv);
+out:
+	gpk_application_search_done (priv);
+}
+
+static void
+gpk_application_search_part_cb (PkClient *client, GAsyncResult *res, GpkApplicationSearch *search_tmp)
+{
+	g_autoptr(GpkApplicationSearch) search = search_tmp;
+	GpkApplicationPrivate *priv = search->priv;
+	g_autoptr(PkResults) results = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(PkError) error_code = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	guint i;
+
+	/* get the results */
+	results = pk_client_generic_finish (client, res, &error);
+
+	/* replaced by a newer search, which now owns the UI */
+	if (g_cancellable_is_cancelled (search->cancellable)) {
+		g_debug ("ignoring superseded search");
+		return;
+	}
+
+	/* the other searches might still find something, so do not stop */
+	if (results != NULL)
+		error_code = pk_results_get_error_code (results);
+	if (results == NULL) {
+		g_warning ("failed to search type %u: %s", search->type, error->message);
+	} else if (error_code != NULL) {
+		g_warning ("failed to search type %u: %s, %s", search->type,
+			   pk_error_enum_to_string (pk_error_get_code (error_code)),
+			   pk_error_get_details (error_code));
+	} else {
+		array = pk_results_get_package_array (results);
+		for (i = 0; i < array->len; i++)
+			gpk_application_search_queue_match (priv, g_ptr_array_index (array, i), search->type);
+
+		/* the same as if this search had been done on its own */
+		if (search->cache_key != NULL)
+			gpk_result_cache_insert (priv->result_cache, search->cache_key, array);
+	}
+
+	/* the slowest search finishes the whole thing */
+	if (--priv->search_parts > 0)
+		return;
+	gpk_application_search_flush (priv, G_MAXUINT);
+	gpk_application_search_finished (priv);
+	gpk_application_search_done (priv);
+}
+
+static void
+gpk_application_search_start (GCancellable *cancellable,
+			      GAsyncReadyCallback callback, gpointer callback_data,
+			      GpkApplicationSearch *search)
+{
+	GpkApplicationPrivate *priv = search->priv;
+
+	if (search->mode == GPK_MODE_GROUP) {
+		pk_client_search_groups_async (PK_CLIENT(priv->task),
+					       search->filters, search->values, cancellable,
+					       (PkProgressCallback) gpk_application_search_progress_cb, search,
+					       callback, callback_data);
+	} else if (search->mode != GPK_MODE_NAME_DETAILS_FILE) {
+		pk_client_get_packages_async (PK_CLIENT(priv->task),
+					      search->filters, cancellable,
+					      (PkProgressCallback) gpk_application_search_progress_cb, search,
+					      callback, callback_data);
+	} else if (search->type == GPK_SEARCH_NAME) {
+		pk_task_search_names_async (priv->task,
+					     search->filters,
+					     search->values, cancellable,
+					     (PkProgressCallback) gpk_application_search_progress_cb, search,
+					     callback, callback_data);
+	} else if (search->type == GPK_SEARCH_DETAILS) {
+		pk_task_search_details_async (priv->task,
+					     search->filters,
+					     search->values, cancellable,
+					     (PkProgressCallback) gpk_application_search_progress_cb, search,
+					     callback, callback_data);
+	} else {
+		pk_task_search_files_async (priv->task,
+					     search->filters,
+					     search->values, cancellable,
+					     (PkProgressCallback) gpk_application_search_progress_cb, search,
+					     callback, callback_data);
+	}
+}
 
-	/* focus back to the text extry */
-	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "entry_text"));
-	gtk_widget_grab_focus (widget);
+static void
+gpk_application_search_push (GpkApplicationPrivate *priv, GpkApplicationSearch *search)
+{
+	GCancellable *cancellable;
+
+	/* the newest search always wins */
+	cancellable = gpk_scheduler_push (priv->scheduler, GPK_SCHEDULER_KIND_SEARCH,
+					  (GpkSchedulerFunc) gpk_application_search_start,
+					  (GAsyncReadyCallback) gpk_application_search_cb,
+					  search, (GDestroyNotify) gpk_application_search_free);
+	search->cancellable = g_object_ref (cancellable);
+	g_set_object (&priv->search_cancellable, cancellable);
+}
 
-	/* reset UI */
-	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "treeview_groups"));
-	gtk_widget_set_sensitive (widget, TRUE);
-	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "textview_description"));
-	gtk_widget_set_sensitive (widget, TRUE);
-	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "entry_text"));
-	gtk_widget_set_sensitive (widget, TRUE);
-	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_apply"));
-	gtk_widget_set_sensitive (widget, TRUE);
-out:
-	/* mark find button sensitive */
-	priv->search_in_progress = FALSE;
-	gpk_application_set_button_find_sensitivity (priv);
-	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "scrolledwindow_groups"));
-	gtk_widget_set_sensitive (widget, TRUE);
+static void
+gpk_application_search_push_all (GpkApplicationPrivate *priv)
+{
+	GCancellable *cancellable;
+	GpkApplicationSearch *search;
+	GpkSchedulerFlags flags = GPK_SCHEDULER_FLAG_NONE;
+	GpkSearchType type;
+
+	/* the first replaces any older search, and the others run alongside
+	 * it, so the results are complete when the slowest one is done */
+	priv->search_parts = 0;
+	for (type = GPK_SEARCH_NAME; type < GPK_SEARCH_ALL; type++) {
+		if (!pk_bitfield_contain (priv->roles, gpk_application_search_type_to_role (type)))
+			continue;
+		search = gpk_application_search_new (priv);
+		search->type = type;
+		search->is_part = TRUE;
+		g_free (search->cache_key);
+		search->cache_key = gpk_application_search_get_cache_key (priv, type);
+		cancellable = gpk_scheduler_push_full (priv->scheduler, GPK_SCHEDULER_KIND_SEARCH, flags,
+						       (GpkSchedulerFunc) gpk_application_search_start,
+						       (GAsyncReadyCallback) gpk_application_search_part_cb,
+						       search, (GDestroyNotify) gpk_application_search_free);
+		search->cancellable = g_object_ref (cancellable);
+		g_set_object (&priv->search_cancellable, cancellable);
+		flags = GPK_SCHEDULER_FLAG_KEEP;
+		priv->search_parts++;
+	}
+	if (priv->search_parts == 0)
+		gpk_application_search_done (priv);
 }
 
 static void
 gpk_application_perform_search_name_details_file (GpkApplicationPrivate *priv)
 {
-	GtkEntry *entry;
 	GtkWindow *window;
 	g_autoptr(GError) error = NULL;
 	gboolean ret;
-	g_auto(GStrv) searches = NULL;
-
-	entry = GTK_ENTRY (gtk_builder_get_object (priv->builder, "entry_text"));
-	g_free (priv->search_text);
-	priv->search_text = g_strdup (gtk_entry_get_text (entry));
+	GpkApplicationSearch *search;
 
 	/* have we got input? */
 	if (_g_strzero (priv->search_text)) {
@@ -1284,37 +3054,24 @@ gpk_application_perform_search_name_details_file (GpkApplicationPrivate *priv)
 		return;
 	}
 	g_debug ("find %s", priv->search_text);
+	if (priv->search_type != GPK_SEARCH_NAME &&
+	    priv->search_type != GPK_SEARCH_DETAILS &&
+	    priv->search_type != GPK_SEARCH_FILE &&
+	    priv->search_type != GPK_SEARCH_ALL) {
+		g_warning ("invalid search type");
+		return;
+	}
 
 	/* mark find button insensitive */
 	priv->search_in_progress = TRUE;
 	gpk_application_set_button_find_sensitivity (priv);
 
-	/* ensure new action succeeds */
-	g_cancellable_reset (priv->cancellable);
-
 	/* do the search */
-	searches = g_strsplit (priv->search_text, " ", -1);
-	if (priv->search_type == GPK_SEARCH_NAME) {
-		pk_task_search_names_async (priv->task,
-					     priv->filters_current,
-					     searches, priv->cancellable,
-					     (PkProgressCallback) gpk_application_progress_cb, priv,
-					     (GAsyncReadyCallback) gpk_application_search_cb, priv);
-	} else if (priv->search_type == GPK_SEARCH_DETAILS) {
-		pk_task_search_details_async (priv->task,
-					     priv->filters_current,
-					     searches, priv->cancellable,
-					     (PkProgressCallback) gpk_application_progress_cb, priv,
-					     (GAsyncReadyCallback) gpk_application_search_cb, priv);
-	} else if (priv->search_type == GPK_SEARCH_FILE) {
-		pk_task_search_files_async (priv->task,
-					     priv->filters_current,
-					     searches, priv->cancellable,
-					     (PkProgressCallback) gpk_application_progress_cb, priv,
-					     (GAsyncReadyCallback) gpk_application_search_cb, priv);
+	if (priv->search_type == GPK_SEARCH_ALL) {
+		gpk_application_search_push_all (priv);
 	} else {
-		g_warning ("invalid search type");
-		return;
+		search = gpk_application_search_new (priv);
+		gpk_application_search_push (priv, search);
 	}
 
 	if (!ret) {
@@ -1331,24 +3088,11 @@ gpk_application_perform_search_name_details_file (GpkApplicationPrivate *priv)
 static void
 gpk_application_perform_search_others (GpkApplicationPrivate *priv)
 {
-	/* ensure new action succeeds */
-	g_cancellable_reset (priv->cancellable);
+	GpkApplicationSearch *search;
 
 	priv->search_in_progress = TRUE;
-
-	if (priv->search_mode == GPK_MODE_GROUP) {
-		g_auto(GStrv) search_groups = NULL;
-		search_groups = g_strsplit (priv->search_group, " ", -1);
-		pk_client_search_groups_async (PK_CLIENT(priv->task),
-					       priv->filters_current, search_groups, priv->cancellable,
-					       (PkProgressCallback) gpk_application_progress_cb, priv,
-					       (GAsyncReadyCallback) gpk_application_search_cb, priv);
-	} else {
-		pk_client_get_packages_async (PK_CLIENT(priv->task),
-					      priv->filters_current, priv->cancellable,
-					      (PkProgressCallback) gpk_application_progress_cb, priv,
-					      (GAsyncReadyCallback) gpk_application_search_cb, priv);
-	}
+	search = gpk_application_search_new (priv);
+	gpk_application_search_push (priv, search);
 }
 
 static gboolean
@@ -1378,9 +3122,14 @@ gpk_application_populate_selected (GpkApplicationPrivate *priv)
 static void
 gpk_application_perform_search (GpkApplicationPrivate *priv)
 {
-	/*if we are in the middle of a search, just return*/
-	if (priv->search_in_progress == TRUE)
-		return;
+	GtkEntry *entry;
+
+	/* a new search replaces the one that is running */
+	if (priv->search_in_progress) {
+		g_debug ("cancelling superseded search");
+		gpk_scheduler_cancel (priv->scheduler, GPK_SCHEDULER_KIND_SEARCH);
+		gpk_application_search_done (priv);
+	}
 
 	/* just shown the welcome screen */
 	if (priv->search_mode == GPK_MODE_UNKNOWN)
@@ -1390,6 +3139,26 @@ gpk_application_perform_search (GpkApplicationPrivate *priv)
 	gpk_application_clear_details (priv);
 	gpk_application_clear_packages (priv);
 
+	/* the cache key needs the current text */
+	if (priv->search_mode == GPK_MODE_NAME_DETAILS_FILE) {
+		entry = GTK_ENTRY (gtk_builder_get_object (priv->builder, "entry_text"));
+		g_free (priv->search_text);
+		priv->search_text = g_strdup (gtk_entry_get_text (entry));
+	}
+
+	/* the results are ranked against the text as they arrive */
+	gpk_package_model_set_search (priv->packages_store,
+				      priv->search_mode == GPK_MODE_NAME_DETAILS_FILE ?
+				      priv->search_text : NULL);
+
+	/* paint straight away if we have seen this before */
+	if (gpk_application_search_from_cache (priv))
+		return;
+	if (gpk_application_search_from_catalog (priv))
+		return;
+	if (gpk_application_search_from_details_index (priv))
+		return;
+
 	if (priv->search_mode == GPK_MODE_NAME_DETAILS_FILE) {
 		gpk_application_perform_search_name_details_file (priv);
 	} else if (priv->search_mode == GPK_MODE_GROUP ||
@@ -1405,10 +3174,107 @@ gpk_application_perform_search (GpkApplicationPrivate *priv)
 static void
 gpk_application_find_cb (GtkWidget *button_widget, GpkApplicationPrivate *priv)
 {
+	/* the user did not wait for the typing to settle */
+	if (priv->search_timeout_id > 0) {
+		g_source_remove (priv->search_timeout_id);
+		priv->search_timeout_id = 0;
+	}
 	priv->search_mode = GPK_MODE_NAME_DETAILS_FILE;
 	gpk_application_perform_search (priv);
 }
 
+static gboolean
+gpk_application_activate_suggestion (GpkApplicationPrivate *priv, GtkTreeIter *iter)
+{
+	GtkEntry *entry;
+	g_autofree gchar *search = NULL;
+
+	gtk_tree_model_get (GTK_TREE_MODEL (priv->packages_store), iter,
+			    GPK_PACKAGE_MODEL_COLUMN_SUGGESTION, &search,
+			    -1);
+	if (search == NULL)
+		return FALSE;
+
+	/* search straight away rather than once the typing has settled */
+	g_debug ("searching for suggestion %s", search);
+	entry = GTK_ENTRY (gtk_builder_get_object (priv->builder, "entry_text"));
+	gtk_entry_set_text (entry, search);
+	gpk_application_find_cb (NULL, priv);
+	return TRUE;
+}
+
+static gboolean
+gpk_application_search_narrow_cb (PkPackage *package, gchar **searches)
+{
+	const gchar *name;
+	guint i;
+
+	/* drop any 'no results' message */
+	if (package == NULL)
+		return FALSE;
+
+	/* every term has to match, as with the backend */
+	name = pk_package_get_name (package);
+	for (i = 0; searches[i] != NULL; i++) {
+		if (!gpk_ascii_strcasestr (name, searches[i]))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+gpk_application_search_narrow (GpkApplicationPrivate *priv)
+{
+	GtkEntry *entry;
+	const gchar *text;
+	guint i;
+	g_auto(GStrv) searches = NULL;
+
+	/* only finished name searches are a superset of a longer name */
+	if (priv->search_text_narrow == NULL ||
+	    priv->search_in_progress ||
+	    priv->search_mode != GPK_MODE_NAME_DETAILS_FILE ||
+	    priv->search_type != GPK_SEARCH_NAME)
+		return FALSE;
+	entry = GTK_ENTRY (gtk_builder_get_object (priv->builder, "entry_text"));
+	text = gtk_entry_get_text (entry);
+	if (!g_str_has_prefix (text, priv->search_text_narrow))
+		return FALSE;
+
+	g_debug ("narrowing %s to %s", priv->search_text_narrow, text);
+	g_free (priv->search_text);
+	priv->search_text = g_strdup (text);
+	g_free (priv->search_text_narrow);
+	priv->search_text_narrow = g_strdup (text);
+
+	/* remove what no longer matches */
+	searches = g_strsplit (text, " ", -1);
+	for (i = 0; searches[i] != NULL; i++) {
+		g_autofree gchar *tmp = searches[i];
+		searches[i] = g_ascii_strdown (tmp, -1);
+	}
+	gpk_package_model_retain (priv->packages_store,
+				  (GpkPackageModelFilterFunc) gpk_application_search_narrow_cb,
+				  searches);
+	gpk_package_model_set_search (priv->packages_store, text);
+	priv->has_package = gpk_package_model_get_size (priv->packages_store) > 0;
+	if (!priv->has_package)
+		gpk_application_suggest_better_search (priv);
+	gpk_application_update_facet_counts (priv);
+	gpk_application_select_exact_match (priv);
+	return TRUE;
+}
+
+static gboolean
+gpk_application_search_timeout_cb (GpkApplicationPrivate *priv)
+{
+	priv->search_timeout_id = 0;
+	priv->search_mode = GPK_MODE_NAME_DETAILS_FILE;
+	if (!gpk_application_search_narrow (priv))
+		gpk_application_perform_search (priv);
+	return FALSE;
+}
+
 static gboolean
 gpk_application_quit (GpkApplicationPrivate *priv)
 {
@@ -1445,6 +3311,9 @@ gpk_application_quit (GpkApplicationPrivate *priv)
 
 	/* we might have visual stuff running, close them down */
 	g_cancellable_cancel (priv->cancellable);
+	if (priv->name_index_cancellable != NULL)
+		g_cancellable_cancel (priv->name_index_cancellable);
+	gpk_scheduler_cancel_all (priv->scheduler);
 	g_application_release (G_APPLICATION (priv->application));
 	return TRUE;
 }
@@ -1465,6 +3334,21 @@ gpk_application_text_changed_cb (GtkEntry *entry, GpkApplicationPrivate *priv)
 
 	/* mark find button sensitive */
 	gpk_application_set_button_find_sensitivity (priv);
+
+	/* search once the user has stopped typing */
+	if (!g_settings_get_boolean (priv->settings, GPK_SETTINGS_SEARCH_AS_YOU_TYPE))
+		return FALSE;
+	if (priv->search_timeout_id > 0) {
+		g_source_remove (priv->search_timeout_id);
+		priv->search_timeout_id = 0;
+	}
+	if (gtk_entry_get_text_length (entry) < GPK_APPLICATION_SEARCH_MIN_LENGTH)
+		return FALSE;
+	priv->search_timeout_id =
+		g_timeout_add (GPK_APPLICATION_SEARCH_DEBOUNCE,
+			       (GSourceFunc) gpk_application_search_timeout_cb, priv);
+	g_source_set_name_by_id (priv->search_timeout_id,
+				 "[GpkApplication] search-as-you-type");
 	return FALSE;
 }
 
@@ -1475,7 +3359,6 @@ gpk_application_packages_installed_clicked_cb (GtkCellRendererToggle *cell, gcha
 	GtkTreeModel *model;
 	GtkTreeIter iter;
 	GtkTreePath *path;
-	GtkTreeSelection *selection;
 	PkBitfield state;
 
 	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
@@ -1485,196 +3368,484 @@ gpk_application_packages_installed_clicked_cb (GtkCellRendererToggle *cell, gcha
 	/* get toggled iter */
 	gtk_tree_model_get_iter (model, &iter, path);
 	gtk_tree_model_get (model, &iter,
-			    PACKAGES_COLUMN_STATE, &state,
+			    GPK_PACKAGE_MODEL_COLUMN_STATE, &state,
 			    -1);
 
-	/* enforce the selection in case we just fire at the checkbox without selecting */
-	selection = gtk_tree_view_get_selection (treeview);
-	gtk_tree_selection_select_iter (selection, &iter);
+	/* only this row, even if others are selected */
+	gpk_application_queue_row (priv, &iter,
+				   gpk_package_state_get_checkbox (state) ?
+					GPK_ACTION_REMOVE : GPK_ACTION_INSTALL);
+	gpk_application_change_queue_status (priv);
+	gpk_application_update_buttons (priv);
+	gtk_tree_path_free (path);
+}
 
-	if (gpk_application_state_get_checkbox (state)) {
-		gpk_application_remove (priv);
-	} else {
-		gpk_application_install (priv);
+
+static void
+gpk_application_button_clear_cb (GtkWidget *widget_button, GpkApplicationPrivate *priv)
+{
+	GHashTableIter hash_iter;
+	GtkTreeIter iter;
+	PkBitfield state;
+	GpkPackageAtom *atom;
+
+	/* reset the state of only the rows that were in the array */
+	g_hash_table_iter_init (&hash_iter, priv->package_queued);
+	while (g_hash_table_iter_next (&hash_iter, (gpointer *) &atom, NULL)) {
+		if (!gpk_package_model_find_by_atom (priv->packages_store, atom, &iter))
+			continue;
+		state = gpk_package_model_get_state (priv->packages_store, &iter);
+		pk_bitfield_remove (state, GPK_PACKAGE_STATE_IN_LIST);
+		gpk_package_model_set_state (priv->packages_store, &iter, state);
+	}
+
+	/* clear queue */
+	gpk_application_queue_clear (priv);
+	gpk_application_change_queue_status (priv);
+
+	/* force a button refresh */
+	gpk_application_update_buttons (priv);
+}
+
+/**
+ * gpk_application_apply_results:
+ * @package_ids: the packages the transaction was asked to change
+ * @installing: %TRUE if the transaction installed packages
+ *
+ * Changes the rows shown for what a finished transaction did, rather than
+ * searching again, so the selection and scroll position are kept. Each
+ * package is looked at in the order the daemon reported it, so the last
+ * thing that happened to it wins.
+ **/
+static void
+gpk_application_apply_results (GpkApplicationPrivate *priv, PkResults *results,
+			       gchar **package_ids, gboolean installing)
+{
+	GHashTableIter hash_iter;
+	GtkTreeIter iter;
+	PkBitfield state;
+	PkPackage *package;
+	const gchar *package_id;
+	gpointer value;
+	guint changed;
+	guint i;
+	g_autoptr(GHashTable) installed = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GPtrArray) added = NULL;
+	g_autoptr(GPtrArray) removed = NULL;
+
+	installed = g_hash_table_new (g_str_hash, g_str_equal);
+	array = pk_results_get_package_array (results);
+	for (i = 0; i < array->len; i++) {
+		package = g_ptr_array_index (array, i);
+		switch (pk_package_get_info (package)) {
+		case PK_INFO_ENUM_INSTALLING:
+		case PK_INFO_ENUM_UPDATING:
+		case PK_INFO_ENUM_REINSTALLING:
+		case PK_INFO_ENUM_DOWNGRADING:
+			value = GINT_TO_POINTER (TRUE);
+			break;
+		case PK_INFO_ENUM_REMOVING:
+		case PK_INFO_ENUM_OBSOLETING:
+		case PK_INFO_ENUM_CLEANUP:
+			value = GINT_TO_POINTER (FALSE);
+			break;
+		case PK_INFO_ENUM_FINISHED:
+			/* only the transaction says which way */
+			value = GINT_TO_POINTER (installing);
+			break;
+		default:
+			continue;
+		}
+		g_hash_table_insert (installed, (gpointer) pk_package_get_id (package), value);
+	}
+
+	/* what was asked for is no longer queued, even if the daemon did not mention it */
+	for (i = 0; package_ids[i] != NULL; i++) {
+		if (gpk_package_model_find_by_id (priv->packages_store, package_ids[i], &iter)) {
+			state = gpk_package_model_get_state (priv->packages_store, &iter);
+			pk_bitfield_remove (state, GPK_PACKAGE_STATE_IN_LIST);
+			gpk_package_model_set_state (priv->packages_store, &iter, state);
+		}
+		gpk_application_queue_remove (priv, package_ids[i]);
+	}
+
+	added = g_ptr_array_new ();
+	removed = g_ptr_array_new ();
+	g_hash_table_iter_init (&hash_iter, installed);
+	while (g_hash_table_iter_next (&hash_iter, (gpointer *) &package_id, &value))
+		g_ptr_array_add (GPOINTER_TO_INT (value) ? added : removed, (gpointer) package_id);
+	g_ptr_array_add (added, NULL);
+	g_ptr_array_add (removed, NULL);
+	changed = gpk_package_model_set_installed (priv->packages_store, (gchar **) added->pdata, TRUE);
+	changed += gpk_package_model_set_installed (priv->packages_store, (gchar **) removed->pdata, FALSE);
+	g_debug ("%u packages installed and %u removed, changing %u rows",
+		 added->len - 1, removed->len - 1, changed);
+
+	gpk_application_update_facet_counts (priv);
+}
+
+/* shows what went wrong, unless the user cancelled it */
+static gboolean
+gpk_application_check_results (GpkApplicationPrivate *priv, PkResults *results,
+			       const GError *error, const gchar *action)
+{
+	GtkWindow *window;
+	g_autoptr(PkError) error_code = NULL;
+
+	if (results == NULL) {
+		g_warning ("failed to %s packages: %s", action, error->message);
+		return FALSE;
+	}
+
+	/* check error code */
+	error_code = pk_results_get_error_code (results);
+	if (error_code == NULL)
+		return TRUE;
+	g_warning ("failed to %s packages: %s, %s", action, pk_error_enum_to_string (pk_error_get_code (error_code)), pk_error_get_details (error_code));
+
+	/* if obvious message, don't tell the user */
+	if (pk_error_get_code (error_code) != PK_ERROR_ENUM_TRANSACTION_CANCELLED) {
+		window = GTK_WINDOW (gtk_builder_get_object (priv->builder, "window_manager"));
+		gpk_error_dialog_modal (window, gpk_error_enum_to_localised_text (pk_error_get_code (error_code)),
+					gpk_error_enum_to_localised_message (pk_error_get_code (error_code)), pk_error_get_details (error_code));
+	}
+	return FALSE;
+}
+
+/* the queue, as a remove and then an install that are confirmed once */
+typedef struct {
+	GpkApplicationPrivate	*priv;
+	gchar			**remove_ids;	/* or NULL */
+	gchar			**install_ids;	/* or NULL */
+	gboolean		 autoremove;
+	PkPackageSack		*simulated;	/* what else would change */
+	gboolean		 install_deferred; /* only simulated after the removes */
+	gboolean		 changed;	/* something was installed or removed */
+} GpkApplicationPlan;
+
+static GpkApplicationPlan *
+gpk_application_plan_new (GpkApplicationPrivate *priv)
+{
+	GpkApplicationPlan *plan;
+	g_autoptr(PkPackageSack) removes = NULL;
+	g_autoptr(PkPackageSack) installs = NULL;
+
+	/* the queue remembers if each package was installed when it was added */
+	plan = g_new0 (GpkApplicationPlan, 1);
+	plan->priv = priv;
+	plan->simulated = pk_package_sack_new ();
+	removes = pk_package_sack_filter_by_info (priv->package_sack, PK_INFO_ENUM_INSTALLED);
+	installs = pk_package_sack_filter_by_info (priv->package_sack, PK_INFO_ENUM_AVAILABLE);
+	if (pk_package_sack_get_size (removes) > 0)
+		plan->remove_ids = pk_package_sack_get_ids (removes);
+	if (pk_package_sack_get_size (installs) > 0)
+		plan->install_ids = pk_package_sack_get_ids (installs);
+	plan->autoremove = g_settings_get_boolean (priv->settings, GPK_SETTINGS_ENABLE_AUTOREMOVE);
+	return plan;
+}
+
+static void
+gpk_application_plan_free (GpkApplicationPlan *plan)
+{
+	g_strfreev (plan->remove_ids);
+	g_strfreev (plan->install_ids);
+	g_object_unref (plan->simulated);
+	g_free (plan);
+}
+
+static void
+gpk_application_plan_finish (GpkApplicationPlan *plan)
+{
+	GpkApplicationPrivate *priv = plan->priv;
+
+	/* back to simulating each transaction on its own */
+	pk_task_set_simulate (priv->task, TRUE);
+	priv->plan_step = 0;
+	priv->plan_steps = 0;
+	gpk_application_progress_finished (priv);
+
+	/* the installed state of cached results is now wrong */
+	if (plan->changed)
+		gpk_application_invalidate_results (priv);
+
+	/* anything that was not done stays in the queue */
+	gpk_application_change_queue_status (priv);
+	gpk_application_update_buttons (priv);
+	gpk_application_plan_free (plan);
+}
+
+static void
+gpk_application_plan_install_cb (PkTask *task, GAsyncResult *res, GpkApplicationPlan *plan)
+{
+	GpkApplicationPrivate *priv = plan->priv;
+	g_autoptr(PkResults) results = NULL;
+	g_autoptr(GError) error = NULL;
+
+	results = pk_task_generic_finish (task, res, &error);
+	if (gpk_application_check_results (priv, results, error, "install")) {
+		gpk_application_apply_results (priv, results, plan->install_ids, TRUE);
+		plan->changed = TRUE;
+	}
+	gpk_application_plan_finish (plan);
+}
+
+static void
+gpk_application_plan_install (GpkApplicationPlan *plan)
+{
+	GpkApplicationPrivate *priv = plan->priv;
+
+	/* PkTask asks about the install itself if it was not confirmed */
+	pk_task_set_simulate (priv->task, plan->install_deferred);
+	priv->plan_step++;
+	pk_task_install_packages_async (priv->task, plan->install_ids, priv->cancellable,
+					(PkProgressCallback) gpk_application_progress_cb, priv,
+					(GAsyncReadyCallback) gpk_application_plan_install_cb, plan);
+}
+
+static void
+gpk_application_plan_remove_cb (PkTask *task, GAsyncResult *res, GpkApplicationPlan *plan)
+{
+	GpkApplicationPrivate *priv = plan->priv;
+	g_autoptr(PkResults) results = NULL;
+	g_autoptr(GError) error = NULL;
+
+	/* nothing is installed if the removes failed */
+	results = pk_task_generic_finish (task, res, &error);
+	if (!gpk_application_check_results (priv, results, error, "remove")) {
+		gpk_application_plan_finish (plan);
+		return;
+	}
+	gpk_application_apply_results (priv, results, plan->remove_ids, FALSE);
+	plan->changed = TRUE;
+
+	/* straight on, as this was confirmed with the removes */
+	if (plan->install_ids == NULL) {
+		gpk_application_plan_finish (plan);
+		return;
+	}
+	gpk_application_plan_install (plan);
+}
+
+/**
+ * gpk_application_plan_run:
+ *
+ * Removes first, so a package can be swapped for one that conflicts
+ * with it. #PkTask does not simulate again, as the plan was confirmed,
+ * apart from an install that could only be simulated after the removes.
+ **/
+static void
+gpk_application_plan_run (GpkApplicationPlan *plan)
+{
+	GpkApplicationPrivate *priv = plan->priv;
+
+	pk_task_set_simulate (priv->task, FALSE);
+	if (plan->remove_ids == NULL) {
+		gpk_application_plan_install (plan);
+		return;
+	}
+	priv->plan_step++;
+	pk_task_remove_packages_async (priv->task, plan->remove_ids, TRUE, plan->autoremove,
+				       priv->cancellable,
+				       (PkProgressCallback) gpk_application_progress_cb, priv,
+				       (GAsyncReadyCallback) gpk_application_plan_remove_cb, plan);
+}
+
+static void
+gpk_application_plan_confirm_cb (GpkTask *task, GAsyncResult *res, GpkApplicationPlan *plan)
+{
+	g_autoptr(GError) error = NULL;
+
+	if (!gpk_task_confirm_finish (task, res, &error)) {
+		if (!g_error_matches (error, PK_CLIENT_ERROR, PK_CLIENT_ERROR_DECLINED_SIMULATION))
+			g_warning ("failed to confirm: %s", error->message);
+		gpk_application_plan_finish (plan);
+		return;
+	}
+	gpk_application_plan_run (plan);
+}
+
+/* the install might only be possible once the removes are done */
+static gboolean
+gpk_application_plan_is_conflict (PkResults *results)
+{
+	g_autoptr(PkError) error_code = NULL;
+
+	if (results == NULL)
+		return FALSE;
+	error_code = pk_results_get_error_code (results);
+	if (error_code == NULL)
+		return FALSE;
+	switch (pk_error_get_code (error_code)) {
+	case PK_ERROR_ENUM_DEP_RESOLUTION_FAILED:
+	case PK_ERROR_ENUM_FILE_CONFLICTS:
+	case PK_ERROR_ENUM_PACKAGE_CONFLICTS:
+		return TRUE;
+	default:
+		return FALSE;
 	}
-	gtk_tree_path_free (path);
 }
 
-static void gpk_application_packages_treeview_clicked_cb (GtkTreeSelection *selection, GpkApplicationPrivate *priv);
-
 static void
-gpk_application_button_clear_cb (GtkWidget *widget_button, GpkApplicationPrivate *priv)
+gpk_application_plan_confirm (GpkApplicationPlan *plan)
 {
-	GtkTreeView *treeview;
-	gboolean valid;
-	gboolean checkbox;
-	GtkTreeIter iter;
-	GtkTreeModel *model;
-	GtkTreeSelection *selection;
-	const gchar *icon;
-	PkBitfield state;
-	gboolean ret;
-
-	/* get the first iter in the array */
-	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
-	model = gtk_tree_view_get_model (treeview);
-	valid = gtk_tree_model_get_iter_first (model, &iter);
+	GpkApplicationPrivate *priv = plan->priv;
+	PkRoleEnum role;
 
-	/* for all current items, reset the state if in the array */
-	while (valid) {
-		gtk_tree_model_get (model, &iter, PACKAGES_COLUMN_STATE, &state, -1);
-		ret = pk_bitfield_contain (state, GPK_STATE_IN_LIST);
-		if (ret) {
-			pk_bitfield_remove (state, GPK_STATE_IN_LIST);
-			/* get the new icon */
-			icon = gpk_application_state_get_icon (state);
-			checkbox = gpk_application_state_get_checkbox (state);
-
-			/* set new value */
-			gtk_list_store_set (GTK_LIST_STORE (model), &iter,
-					    PACKAGES_COLUMN_STATE, state,
-					    PACKAGES_COLUMN_CHECKBOX, checkbox,
-					    PACKAGES_COLUMN_IMAGE, icon,
-					    -1);
-		}
-		valid = gtk_tree_model_iter_next (model, &iter);
+	/* nothing else changes, so there is nothing to ask */
+	if (pk_package_sack_get_size (plan->simulated) == 0) {
+		gpk_application_plan_run (plan);
+		return;
 	}
-
-	/* clear queue */
-	pk_package_sack_clear (priv->package_sack);
-
-	/* force a button refresh */
-	selection = gtk_tree_view_get_selection (treeview);
-	gpk_application_packages_treeview_clicked_cb (selection, priv);
-
-	priv->action = GPK_ACTION_NONE;
-	gpk_application_change_queue_status (priv);
+	if (plan->install_ids == NULL || plan->install_deferred)
+		role = PK_ROLE_ENUM_REMOVE_PACKAGES;
+	else if (plan->remove_ids == NULL)
+		role = PK_ROLE_ENUM_INSTALL_PACKAGES;
+	else
+		role = PK_ROLE_ENUM_UNKNOWN;
+	gpk_task_confirm_async (GPK_TASK (priv->task), role,
+				pk_package_sack_get_size (priv->package_sack),
+				plan->simulated, priv->cancellable,
+				(GAsyncReadyCallback) gpk_application_plan_confirm_cb, plan);
 }
 
-static void
-gpk_application_install_packages_cb (PkTask *task, GAsyncResult *res, GpkApplicationPrivate *priv)
+static gboolean
+gpk_application_plan_simulate_add (GpkApplicationPlan *plan, PkClient *client,
+				   GAsyncResult *res, gboolean installing)
 {
+	GpkApplicationPrivate *priv = plan->priv;
+	PkPackage *package;
+	PkInfoEnum info;
+	guint i;
 	g_autoptr(PkResults) results = NULL;
 	g_autoptr(GError) error = NULL;
-	g_autoptr(PkError) error_code = NULL;
-	GtkWindow *window;
-	guint idle_id;
+	g_autoptr(GPtrArray) array = NULL;
 
-	/* get the results */
-	results = pk_task_generic_finish (task, res, &error);
-	if (results == NULL) {
-		g_warning ("failed to install packages: %s", error->message);
-		return;
+	/* the daemon simulates the install without the removes, so a swap
+	 * for a conflicting package is simulated again when it is run */
+	results = pk_client_generic_finish (client, res, &error);
+	if (installing && plan->remove_ids != NULL &&
+	    gpk_application_plan_is_conflict (results)) {
+		g_debug ("install conflicts with the queue, simulating after the removes");
+		plan->install_deferred = TRUE;
+		return TRUE;
 	}
+	if (!gpk_application_check_results (priv, results, error, "simulate"))
+		return FALSE;
 
-	/* check error code */
-	error_code = pk_results_get_error_code (results);
-	if (error_code != NULL) {
-		g_warning ("failed to install packages: %s, %s", pk_error_enum_to_string (pk_error_get_code (error_code)), pk_error_get_details (error_code));
+	/* the same packages PkTask would ask about */
+	array = pk_results_get_package_array (results);
+	for (i = 0; i < array->len; i++) {
+		package = g_ptr_array_index (array, i);
+		info = pk_package_get_info (package);
+		if (info == PK_INFO_ENUM_CLEANUP ||
+		    info == PK_INFO_ENUM_UNTRUSTED ||
+		    info == PK_INFO_ENUM_FINISHED)
+			continue;
+		if (gpk_application_queue_contains (priv, pk_package_get_id (package)))
+			continue;
+		pk_package_sack_add_package (plan->simulated, package);
+	}
+	return TRUE;
+}
 
-		/* if obvious message, don't tell the user */
-		if (pk_error_get_code (error_code) != PK_ERROR_ENUM_TRANSACTION_CANCELLED) {
-			window = GTK_WINDOW (gtk_builder_get_object (priv->builder, "window_manager"));
-			gpk_error_dialog_modal (window, gpk_error_enum_to_localised_text (pk_error_get_code (error_code)),
-						gpk_error_enum_to_localised_message (pk_error_get_code (error_code)), pk_error_get_details (error_code));
-		}
+static void
+gpk_application_plan_simulate_install_cb (PkClient *client, GAsyncResult *res, GpkApplicationPlan *plan)
+{
+	if (!gpk_application_plan_simulate_add (plan, client, res, TRUE)) {
+		gpk_application_plan_finish (plan);
 		return;
 	}
-
-	/* idle add in the background */
-	idle_id = g_idle_add ((GSourceFunc) gpk_application_perform_search_idle_cb, priv);
-	g_source_set_name_by_id (idle_id, "[GpkApplication] search");
-
-	/* clear if success */
-	pk_package_sack_clear (priv->package_sack);
-	priv->action = GPK_ACTION_NONE;
-	gpk_application_change_queue_status (priv);
+	gpk_application_plan_confirm (plan);
 }
 
 static void
-gpk_application_remove_packages_cb (PkTask *task, GAsyncResult *res, GpkApplicationPrivate *priv)
+gpk_application_plan_simulate_install (GpkApplicationPlan *plan)
 {
-	g_autoptr(PkResults) results = NULL;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(PkError) error_code = NULL;
-	GtkWindow *window;
-	guint idle_id;
+	GpkApplicationPrivate *priv = plan->priv;
+
+	pk_client_install_packages_async (PK_CLIENT (priv->task),
+					  pk_bitfield_value (PK_TRANSACTION_FLAG_ENUM_SIMULATE),
+					  plan->install_ids,
+					  priv->cancellable,
+					  (PkProgressCallback) gpk_application_progress_cb, priv,
+					  (GAsyncReadyCallback) gpk_application_plan_simulate_install_cb, plan);
+}
 
-	/* get the results */
-	results = pk_task_generic_finish (task, res, &error);
-	if (results == NULL) {
-		g_warning ("failed to remove packages: %s", error->message);
+static void
+gpk_application_plan_simulate_remove_cb (PkClient *client, GAsyncResult *res, GpkApplicationPlan *plan)
+{
+	if (!gpk_application_plan_simulate_add (plan, client, res, FALSE)) {
+		gpk_application_plan_finish (plan);
 		return;
 	}
 
-	/* check error code */
-	error_code = pk_results_get_error_code (results);
-	if (error_code != NULL) {
-		g_warning ("failed to remove packages: %s, %s", pk_error_enum_to_string (pk_error_get_code (error_code)), pk_error_get_details (error_code));
-
-		/* if obvious message, don't tell the user */
-		if (pk_error_get_code (error_code) != PK_ERROR_ENUM_TRANSACTION_CANCELLED) {
-			window = GTK_WINDOW (gtk_builder_get_object (priv->builder, "window_manager"));
-			gpk_error_dialog_modal (window, gpk_error_enum_to_localised_text (pk_error_get_code (error_code)),
-						gpk_error_enum_to_localised_message (pk_error_get_code (error_code)), pk_error_get_details (error_code));
-		}
+	/* only once the removes are known to be possible */
+	if (plan->install_ids == NULL) {
+		gpk_application_plan_confirm (plan);
 		return;
 	}
+	plan->priv->plan_step++;
+	gpk_application_plan_simulate_install (plan);
+}
 
-	/* idle add in the background */
-	idle_id = g_idle_add ((GSourceFunc) gpk_application_perform_search_idle_cb, priv);
-	g_source_set_name_by_id (idle_id, "[GpkApplication] search");
+/**
+ * gpk_application_plan_simulate:
+ *
+ * The daemon has no single transaction that both installs and removes,
+ * so the removes are simulated and then the installs, and what both
+ * would change is confirmed together.
+ **/
+static void
+gpk_application_plan_simulate (GpkApplicationPlan *plan)
+{
+	GpkApplicationPrivate *priv = plan->priv;
 
-	/* clear if success */
-	pk_package_sack_clear (priv->package_sack);
-	priv->action = GPK_ACTION_NONE;
-	gpk_application_change_queue_status (priv);
+	if (plan->remove_ids == NULL) {
+		gpk_application_plan_simulate_install (plan);
+		return;
+	}
+	pk_client_remove_packages_async (PK_CLIENT (priv->task),
+					 pk_bitfield_value (PK_TRANSACTION_FLAG_ENUM_SIMULATE),
+					 plan->remove_ids, TRUE, plan->autoremove,
+					 priv->cancellable,
+					 (PkProgressCallback) gpk_application_progress_cb, priv,
+					 (GAsyncReadyCallback) gpk_application_plan_simulate_remove_cb, plan);
 }
 
 static void
 gpk_application_button_apply_cb (GtkWidget *widget, GpkApplicationPrivate *priv)
 {
-	g_auto(GStrv) package_ids = NULL;
-	gboolean autoremove;
+	GpkApplicationPlan *plan;
+
+	/* already running */
+	if (priv->plan_steps > 0)
+		return;
+	if (pk_package_sack_get_size (priv->package_sack) == 0)
+		return;
 
 	/* ensure new action succeeds */
 	g_cancellable_reset (priv->cancellable);
 
-	package_ids = pk_package_sack_get_ids (priv->package_sack);
-	if (priv->action == GPK_ACTION_INSTALL) {
-		/* install */
-		pk_task_install_packages_async (priv->task, package_ids, priv->cancellable,
-						(PkProgressCallback) gpk_application_progress_cb, priv,
-						(GAsyncReadyCallback) gpk_application_install_packages_cb, priv);
-
-		/* make package array insensitive */
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "treeview_packages"));
-		gtk_widget_set_sensitive (widget, FALSE);
-
-		/* make apply button insensitive */
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_apply"));
-		gtk_widget_set_visible (widget, FALSE);
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_clear"));
-		gtk_widget_set_visible (widget, FALSE);
-
-	} else if (priv->action == GPK_ACTION_REMOVE) {
-		autoremove = g_settings_get_boolean (priv->settings, GPK_SETTINGS_ENABLE_AUTOREMOVE);
-
-		/* remove */
-		pk_task_remove_packages_async (priv->task, package_ids, TRUE, autoremove, priv->cancellable,
-					       (PkProgressCallback) gpk_application_progress_cb, priv,
-					       (GAsyncReadyCallback) gpk_application_remove_packages_cb, priv);
-
-		/* make package array insensitive */
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "treeview_packages"));
-		gtk_widget_set_sensitive (widget, FALSE);
+	/* a simulation and a transaction for each half */
+	plan = gpk_application_plan_new (priv);
+	priv->plan_step = 0;
+	priv->plan_steps = 0;
+	if (plan->remove_ids != NULL)
+		priv->plan_steps += 2;
+	if (plan->install_ids != NULL)
+		priv->plan_steps += 2;
+	gpk_application_plan_simulate (plan);
+
+	/* make package array insensitive */
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "treeview_packages"));
+	gtk_widget_set_sensitive (widget, FALSE);
 
-		/* make apply button insensitive */
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_apply"));
-		gtk_widget_set_visible (widget, FALSE);
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_clear"));
-		gtk_widget_set_visible (widget, FALSE);
-	}
+	/* make apply button insensitive */
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_apply"));
+	gtk_widget_set_visible (widget, FALSE);
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_clear"));
+	gtk_widget_set_visible (widget, FALSE);
 }
 
 static void
@@ -1692,8 +3863,9 @@ gpk_application_packages_add_columns (GpkApplicationPrivate *priv)
 
 	/* TRANSLATORS: column for installed status */
 	column = gtk_tree_view_column_new_with_attributes (_("Installed"), renderer,
-							   "active", PACKAGES_COLUMN_CHECKBOX,
-							   "visible", PACKAGES_COLUMN_CHECKBOX_VISIBLE, NULL);
+							   "active", GPK_PACKAGE_MODEL_COLUMN_CHECKBOX,
+							   "visible", GPK_PACKAGE_MODEL_COLUMN_CHECKBOX_VISIBLE, NULL);
+	gtk_tree_view_column_set_sort_column_id (column, GPK_PACKAGE_MODEL_COLUMN_STATE);
 	gtk_tree_view_append_column (treeview, column);
 
 	/* column for images */
@@ -1701,15 +3873,41 @@ gpk_application_packages_add_columns (GpkApplicationPrivate *priv)
 	renderer = gtk_cell_renderer_pixbuf_new ();
 	g_object_set (renderer, "stock-size", GTK_ICON_SIZE_DIALOG, NULL);
 	gtk_tree_view_column_pack_start (column, renderer, FALSE);
-	gtk_tree_view_column_add_attribute (column, renderer, "icon-name", PACKAGES_COLUMN_IMAGE);
+	gtk_tree_view_column_add_attribute (column, renderer, "icon-name", GPK_PACKAGE_MODEL_COLUMN_IMAGE);
 	gtk_tree_view_append_column (treeview, column);
 
 	/* column for name */
 	renderer = gtk_cell_renderer_text_new ();
 	/* TRANSLATORS: column for package name */
 	column = gtk_tree_view_column_new_with_attributes (_("Name"), renderer,
-							   "markup", PACKAGES_COLUMN_TEXT, NULL);
-	gtk_tree_view_column_set_sort_column_id (column, PACKAGES_COLUMN_TEXT);
+							   "markup", GPK_PACKAGE_MODEL_COLUMN_TEXT, NULL);
+	gtk_tree_view_column_set_sort_column_id (column, GPK_PACKAGE_MODEL_COLUMN_TEXT);
+	gtk_tree_view_column_set_expand (column, TRUE);
+	gtk_tree_view_append_column (treeview, column);
+
+	/* column for version */
+	renderer = gtk_cell_renderer_text_new ();
+	/* TRANSLATORS: column for package version */
+	column = gtk_tree_view_column_new_with_attributes (_("Version"), renderer,
+							   "text", GPK_PACKAGE_MODEL_COLUMN_VERSION, NULL);
+	gtk_tree_view_column_set_sort_column_id (column, GPK_PACKAGE_MODEL_COLUMN_VERSION);
+	gtk_tree_view_append_column (treeview, column);
+
+	/* column for the source of the package */
+	renderer = gtk_cell_renderer_text_new ();
+	/* TRANSLATORS: column for the repository the package comes from */
+	column = gtk_tree_view_column_new_with_attributes (_("Source"), renderer,
+							   "text", GPK_PACKAGE_MODEL_COLUMN_REPO, NULL);
+	gtk_tree_view_column_set_sort_column_id (column, GPK_PACKAGE_MODEL_COLUMN_REPO);
+	gtk_tree_view_append_column (treeview, column);
+
+	/* column for size, only known once the details have been fetched */
+	renderer = gtk_cell_renderer_text_new ();
+	g_object_set (renderer, "xalign", 1.0f, NULL);
+	/* TRANSLATORS: column for package size */
+	column = gtk_tree_view_column_new_with_attributes (_("Size"), renderer,
+							   "text", GPK_PACKAGE_MODEL_COLUMN_SIZE, NULL);
+	gtk_tree_view_column_set_sort_column_id (column, GPK_PACKAGE_MODEL_COLUMN_SIZE);
 	gtk_tree_view_append_column (treeview, column);
 }
 
@@ -1787,19 +3985,13 @@ gpk_application_groups_treeview_changed_cb (GtkTreeSelection *selection, GpkAppl
 }
 
 static void
-gpk_application_get_details_cb (PkClient *client, GAsyncResult *res, GpkApplicationPrivate *priv)
+gpk_application_show_details (GpkApplicationPrivate *priv, PkDetails *item)
 {
-	g_autoptr(PkResults) results = NULL;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(PkError) error_code = NULL;
-	g_autoptr(GPtrArray) array = NULL;
-	PkDetails *item;
 	GtkWidget *widget;
 	gchar *value;
 	const gchar *repo_name;
 	gboolean installed;
 	g_auto(GStrv) split = NULL;
-	GtkWindow *window;
 	g_autofree gchar *package_id = NULL;
 	g_autofree gchar *url = NULL;
 	PkGroupEnum group;
@@ -1807,37 +3999,6 @@ gpk_application_get_details_cb (PkClient *client, GAsyncResult *res, GpkApplicat
 	g_autofree gchar *description = NULL;
 	guint64 size;
 
-	/* get the results */
-	results = pk_client_generic_finish (client, res, &error);
-	if (results == NULL) {
-		g_warning ("failed to get list of categories: %s", error->message);
-		return;
-	}
-
-	/* check error code */
-	error_code = pk_results_get_error_code (results);
-	if (error_code != NULL) {
-		g_warning ("failed to get details: %s, %s", pk_error_enum_to_string (pk_error_get_code (error_code)), pk_error_get_details (error_code));
-
-		/* if obvious message, don't tell the user */
-		if (pk_error_get_code (error_code) != PK_ERROR_ENUM_TRANSACTION_CANCELLED) {
-			window = GTK_WINDOW (gtk_builder_get_object (priv->builder, "window_manager"));
-			gpk_error_dialog_modal (window, gpk_error_enum_to_localised_text (pk_error_get_code (error_code)),
-						gpk_error_enum_to_localised_message (pk_error_get_code (error_code)), pk_error_get_details (error_code));
-		}
-		return;
-	}
-
-	/* get data */
-	array = pk_results_get_details_array (results);
-	if (array->len != 1) {
-		g_warning ("not one entry %u", array->len);
-		return;
-	}
-
-	/* only choose the first item */
-	item = g_ptr_array_index (array, 0);
-
 	/* show to start */
 	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "grid_details"));
 	gtk_widget_show (widget);
@@ -1906,12 +4067,228 @@ gpk_application_get_details_cb (PkClient *client, GAsyncResult *res, GpkApplicat
 		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_size"));
 		gtk_widget_hide (widget);
 	}
-
-	/* set the repo text */
-	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_source"));
-	/* get the full name of the repo from the repo_id */
-	repo_name = gpk_application_get_full_repo_name (priv, split[PK_PACKAGE_ID_DATA]);
-	gtk_label_set_label (GTK_LABEL (widget), repo_name);
+
+	/* set the repo text */
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_source"));
+	/* get the full name of the repo from the repo_id */
+	repo_name = gpk_application_get_full_repo_name (priv, split[PK_PACKAGE_ID_DATA]);
+	gtk_label_set_label (GTK_LABEL (widget), repo_name);
+}
+
+typedef struct {
+	GpkApplicationPrivate	*priv;
+	gchar			**package_ids;
+} GpkApplicationDetailsBatch;
+
+static void
+gpk_application_details_batch_free (GpkApplicationDetailsBatch *batch)
+{
+	guint i;
+
+	/* anything the backend did not return can be asked for again */
+	for (i = 0; batch->package_ids[i] != NULL; i++)
+		g_hash_table_remove (batch->priv->details_requested, batch->package_ids[i]);
+	g_strfreev (batch->package_ids);
+	g_free (batch);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GpkApplicationDetailsBatch, gpk_application_details_batch_free)
+
+static gboolean
+gpk_application_details_batch_has_selected (GpkApplicationDetailsBatch *batch)
+{
+	GpkApplicationPrivate *priv = batch->priv;
+	return priv->details_selected != NULL &&
+	       g_strv_contains ((const gchar * const *) batch->package_ids, priv->details_selected);
+}
+
+static void
+gpk_application_get_details_cb (PkClient *client, GAsyncResult *res, GpkApplicationDetailsBatch *batch_tmp)
+{
+	g_autoptr(GpkApplicationDetailsBatch) batch = batch_tmp;
+	GpkApplicationPrivate *priv = batch->priv;
+	g_autoptr(PkResults) results = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(PkError) error_code = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	PkDetails *item;
+	PkDetails *selected = NULL;
+	GtkWindow *window;
+	gchar *package_id;
+	guint i;
+
+	/* get the results */
+	results = pk_client_generic_finish (client, res, &error);
+	if (results == NULL) {
+		g_warning ("failed to get details: %s", error->message);
+		return;
+	}
+
+	/* check error code */
+	error_code = pk_results_get_error_code (results);
+	if (error_code != NULL) {
+		g_warning ("failed to get details: %s, %s", pk_error_enum_to_string (pk_error_get_code (error_code)), pk_error_get_details (error_code));
+
+		/* if obvious message, don't tell the user, or if they never asked */
+		if (pk_error_get_code (error_code) != PK_ERROR_ENUM_TRANSACTION_CANCELLED &&
+		    gpk_application_details_batch_has_selected (batch)) {
+			window = GTK_WINDOW (gtk_builder_get_object (priv->builder, "window_manager"));
+			gpk_error_dialog_modal (window, gpk_error_enum_to_localised_text (pk_error_get_code (error_code)),
+						gpk_error_enum_to_localised_message (pk_error_get_code (error_code)), pk_error_get_details (error_code));
+		}
+		return;
+	}
+
+	/* keep them all, a lot of memory is not used for each */
+	if (g_hash_table_size (priv->details_cache) > GPK_APPLICATION_DETAILS_CACHE_MAX)
+		g_hash_table_remove_all (priv->details_cache);
+	array = pk_results_get_details_array (results);
+	for (i = 0; i < array->len; i++) {
+		item = g_ptr_array_index (array, i);
+		g_object_get (item,
+			      "package-id", &package_id,
+			      NULL);
+		if (g_strcmp0 (package_id, priv->details_selected) == 0)
+			selected = item;
+		gpk_package_model_set_size (priv->packages_store, package_id,
+					    pk_details_get_size (item));
+		g_hash_table_insert (priv->details_cache, package_id, g_object_ref (item));
+	}
+
+	/* the user is still waiting for this one */
+	if (selected != NULL)
+		gpk_application_show_details (priv, selected);
+}
+
+static void
+gpk_application_details_batch_start (GCancellable *cancellable,
+				     GAsyncReadyCallback callback, gpointer callback_data,
+				     GpkApplicationDetailsBatch *batch)
+{
+	GpkApplicationPrivate *priv = batch->priv;
+
+	/* only show progress for what the user is waiting for */
+	pk_client_get_details_async (PK_CLIENT (priv->task), batch->package_ids, cancellable,
+				     gpk_application_details_batch_has_selected (batch) ?
+					(PkProgressCallback) gpk_application_progress_cb : NULL, priv,
+				     callback, callback_data);
+}
+
+static void
+gpk_application_details_add_row (GpkApplicationPrivate *priv, GPtrArray *package_ids, GtkTreeIter *iter)
+{
+	const gchar *package_id;
+	PkPackage *package;
+
+	/* skip help lines, and ones we have or are getting */
+	package = gpk_package_model_get_package (priv->packages_store, iter);
+	if (package == NULL)
+		return;
+	package_id = pk_package_get_id (package);
+	if (g_hash_table_contains (priv->details_cache, package_id) ||
+	    g_hash_table_contains (priv->details_requested, package_id))
+		return;
+	g_ptr_array_add (package_ids, g_strdup (package_id));
+	g_hash_table_add (priv->details_requested, g_strdup (package_id));
+}
+
+static void
+gpk_application_details_prefetch (GpkApplicationPrivate *priv, GtkTreeIter *selected)
+{
+	GpkApplicationDetailsBatch *batch;
+	GtkTreeIter iter;
+	GtkTreeModel *model;
+	GtkTreePath *start = NULL;
+	GtkTreePath *end = NULL;
+	GtkTreeView *treeview;
+	gint i;
+	gint first = 0;
+	gint last = -1;
+	g_autoptr(GPtrArray) package_ids = NULL;
+
+	if (!pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_GET_DETAILS))
+		return;
+
+	/* the row the user wants first, then what they can see and will
+	 * probably scroll to next */
+	package_ids = g_ptr_array_new_with_free_func (g_free);
+	if (selected != NULL)
+		gpk_application_details_add_row (priv, package_ids, selected);
+	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
+	model = GTK_TREE_MODEL (priv->packages_store);
+	if (gtk_tree_view_get_visible_range (treeview, &start, &end)) {
+		first = gtk_tree_path_get_indices (start)[0];
+		last = gtk_tree_path_get_indices (end)[0] + GPK_APPLICATION_DETAILS_LOOKAHEAD;
+		gtk_tree_path_free (start);
+		gtk_tree_path_free (end);
+	}
+	for (i = first; i <= last && package_ids->len < GPK_APPLICATION_DETAILS_BATCH_MAX; i++) {
+		if (!gtk_tree_model_iter_nth_child (model, &iter, NULL, i))
+			break;
+		gpk_application_details_add_row (priv, package_ids, &iter);
+	}
+	if (package_ids->len == 0)
+		return;
+
+	/* one transaction for all of them */
+	g_debug ("getting details of %u packages", package_ids->len);
+	g_ptr_array_add (package_ids, NULL);
+	batch = g_new0 (GpkApplicationDetailsBatch, 1);
+	batch->priv = priv;
+	batch->package_ids = (gchar **) g_ptr_array_free (g_steal_pointer (&package_ids), FALSE);
+
+	/* a newer selection replaces this one, rows just scrolled past do not */
+	gpk_scheduler_push (priv->scheduler,
+			    gpk_application_details_batch_has_selected (batch) ?
+				GPK_SCHEDULER_KIND_DETAILS : GPK_SCHEDULER_KIND_PREFETCH,
+			    (GpkSchedulerFunc) gpk_application_details_batch_start,
+			    (GAsyncReadyCallback) gpk_application_get_details_cb,
+			    batch, (GDestroyNotify) gpk_application_details_batch_free);
+}
+
+static gboolean
+gpk_application_details_prefetch_cb (GpkApplicationPrivate *priv)
+{
+	priv->details_prefetch_id = 0;
+	gpk_application_details_prefetch (priv, NULL);
+	return FALSE;
+}
+
+static void
+gpk_application_details_schedule_prefetch (GpkApplicationPrivate *priv)
+{
+	/* wait for scrolling to settle */
+	if (priv->details_prefetch_id > 0)
+		g_source_remove (priv->details_prefetch_id);
+	priv->details_prefetch_id =
+		g_timeout_add (GPK_APPLICATION_DETAILS_PREFETCH_DELAY,
+			       (GSourceFunc) gpk_application_details_prefetch_cb, priv);
+	g_source_set_name_by_id (priv->details_prefetch_id,
+				 "[GpkApplication] details-prefetch");
+}
+
+static void
+gpk_application_packages_adjustment_changed_cb (GtkAdjustment *adjustment, GpkApplicationPrivate *priv)
+{
+	/* less than a screen left, or the rows do not fill the view yet */
+	if (gtk_adjustment_get_value (adjustment) + 2 * gtk_adjustment_get_page_size (adjustment) <
+	    gtk_adjustment_get_upper (adjustment))
+		return;
+	gpk_application_all_packages_page (priv);
+}
+
+static void
+gpk_application_packages_scrolled_cb (GtkAdjustment *adjustment, GpkApplicationPrivate *priv)
+{
+	/* less than a screen above, and the pages before it were dropped;
+	 * loading them again scrolls back to where the view was */
+	if (gtk_adjustment_get_value (adjustment) < gtk_adjustment_get_page_size (adjustment)) {
+		g_signal_handlers_block_by_func (adjustment, gpk_application_packages_scrolled_cb, priv);
+		gpk_application_all_packages_page_back (priv);
+		g_signal_handlers_unblock_by_func (adjustment, gpk_application_packages_scrolled_cb, priv);
+	}
+	gpk_application_packages_adjustment_changed_cb (adjustment, priv);
+	gpk_application_details_schedule_prefetch (priv);
 }
 
 static void
@@ -1920,19 +4297,16 @@ gpk_application_packages_treeview_clicked_cb (GtkTreeSelection *selection, GpkAp
 	GtkWidget *widget;
 	GtkTreeModel *model;
 	GtkTreeIter iter;
-	gboolean show_install = TRUE;
-	gboolean show_remove = TRUE;
-	PkBitfield state;
-	g_auto(GStrv) package_ids = NULL;
+	PkDetails *details;
 	g_autofree gchar *package_id = NULL;
-	g_autofree gchar *summary = NULL;
 
 	/* ignore selection changed if we've just cleared the package list */
 	if (!priv->has_package)
 		return;
 
-	/* This will only work in single or browse selection mode! */
-	if (!gtk_tree_selection_get_selected (selection, &model, &iter)) {
+	/* the details are for the focused row */
+	model = GTK_TREE_MODEL (priv->packages_store);
+	if (!gpk_application_get_selected_iter (priv, &iter)) {
 		g_debug ("no row selected");
 
 		/* we cannot now add it */
@@ -1942,15 +4316,14 @@ gpk_application_packages_treeview_clicked_cb (GtkTreeSelection *selection, GpkAp
 		gtk_widget_hide (widget);
 
 		/* hide details */
+		g_clear_pointer (&priv->details_selected, g_free);
 		gpk_application_clear_details (priv);
 		return;
 	}
 
 	/* check we aren't a help line */
 	gtk_tree_model_get (model, &iter,
-			    PACKAGES_COLUMN_STATE, &state,
-			    PACKAGES_COLUMN_ID, &package_id,
-			    PACKAGES_COLUMN_SUMMARY, &summary,
+			    GPK_PACKAGE_MODEL_COLUMN_ID, &package_id,
 			    -1);
 	if (package_id == NULL) {
 		g_debug ("ignoring help click");
@@ -1961,32 +4334,24 @@ gpk_application_packages_treeview_clicked_cb (GtkTreeSelection *selection, GpkAp
 	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "hbox_packages"));
 	gtk_widget_show (widget);
 
-	show_install = (state == 0 ||
-			state == pk_bitfield_from_enums (GPK_STATE_INSTALLED, GPK_STATE_IN_LIST, -1));
-	show_remove = (state == pk_bitfield_value (GPK_STATE_INSTALLED) ||
-		       state == pk_bitfield_value (GPK_STATE_IN_LIST));
-
-	if (priv->action == GPK_ACTION_INSTALL && !pk_bitfield_contain (state, GPK_STATE_IN_LIST))
-		show_remove = FALSE;
-	if (priv->action == GPK_ACTION_REMOVE && !pk_bitfield_contain (state, GPK_STATE_IN_LIST))
-		show_install = FALSE;
-
 	/* only show buttons if we are in the correct mode */
-	gpk_application_allow_install (priv, show_install);
-	gpk_application_allow_remove (priv, show_remove);
+	gpk_application_update_buttons (priv);
+
+	/* we might have got this already */
+	g_free (priv->details_selected);
+	priv->details_selected = g_strdup (package_id);
+	details = g_hash_table_lookup (priv->details_cache, package_id);
+	if (details != NULL) {
+		gpk_application_show_details (priv, details);
+		return;
+	}
 
 	/* clear the description text */
 	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "textview_description"));
 	gpk_application_set_text_buffer (widget, NULL);
 
-	/* ensure new action succeeds */
-	g_cancellable_reset (priv->cancellable);
-
-	/* get the details */
-	package_ids = pk_package_ids_from_id (package_id);
-	pk_client_get_details_async (PK_CLIENT(priv->task), package_ids, priv->cancellable,
-				     (PkProgressCallback) gpk_application_progress_cb, priv,
-				     (GAsyncReadyCallback) gpk_application_get_details_cb, priv);
+	/* get the details, and the ones near it while we are asking */
+	gpk_application_details_prefetch (priv, &iter);
 }
 
 static void
@@ -2001,6 +4366,12 @@ gpk_application_notify_network_state_cb (PkControl *_control, GParamSpec *pspec,
 	g_debug ("state=%u", state);
 }
 
+static void
+gpk_application_results_changed_cb (PkControl *control, GpkApplicationPrivate *priv)
+{
+	gpk_application_invalidate_results (priv);
+}
+
 static void
 gpk_application_group_add_data (GpkApplicationPrivate *priv, PkGroupEnum group)
 {
@@ -2090,6 +4461,29 @@ gpk_application_menu_search_by_file (GtkMenuItem *item, GpkApplicationPrivate *p
 					   "folder-open");
 }
 
+static void
+gpk_application_menu_search_everything (GtkMenuItem *item, GpkApplicationPrivate *priv)
+{
+	GtkWidget *widget;
+
+	/* set type */
+	priv->search_type = GPK_SEARCH_ALL;
+	g_debug ("set search type=%u", priv->search_type);
+
+	/* save default to GSettings */
+	g_settings_set_enum (priv->settings,
+			     GPK_SETTINGS_SEARCH_MODE,
+			     priv->search_type);
+
+	/* set the new icon */
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "entry_text"));
+	/* TRANSLATORS: entry tooltip: name, description and file search at once */
+	gtk_widget_set_tooltip_text (widget, _("Searching names, descriptions and files"));
+	gtk_entry_set_icon_from_icon_name (GTK_ENTRY (widget),
+					   GTK_ENTRY_ICON_PRIMARY,
+					   "system-search");
+}
+
 static void
 gpk_application_entry_text_icon_press_cb (GtkEntry *entry, GtkEntryIconPosition icon_pos, GdkEventButton *event, GpkApplicationPrivate *priv)
 {
@@ -2126,6 +4520,16 @@ gpk_application_entry_text_icon_press_cb (GtkEntry *entry, GtkEntryIconPosition
 		gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
 	}
 
+	/* the searches that cannot be done are left out */
+	if (pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_SEARCH_DETAILS) ||
+	    pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_SEARCH_FILE)) {
+		/* TRANSLATORS: context menu item for the search type icon */
+		item = gtk_menu_item_new_with_mnemonic (_("Search everything"));
+		g_signal_connect (G_OBJECT (item), "activate",
+				  G_CALLBACK (gpk_application_menu_search_everything), priv);
+		gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
+	}
+
 	gtk_widget_show_all (GTK_WIDGET (menu));
 	gtk_menu_popup (GTK_MENU (menu), NULL, NULL, NULL, NULL,
 			event->button, event->time);
@@ -2301,20 +4705,22 @@ gpk_application_package_row_activated_cb (GtkTreeView *treeview, GtkTreePath *pa
 
 	/* get data */
 	gtk_tree_model_get (model, &iter,
-			    PACKAGES_COLUMN_STATE, &state,
-			    PACKAGES_COLUMN_ID, &package_id,
+			    GPK_PACKAGE_MODEL_COLUMN_STATE, &state,
+			    GPK_PACKAGE_MODEL_COLUMN_ID, &package_id,
 			    -1);
 
 	/* check we aren't a help line */
 	if (package_id == NULL) {
-		g_debug ("ignoring help click");
+		if (!gpk_application_activate_suggestion (priv, &iter))
+			g_debug ("ignoring help click");
 		return;
 	}
 
-	if (gpk_application_state_get_checkbox (state))
-		gpk_application_remove (priv);
-	else
-		gpk_application_install (priv);
+	gpk_application_queue_row (priv, &iter,
+				   gpk_package_state_get_checkbox (state) ?
+					GPK_ACTION_REMOVE : GPK_ACTION_INSTALL);
+	gpk_application_change_queue_status (priv);
+	gpk_application_update_buttons (priv);
 }
 
 static gboolean
@@ -2328,13 +4734,10 @@ gpk_application_group_row_separator_func (GtkTreeModel *model, GtkTreeIter *iter
 static void
 gpk_application_add_welcome (GpkApplicationPrivate *priv)
 {
-	GtkTreeIter iter;
 	const gchar *welcome;
-	PkBitfield state = 0;
 
 	g_debug ("CLEAR welcome");
 	gpk_application_clear_packages (priv);
-	gtk_list_store_append (priv->packages_store, &iter);
 
 	/* enter something nice */
 	if (pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_SEARCH_GROUP)) {
@@ -2344,15 +4747,7 @@ gpk_application_add_welcome (GpkApplicationPrivate *priv)
 		/* TRANSLATORS: welcome text if we have to search by name */
 		welcome = _("Enter a search word to get started.");
 	}
-	gtk_list_store_set (priv->packages_store, &iter,
-			    PACKAGES_COLUMN_STATE, state,
-			    PACKAGES_COLUMN_CHECKBOX, FALSE,
-			    PACKAGES_COLUMN_CHECKBOX_VISIBLE, FALSE,
-			    PACKAGES_COLUMN_TEXT, welcome,
-			    PACKAGES_COLUMN_IMAGE, "system-search",
-			    PACKAGES_COLUMN_SUMMARY, NULL,
-			    PACKAGES_COLUMN_ID, NULL,
-			    -1);
+	gpk_package_model_add_message (priv->packages_store, "system-search", welcome);
 }
 
 static void
@@ -2377,6 +4772,64 @@ gpk_application_create_group_array_enum (GpkApplicationPrivate *priv)
 	}
 }
 
+static void
+gpk_application_categories_add_node (GpkApplicationPrivate *priv, GNode *node, GtkTreeIter *parent)
+{
+	GtkTreeIter iter;
+	PkCategory *item;
+
+	for (node = node->children; node != NULL; node = node->next) {
+		item = node->data;
+		gtk_tree_store_append (priv->groups_store, &iter, parent);
+		gtk_tree_store_set (priv->groups_store, &iter,
+				    GROUPS_COLUMN_NAME, pk_category_get_name (item),
+				    GROUPS_COLUMN_SUMMARY, pk_category_get_summary (item),
+				    GROUPS_COLUMN_ID, pk_category_get_id (item),
+				    GROUPS_COLUMN_ICON, pk_category_get_icon (item),
+				    GROUPS_COLUMN_ACTIVE, parent != NULL,
+				    -1);
+		gpk_application_categories_add_node (priv, node, &iter);
+	}
+}
+
+static void
+gpk_application_categories_show (GpkApplicationPrivate *priv)
+{
+	GtkTreeIter iter;
+	GtkTreeModel *model = GTK_TREE_MODEL (priv->groups_store);
+	GtkTreeView *treeview;
+	gboolean valid;
+	g_autofree gchar *id = NULL;
+
+	/* set to expanders with indent */
+	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_groups"));
+	gtk_tree_view_set_show_expanders (treeview, TRUE);
+	gtk_tree_view_set_level_indentation  (treeview, 3);
+
+	/* remove the categories shown before, which are after the separator
+	 * if there is one */
+	valid = gtk_tree_model_get_iter_first (model, &iter);
+	while (valid) {
+		gtk_tree_model_get (model, &iter, GROUPS_COLUMN_ID, &id, -1);
+		if (g_strcmp0 (id, "separator") == 0)
+			break;
+		g_clear_pointer (&id, g_free);
+		valid = gtk_tree_model_iter_next (model, &iter);
+	}
+	if (valid) {
+		valid = gtk_tree_model_iter_next (model, &iter);
+		while (valid)
+			valid = gtk_tree_store_remove (priv->groups_store, &iter);
+	} else {
+		gtk_tree_store_clear (priv->groups_store);
+	}
+
+	gpk_application_categories_add_node (priv, gpk_category_tree_get_root (priv->categories), NULL);
+
+	/* open all expanders */
+	gtk_tree_view_collapse_all (treeview);
+}
+
 static void
 gpk_application_get_categories_cb (PkClient *client, GAsyncResult *res, GpkApplicationPrivate *priv)
 {
@@ -2384,12 +4837,8 @@ gpk_application_get_categories_cb (PkClient *client, GAsyncResult *res, GpkAppli
 	g_autoptr(GError) error = NULL;
 	g_autoptr(PkError) error_code = NULL;
 	g_autoptr(GPtrArray) array = NULL;
-	GtkTreeIter iter;
-	GtkTreeIter iter2;
-	guint i, j;
-	GtkTreeView *treeview;
-	PkCategory *item;
-	PkCategory *item2;
+	g_autoptr(GpkCategoryTree) categories = NULL;
+	g_autofree gchar *filename = NULL;
 	GtkWindow *window;
 
 	/* get the results */
@@ -2413,75 +4862,39 @@ gpk_application_get_categories_cb (PkClient *client, GAsyncResult *res, GpkAppli
 		return;
 	}
 
-	/* set to expanders with indent */
-	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_groups"));
-	gtk_tree_view_set_show_expanders (treeview, TRUE);
-	gtk_tree_view_set_level_indentation  (treeview, 3);
-
-	/* add repos with descriptions */
+	/* nothing changed since the copy we already showed */
 	array = pk_results_get_category_array (results);
-	for (i = 0; i < array->len; i++) {
-		g_autofree gchar *package_id = NULL;
-		g_autofree gchar *name = NULL;
-		g_autofree gchar *summary = NULL;
-		g_autofree gchar *cat_id = NULL;
-		g_autofree gchar *icon = NULL;
-
-		item = g_ptr_array_index (array, i);
-		g_object_get (item,
-			      "name", &name,
-			      "summary", &summary,
-			      "cat-id", &cat_id,
-			      "icon", &icon,
-			      NULL);
-
-		gtk_tree_store_append (priv->groups_store, &iter, NULL);
-		gtk_tree_store_set (priv->groups_store, &iter,
-				    GROUPS_COLUMN_NAME, name,
-				    GROUPS_COLUMN_SUMMARY, summary,
-				    GROUPS_COLUMN_ID, cat_id,
-				    GROUPS_COLUMN_ICON, icon,
-				    GROUPS_COLUMN_ACTIVE, FALSE,
-				    -1);
-		j = 0;
-		do {
-			g_autofree gchar *cat_id_tmp = NULL;
-			g_autofree gchar *icon_tmp = NULL;
-			g_autofree gchar *name_tmp = NULL;
-			g_autofree gchar *parent_id_tmp = NULL;
-			g_autofree gchar *summary_tmp = NULL;
-
-			/* only allows groups two layers deep */
-			item2 = g_ptr_array_index (array, j);
-			g_object_get (item2,
-				      "parent-id", &parent_id_tmp,
-				      "cat-id", &cat_id_tmp,
-				      "name", &name_tmp,
-				      "summary", &summary_tmp,
-				      "icon", &icon_tmp,
-				      NULL);
-			if (g_strcmp0 (parent_id_tmp, cat_id) == 0) {
-				gtk_tree_store_append (priv->groups_store, &iter2, &iter);
-				gtk_tree_store_set (priv->groups_store, &iter2,
-						    GROUPS_COLUMN_NAME, name_tmp,
-						    GROUPS_COLUMN_SUMMARY, summary_tmp,
-						    GROUPS_COLUMN_ID, cat_id_tmp,
-						    GROUPS_COLUMN_ICON, icon_tmp,
-						    GROUPS_COLUMN_ACTIVE, TRUE,
-						    -1);
-				g_ptr_array_remove (array, item2);
-			} else
-				j++;
-		} while (j < array->len);
-	}
-
-	/* open all expanders */
-	gtk_tree_view_collapse_all (treeview);
+	categories = gpk_category_tree_new ();
+	gpk_category_tree_set_categories (categories, array);
+	if (priv->categories_shown &&
+	    gpk_category_tree_equal (categories, priv->categories))
+		return;
+	g_set_object (&priv->categories, categories);
+	gpk_application_categories_show (priv);
+	priv->categories_shown = TRUE;
+
+	/* for the next time we start */
+	filename = gpk_application_get_cache_filename ("categories");
+	if (!gpk_category_tree_save (priv->categories, filename, &error))
+		g_warning ("failed to save categories: %s", error->message);
 }
 
 static void
 gpk_application_create_group_array_categories (GpkApplicationPrivate *priv)
 {
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *filename = NULL;
+
+	/* show what we had last time while the backend is asked */
+	priv->categories_shown = FALSE;
+	filename = gpk_application_get_cache_filename ("categories");
+	if (gpk_category_tree_load (priv->categories, filename, &error)) {
+		gpk_application_categories_show (priv);
+		priv->categories_shown = TRUE;
+	} else if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+		g_warning ("failed to load categories: %s", error->message);
+	}
+
 	/* ensure new action succeeds */
 	g_cancellable_reset (priv->cancellable);
 
@@ -2503,72 +4916,179 @@ gpk_application_key_changed_cb (GSettings *settings, const gchar *key, GpkApplic
 			gpk_application_create_group_array_categories (priv);
 		else
 			gpk_application_create_group_array_enum (priv);
-	} else if (g_strcmp0 (key, "filter-newest") == 0) {
-		/* refresh the search results */
-		if (g_settings_get_boolean (priv->settings, key))
-			pk_bitfield_add (priv->filters_current, PK_FILTER_ENUM_NEWEST);
-		else
-			pk_bitfield_remove (priv->filters_current, PK_FILTER_ENUM_NEWEST);
-		gpk_application_perform_search (priv);
-	} else if (g_strcmp0 (key, "filter-arch") == 0) {
-		/* refresh the search results */
-		if (g_settings_get_boolean (priv->settings, key))
-			pk_bitfield_add (priv->filters_current, PK_FILTER_ENUM_ARCH);
-		else
-			pk_bitfield_remove (priv->filters_current, PK_FILTER_ENUM_ARCH);
-		gpk_application_perform_search (priv);
+	} else if (g_strcmp0 (key, GPK_SETTINGS_FILTER_NEWEST) == 0 ||
+		   g_strcmp0 (key, GPK_SETTINGS_FILTER_ARCH) == 0 ||
+		   g_strcmp0 (key, GPK_SETTINGS_FILTER_BASENAME) == 0) {
+		/* the daemon returns everything, so nothing needs fetching */
+		gpk_application_update_facets (priv);
+	} else if (g_strcmp0 (key, GPK_SETTINGS_DETAILS_INDEX) == 0) {
+		if (!priv->catalog_stale)
+			gpk_application_details_index_update (priv);
+	} else if (g_strcmp0 (key, GPK_SETTINGS_SEARCH_CACHE_SIZE) == 0) {
+		gpk_result_cache_set_max_size (priv->result_cache,
+					       g_settings_get_uint (priv->settings, key) * 1024);
+	}
+}
+
+static gboolean
+gpk_application_startup_cache_load (GpkApplicationPrivate *priv, GError **error)
+{
+	GVariantIter *iter = NULL;
+	const gchar *repo_id;
+	const gchar *description;
+	gchar *data = NULL;
+	gsize len;
+	guint32 version;
+	guint64 roles;
+	guint64 filters;
+	guint64 groups;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GVariant) value = NULL;
+
+	filename = gpk_application_get_cache_filename ("startup");
+	if (!g_file_get_contents (filename, &data, &len, error))
+		return FALSE;
+	bytes = g_bytes_new_take (data, len);
+	value = g_variant_new_from_bytes (G_VARIANT_TYPE (GPK_APPLICATION_STARTUP_CACHE_FORMAT), bytes, FALSE);
+	g_variant_ref_sink (value);
+	g_variant_get (value, GPK_APPLICATION_STARTUP_CACHE_FORMAT,
+		       &version, &roles, &filters, &groups, &iter);
+	if (version != GPK_APPLICATION_STARTUP_CACHE_VERSION) {
+		g_variant_iter_free (iter);
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			     "%s is version %u, expected %u",
+			     filename, version, (guint) GPK_APPLICATION_STARTUP_CACHE_VERSION);
+		return FALSE;
+	}
+	priv->roles = roles;
+	priv->filters_supported = filters;
+	priv->groups = groups;
+	while (g_variant_iter_next (iter, "{&s&s}", &repo_id, &description))
+		g_hash_table_insert (priv->repos, g_strdup (repo_id), g_strdup (description));
+	g_variant_iter_free (iter);
+	return TRUE;
+}
+
+static gboolean
+gpk_application_startup_cache_save (GpkApplicationPrivate *priv, GError **error)
+{
+	GHashTableIter hash_iter;
+	GVariantBuilder builder;
+	const gchar *repo_id;
+	const gchar *description;
+	g_autofree gchar *dirname = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GVariant) value = NULL;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{ss}"));
+	g_hash_table_iter_init (&hash_iter, priv->repos);
+	while (g_hash_table_iter_next (&hash_iter, (gpointer *) &repo_id, (gpointer *) &description))
+		g_variant_builder_add (&builder, "{ss}", repo_id, description);
+	value = g_variant_new (GPK_APPLICATION_STARTUP_CACHE_FORMAT,
+			       (guint32) GPK_APPLICATION_STARTUP_CACHE_VERSION,
+			       (guint64) priv->roles,
+			       (guint64) priv->filters_supported,
+			       (guint64) priv->groups,
+			       &builder);
+	g_variant_ref_sink (value);
+
+	filename = gpk_application_get_cache_filename ("startup");
+	dirname = g_path_get_dirname (filename);
+	if (g_mkdir_with_parents (dirname, 0700) < 0) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+			     "failed to create %s", dirname);
+		return FALSE;
 	}
+	return g_file_set_contents (filename,
+				    g_variant_get_data (value),
+				    g_variant_get_size (value),
+				    error);
+}
+
+static gboolean
+gpk_application_startup_tick_cb (GtkWidget *widget, GdkFrameClock *clock, gpointer user_data)
+{
+	GpkApplicationPrivate *priv = (GpkApplicationPrivate *) user_data;
+	g_print ("Interactive after %.1fms%s\n",
+		 g_timer_elapsed (priv->startup_timer, NULL) * 1000,
+		 priv->startup_warm ? " (from cache)" : "");
+	priv->startup_painted = TRUE;
+	if (priv->startup_pending == 0)
+		gpk_application_quit (priv);
+	return G_SOURCE_REMOVE;
 }
 
+/* the whole window can be used from the next frame */
 static void
-pk_backend_status_get_properties_cb (GObject *object, GAsyncResult *res, GpkApplicationPrivate *priv)
+gpk_application_startup_interactive (GpkApplicationPrivate *priv)
+{
+	GtkWidget *window;
+
+	if (priv->startup_timer == NULL || priv->startup_interactive)
+		return;
+	priv->startup_interactive = TRUE;
+	window = GTK_WIDGET (gtk_builder_get_object (priv->builder, "window_manager"));
+	gtk_widget_add_tick_callback (window, gpk_application_startup_tick_cb, priv, NULL);
+	gtk_widget_queue_draw (window);
+}
+
+/* called as each reply from the daemon arrives */
+static void
+gpk_application_startup_reconciled (GpkApplicationPrivate *priv)
 {
-	GtkWidget *widget;
 	g_autoptr(GError) error = NULL;
-	PkControl *control = PK_CONTROL(object);
-	gboolean ret;
-	PkBitfield filters;
-	GtkTreeIter iter;
-	const gchar *icon_name;
 
-	/* get the result */
-	ret = pk_control_get_properties_finish (control, res, &error);
-	if (!ret) {
-		/* TRANSLATORS: daemon is broken */
-		g_print ("%s: %s\n", _("Exiting as properties could not be retrieved"), error->message);
+	if (priv->startup_pending == 0 || --priv->startup_pending > 0)
 		return;
+
+	/* for the next time we start, unless a reply never came */
+	if (priv->startup_failed)
+		g_debug ("not saving startup cache as the daemon did not reply");
+	else if (!gpk_application_startup_cache_save (priv, &error))
+		g_warning ("failed to save startup cache: %s", error->message);
+
+	if (priv->startup_timer != NULL) {
+		g_print ("Up to date with PackageKit after %.1fms\n",
+			 g_timer_elapsed (priv->startup_timer, NULL) * 1000);
+		if (priv->startup_painted)
+			gpk_application_quit (priv);
 	}
+}
 
-	/* get values */
-	g_object_get (control,
-		      "roles", &priv->roles,
-		      "filters", &filters,
-		      "groups", &priv->groups,
-		      NULL);
+/**
+ * gpk_application_setup_properties:
+ * @first: %TRUE the first time, %FALSE if the backend has changed since
+ *
+ * Makes the window match what the backend can do, from either the daemon
+ * or what was saved the last time we ran.
+ **/
+static void
+gpk_application_setup_properties (GpkApplicationPrivate *priv, gboolean first)
+{
+	GtkWidget *widget;
+	gboolean ret;
+	GtkTreeIter iter;
+	const gchar *icon_name;
 
 	/* Remove description/file array if needed. */
-	if (pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_GET_DETAILS) == FALSE) {
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "scrolledwindow2"));
-		gtk_widget_hide (widget);
-	}
-	if (pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_GET_FILES) == FALSE) {
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_files"));
-		gtk_widget_hide (widget);
-	}
-	if (pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_DEPENDS_ON) == FALSE) {
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_depends"));
-		gtk_widget_hide (widget);
-	}
-	if (pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_REQUIRED_BY) == FALSE) {
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_requires"));
-		gtk_widget_hide (widget);
-	}
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "scrolledwindow2"));
+	gtk_widget_set_visible (widget, pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_GET_DETAILS));
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_files"));
+	gtk_widget_set_visible (widget, pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_GET_FILES));
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_depends"));
+	gtk_widget_set_visible (widget, pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_DEPENDS_ON));
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_requires"));
+	gtk_widget_set_visible (widget, pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_REQUIRED_BY));
 
 	/* hide the group selector if we don't support search-groups */
-	if (pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_SEARCH_GROUP) == FALSE) {
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "scrolledwindow_groups"));
-		gtk_widget_hide (widget);
-	}
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "scrolledwindow_groups"));
+	gtk_widget_set_visible (widget, pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_SEARCH_GROUP));
+
+	/* start again if the backend changed */
+	gtk_tree_store_clear (priv->groups_store);
+	if (pk_package_sack_get_size (priv->package_sack) > 0)
+		gpk_application_group_add_selected (priv);
 
 	/* add an "all" entry if we can GetPackages */
 	ret = g_settings_get_boolean (priv->settings, GPK_SETTINGS_SHOW_ALL_PACKAGES);
@@ -2632,14 +5152,86 @@ pk_backend_status_get_properties_cb (GObject *object, GAsyncResult *res, GpkAppl
 			gpk_application_menu_search_by_name (NULL, priv);
 		}
 
+	/* whatever searches the backend can do, if more than a name */
+	} else if (priv->search_type == GPK_SEARCH_ALL) {
+		if (pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_SEARCH_DETAILS) ||
+		    pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_SEARCH_FILE)) {
+			gpk_application_menu_search_everything (NULL, priv);
+		} else {
+			g_warning ("cannot use mode %u as not capable, using name", priv->search_type);
+			gpk_application_menu_search_by_name (NULL, priv);
+		}
+
 	/* mode not recognized */
 	} else {
 		g_warning ("cannot recognize mode %u, using name", priv->search_type);
 		gpk_application_menu_search_by_name (NULL, priv);
 	}
 
+	/* the user might already be using the window */
+	if (!first)
+		return;
+
 	/* welcome */
 	gpk_application_add_welcome (priv);
+
+	/* answer name searches without the daemon */
+	gpk_application_catalog_setup (priv);
+}
+
+static void
+pk_backend_status_get_properties_cb (GObject *object, GAsyncResult *res, GpkApplicationPrivate *priv)
+{
+	g_autoptr(GError) error = NULL;
+	PkControl *control = PK_CONTROL(object);
+	gboolean ret;
+	PkBitfield filters;
+	PkBitfield groups;
+	PkBitfield roles;
+	g_autofree gchar *distro_id = NULL;
+	g_auto(GStrv) split = NULL;
+
+	/* get the result */
+	ret = pk_control_get_properties_finish (control, res, &error);
+	if (!ret) {
+		/* TRANSLATORS: daemon is broken */
+		g_print ("%s: %s\n", _("Exiting as properties could not be retrieved"), error->message);
+		priv->startup_failed = TRUE;
+		gpk_application_startup_interactive (priv);
+		gpk_application_startup_reconciled (priv);
+		return;
+	}
+
+	/* get values */
+	g_object_get (control,
+		      "roles", &roles,
+		      "filters", &filters,
+		      "groups", &groups,
+		      "distro-id", &distro_id,
+		      NULL);
+
+	/* for the native packages facet, e.g. "fedora;25;x86_64" */
+	if (distro_id != NULL) {
+		split = g_strsplit (distro_id, ";", -1);
+		if (g_strv_length (split) >= 3) {
+			gpk_package_model_set_native_arch (priv->packages_store, split[2]);
+			gpk_application_update_facet_counts (priv);
+		}
+	}
+
+	/* only redo the window if the backend changed since last time */
+	if (!priv->startup_warm ||
+	    roles != priv->roles ||
+	    filters != priv->filters_supported ||
+	    groups != priv->groups) {
+		g_debug ("backend properties changed");
+		priv->roles = roles;
+		priv->filters_supported = filters;
+		priv->groups = groups;
+		gpk_application_setup_properties (priv, !priv->startup_warm);
+	}
+	gpk_application_startup_interactive (priv);
+	gpk_application_startup_reconciled (priv);
 }
 
 static void
@@ -2657,6 +5249,8 @@ gpk_application_get_repo_list_cb (PkClient *client, GAsyncResult *res, GpkApplic
 	results = pk_client_generic_finish (client, res, &error);
 	if (results == NULL) {
 		g_warning ("failed to get list of repos: %s", error->message);
+		priv->startup_failed = TRUE;
+		gpk_application_startup_reconciled (priv);
 		return;
 	}
 
@@ -2671,10 +5265,13 @@ gpk_application_get_repo_list_cb (PkClient *client, GAsyncResult *res, GpkApplic
 			gpk_error_dialog_modal (window, gpk_error_enum_to_localised_text (pk_error_get_code (error_code)),
 						gpk_error_enum_to_localised_message (pk_error_get_code (error_code)), pk_error_get_details (error_code));
 		}
+		priv->startup_failed = TRUE;
+		gpk_application_startup_reconciled (priv);
 		return;
 	}
 
-	/* add repos with descriptions */
+	/* add repos with descriptions, forgetting any that have gone */
+	g_hash_table_remove_all (priv->repos);
 	array = pk_results_get_repo_detail_array (results);
 	for (i = 0; i < array->len; i++) {
 		g_autofree gchar *repo_id = NULL;
@@ -2690,6 +5287,7 @@ gpk_application_get_repo_list_cb (PkClient *client, GAsyncResult *res, GpkApplic
 		if (description != NULL)
 			g_hash_table_insert (priv->repos, g_strdup (repo_id), g_strdup (description));
 	}
+	gpk_application_startup_reconciled (priv);
 }
 
 static void
@@ -2712,22 +5310,34 @@ gpk_application_startup_cb (GtkApplication *application, GpkApplicationPrivate *
 	guint retval;
 
 	priv->package_sack = pk_package_sack_new ();
+	priv->package_queued = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+						      (GDestroyNotify) gpk_package_atom_unref, NULL);
 	priv->settings = g_settings_new (GPK_SETTINGS_SCHEMA);
 	priv->cancellable = g_cancellable_new ();
+	priv->search_cancellable = g_cancellable_new ();
 	priv->repos = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	priv->search_seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	priv->search_matches = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	priv->search_pending = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	priv->details_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_object_unref);
+	priv->details_requested = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	priv->catalog = gpk_catalog_new ();
+	priv->details_index = gpk_trigram_index_new ();
+	priv->details_index_pending = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	priv->scheduler = gpk_scheduler_new (GPK_APPLICATION_MAX_TRANSACTIONS);
+	priv->dependency_graph = gpk_dependency_graph_new ();
+	priv->categories = gpk_category_tree_new ();
+	priv->result_cache = gpk_result_cache_new (g_settings_get_uint (priv->settings, GPK_SETTINGS_SEARCH_CACHE_SIZE) * 1024);
 
 	/* watch gnome-packagekit keys */
 	g_signal_connect (priv->settings, "changed", G_CALLBACK (gpk_application_key_changed_cb), priv);
 
 	/* create array stores */
-	priv->packages_store = gtk_list_store_new (PACKAGES_COLUMN_LAST,
-					      G_TYPE_STRING,
-					      G_TYPE_UINT64,
-					      G_TYPE_BOOLEAN,
-					      G_TYPE_BOOLEAN,
-					      G_TYPE_STRING,
-					      G_TYPE_STRING,
-					      G_TYPE_STRING);
+	priv->packages_store = gpk_package_model_new ();
+	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (priv->packages_store),
+					      GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID,
+					      GTK_SORT_ASCENDING);
 	priv->groups_store = gtk_tree_store_new (GROUPS_COLUMN_LAST,
 					   G_TYPE_STRING,
 					   G_TYPE_STRING,
@@ -2749,10 +5359,21 @@ gpk_application_startup_cb (GtkApplication *application, GpkApplicationPrivate *
 		      "background", FALSE,
 		      NULL);
 
+	/* used to keep the catalog up to date */
+	priv->catalog_client = pk_client_new ();
+	g_object_set (priv->catalog_client,
+		      "background", TRUE,
+		      "interactive", FALSE,
+		      NULL);
+
 	/* get properties */
 	pk_control_get_properties_async (priv->control, NULL, (GAsyncReadyCallback) pk_backend_status_get_properties_cb, priv);
 	g_signal_connect (priv->control, "notify::network-state",
 			  G_CALLBACK (gpk_application_notify_network_state_cb), priv);
+	g_signal_connect (priv->control, "updates-changed",
+			  G_CALLBACK (gpk_application_results_changed_cb), priv);
+	g_signal_connect (priv->control, "repo-list-changed",
+			  G_CALLBACK (gpk_application_results_changed_cb), priv);
 
 	/* get UI */
 	priv->builder = gtk_builder_new ();
@@ -2765,6 +5386,8 @@ gpk_application_startup_cb (GtkApplication *application, GpkApplicationPrivate *
 	}
 
 	main_window = GTK_WIDGET (gtk_builder_get_object (priv->builder, "window_manager"));
+	gpk_package_model_set_style (priv->packages_store,
+				     gtk_widget_get_style_context (main_window));
 	gtk_application_add_window (application, GTK_WINDOW (main_window));
 	gtk_window_set_application (GTK_WINDOW (main_window), application);
 
@@ -2775,6 +5398,8 @@ gpk_application_startup_cb (GtkApplication *application, GpkApplicationPrivate *
 	g_action_map_add_action (G_ACTION_MAP (priv->application), action);
 	action = g_settings_create_action (priv->settings, "filter-arch");
 	g_action_map_add_action (G_ACTION_MAP (priv->application), action);
+	action = g_settings_create_action (priv->settings, GPK_SETTINGS_FILTER_BASENAME);
+	g_action_map_add_action (G_ACTION_MAP (priv->application), action);
 
 	/* Hide window first so that the dialogue resizes itself without redrawing */
 	gtk_widget_hide (main_window);
@@ -2854,10 +5479,8 @@ gpk_application_startup_cb (GtkApplication *application, GpkApplicationPrivate *
 	gtk_tree_view_columns_autosize (GTK_TREE_VIEW (widget));
 	g_signal_connect (GTK_TREE_VIEW (widget), "row-activated",
 			  G_CALLBACK (gpk_application_package_row_activated_cb), priv);
-
-	/* sorted */
-	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (priv->packages_store),
-					      PACKAGES_COLUMN_ID, GTK_SORT_ASCENDING);
+	g_signal_connect (GTK_TREE_VIEW (widget), "button-press-event",
+			  G_CALLBACK (gpk_application_packages_button_press_cb), priv);
 
 	/* create package tree view */
 	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "treeview_packages"));
@@ -2865,8 +5488,13 @@ gpk_application_startup_cb (GtkApplication *application, GpkApplicationPrivate *
 				 GTK_TREE_MODEL (priv->packages_store));
 
 	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (widget));
+	gtk_tree_selection_set_mode (selection, GTK_SELECTION_MULTIPLE);
 	g_signal_connect (selection, "changed",
 			  G_CALLBACK (gpk_application_packages_treeview_clicked_cb), priv);
+	g_signal_connect (gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (widget)), "value-changed",
+			  G_CALLBACK (gpk_application_packages_scrolled_cb), priv);
+	g_signal_connect (gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (widget)), "changed",
+			  G_CALLBACK (gpk_application_packages_adjustment_changed_cb), priv);
 
 	/* add columns to the tree view */
 	gpk_application_packages_add_columns (priv);
@@ -2893,16 +5521,23 @@ gpk_application_startup_cb (GtkApplication *application, GpkApplicationPrivate *
 				       (PkProgressCallback) gpk_application_progress_cb, priv,
 				       (GAsyncReadyCallback) gpk_application_get_repo_list_cb, priv);
 
-	/* set current action */
-	priv->action = GPK_ACTION_NONE;
 	gpk_application_change_queue_status (priv);
 
 	/* sync toggles */
-	gpk_application_key_changed_cb (priv->settings, "filter-newest", priv);
-	gpk_application_key_changed_cb (priv->settings, "filter-arch", priv);
+	gpk_application_update_facets (priv);
 
 	/* hide details */
 	gpk_application_clear_details (priv);
+
+	/* show what the backend could do last time, and check it when it replies */
+	priv->startup_pending = 2;
+	if (gpk_application_startup_cache_load (priv, &error)) {
+		priv->startup_warm = TRUE;
+		gpk_application_setup_properties (priv, TRUE);
+		gpk_application_startup_interactive (priv);
+	} else if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+		g_warning ("failed to load startup cache: %s", error->message);
+	}
 }
 
 static void
@@ -2940,10 +5575,60 @@ static GActionEntry gpk_menu_app_entries[] = {
 	{ "about",		gpk_application_activate_about_cb, NULL, NULL, NULL },
 };
 
+static gint
+gpk_application_benchmark_details (const gchar *text)
+{
+	g_auto(GStrv) searches = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GTimer) timer = NULL;
+	g_autoptr(GpkTrigramIndex) index = NULL;
+	g_autoptr(PkClient) client = NULL;
+	g_autoptr(PkResults) results = NULL;
+
+	searches = g_strsplit (text, " ", -1);
+	timer = g_timer_new ();
+
+	/* the local index, as written by a running gpk-application */
+	index = gpk_trigram_index_new ();
+	filename = gpk_application_get_cache_filename ("details-index");
+	if (!gpk_trigram_index_load (index, filename, &error)) {
+		g_print ("Failed to load index: %s\n", error->message);
+		return 1;
+	}
+	g_print ("Loaded %u packages in %.1fms\n",
+		 gpk_trigram_index_get_size (index),
+		 g_timer_elapsed (timer, NULL) * 1000);
+	g_timer_reset (timer);
+	array = gpk_trigram_index_search (index, searches);
+	g_print ("Index:  %u packages in %.3fms\n",
+		 array->len, g_timer_elapsed (timer, NULL) * 1000);
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	/* the same search in the daemon */
+	client = pk_client_new ();
+	g_timer_reset (timer);
+	results = pk_client_search_details (client, pk_bitfield_value (PK_FILTER_ENUM_NONE),
+					    searches, NULL, NULL, NULL, &error);
+	if (results == NULL) {
+		g_print ("Failed to search: %s\n", error->message);
+		return 1;
+	}
+	array = pk_results_get_package_array (results);
+	g_print ("Daemon: %u packages in %.3fms\n",
+		 array->len, g_timer_elapsed (timer, NULL) * 1000);
+	return 0;
+}
+
 int
 main (int argc, char *argv[])
 {
 	gboolean program_version = FALSE;
+	g_autofree gchar *benchmark_details = NULL;
+	gboolean benchmark_startup = FALSE;
+	gboolean allow_privileged = FALSE;
+	g_autofree gchar *search = NULL;
 	GOptionContext *context;
 	gboolean ret;
 	gint status = 0;
@@ -2954,6 +5639,16 @@ main (int argc, char *argv[])
 		{ "version", '\0', 0, G_OPTION_ARG_NONE, &program_version,
 		  /* TRANSLATORS: show the program version */
 		  _("Show the program version and exit"), NULL },
+		{ "benchmark-details", '\0', 0, G_OPTION_ARG_STRING, &benchmark_details,
+		  "Time a details search using the local index and PackageKit, then exit", NULL },
+		{ "benchmark-startup", '\0', 0, G_OPTION_ARG_NONE, &benchmark_startup,
+		  /* TRANSLATORS: developer option to time starting the window */
+		  _("Time how long the window takes to be usable, then exit"), NULL },
+		{ "allow-privileged", '\0', G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_NONE, &allow_privileged,
+		  /* TRANSLATORS: developer option, for running from automated tests */
+		  _("Do not warn when running as a privileged user"), NULL },
+		{ "search", '\0', G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_STRING, &search,
+		  "Search for this once the packages are known, for profiling", NULL },
 		{ NULL}
 	};
 
@@ -2964,6 +5659,7 @@ main (int argc, char *argv[])
 	textdomain (GETTEXT_PACKAGE);
 
 	gtk_init (&argc, &argv);
+	gpk_profile_init ();
 
 	context = g_option_context_new (NULL);
 	g_option_context_set_summary (context, _("Install Software"));
@@ -2981,12 +5677,18 @@ main (int argc, char *argv[])
 		return 0;
 	}
 
+	if (benchmark_details != NULL)
+		return gpk_application_benchmark_details (benchmark_details);
+
 	/* are we running privileged */
-	ret = gpk_check_privileged_user (_("Package installer"), TRUE);
+	ret = gpk_check_privileged_user (_("Package installer"), !allow_privileged);
 	if (!ret)
 		return 1;
 
 	priv = g_new0 (GpkApplicationPrivate, 1);
+	if (benchmark_startup)
+		priv->startup_timer = g_timer_new ();
+	priv->profile_search = g_steal_pointer (&search);
 
 	/* are we already activated? */
 	priv->application = gtk_application_new ("org.freedesktop.PackageKit.Application", 0);
@@ -3011,9 +5713,43 @@ main (int argc, char *argv[])
 
 	if (priv->details_event_id > 0)
 		g_source_remove (priv->details_event_id);
+	if (priv->details_prefetch_id > 0)
+		g_source_remove (priv->details_prefetch_id);
+	if (priv->details_cache != NULL)
+		g_hash_table_unref (priv->details_cache);
+	if (priv->details_requested != NULL)
+		g_hash_table_unref (priv->details_requested);
+	g_free (priv->details_selected);
 
 	if (priv->packages_store != NULL)
 		g_object_unref (priv->packages_store);
+	if (priv->result_cache != NULL)
+		g_object_unref (priv->result_cache);
+	if (priv->scheduler != NULL)
+		g_object_unref (priv->scheduler);
+	if (priv->dependency_graph != NULL)
+		g_object_unref (priv->dependency_graph);
+	if (priv->startup_timer != NULL)
+		g_timer_destroy (priv->startup_timer);
+	g_free (priv->profile_search);
+	if (priv->categories != NULL)
+		g_object_unref (priv->categories);
+	if (priv->catalog_client != NULL)
+		g_object_unref (priv->catalog_client);
+	if (priv->catalog != NULL)
+		g_object_unref (priv->catalog);
+	if (priv->details_index != NULL)
+		g_object_unref (priv->details_index);
+	if (priv->details_index_pending != NULL)
+		g_ptr_array_unref (priv->details_index_pending);
+	if (priv->details_index_retry_id > 0)
+		g_source_remove (priv->details_index_retry_id);
+	if (priv->name_index_cancellable != NULL) {
+		g_cancellable_cancel (priv->name_index_cancellable);
+		g_object_unref (priv->name_index_cancellable);
+	}
+	if (priv->name_index != NULL)
+		g_object_unref (priv->name_index);
 	if (priv->control != NULL)
 		g_object_unref (priv->control);
 	if (priv->task != NULL)
@@ -3026,13 +5762,28 @@ main (int argc, char *argv[])
 		g_object_unref (priv->cancellable);
 	if (priv->package_sack != NULL)
 		g_object_unref (priv->package_sack);
+	if (priv->package_queued != NULL)
+		g_hash_table_unref (priv->package_queued);
 	if (priv->repos != NULL)
 		g_hash_table_destroy (priv->repos);
+	if (priv->search_seen != NULL)
+		g_hash_table_destroy (priv->search_seen);
+	if (priv->search_matches != NULL)
+		g_hash_table_destroy (priv->search_matches);
+	if (priv->search_pending != NULL)
+		g_ptr_array_unref (priv->search_pending);
+	if (priv->search_flush_id > 0)
+		g_source_remove (priv->search_flush_id);
+	if (priv->search_timeout_id > 0)
+		g_source_remove (priv->search_timeout_id);
+	if (priv->search_cancellable != NULL)
+		g_object_unref (priv->search_cancellable);
 	if (priv->status_id > 0)
 		g_source_remove (priv->status_id);
 	g_free (priv->homepage_url);
 	g_free (priv->search_group);
 	g_free (priv->search_text);
+	g_free (priv->search_text_narrow);
 	g_free (priv);
 
 	return status;
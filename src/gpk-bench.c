@@ -0,0 +1,486 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <gtk/gtk.h>
+#include <packagekit-glib2/packagekit.h>
+
+#include "gpk-category-tree.h"
+#include "gpk-common.h"
+#include "gpk-dialog.h"
+#include "gpk-update-tree.h"
+
+/* each benchmark is repeated until it has run for at least this long */
+#define GPK_BENCH_MIN_TIME		0.2 /* s */
+
+/* allocation counts are exact, so only allow for rounding */
+#define GPK_BENCH_ALLOCS_SLACK		0.5
+
+typedef guint	(*GpkBenchFunc)		(gpointer	 user_data);
+
+typedef struct {
+	const gchar		*name;
+	gdouble			 ns_per_op;
+	gdouble			 allocs_per_op;	/* or -1 if unknown */
+} GpkBenchResult;
+
+/* counting allocations needs the malloc in glibc to be wrapped */
+#ifdef __GLIBC__
+static volatile guint64 gpk_bench_allocs = 0;
+
+extern void	*__libc_malloc		(size_t size);
+extern void	*__libc_calloc		(size_t nmemb, size_t size);
+extern void	*__libc_realloc		(void *ptr, size_t size);
+
+void *
+malloc (size_t size)
+{
+	gpk_bench_allocs++;
+	return __libc_malloc (size);
+}
+
+void *
+calloc (size_t nmemb, size_t size)
+{
+	gpk_bench_allocs++;
+	return __libc_calloc (nmemb, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+	gpk_bench_allocs++;
+	return __libc_realloc (ptr, size);
+}
+#endif
+
+static guint64
+gpk_bench_get_allocs (void)
+{
+#ifdef __GLIBC__
+	return gpk_bench_allocs;
+#else
+	return 0;
+#endif
+}
+
+static void
+gpk_bench_run (GArray *results, const gchar *name, GpkBenchFunc func, gpointer user_data)
+{
+	GpkBenchResult result;
+	gdouble elapsed = 0;
+	guint64 allocs;
+	guint64 ops = 0;
+	g_autoptr(GTimer) timer = NULL;
+
+	/* fill caches, and intern whatever is interned once */
+	func (user_data);
+
+	allocs = gpk_bench_get_allocs ();
+	timer = g_timer_new ();
+	while (elapsed < GPK_BENCH_MIN_TIME) {
+		ops += func (user_data);
+		elapsed = g_timer_elapsed (timer, NULL);
+	}
+	result.name = name;
+	result.ns_per_op = elapsed * 1e9 / (gdouble) ops;
+#ifdef __GLIBC__
+	result.allocs_per_op = (gdouble) (gpk_bench_get_allocs () - allocs) / (gdouble) ops;
+#else
+	result.allocs_per_op = -1;
+#endif
+	g_array_append_val (results, result);
+}
+
+static GPtrArray *
+gpk_bench_get_packages (guint size)
+{
+	GPtrArray *packages;
+	PkInfoEnum infos[] = { PK_INFO_ENUM_NORMAL, PK_INFO_ENUM_BUGFIX,
+			       PK_INFO_ENUM_SECURITY, PK_INFO_ENUM_ENHANCEMENT,
+			       PK_INFO_ENUM_INSTALLED };
+	guint i;
+
+	/* something like a real distribution */
+	packages = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (i = 0; i < size; i++) {
+		PkPackage *package = pk_package_new ();
+		g_autofree gchar *package_id = NULL;
+		package_id = g_strdup_printf ("pack%05u;1.0.%u-1.fc25;%s;%s",
+					      (i * 7919) % size, i,
+					      i % 3 == 0 ? "noarch" : "x86_64",
+					      i % 10 == 0 ? "installed" : "fedora");
+		pk_package_set_id (package, package_id, NULL);
+		g_object_set (package,
+			      "info", infos[i % G_N_ELEMENTS (infos)],
+			      "summary", "A package & its <friends>",
+			      NULL);
+		g_ptr_array_add (packages, package);
+	}
+	return packages;
+}
+
+typedef struct {
+	GPtrArray		*packages;
+	GtkStyleContext		*style;
+} GpkBenchFormat;
+
+static guint
+gpk_bench_format_twoline_cb (gpointer user_data)
+{
+	GpkBenchFormat *data = user_data;
+	PkPackage *package;
+	guint i;
+
+	for (i = 0; i < data->packages->len; i++) {
+		g_autofree gchar *text = NULL;
+		package = g_ptr_array_index (data->packages, i);
+		text = gpk_package_id_format_twoline (data->style,
+						      pk_package_get_id (package),
+						      pk_package_get_summary (package));
+	}
+	return data->packages->len;
+}
+
+static guint
+gpk_bench_format_oneline_cb (gpointer user_data)
+{
+	GpkBenchFormat *data = user_data;
+	PkPackage *package;
+	guint i;
+
+	for (i = 0; i < data->packages->len; i++) {
+		g_autofree gchar *text = NULL;
+		package = g_ptr_array_index (data->packages, i);
+		text = gpk_package_id_format_oneline (pk_package_get_id (package),
+						      pk_package_get_summary (package));
+	}
+	return data->packages->len;
+}
+
+static guint
+gpk_bench_dialog_list_store_cb (gpointer user_data)
+{
+	GpkBenchFormat *data = user_data;
+	g_autoptr(GtkListStore) store = NULL;
+
+	store = gpk_dialog_package_array_to_list_store (data->packages);
+	return data->packages->len;
+}
+
+static guint
+gpk_bench_update_tree_cb (gpointer user_data)
+{
+	GpkBenchFormat *data = user_data;
+	guint i;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GtkTreeStore) store = NULL;
+	g_autoptr(PkPackageSack) sack = NULL;
+
+	/* the same steps as gpk-update-viewer, without the window */
+	sack = pk_package_sack_new ();
+	for (i = 0; i < data->packages->len; i++)
+		pk_package_sack_add_package (sack, g_ptr_array_index (data->packages, i));
+	pk_package_sack_sort (sack, PK_PACKAGE_SACK_SORT_TYPE_NAME);
+	array = pk_package_sack_get_array (sack);
+	store = gpk_update_tree_store_new ();
+	gpk_update_tree_add_packages (store, data->style, array, TRUE);
+	return array->len;
+}
+
+static guint
+gpk_bench_category_tree_cb (gpointer user_data)
+{
+	GPtrArray *categories = user_data;
+	g_autoptr(GpkCategoryTree) tree = gpk_category_tree_new ();
+
+	gpk_category_tree_set_categories (tree, categories);
+	return categories->len;
+}
+
+static GPtrArray *
+gpk_bench_get_categories (void)
+{
+	GPtrArray *categories;
+	guint i;
+	guint j;
+
+	/* like comps, a few levels deep */
+	categories = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (i = 0; i < 50; i++) {
+		g_autofree gchar *parent_id = g_strdup_printf ("parent%u", i);
+		g_ptr_array_add (categories, g_object_new (PK_TYPE_CATEGORY,
+							   "parent-id", "",
+							   "cat-id", parent_id,
+							   "name", parent_id,
+							   NULL));
+		for (j = 0; j < 9; j++) {
+			g_autofree gchar *cat_id = g_strdup_printf ("@category%u_%u", i, j);
+			g_ptr_array_add (categories, g_object_new (PK_TYPE_CATEGORY,
+								   "parent-id", parent_id,
+								   "cat-id", cat_id,
+								   "name", cat_id,
+								   NULL));
+		}
+	}
+	return categories;
+}
+
+typedef struct {
+	GPtrArray		*transactions;
+	const gchar		*filter;
+} GpkBenchLog;
+
+static guint
+gpk_bench_log_filter_cb (gpointer user_data)
+{
+	GpkBenchLog *data = user_data;
+	guint i;
+
+	for (i = 0; i < data->transactions->len; i++)
+		gpk_log_filter (g_ptr_array_index (data->transactions, i), data->filter);
+	return data->transactions->len;
+}
+
+static guint
+gpk_bench_log_details_cb (gpointer user_data)
+{
+	GpkBenchLog *data = user_data;
+	PkTransactionPast *item;
+	guint i;
+
+	for (i = 0; i < data->transactions->len; i++) {
+		g_autofree gchar *details = NULL;
+		g_autofree gchar *timespec = NULL;
+		g_autofree gchar *text = NULL;
+		item = g_ptr_array_index (data->transactions, i);
+		g_object_get (item,
+			      "timespec", &timespec,
+			      "data", &text,
+			      NULL);
+		details = gpk_log_get_details_localised (timespec, text);
+	}
+	return data->transactions->len;
+}
+
+static GPtrArray *
+gpk_bench_get_transactions (guint size)
+{
+	GPtrArray *transactions;
+	guint i;
+	guint j;
+
+	transactions = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (i = 0; i < size; i++) {
+		g_autofree gchar *tid = g_strdup_printf ("/%u_bench", i);
+		g_autoptr(GString) data = g_string_new (NULL);
+		for (j = 0; j < 1 + i % 5; j++) {
+			g_string_append_printf (data, "%s\tpack%05u;1.0.%u-1.fc25;x86_64;fedora\n",
+						j % 2 == 0 ? "installing" : "updating",
+						i * 5 + j, j);
+		}
+		g_string_truncate (data, data->len - 1);
+		g_ptr_array_add (transactions, g_object_new (PK_TYPE_TRANSACTION_PAST,
+							     "tid", tid,
+							     "timespec", "2016-10-10T09:00:00Z",
+							     "succeeded", TRUE,
+							     "role", PK_ROLE_ENUM_INSTALL_PACKAGES,
+							     "duration", 1000,
+							     "data", data->str,
+							     "uid", 1000,
+							     "cmdline", "/usr/bin/gpk-application",
+							     NULL));
+	}
+	return transactions;
+}
+
+static gboolean
+gpk_bench_check_baseline (GArray *results, const gchar *filename,
+			  gdouble threshold, GError **error)
+{
+	GpkBenchResult *result;
+	gboolean ret = TRUE;
+	gdouble allocs;
+	gdouble ns;
+	guint i;
+	g_autoptr(GKeyFile) keyfile = g_key_file_new ();
+
+	if (!g_key_file_load_from_file (keyfile, filename, G_KEY_FILE_NONE, error))
+		return FALSE;
+	for (i = 0; i < results->len; i++) {
+		result = &g_array_index (results, GpkBenchResult, i);
+		if (!g_key_file_has_group (keyfile, result->name)) {
+			g_printerr ("%s: not in baseline\n", result->name);
+			continue;
+		}
+		ns = g_key_file_get_double (keyfile, result->name, "ns-per-op", NULL);
+		if (ns > 0 && result->ns_per_op > ns * (1 + threshold / 100)) {
+			g_printerr ("%s: %.1fns/op is slower than %.1fns/op\n",
+				    result->name, result->ns_per_op, ns);
+			ret = FALSE;
+		}
+		/* allocation counts depend on the libc, so may not be saved */
+		if (!g_key_file_has_key (keyfile, result->name, "allocs-per-op", NULL))
+			continue;
+		allocs = g_key_file_get_double (keyfile, result->name, "allocs-per-op", NULL);
+		if (result->allocs_per_op >= 0 &&
+		    result->allocs_per_op > allocs + GPK_BENCH_ALLOCS_SLACK) {
+			g_printerr ("%s: %.1f allocs/op is more than %.1f allocs/op\n",
+				    result->name, result->allocs_per_op, allocs);
+			ret = FALSE;
+		}
+	}
+	if (!ret) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+				     "slower than the baseline");
+	}
+	return ret;
+}
+
+static gboolean
+gpk_bench_save_baseline (GArray *results, const gchar *filename, GError **error)
+{
+	GpkBenchResult *result;
+	guint i;
+	g_autoptr(GKeyFile) keyfile = g_key_file_new ();
+
+	for (i = 0; i < results->len; i++) {
+		result = &g_array_index (results, GpkBenchResult, i);
+		g_key_file_set_double (keyfile, result->name, "ns-per-op", result->ns_per_op);
+		g_key_file_set_double (keyfile, result->name, "allocs-per-op", result->allocs_per_op);
+	}
+	return g_key_file_save_to_file (keyfile, filename, error);
+}
+
+static void
+gpk_bench_print (GArray *results, gboolean json)
+{
+	GpkBenchResult *result;
+	guint i;
+
+	if (json)
+		g_print ("{\n  \"results\": [\n");
+	for (i = 0; i < results->len; i++) {
+		result = &g_array_index (results, GpkBenchResult, i);
+		if (json) {
+			g_print ("    { \"name\": \"%s\", \"ns_per_op\": %.1f, "
+				 "\"allocs_per_op\": %.2f }%s\n",
+				 result->name, result->ns_per_op,
+				 result->allocs_per_op,
+				 i + 1 < results->len ? "," : "");
+		} else {
+			g_print ("%-32s %12.1f ns/op %10.2f allocs/op\n",
+				 result->name, result->ns_per_op,
+				 result->allocs_per_op);
+		}
+	}
+	if (json)
+		g_print ("  ]\n}\n");
+}
+
+int
+main (int argc, char *argv[])
+{
+	GOptionContext *context;
+	GpkBenchFormat format;
+	GpkBenchLog log;
+	gboolean json = FALSE;
+	gdouble threshold = 20;
+	g_autofree gchar *baseline = NULL;
+	g_autofree gchar *save_baseline = NULL;
+	g_autoptr(GArray) results = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) categories = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(GPtrArray) transactions = NULL;
+	g_autoptr(GPtrArray) updates = NULL;
+	g_autoptr(GtkStyleContext) style = NULL;
+
+	const GOptionEntry options[] = {
+		{ "json", '\0', 0, G_OPTION_ARG_NONE, &json,
+		  "Print the results as JSON", NULL },
+		{ "baseline", '\0', 0, G_OPTION_ARG_FILENAME, &baseline,
+		  "Fail if slower than the results in this file", NULL },
+		{ "save-baseline", '\0', 0, G_OPTION_ARG_FILENAME, &save_baseline,
+		  "Save the results as the new baseline", NULL },
+		{ "threshold", '\0', 0, G_OPTION_ARG_DOUBLE, &threshold,
+		  "How much slower is allowed, in percent", NULL },
+		{ NULL}
+	};
+
+	gtk_init (&argc, &argv);
+
+	context = g_option_context_new (NULL);
+	g_option_context_set_summary (context, "Benchmark the shared code");
+	g_option_context_add_main_entries (context, options, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_option_context_free (context);
+		return 1;
+	}
+	g_option_context_free (context);
+
+	results = g_array_new (FALSE, FALSE, sizeof (GpkBenchResult));
+	style = gtk_style_context_new ();
+	packages = gpk_bench_get_packages (1000);
+	updates = gpk_bench_get_packages (500);
+	categories = gpk_bench_get_categories ();
+	transactions = gpk_bench_get_transactions (5000);
+
+	format.packages = packages;
+	format.style = style;
+	gpk_bench_run (results, "package-id-format-twoline",
+		       gpk_bench_format_twoline_cb, &format);
+	gpk_bench_run (results, "package-id-format-oneline",
+		       gpk_bench_format_oneline_cb, &format);
+	gpk_bench_run (results, "dialog-package-list-store",
+		       gpk_bench_dialog_list_store_cb, &format);
+	format.packages = updates;
+	gpk_bench_run (results, "update-tree-build",
+		       gpk_bench_update_tree_cb, &format);
+	gpk_bench_run (results, "category-tree-build",
+		       gpk_bench_category_tree_cb, categories);
+
+	log.transactions = transactions;
+	log.filter = "pack04242";
+	gpk_bench_run (results, "log-filter",
+		       gpk_bench_log_filter_cb, &log);
+	gpk_bench_run (results, "log-details-localised",
+		       gpk_bench_log_details_cb, &log);
+
+	gpk_bench_print (results, json);
+
+	if (save_baseline != NULL &&
+	    !gpk_bench_save_baseline (results, save_baseline, &error)) {
+		g_printerr ("failed to save baseline: %s\n", error->message);
+		return 1;
+	}
+	if (baseline != NULL &&
+	    !gpk_bench_check_baseline (results, baseline, threshold, &error)) {
+		g_printerr ("%s\n", error->message);
+		return 1;
+	}
+	return 0;
+}
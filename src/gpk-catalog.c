@@ -0,0 +1,519 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <packagekit-glib2/packagekit.h>
+
+#include "gpk-catalog.h"
+#include "gpk-common.h"
+
+/*
+ * The catalog is a single file that is mapped into memory, laid out as:
+ *
+ *  GpkCatalogHeader
+ *  GpkCatalogRecord[n_packages]
+ *  guint32[n_packages]		record indexes, sorted by name
+ *  gchar[strings_size]		NUL terminated strings, the first is ""
+ *
+ * All the values are in host byte order, and a file written on a machine
+ * with a different endianness is rejected as having a bad magic.
+ */
+#define GPK_CATALOG_MAGIC	0x434b5047	/* "GPKC" */
+#define GPK_CATALOG_VERSION	1
+
+typedef struct {
+	guint32			 magic;
+	guint32			 version;
+	guint64			 filters;
+	gint64			 created;	/* seconds since the epoch */
+	guint32			 n_packages;
+	guint32			 strings_size;
+} GpkCatalogHeader;
+
+typedef struct {
+	guint32			 name;		/* offsets into the strings */
+	guint32			 version;
+	guint32			 arch;
+	guint32			 data;
+	guint32			 summary;
+	guint32			 info;
+} GpkCatalogRecord;
+
+struct _GpkCatalog
+{
+	GObject			 parent_instance;
+	GMappedFile		*file;
+	const GpkCatalogHeader	*header;
+	const GpkCatalogRecord	*records;
+	const guint32		*index;
+	const gchar		*strings;
+};
+
+G_DEFINE_TYPE (GpkCatalog, gpk_catalog, G_TYPE_OBJECT)
+
+typedef struct {
+	const GpkCatalogRecord	*records;
+	const gchar		*strings;
+} GpkCatalogSortHelper;
+
+static guint32
+gpk_catalog_add_string (GString *strings, GHashTable *offsets, const gchar *value)
+{
+	gpointer offset;
+	guint32 tmp;
+
+	/* the empty string is always at the start */
+	if (value == NULL || value[0] == '\0')
+		return 0;
+
+	/* versions, arches and repos are shared by many packages */
+	if (g_hash_table_lookup_extended (offsets, value, NULL, &offset))
+		return GPOINTER_TO_UINT (offset);
+	tmp = strings->len;
+	g_string_append_len (strings, value, strlen (value) + 1);
+	g_hash_table_insert (offsets, g_strdup (value), GUINT_TO_POINTER (tmp));
+	return tmp;
+}
+
+static gint
+gpk_catalog_index_sort_cb (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	GpkCatalogSortHelper *helper = (GpkCatalogSortHelper *) user_data;
+	const GpkCatalogRecord *record_a = &helper->records[*(const guint32 *) a];
+	const GpkCatalogRecord *record_b = &helper->records[*(const guint32 *) b];
+	return g_ascii_strcasecmp (helper->strings + record_a->name,
+				   helper->strings + record_b->name);
+}
+
+/**
+ * gpk_catalog_write:
+ * @filename: the file to write, which is replaced atomically
+ * @packages: an array of #PkPackage
+ * @filters: the filters used to get @packages
+ * @error: a #GError, or %NULL
+ *
+ * Writes a catalog that can be loaded with gpk_catalog_load().
+ **/
+gboolean
+gpk_catalog_write (const gchar *filename, GPtrArray *packages, PkBitfield filters, GError **error)
+{
+	GpkCatalogHeader header;
+	GpkCatalogRecord *record;
+	GpkCatalogSortHelper helper;
+	PkPackage *package;
+	guint32 i;
+	g_autofree gchar *dirname = NULL;
+	g_autofree GpkCatalogRecord *records = NULL;
+	g_autoptr(GArray) index = NULL;
+	g_autoptr(GByteArray) data = NULL;
+	g_autoptr(GHashTable) offsets = NULL;
+	g_autoptr(GString) strings = NULL;
+
+	/* the first string is always "" */
+	strings = g_string_sized_new (packages->len * 64);
+	g_string_append_c (strings, '\0');
+	offsets = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	records = g_new0 (GpkCatalogRecord, packages->len);
+	index = g_array_sized_new (FALSE, FALSE, sizeof (guint32), packages->len);
+	for (i = 0; i < packages->len; i++) {
+		package = g_ptr_array_index (packages, i);
+		record = &records[i];
+		record->name = gpk_catalog_add_string (strings, offsets, pk_package_get_name (package));
+		record->version = gpk_catalog_add_string (strings, offsets, pk_package_get_version (package));
+		record->arch = gpk_catalog_add_string (strings, offsets, pk_package_get_arch (package));
+		record->data = gpk_catalog_add_string (strings, offsets, pk_package_get_data (package));
+		record->summary = gpk_catalog_add_string (strings, offsets, pk_package_get_summary (package));
+		record->info = pk_package_get_info (package);
+		g_array_append_val (index, i);
+	}
+
+	/* sort by name so prefixes can be found with a binary search */
+	helper.records = records;
+	helper.strings = strings->str;
+	g_array_sort_with_data (index, gpk_catalog_index_sort_cb, &helper);
+
+	memset (&header, 0, sizeof (header));
+	header.magic = GPK_CATALOG_MAGIC;
+	header.version = GPK_CATALOG_VERSION;
+	header.filters = filters;
+	header.created = g_get_real_time () / G_USEC_PER_SEC;
+	header.n_packages = packages->len;
+	header.strings_size = strings->len;
+
+	data = g_byte_array_sized_new (sizeof (header) +
+				       packages->len * (sizeof (GpkCatalogRecord) + sizeof (guint32)) +
+				       strings->len);
+	g_byte_array_append (data, (const guint8 *) &header, sizeof (header));
+	g_byte_array_append (data, (const guint8 *) records, packages->len * sizeof (GpkCatalogRecord));
+	g_byte_array_append (data, (const guint8 *) index->data, packages->len * sizeof (guint32));
+	g_byte_array_append (data, (const guint8 *) strings->str, strings->len);
+
+	dirname = g_path_get_dirname (filename);
+	if (g_mkdir_with_parents (dirname, 0700) < 0) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+			     "failed to create %s", dirname);
+		return FALSE;
+	}
+	return g_file_set_contents (filename, (const gchar *) data->data, data->len, error);
+}
+
+/**
+ * gpk_catalog_load:
+ * @catalog: a #GpkCatalog
+ * @filename: a file written with gpk_catalog_write()
+ * @error: a #GError, or %NULL
+ *
+ * Maps the catalog into memory, replacing any that was loaded before.
+ * Nothing is copied, so this is fast even for very large catalogs.
+ **/
+gboolean
+gpk_catalog_load (GpkCatalog *catalog, const gchar *filename, GError **error)
+{
+	const GpkCatalogHeader *header;
+	const GpkCatalogRecord *records;
+	const guint32 *index;
+	const gchar *data;
+	gsize size;
+	guint32 i;
+	g_autoptr(GMappedFile) file = NULL;
+
+	g_return_val_if_fail (GPK_IS_CATALOG (catalog), FALSE);
+
+	file = g_mapped_file_new (filename, FALSE, error);
+	if (file == NULL)
+		return FALSE;
+	data = g_mapped_file_get_contents (file);
+	size = g_mapped_file_get_length (file);
+
+	/* check header */
+	if (size < sizeof (GpkCatalogHeader)) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			     "%s is too small", filename);
+		return FALSE;
+	}
+	header = (const GpkCatalogHeader *) data;
+	if (header->magic != GPK_CATALOG_MAGIC ||
+	    header->version != GPK_CATALOG_VERSION) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			     "%s is not a supported catalog", filename);
+		return FALSE;
+	}
+	if (header->strings_size == 0 ||
+	    size != sizeof (GpkCatalogHeader) +
+		    (gsize) header->n_packages * (sizeof (GpkCatalogRecord) + sizeof (guint32)) +
+		    header->strings_size ||
+	    data[size - 1] != '\0') {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			     "%s is truncated", filename);
+		return FALSE;
+	}
+
+	/* check every offset once, so lookups never have to */
+	records = (const GpkCatalogRecord *) (data + sizeof (GpkCatalogHeader));
+	index = (const guint32 *) (records + header->n_packages);
+	for (i = 0; i < header->n_packages; i++) {
+		if (records[i].name >= header->strings_size ||
+		    records[i].version >= header->strings_size ||
+		    records[i].arch >= header->strings_size ||
+		    records[i].data >= header->strings_size ||
+		    records[i].summary >= header->strings_size ||
+		    index[i] >= header->n_packages) {
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+				     "%s is corrupt", filename);
+			return FALSE;
+		}
+	}
+
+	g_clear_pointer (&catalog->file, g_mapped_file_unref);
+	catalog->file = g_steal_pointer (&file);
+	catalog->header = header;
+	catalog->records = records;
+	catalog->index = index;
+	catalog->strings = (const gchar *) (index + header->n_packages);
+	return TRUE;
+}
+
+guint
+gpk_catalog_get_size (GpkCatalog *catalog)
+{
+	g_return_val_if_fail (GPK_IS_CATALOG (catalog), 0);
+	if (catalog->header == NULL)
+		return 0;
+	return catalog->header->n_packages;
+}
+
+PkBitfield
+gpk_catalog_get_filters (GpkCatalog *catalog)
+{
+	g_return_val_if_fail (GPK_IS_CATALOG (catalog), 0);
+	if (catalog->header == NULL)
+		return 0;
+	return catalog->header->filters;
+}
+
+/**
+ * gpk_catalog_get_age:
+ *
+ * Return value: the number of seconds since the catalog was written, or
+ * -1 if no catalog is loaded
+ **/
+gint64
+gpk_catalog_get_age (GpkCatalog *catalog)
+{
+	g_return_val_if_fail (GPK_IS_CATALOG (catalog), -1);
+	if (catalog->header == NULL)
+		return -1;
+	return g_get_real_time () / G_USEC_PER_SEC - catalog->header->created;
+}
+
+static PkPackage *
+gpk_catalog_get_package (GpkCatalog *catalog, const GpkCatalogRecord *record)
+{
+	g_autofree gchar *package_id = NULL;
+	g_autoptr(PkPackage) package = NULL;
+
+	package_id = pk_package_id_build (catalog->strings + record->name,
+					  catalog->strings + record->version,
+					  catalog->strings + record->arch,
+					  catalog->strings + record->data);
+	package = pk_package_new ();
+	if (!pk_package_set_id (package, package_id, NULL))
+		return NULL;
+	pk_package_set_info (package, record->info);
+	pk_package_set_summary (package, catalog->strings + record->summary);
+	return g_steal_pointer (&package);
+}
+
+/**
+ * gpk_catalog_get_packages:
+ * @catalog: a #GpkCatalog
+ *
+ * Return value: (transfer container): every #PkPackage in the catalog
+ **/
+GPtrArray *
+gpk_catalog_get_packages (GpkCatalog *catalog)
+{
+	GPtrArray *array;
+	PkPackage *package;
+	guint32 i;
+
+	g_return_val_if_fail (GPK_IS_CATALOG (catalog), NULL);
+
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	if (catalog->header == NULL)
+		return array;
+	for (i = 0; i < catalog->header->n_packages; i++) {
+		package = gpk_catalog_get_package (catalog, &catalog->records[i]);
+		if (package != NULL)
+			g_ptr_array_add (array, package);
+	}
+	return array;
+}
+
+/**
+ * gpk_catalog_get_names:
+ * @catalog: a #GpkCatalog
+ *
+ * Gets each package name once, without creating any #PkPackage objects.
+ *
+ * Return value: (transfer full): package names, sorted ignoring case
+ **/
+gchar **
+gpk_catalog_get_names (GpkCatalog *catalog)
+{
+	GPtrArray *array;
+	const gchar *last = NULL;
+	const gchar *name;
+	guint32 i;
+
+	g_return_val_if_fail (GPK_IS_CATALOG (catalog), NULL);
+
+	array = g_ptr_array_new ();
+	for (i = 0; catalog->header != NULL && i < catalog->header->n_packages; i++) {
+		name = catalog->strings + catalog->records[catalog->index[i]].name;
+		if (last != NULL && g_ascii_strcasecmp (last, name) == 0)
+			continue;
+		g_ptr_array_add (array, g_strdup (name));
+		last = name;
+	}
+	g_ptr_array_add (array, NULL);
+	return (gchar **) g_ptr_array_free (array, FALSE);
+}
+
+/**
+ * gpk_catalog_get_page:
+ * @catalog: a #GpkCatalog
+ * @start: the position of the first package, in name order
+ * @len: the most packages to return
+ *
+ * Gets some of the packages without creating objects for the rest, so a
+ * view of every package only costs what has been scrolled to.
+ *
+ * Return value: (transfer container): an array of #PkPackage, sorted by name
+ **/
+GPtrArray *
+gpk_catalog_get_page (GpkCatalog *catalog, guint start, guint len)
+{
+	GPtrArray *array;
+	PkPackage *package;
+	guint32 i;
+	guint32 end;
+
+	g_return_val_if_fail (GPK_IS_CATALOG (catalog), NULL);
+
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	if (catalog->header == NULL || start >= catalog->header->n_packages)
+		return array;
+	end = start + MIN (len, catalog->header->n_packages - start);
+	for (i = start; i < end; i++) {
+		package = gpk_catalog_get_package (catalog, &catalog->records[catalog->index[i]]);
+		if (package != NULL)
+			g_ptr_array_add (array, package);
+	}
+	return array;
+}
+
+/**
+ * gpk_catalog_search_names:
+ * @catalog: a #GpkCatalog
+ * @values: search terms, which must all be found in the name
+ *
+ * Finds packages in the same way as a PackageKit name search.
+ *
+ * Return value: (transfer container): an array of #PkPackage
+ **/
+GPtrArray *
+gpk_catalog_search_names (GpkCatalog *catalog, gchar **values)
+{
+	const GpkCatalogRecord *record;
+	GPtrArray *array;
+	PkPackage *package;
+	guint32 i;
+	guint j;
+	g_auto(GStrv) needles = NULL;
+
+	g_return_val_if_fail (GPK_IS_CATALOG (catalog), NULL);
+
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	if (catalog->header == NULL)
+		return array;
+
+	needles = g_new0 (gchar *, g_strv_length (values) + 1);
+	for (j = 0; values[j] != NULL; j++)
+		needles[j] = g_ascii_strdown (values[j], -1);
+	for (i = 0; i < catalog->header->n_packages; i++) {
+		record = &catalog->records[i];
+		for (j = 0; needles[j] != NULL; j++) {
+			if (!gpk_ascii_strcasestr (catalog->strings + record->name, needles[j]))
+				break;
+		}
+		if (needles[j] != NULL)
+			continue;
+		package = gpk_catalog_get_package (catalog, record);
+		if (package != NULL)
+			g_ptr_array_add (array, package);
+	}
+	return array;
+}
+
+/**
+ * gpk_catalog_search_prefix:
+ * @catalog: a #GpkCatalog
+ * @prefix: the start of a package name
+ *
+ * Finds packages with names that start with @prefix, ignoring case.
+ *
+ * Return value: (transfer container): an array of #PkPackage, sorted by name
+ **/
+GPtrArray *
+gpk_catalog_search_prefix (GpkCatalog *catalog, const gchar *prefix)
+{
+	const GpkCatalogRecord *record;
+	GPtrArray *array;
+	PkPackage *package;
+	gsize len;
+	guint32 first = 0;
+	guint32 last;
+	guint32 mid;
+
+	g_return_val_if_fail (GPK_IS_CATALOG (catalog), NULL);
+	g_return_val_if_fail (prefix != NULL, NULL);
+
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	if (catalog->header == NULL)
+		return array;
+
+	/* find the first name that is not before the prefix */
+	len = strlen (prefix);
+	last = catalog->header->n_packages;
+	while (first < last) {
+		mid = first + (last - first) / 2;
+		record = &catalog->records[catalog->index[mid]];
+		if (g_ascii_strncasecmp (catalog->strings + record->name, prefix, len) < 0)
+			first = mid + 1;
+		else
+			last = mid;
+	}
+
+	/* everything that matches is next to it */
+	for (; first < catalog->header->n_packages; first++) {
+		record = &catalog->records[catalog->index[first]];
+		if (g_ascii_strncasecmp (catalog->strings + record->name, prefix, len) != 0)
+			break;
+		package = gpk_catalog_get_package (catalog, record);
+		if (package != NULL)
+			g_ptr_array_add (array, package);
+	}
+	return array;
+}
+
+static void
+gpk_catalog_finalize (GObject *object)
+{
+	GpkCatalog *catalog = GPK_CATALOG (object);
+
+	if (catalog->file != NULL)
+		g_mapped_file_unref (catalog->file);
+
+	G_OBJECT_CLASS (gpk_catalog_parent_class)->finalize (object);
+}
+
+static void
+gpk_catalog_class_init (GpkCatalogClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gpk_catalog_finalize;
+}
+
+static void
+gpk_catalog_init (GpkCatalog *catalog)
+{
+}
+
+GpkCatalog *
+gpk_catalog_new (void)
+{
+	return g_object_new (GPK_TYPE_CATALOG, NULL);
+}
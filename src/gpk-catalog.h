@@ -0,0 +1,56 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __GPK_CATALOG_H
+#define __GPK_CATALOG_H
+
+#include <glib-object.h>
+#include <packagekit-glib2/packagekit.h>
+
+G_BEGIN_DECLS
+
+#define GPK_TYPE_CATALOG (gpk_catalog_get_type ())
+G_DECLARE_FINAL_TYPE (GpkCatalog, gpk_catalog, GPK, CATALOG, GObject)
+
+GpkCatalog	*gpk_catalog_new			(void);
+gboolean	 gpk_catalog_write			(const gchar		*filename,
+							 GPtrArray		*packages,
+							 PkBitfield		 filters,
+							 GError			**error);
+gboolean	 gpk_catalog_load			(GpkCatalog		*catalog,
+							 const gchar		*filename,
+							 GError			**error);
+guint		 gpk_catalog_get_size			(GpkCatalog		*catalog);
+PkBitfield	 gpk_catalog_get_filters		(GpkCatalog		*catalog);
+gint64		 gpk_catalog_get_age			(GpkCatalog		*catalog);
+GPtrArray	*gpk_catalog_get_packages		(GpkCatalog		*catalog);
+gchar		**gpk_catalog_get_names			(GpkCatalog		*catalog);
+GPtrArray	*gpk_catalog_get_page			(GpkCatalog		*catalog,
+							 guint			 start,
+							 guint			 len);
+GPtrArray	*gpk_catalog_search_names		(GpkCatalog		*catalog,
+							 gchar			**values);
+GPtrArray	*gpk_catalog_search_prefix		(GpkCatalog		*catalog,
+							 const gchar		*prefix);
+
+G_END_DECLS
+
+#endif /* __GPK_CATALOG_H */
@@ -0,0 +1,315 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <packagekit-glib2/packagekit.h>
+
+#include "gpk-category-tree.h"
+
+/* bump if the meaning of the saved categories changes */
+#define GPK_CATEGORY_TREE_VERSION	1
+#define GPK_CATEGORY_TREE_FORMAT	"(ua(sssss))"
+
+struct _GpkCategoryTree
+{
+	GObject			 parent_instance;
+	GNode			*root;		/* data is a PkCategory, NULL for the root */
+	guint			 size;
+};
+
+G_DEFINE_TYPE (GpkCategoryTree, gpk_category_tree, G_TYPE_OBJECT)
+
+static gboolean
+gpk_category_tree_node_unref_cb (GNode *node, gpointer user_data)
+{
+	if (node->data != NULL)
+		g_object_unref (node->data);
+	return FALSE;
+}
+
+static void
+gpk_category_tree_clear (GpkCategoryTree *tree)
+{
+	g_node_traverse (tree->root, G_IN_ORDER, G_TRAVERSE_ALL, -1,
+			 gpk_category_tree_node_unref_cb, NULL);
+	g_node_destroy (tree->root);
+	tree->root = g_node_new (NULL);
+	tree->size = 0;
+}
+
+/**
+ * gpk_category_tree_set_categories:
+ * @tree: a #GpkCategoryTree
+ * @categories: (element-type PkCategory): the categories from the backend
+ *
+ * Replaces the tree, nesting each category under the one matching its
+ * parent ID to any depth. Categories without a known parent, or that would
+ * make a loop, are put at the top level. The order of @categories is kept.
+ **/
+void
+gpk_category_tree_set_categories (GpkCategoryTree *tree, GPtrArray *categories)
+{
+	PkCategory *item;
+	GNode *parent;
+	const gchar *cat_id;
+	const gchar *parent_id;
+	guint i;
+	g_autofree GNode **nodes = NULL;
+	g_autoptr(GHashTable) index = NULL;
+
+	g_return_if_fail (GPK_IS_CATEGORY_TREE (tree));
+
+	gpk_category_tree_clear (tree);
+
+	/* index every category by ID, the first one wins */
+	index = g_hash_table_new (g_str_hash, g_str_equal);
+	nodes = g_new0 (GNode *, categories->len);
+	for (i = 0; i < categories->len; i++) {
+		item = g_ptr_array_index (categories, i);
+		nodes[i] = g_node_new (g_object_ref (item));
+		cat_id = pk_category_get_id (item);
+		if (cat_id != NULL && !g_hash_table_contains (index, cat_id))
+			g_hash_table_insert (index, (gpointer) cat_id, nodes[i]);
+	}
+
+	/* link backwards, as prepending does not have to find the last child */
+	for (i = categories->len; i > 0; i--) {
+		item = g_ptr_array_index (categories, i - 1);
+		parent_id = pk_category_get_parent_id (item);
+		parent = NULL;
+		if (parent_id != NULL && parent_id[0] != '\0')
+			parent = g_hash_table_lookup (index, parent_id);
+		if (parent == NULL || g_node_is_ancestor (nodes[i - 1], parent) ||
+		    parent == nodes[i - 1])
+			parent = tree->root;
+		g_node_prepend (parent, nodes[i - 1]);
+	}
+	tree->size = categories->len;
+}
+
+/**
+ * gpk_category_tree_get_root:
+ * @tree: a #GpkCategoryTree
+ *
+ * Return value: (transfer none): the root node, whose children are the
+ * top level categories. Each node other than the root holds a #PkCategory.
+ **/
+GNode *
+gpk_category_tree_get_root (GpkCategoryTree *tree)
+{
+	g_return_val_if_fail (GPK_IS_CATEGORY_TREE (tree), NULL);
+	return tree->root;
+}
+
+guint
+gpk_category_tree_get_size (GpkCategoryTree *tree)
+{
+	g_return_val_if_fail (GPK_IS_CATEGORY_TREE (tree), 0);
+	return tree->size;
+}
+
+static const gchar *
+gpk_category_tree_str (const gchar *text)
+{
+	return text != NULL ? text : "";
+}
+
+static gboolean
+gpk_category_tree_node_equal (GNode *node1, GNode *node2)
+{
+	PkCategory *item1;
+	PkCategory *item2;
+
+	for (node1 = node1->children, node2 = node2->children;
+	     node1 != NULL && node2 != NULL;
+	     node1 = node1->next, node2 = node2->next) {
+		item1 = node1->data;
+		item2 = node2->data;
+		if (g_strcmp0 (gpk_category_tree_str (pk_category_get_id (item1)),
+			       gpk_category_tree_str (pk_category_get_id (item2))) != 0 ||
+		    g_strcmp0 (gpk_category_tree_str (pk_category_get_name (item1)),
+			       gpk_category_tree_str (pk_category_get_name (item2))) != 0 ||
+		    g_strcmp0 (gpk_category_tree_str (pk_category_get_summary (item1)),
+			       gpk_category_tree_str (pk_category_get_summary (item2))) != 0 ||
+		    g_strcmp0 (gpk_category_tree_str (pk_category_get_icon (item1)),
+			       gpk_category_tree_str (pk_category_get_icon (item2))) != 0)
+			return FALSE;
+		if (!gpk_category_tree_node_equal (node1, node2))
+			return FALSE;
+	}
+	return node1 == NULL && node2 == NULL;
+}
+
+/**
+ * gpk_category_tree_equal:
+ *
+ * Return value: %TRUE if both trees would be shown the same way
+ **/
+gboolean
+gpk_category_tree_equal (GpkCategoryTree *tree1, GpkCategoryTree *tree2)
+{
+	g_return_val_if_fail (GPK_IS_CATEGORY_TREE (tree1), FALSE);
+	g_return_val_if_fail (GPK_IS_CATEGORY_TREE (tree2), FALSE);
+	if (tree1->size != tree2->size)
+		return FALSE;
+	return gpk_category_tree_node_equal (tree1->root, tree2->root);
+}
+
+/**
+ * gpk_category_tree_load:
+ * @tree: a #GpkCategoryTree
+ * @filename: a file written by gpk_category_tree_save()
+ * @error: a #GError, or %NULL
+ *
+ * Replaces the tree with one saved earlier, so it can be shown before
+ * the backend has been asked.
+ **/
+gboolean
+gpk_category_tree_load (GpkCategoryTree *tree, const gchar *filename, GError **error)
+{
+	GVariantIter *iter = NULL;
+	PkCategory *item;
+	const gchar *parent_id;
+	const gchar *cat_id;
+	const gchar *name;
+	const gchar *summary;
+	const gchar *icon;
+	gchar *data = NULL;
+	gsize len;
+	guint32 version;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GPtrArray) categories = NULL;
+	g_autoptr(GVariant) value = NULL;
+
+	g_return_val_if_fail (GPK_IS_CATEGORY_TREE (tree), FALSE);
+
+	if (!g_file_get_contents (filename, &data, &len, error))
+		return FALSE;
+	bytes = g_bytes_new_take (data, len);
+	value = g_variant_new_from_bytes (G_VARIANT_TYPE (GPK_CATEGORY_TREE_FORMAT), bytes, FALSE);
+	g_variant_ref_sink (value);
+	g_variant_get (value, GPK_CATEGORY_TREE_FORMAT, &version, &iter);
+	if (version != GPK_CATEGORY_TREE_VERSION) {
+		g_variant_iter_free (iter);
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			     "%s is version %u, expected %u",
+			     filename, version, (guint) GPK_CATEGORY_TREE_VERSION);
+		return FALSE;
+	}
+	categories = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	while (g_variant_iter_next (iter, "(&s&s&s&s&s)",
+				    &parent_id, &cat_id, &name, &summary, &icon)) {
+		item = g_object_new (PK_TYPE_CATEGORY,
+				     "parent-id", parent_id[0] != '\0' ? parent_id : NULL,
+				     "cat-id", cat_id,
+				     "name", name,
+				     "summary", summary,
+				     "icon", icon[0] != '\0' ? icon : NULL,
+				     NULL);
+		g_ptr_array_add (categories, item);
+	}
+	g_variant_iter_free (iter);
+	gpk_category_tree_set_categories (tree, categories);
+	return TRUE;
+}
+
+static gboolean
+gpk_category_tree_save_cb (GNode *node, GVariantBuilder *builder)
+{
+	PkCategory *item = node->data;
+	PkCategory *parent;
+
+	/* the root */
+	if (item == NULL)
+		return FALSE;
+
+	/* save where it ended up, not what the backend asked for */
+	parent = node->parent->data;
+	g_variant_builder_add (builder, "(sssss)",
+			       parent != NULL ? gpk_category_tree_str (pk_category_get_id (parent)) : "",
+			       gpk_category_tree_str (pk_category_get_id (item)),
+			       gpk_category_tree_str (pk_category_get_name (item)),
+			       gpk_category_tree_str (pk_category_get_summary (item)),
+			       gpk_category_tree_str (pk_category_get_icon (item)));
+	return FALSE;
+}
+
+gboolean
+gpk_category_tree_save (GpkCategoryTree *tree, const gchar *filename, GError **error)
+{
+	GVariantBuilder builder;
+	g_autofree gchar *dirname = NULL;
+	g_autoptr(GVariant) value = NULL;
+
+	g_return_val_if_fail (GPK_IS_CATEGORY_TREE (tree), FALSE);
+
+	/* parents before children, so the order is kept */
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sssss)"));
+	g_node_traverse (tree->root, G_PRE_ORDER, G_TRAVERSE_ALL, -1,
+			 (GNodeTraverseFunc) gpk_category_tree_save_cb, &builder);
+	value = g_variant_new (GPK_CATEGORY_TREE_FORMAT, (guint32) GPK_CATEGORY_TREE_VERSION, &builder);
+	g_variant_ref_sink (value);
+
+	dirname = g_path_get_dirname (filename);
+	if (g_mkdir_with_parents (dirname, 0700) < 0) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+			     "failed to create %s", dirname);
+		return FALSE;
+	}
+	return g_file_set_contents (filename,
+				    g_variant_get_data (value),
+				    g_variant_get_size (value),
+				    error);
+}
+
+static void
+gpk_category_tree_finalize (GObject *object)
+{
+	GpkCategoryTree *tree = GPK_CATEGORY_TREE (object);
+
+	g_node_traverse (tree->root, G_IN_ORDER, G_TRAVERSE_ALL, -1,
+			 gpk_category_tree_node_unref_cb, NULL);
+	g_node_destroy (tree->root);
+
+	G_OBJECT_CLASS (gpk_category_tree_parent_class)->finalize (object);
+}
+
+static void
+gpk_category_tree_class_init (GpkCategoryTreeClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gpk_category_tree_finalize;
+}
+
+static void
+gpk_category_tree_init (GpkCategoryTree *tree)
+{
+	tree->root = g_node_new (NULL);
+}
+
+GpkCategoryTree *
+gpk_category_tree_new (void)
+{
+	return g_object_new (GPK_TYPE_CATEGORY_TREE, NULL);
+}
@@ -0,0 +1,49 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __GPK_CATEGORY_TREE_H
+#define __GPK_CATEGORY_TREE_H
+
+#include <glib-object.h>
+#include <packagekit-glib2/packagekit.h>
+
+G_BEGIN_DECLS
+
+#define GPK_TYPE_CATEGORY_TREE (gpk_category_tree_get_type ())
+G_DECLARE_FINAL_TYPE (GpkCategoryTree, gpk_category_tree, GPK, CATEGORY_TREE, GObject)
+
+GpkCategoryTree	*gpk_category_tree_new			(void);
+void		 gpk_category_tree_set_categories	(GpkCategoryTree	*tree,
+							 GPtrArray		*categories);
+GNode		*gpk_category_tree_get_root		(GpkCategoryTree	*tree);
+guint		 gpk_category_tree_get_size		(GpkCategoryTree	*tree);
+gboolean	 gpk_category_tree_equal		(GpkCategoryTree	*tree1,
+							 GpkCategoryTree	*tree2);
+gboolean	 gpk_category_tree_load			(GpkCategoryTree	*tree,
+							 const gchar		*filename,
+							 GError			**error);
+gboolean	 gpk_category_tree_save			(GpkCategoryTree	*tree,
+							 const gchar		*filename,
+							 GError			**error);
+
+G_END_DECLS
+
+#endif /* __GPK_CATEGORY_TREE_H */
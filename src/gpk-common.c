@@ -21,11 +21,13 @@
 
 #include "config.h"
 
+#include <errno.h>
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <math.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/resource.h>
 #include <sys/types.h>
 #include <gtk/gtk.h>
 #include <gdk/gdkx.h>
@@ -133,22 +135,22 @@ gpk_window_set_parent_xid (GtkWindow *window, guint32 xid)
 }
 
 static const gchar *
-gpk_get_pretty_arch (const gchar *arch)
+gpk_get_pretty_arch (const gchar *arch, gsize len)
 {
 	const gchar *id = NULL;
 
-	if (arch[0] == '\0')
+	if (len == 0)
 		goto out;
 
 	/* 32 bit */
-	if (g_str_has_prefix (arch, "i")) {
+	if (arch[0] == 'i') {
 		/* TRANSLATORS: a 32 bit package */
 		id = _("32-bit");
 		goto out;
 	}
 
 	/* 64 bit */
-	if (g_str_has_suffix (arch, "64")) {
+	if (len >= 2 && arch[len - 2] == '6' && arch[len - 1] == '4') {
 		/* TRANSLATORS: a 64 bit package */
 		id = _("64-bit");
 		goto out;
@@ -157,64 +159,436 @@ out:
 	return id;
 }
 
+/* the same rules as pk_package_id_split(), but without copying anything */
+static gboolean
+gpk_package_id_tokenize (const gchar *package_id, const gchar **sections, gsize *lengths)
+{
+	const gchar *start = package_id;
+	const gchar *tmp;
+	guint i = 0;
+
+	for (tmp = package_id; ; tmp++) {
+		if (*tmp != ';' && *tmp != '\0')
+			continue;
+		if (i == 4)
+			return FALSE;
+		sections[i] = start;
+		lengths[i++] = tmp - start;
+		if (*tmp == '\0')
+			break;
+		start = tmp + 1;
+	}
+	return i == 4 && lengths[PK_PACKAGE_ID_NAME] > 0;
+}
+
+/* what g_markup_escape_text() does, appending to @string */
+static void
+gpk_markup_append_escaped (GString *string, const gchar *text)
+{
+	const gchar *run = text;
+	const gchar *tmp;
+	const gchar *entity;
+	guchar c;
+
+	for (tmp = text; *tmp != '\0'; tmp++) {
+		c = (guchar) *tmp;
+		entity = NULL;
+		switch (c) {
+		case '&':
+			entity = "&amp;";
+			break;
+		case '<':
+			entity = "&lt;";
+			break;
+		case '>':
+			entity = "&gt;";
+			break;
+		case '\'':
+			entity = "&#39;";
+			break;
+		case '"':
+			entity = "&quot;";
+			break;
+		default:
+			break;
+		}
+		if (entity == NULL) {
+			/* restricted C0 and C1 control characters */
+			if ((c >= 0x1 && c <= 0x8) || c == 0xb || c == 0xc ||
+			    (c >= 0xe && c <= 0x1f) || c == 0x7f) {
+				g_string_append_len (string, run, tmp - run);
+				g_string_append_printf (string, "&#x%x;", c);
+				run = tmp + 1;
+			} else if (c == 0xc2 && (guchar) tmp[1] >= 0x80 && (guchar) tmp[1] <= 0x9f) {
+				g_string_append_len (string, run, tmp - run);
+				g_string_append_printf (string, "&#x%x;", (guchar) tmp[1]);
+				run = ++tmp + 1;
+			}
+			continue;
+		}
+		g_string_append_len (string, run, tmp - run);
+		g_string_append (string, entity);
+		run = tmp + 1;
+	}
+	g_string_append_len (string, run, tmp - run);
+}
+
+static gboolean
+gpk_package_id_append_twoline (GString *string,
+			       const gchar *color,
+			       const gchar *package_id,
+			       const gchar *summary)
+{
+	const gchar *sections[4];
+	const gchar *arch;
+	gsize lengths[4];
+	gboolean has_summary;
+
+	if (!gpk_package_id_tokenize (package_id, sections, lengths)) {
+		g_warning ("could not parse %s", package_id);
+		return FALSE;
+	}
+
+	/* name and summary, or just the name */
+	has_summary = summary != NULL && summary[0] != '\0';
+	if (has_summary) {
+		gpk_markup_append_escaped (string, summary);
+		g_string_append (string, "\n<span color=\"");
+		g_string_append (string, color);
+		g_string_append (string, "\">");
+	}
+	g_string_append_len (string,
+			     sections[PK_PACKAGE_ID_NAME],
+			     lengths[PK_PACKAGE_ID_NAME]);
+	if (lengths[PK_PACKAGE_ID_VERSION] > 0) {
+		g_string_append_c (string, '-');
+		g_string_append_len (string,
+				     sections[PK_PACKAGE_ID_VERSION],
+				     lengths[PK_PACKAGE_ID_VERSION]);
+	}
+	arch = gpk_get_pretty_arch (sections[PK_PACKAGE_ID_ARCH],
+					lengths[PK_PACKAGE_ID_ARCH]);
+	if (arch != NULL) {
+		g_string_append (string, " (");
+		g_string_append (string, arch);
+		g_string_append_c (string, ')');
+	}
+	if (has_summary)
+		g_string_append (string, "</span>");
+	return TRUE;
+}
+
+static void
+gpk_style_get_insensitive_color (GtkStyleContext *style, gchar *color, gsize color_len)
+{
+	GdkRGBA inactive;
+
+	if (style == NULL) {
+		g_strlcpy (color, "gray", color_len);
+		return;
+	}
+	gtk_style_context_get_color (style,
+				     GTK_STATE_FLAG_INSENSITIVE,
+				     &inactive);
+	g_snprintf (color, color_len, "#%02x%02x%02x",
+		    (guint) (inactive.red * 255.0f),
+		    (guint) (inactive.green * 255.0f),
+		    (guint) (inactive.blue * 255.0f));
+}
+
 gchar *
 gpk_package_id_format_twoline (GtkStyleContext *style,
 			       const gchar *package_id,
 			       const gchar *summary)
 {
-	g_autofree gchar *summary_safe = NULL;
 	GString *string;
-	g_auto(GStrv) split = NULL;
-	g_autofree gchar *color = NULL;
-	const gchar *arch;
-	GdkRGBA inactive;
+	gchar color[GPK_PACKAGE_FORMATTER_COLOR_LEN];
 
 	g_return_val_if_fail (package_id != NULL, NULL);
 
-	/* get style color */
+	gpk_style_get_insensitive_color (style, color, sizeof (color));
+	string = g_string_new (NULL);
+	if (!gpk_package_id_append_twoline (string, color, package_id, summary)) {
+		g_string_free (string, TRUE);
+		return NULL;
+	}
+	return g_string_free (string, FALSE);
+}
+
+struct _GpkPackageFormatter {
+	GtkStyleContext		*style;
+	gulong			 style_changed_id;
+	gboolean		 color_valid;
+	gchar			 color[GPK_PACKAGE_FORMATTER_COLOR_LEN];
+};
+
+static void
+gpk_package_formatter_style_changed_cb (GtkStyleContext *style, GpkPackageFormatter *formatter)
+{
+	formatter->color_valid = FALSE;
+}
+
+/**
+ * gpk_package_formatter_new:
+ * @style: (allow-none): the style to take the insensitive colour from
+ *
+ * Creates a formatter that produces the same markup as
+ * gpk_package_id_format_twoline(), but that looks up the colour only when
+ * the theme changes and that can reuse the caller's buffers.
+ **/
+GpkPackageFormatter *
+gpk_package_formatter_new (GtkStyleContext *style)
+{
+	GpkPackageFormatter *formatter = g_new0 (GpkPackageFormatter, 1);
 	if (style != NULL) {
-		gtk_style_context_get_color (style,
-					     GTK_STATE_FLAG_INSENSITIVE,
-					     &inactive);
-		color = g_strdup_printf ("#%02x%02x%02x",
-					 (guint) (inactive.red * 255.0f),
-					 (guint) (inactive.green * 255.0f),
-					 (guint) (inactive.blue * 255.0f));
-	} else {
-		color = g_strdup ("gray");
+		formatter->style = g_object_ref (style);
+		formatter->style_changed_id =
+			g_signal_connect (style, "changed",
+					  G_CALLBACK (gpk_package_formatter_style_changed_cb),
+					  formatter);
 	}
+	return formatter;
+}
 
-	/* optional */
-	split = pk_package_id_split (package_id);
-	if (split == NULL) {
+void
+gpk_package_formatter_free (GpkPackageFormatter *formatter)
+{
+	if (formatter == NULL)
+		return;
+	if (formatter->style != NULL) {
+		g_signal_handler_disconnect (formatter->style, formatter->style_changed_id);
+		g_object_unref (formatter->style);
+	}
+	g_free (formatter);
+}
+
+/**
+ * gpk_package_formatter_append:
+ * @string: where the markup is appended, which can be reused between calls
+ *
+ * Returns: %FALSE if @package_id could not be parsed, leaving @string as it was
+ **/
+gboolean
+gpk_package_formatter_append (GpkPackageFormatter *formatter,
+			      GString *string,
+			      const gchar *package_id,
+			      const gchar *summary)
+{
+	gsize len;
+
+	g_return_val_if_fail (formatter != NULL, FALSE);
+	g_return_val_if_fail (string != NULL, FALSE);
+	g_return_val_if_fail (package_id != NULL, FALSE);
+
+	if (!formatter->color_valid) {
+		gpk_style_get_insensitive_color (formatter->style,
+						 formatter->color,
+						 sizeof (formatter->color));
+		formatter->color_valid = TRUE;
+	}
+	len = string->len;
+	if (!gpk_package_id_append_twoline (string, formatter->color, package_id, summary)) {
+		g_string_truncate (string, len);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * gpk_package_formatter_append_packages:
+ * @packages: array of #PkPackage
+ * @arena: the markup for each package is appended, each one nul terminated
+ * @offsets: a #gsize offset into @arena is appended for each package
+ *
+ * Formats many packages at once, so the whole batch needs at most a few
+ * reallocations of @arena. Packages with an invalid ID get empty markup.
+ **/
+void
+gpk_package_formatter_append_packages (GpkPackageFormatter *formatter,
+				       GPtrArray *packages,
+				       GString *arena,
+				       GArray *offsets)
+{
+	PkPackage *package;
+	gsize offset;
+	guint i;
+
+	g_return_if_fail (formatter != NULL);
+	g_return_if_fail (packages != NULL);
+	g_return_if_fail (arena != NULL);
+	g_return_if_fail (offsets != NULL);
+
+	for (i = 0; i < packages->len; i++) {
+		package = g_ptr_array_index (packages, i);
+		offset = arena->len;
+		g_array_append_val (offsets, offset);
+		gpk_package_formatter_append (formatter, arena,
+					      pk_package_get_id (package),
+					      pk_package_get_summary (package));
+		g_string_append_c (arena, '\0');
+	}
+}
+
+struct _GpkPackageAtom {
+	gint			 refcount;
+	const gchar		*sections[4];	/* into id, after the full ID */
+	gchar			 id[];		/* the ID, then each section */
+};
+
+/* package_id:GpkPackageAtom, only for atoms that are still referenced */
+static GHashTable *gpk_package_atoms = NULL;
+G_LOCK_DEFINE_STATIC (gpk_package_atoms);
+
+G_DEFINE_BOXED_TYPE (GpkPackageAtom, gpk_package_atom,
+		     gpk_package_atom_ref, gpk_package_atom_unref)
+
+/**
+ * gpk_package_atom_intern:
+ * @package_id: a package ID
+ *
+ * Gets the one atom for @package_id in this process, so that atoms can be
+ * compared by pointer and the ID is only stored once however many models
+ * it is shown in.
+ *
+ * Return value: (transfer full): a new reference, or %NULL if @package_id
+ * is not valid
+ **/
+GpkPackageAtom *
+gpk_package_atom_intern (const gchar *package_id)
+{
+	GpkPackageAtom *atom;
+	const gchar *sections[4];
+	gsize lengths[4];
+	gsize len;
+	gchar *tmp;
+	guint i;
+
+	g_return_val_if_fail (package_id != NULL, NULL);
+
+	G_LOCK (gpk_package_atoms);
+	if (gpk_package_atoms == NULL)
+		gpk_package_atoms = g_hash_table_new (g_str_hash, g_str_equal);
+	atom = g_hash_table_lookup (gpk_package_atoms, package_id);
+	if (atom != NULL) {
+		atom->refcount++;
+		G_UNLOCK (gpk_package_atoms);
+		return atom;
+	}
+	if (!gpk_package_id_tokenize (package_id, sections, lengths)) {
+		G_UNLOCK (gpk_package_atoms);
 		g_warning ("could not parse %s", package_id);
 		return NULL;
 	}
 
-	/* no summary */
-	if (summary == NULL || summary[0] == '\0') {
-		string = g_string_new (split[PK_PACKAGE_ID_NAME]);
-		if (split[PK_PACKAGE_ID_VERSION][0] != '\0')
-			g_string_append_printf (string, "-%s", split[PK_PACKAGE_ID_VERSION]);
-		arch = gpk_get_pretty_arch (split[PK_PACKAGE_ID_ARCH]);
-		if (arch != NULL)
-			g_string_append_printf (string, " (%s)", arch);
-		return g_string_free (string, FALSE);
+	/* one block holding "id\0name\0version\0arch\0data\0" */
+	len = strlen (package_id);
+	atom = g_malloc (sizeof (GpkPackageAtom) + (len + 1) * 2);
+	atom->refcount = 1;
+	memcpy (atom->id, package_id, len + 1);
+	tmp = atom->id + len + 1;
+	for (i = 0; i < 4; i++) {
+		memcpy (tmp, sections[i], lengths[i]);
+		tmp[lengths[i]] = '\0';
+		atom->sections[i] = tmp;
+		tmp += lengths[i] + 1;
 	}
+	g_hash_table_insert (gpk_package_atoms, atom->id, atom);
+	G_UNLOCK (gpk_package_atoms);
+	return atom;
+}
 
-	/* name and summary */
-	string = g_string_new ("");
-	summary_safe = g_markup_escape_text (summary, -1);
-	g_string_append_printf (string, "%s\n", summary_safe);
-	g_string_append_printf (string, "<span color=\"%s\">", color);
-	g_string_append (string, split[PK_PACKAGE_ID_NAME]);
-	if (split[PK_PACKAGE_ID_VERSION][0] != '\0')
-		g_string_append_printf (string, "-%s", split[PK_PACKAGE_ID_VERSION]);
-	arch = gpk_get_pretty_arch (split[PK_PACKAGE_ID_ARCH]);
-	if (arch != NULL)
-		g_string_append_printf (string, " (%s)", arch);
-	g_string_append (string, "</span>");
-	return g_string_free (string, FALSE);
+/**
+ * gpk_package_atom_lookup:
+ * @package_id: a package ID
+ *
+ * Finds the atom for @package_id without creating one, which is enough to
+ * look it up in a table keyed by atom: if nothing holds the atom then
+ * nothing can be keyed by it either.
+ *
+ * Return value: (transfer none): the atom, or %NULL
+ **/
+GpkPackageAtom *
+gpk_package_atom_lookup (const gchar *package_id)
+{
+	GpkPackageAtom *atom = NULL;
+
+	g_return_val_if_fail (package_id != NULL, NULL);
+
+	G_LOCK (gpk_package_atoms);
+	if (gpk_package_atoms != NULL)
+		atom = g_hash_table_lookup (gpk_package_atoms, package_id);
+	G_UNLOCK (gpk_package_atoms);
+	return atom;
+}
+
+GpkPackageAtom *
+gpk_package_atom_ref (GpkPackageAtom *atom)
+{
+	g_return_val_if_fail (atom != NULL, NULL);
+	G_LOCK (gpk_package_atoms);
+	atom->refcount++;
+	G_UNLOCK (gpk_package_atoms);
+	return atom;
+}
+
+void
+gpk_package_atom_unref (GpkPackageAtom *atom)
+{
+	g_return_if_fail (atom != NULL);
+	G_LOCK (gpk_package_atoms);
+	if (--atom->refcount > 0) {
+		G_UNLOCK (gpk_package_atoms);
+		return;
+	}
+	g_hash_table_remove (gpk_package_atoms, atom->id);
+	G_UNLOCK (gpk_package_atoms);
+	g_free (atom);
+}
+
+const gchar *
+gpk_package_atom_get_id (GpkPackageAtom *atom)
+{
+	return atom->id;
+}
+
+const gchar *
+gpk_package_atom_get_name (GpkPackageAtom *atom)
+{
+	return atom->sections[PK_PACKAGE_ID_NAME];
+}
+
+const gchar *
+gpk_package_atom_get_version (GpkPackageAtom *atom)
+{
+	return atom->sections[PK_PACKAGE_ID_VERSION];
+}
+
+const gchar *
+gpk_package_atom_get_arch (GpkPackageAtom *atom)
+{
+	return atom->sections[PK_PACKAGE_ID_ARCH];
+}
+
+const gchar *
+gpk_package_atom_get_data (GpkPackageAtom *atom)
+{
+	return atom->sections[PK_PACKAGE_ID_DATA];
+}
+
+/**
+ * gpk_package_atom_get_count:
+ *
+ * Return value: the number of package IDs interned at the moment
+ **/
+guint
+gpk_package_atom_get_count (void)
+{
+	guint count = 0;
+	G_LOCK (gpk_package_atoms);
+	if (gpk_package_atoms != NULL)
+		count = g_hash_table_size (gpk_package_atoms);
+	G_UNLOCK (gpk_package_atoms);
+	return count;
 }
 
 gchar *
@@ -278,6 +652,30 @@ gpk_check_privileged_user (const gchar *application_name, gboolean show_ui)
 	return TRUE;
 }
 
+/**
+ * gpk_ascii_strcasestr:
+ * @haystack: the string to search
+ * @needle: the string to find, which must already be lowercase
+ *
+ * Return value: %TRUE if @needle is in @haystack, ignoring ASCII case
+ **/
+gboolean
+gpk_ascii_strcasestr (const gchar *haystack, const gchar *needle)
+{
+	guint i;
+	guint j;
+
+	for (i = 0; haystack[i] != '\0'; i++) {
+		for (j = 0; needle[j] != '\0'; j++) {
+			if (g_ascii_tolower (haystack[i + j]) != needle[j])
+				break;
+		}
+		if (needle[j] == '\0')
+			return TRUE;
+	}
+	return needle[0] == '\0';
+}
+
 /**
  * gpk_strv_join_locale:
  *
@@ -317,3 +715,226 @@ gpk_strv_join_locale (gchar **array)
 					array[3], array[4]);
 	return NULL;
 }
+
+static gchar *
+gpk_log_get_type_line (gchar **array, PkInfoEnum info)
+{
+	guint i;
+	guint size;
+	PkInfoEnum info_local;
+	const gchar *info_text;
+	GString *string;
+	g_autofree gchar *text = NULL;
+	gchar *whole;
+
+	string = g_string_new ("");
+	size = g_strv_length (array);
+	info_text = gpk_info_enum_to_localised_past (info);
+
+	/* find all of this type */
+	for (i = 0; i < size; i++) {
+		g_auto(GStrv) sections = NULL;
+		sections = g_strsplit (array[i], "\t", 0);
+		info_local = pk_info_enum_from_string (sections[0]);
+		if (info_local == info) {
+			g_autofree gchar *str = NULL;
+			str = gpk_package_id_format_oneline (sections[1], NULL);
+			g_string_append_printf (string, "%s, ", str);
+		}
+	}
+
+	/* nothing, so return NULL */
+	if (string->len == 0) {
+		g_string_free (string, TRUE);
+		return NULL;
+	}
+
+	/* remove last comma space */
+	g_string_set_size (string, string->len - 2);
+
+	/* add a nice header, and make text italic */
+	text = g_string_free (string, FALSE);
+	whole = g_strdup_printf ("<b>%s</b>: %s\n", info_text, text);
+	return whole;
+}
+
+/**
+ * gpk_log_get_details_localised:
+ * @timespec: the time of the transaction
+ * @data: the transaction data, one "info\tpackage_id" per line
+ *
+ * Return value: markup listing what was installed, removed and updated
+ **/
+gchar *
+gpk_log_get_details_localised (const gchar *timespec, const gchar *data)
+{
+	GString *string;
+	gchar *text;
+	g_auto(GStrv) array = NULL;
+
+	string = g_string_new ("");
+	array = g_strsplit (data, "\n", 0);
+
+	/* get each type */
+	text = gpk_log_get_type_line (array, PK_INFO_ENUM_INSTALLING);
+	if (text != NULL)
+		g_string_append (string, text);
+	g_free (text);
+	text = gpk_log_get_type_line (array, PK_INFO_ENUM_REMOVING);
+	if (text != NULL)
+		g_string_append (string, text);
+	g_free (text);
+	text = gpk_log_get_type_line (array, PK_INFO_ENUM_UPDATING);
+	if (text != NULL)
+		g_string_append (string, text);
+	g_free (text);
+
+	/* remove last \n */
+	if (string->len > 0)
+		g_string_set_size (string, string->len - 1);
+
+	return g_string_free (string, FALSE);
+}
+
+/**
+ * gpk_log_filter:
+ * @item: a #PkTransactionPast
+ * @filter: the text the user is looking for, or %NULL
+ *
+ * Return value: %TRUE if @item should be shown
+ **/
+gboolean
+gpk_log_filter (PkTransactionPast *item, const gchar *filter)
+{
+	gboolean ret = FALSE;
+	guint i;
+	guint length;
+	g_auto(GStrv) packages = NULL;
+	g_autofree gchar *tid = NULL;
+	gboolean succeeded;
+	g_autofree gchar *cmdline = NULL;
+	g_autofree gchar *data = NULL;
+
+	/* get data */
+	g_object_get (item,
+		      "tid", &tid,
+		      "succeeded", &succeeded,
+		      "cmdline", &cmdline,
+		      "data", &data,
+		      NULL);
+
+	/* only show transactions that succeeded */
+	if (!succeeded) {
+		g_debug ("tid %s did not succeed, so not adding", tid);
+		return FALSE;
+	}
+
+	if (filter == NULL)
+		return TRUE;
+
+	/* matches cmdline */
+	if (cmdline != NULL && g_strrstr (cmdline, filter) != NULL)
+		ret = TRUE;
+
+	/* look in all the data for the filter string */
+	packages = g_strsplit (data, "\n", 0);
+	length = g_strv_length (packages);
+	for (i = 0; i < length; i++) {
+		g_auto(GStrv) split = NULL;
+		g_auto(GStrv) sections = NULL;
+		sections = g_strsplit (packages[i], "\t", 0);
+
+		/* check if type matches filter */
+		if (g_strrstr (sections[0], filter) != NULL)
+			ret = TRUE;
+
+		/* check to see if package name, version or arch matches */
+		split = pk_package_id_split (sections[1]);
+		if (g_strrstr (split[0], filter) != NULL)
+			ret = TRUE;
+		if (split[1] != NULL && g_strrstr (split[1], filter) != NULL)
+			ret = TRUE;
+		if (split[2] != NULL && g_strrstr (split[2], filter) != NULL)
+			ret = TRUE;
+
+		/* shortcut for speed */
+		if (ret)
+			break;
+	}
+	return ret;
+}
+
+/* the main loop is checked this often when profiling */
+#define GPK_PROFILE_STALL_INTERVAL	10 /* ms */
+
+/* a check this much later than it was due is counted as a stall */
+#define GPK_PROFILE_STALL_THRESHOLD	50 /* ms */
+
+static gint gpk_profile_fd = -1;
+static gint64 gpk_profile_start = 0;
+static gint64 gpk_profile_last = 0;
+static guint gpk_profile_stalls = 0;
+static gint64 gpk_profile_stall_max = 0;
+
+static gboolean
+gpk_profile_stall_cb (gpointer user_data)
+{
+	gint64 now = g_get_monotonic_time ();
+	gint64 late;
+
+	late = (now - gpk_profile_last) / 1000 - GPK_PROFILE_STALL_INTERVAL;
+	if (late > GPK_PROFILE_STALL_THRESHOLD) {
+		gpk_profile_stalls++;
+		gpk_profile_stall_max = MAX (gpk_profile_stall_max, late);
+	}
+	gpk_profile_last = now;
+	return G_SOURCE_CONTINUE;
+}
+
+/**
+ * gpk_profile_init:
+ *
+ * Starts counting main loop stalls if GPK_PROFILE_FD is set, which is done
+ * by gpk-perf-test when it runs the tools against a mock daemon. Nothing
+ * is done otherwise.
+ **/
+void
+gpk_profile_init (void)
+{
+	const gchar *tmp;
+	guint id;
+
+	tmp = g_getenv ("GPK_PROFILE_FD");
+	if (tmp == NULL)
+		return;
+	gpk_profile_fd = (gint) g_ascii_strtoll (tmp, NULL, 10);
+	gpk_profile_start = g_get_monotonic_time ();
+	gpk_profile_last = gpk_profile_start;
+	id = g_timeout_add (GPK_PROFILE_STALL_INTERVAL, gpk_profile_stall_cb, NULL);
+	g_source_set_name_by_id (id, "[GpkProfile] stall");
+}
+
+/**
+ * gpk_profile_mark:
+ * @event: "first-row" or "complete"
+ *
+ * Reports that something the user waits for has happened, with the stalls
+ * so far and the peak memory use, as one line on the profile pipe.
+ **/
+void
+gpk_profile_mark (const gchar *event)
+{
+	struct rusage usage;
+	g_autofree gchar *line = NULL;
+
+	if (gpk_profile_fd < 0)
+		return;
+	if (getrusage (RUSAGE_SELF, &usage) != 0)
+		usage.ru_maxrss = 0;
+	line = g_strdup_printf ("%s %.1f %u %" G_GINT64_FORMAT " %ld\n", event,
+				(g_get_monotonic_time () - gpk_profile_start) / 1000.f,
+				gpk_profile_stalls, gpk_profile_stall_max,
+				(glong) usage.ru_maxrss);
+	if (write (gpk_profile_fd, line, strlen (line)) < 0)
+		g_warning ("failed to write profile: %s", g_strerror (errno));
+}
@@ -34,6 +34,7 @@ G_BEGIN_DECLS
 #define GPK_SETTINGS_CATEGORY_GROUPS			"category-groups"
 #define GPK_SETTINGS_DBUS_DEFAULT_INTERACTION		"dbus-default-interaction"
 #define GPK_SETTINGS_DBUS_ENFORCED_INTERACTION		"dbus-enforced-interaction"
+#define GPK_SETTINGS_DETAILS_INDEX			"details-index"
 #define GPK_SETTINGS_ENABLE_AUTOREMOVE			"enable-autoremove"
 #define GPK_SETTINGS_ENABLE_CODEC_HELPER		"enable-codec-helper"
 #define GPK_SETTINGS_ENABLE_FONT_HELPER			"enable-font-helper"
@@ -46,6 +47,8 @@ G_BEGIN_DECLS
 #define GPK_SETTINGS_ONLY_NEWEST			"only-newest"
 #define GPK_SETTINGS_REPO_SHOW_DETAILS			"repo-show-details"
 #define GPK_SETTINGS_SCROLL_ACTIVE			"scroll-active"
+#define GPK_SETTINGS_SEARCH_AS_YOU_TYPE			"search-as-you-type"
+#define GPK_SETTINGS_SEARCH_CACHE_SIZE			"search-cache-size"
 #define GPK_SETTINGS_SEARCH_MODE			"search-mode"
 #define GPK_SETTINGS_SHOW_ALL_PACKAGES			"show-all-packages"
 #define GPK_SETTINGS_SHOW_DEPENDS			"show-depends"
@@ -62,11 +65,46 @@ G_BEGIN_DECLS
 gchar		*gpk_package_id_format_twoline		(GtkStyleContext *style,
 							 const gchar 	*package_id,
 							 const gchar	*summary);
+
+/* large enough for "#rrggbb" */
+#define GPK_PACKAGE_FORMATTER_COLOR_LEN		8
+
+typedef struct _GpkPackageFormatter GpkPackageFormatter;
+
+GpkPackageFormatter *gpk_package_formatter_new		(GtkStyleContext *style);
+void		 gpk_package_formatter_free		(GpkPackageFormatter *formatter);
+gboolean	 gpk_package_formatter_append		(GpkPackageFormatter *formatter,
+							 GString	*string,
+							 const gchar	*package_id,
+							 const gchar	*summary);
+void		 gpk_package_formatter_append_packages	(GpkPackageFormatter *formatter,
+							 GPtrArray	*packages,
+							 GString	*arena,
+							 GArray		*offsets);
+
+#define GPK_TYPE_PACKAGE_ATOM (gpk_package_atom_get_type ())
+
+typedef struct _GpkPackageAtom GpkPackageAtom;
+
+GType		 gpk_package_atom_get_type		(void);
+GpkPackageAtom	*gpk_package_atom_intern		(const gchar	*package_id);
+GpkPackageAtom	*gpk_package_atom_lookup		(const gchar	*package_id);
+GpkPackageAtom	*gpk_package_atom_ref			(GpkPackageAtom	*atom);
+void		 gpk_package_atom_unref			(GpkPackageAtom	*atom);
+const gchar	*gpk_package_atom_get_id		(GpkPackageAtom	*atom);
+const gchar	*gpk_package_atom_get_name		(GpkPackageAtom	*atom);
+const gchar	*gpk_package_atom_get_version		(GpkPackageAtom	*atom);
+const gchar	*gpk_package_atom_get_arch		(GpkPackageAtom	*atom);
+const gchar	*gpk_package_atom_get_data		(GpkPackageAtom	*atom);
+guint		 gpk_package_atom_get_count		(void);
+
 gchar		*gpk_package_id_format_oneline		(const gchar 	*package_id,
 							 const gchar	*summary);
 gboolean	 gpk_check_privileged_user		(const gchar	*application_name,
 							 gboolean	 show_ui);
 gchar		*gpk_strv_join_locale			(gchar		**array);
+gboolean	 gpk_ascii_strcasestr			(const gchar	*haystack,
+							 const gchar	*needle);
 gboolean	 gpk_window_set_size_request		(GtkWindow	*window,
 							 guint		 width,
 							 guint		 height);
@@ -74,6 +112,15 @@ gboolean	 gpk_window_set_parent_xid		(GtkWindow	*window,
 							 guint32	 xid);
 GPtrArray	*pk_strv_to_ptr_array			(gchar		**array)
 							 G_GNUC_WARN_UNUSED_RESULT;
+gchar		*gpk_log_get_details_localised		(const gchar	*timespec,
+							 const gchar	*data);
+gboolean	 gpk_log_filter				(PkTransactionPast *item,
+							 const gchar	*filter);
+void		 gpk_profile_init			(void);
+void		 gpk_profile_mark			(const gchar	*event);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GpkPackageFormatter, gpk_package_formatter_free)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GpkPackageAtom, gpk_package_atom_unref)
 
 G_END_DECLS
 
@@ -0,0 +1,282 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <packagekit-glib2/packagekit.h>
+
+#include "gpk-dependency-graph.h"
+
+struct _GpkDependencyGraph
+{
+	GObject			 parent_instance;
+	GHashTable		*edges[GPK_DEPENDENCY_GRAPH_LAST];	/* package_id:GPtrArray */
+	GHashTable		*closures[GPK_DEPENDENCY_GRAPH_LAST];	/* package_id:GPtrArray */
+	GHashTable		*sizes;					/* package_id:guint64 */
+};
+
+G_DEFINE_TYPE (GpkDependencyGraph, gpk_dependency_graph, G_TYPE_OBJECT)
+
+/**
+ * gpk_dependency_graph_set_edges:
+ * @graph: a #GpkDependencyGraph
+ * @direction: a #GpkDependencyGraphDirection
+ * @package_id: a package ID
+ * @packages: the #PkPackage objects directly linked to @package_id
+ *
+ * Remembers the result of a non-recursive query for one package.
+ **/
+void
+gpk_dependency_graph_set_edges (GpkDependencyGraph *graph,
+				GpkDependencyGraphDirection direction,
+				const gchar *package_id,
+				GPtrArray *packages)
+{
+	g_return_if_fail (GPK_IS_DEPENDENCY_GRAPH (graph));
+	g_return_if_fail (direction < GPK_DEPENDENCY_GRAPH_LAST);
+	g_hash_table_insert (graph->edges[direction],
+			     g_strdup (package_id),
+			     g_ptr_array_ref (packages));
+}
+
+/**
+ * gpk_dependency_graph_get_edges:
+ * @graph: a #GpkDependencyGraph
+ * @direction: a #GpkDependencyGraphDirection
+ * @package_id: a package ID
+ *
+ * Return value: (transfer container): the linked packages, or %NULL if unknown
+ **/
+GPtrArray *
+gpk_dependency_graph_get_edges (GpkDependencyGraph *graph,
+				GpkDependencyGraphDirection direction,
+				const gchar *package_id)
+{
+	GPtrArray *packages;
+
+	g_return_val_if_fail (GPK_IS_DEPENDENCY_GRAPH (graph), NULL);
+	g_return_val_if_fail (direction < GPK_DEPENDENCY_GRAPH_LAST, NULL);
+	packages = g_hash_table_lookup (graph->edges[direction], package_id);
+	if (packages == NULL)
+		return NULL;
+	return g_ptr_array_ref (packages);
+}
+
+/**
+ * gpk_dependency_graph_set_closure:
+ * @graph: a #GpkDependencyGraph
+ * @direction: a #GpkDependencyGraphDirection
+ * @package_id: a package ID
+ * @packages: every #PkPackage that can be reached from @package_id
+ *
+ * Remembers the transitive closure, not including @package_id itself.
+ **/
+void
+gpk_dependency_graph_set_closure (GpkDependencyGraph *graph,
+				  GpkDependencyGraphDirection direction,
+				  const gchar *package_id,
+				  GPtrArray *packages)
+{
+	g_return_if_fail (GPK_IS_DEPENDENCY_GRAPH (graph));
+	g_return_if_fail (direction < GPK_DEPENDENCY_GRAPH_LAST);
+	g_hash_table_insert (graph->closures[direction],
+			     g_strdup (package_id),
+			     g_ptr_array_ref (packages));
+}
+
+/**
+ * gpk_dependency_graph_get_closure:
+ * @graph: a #GpkDependencyGraph
+ * @direction: a #GpkDependencyGraphDirection
+ * @package_id: a package ID
+ *
+ * Return value: (transfer container): the reachable packages, or %NULL if unknown
+ **/
+GPtrArray *
+gpk_dependency_graph_get_closure (GpkDependencyGraph *graph,
+				  GpkDependencyGraphDirection direction,
+				  const gchar *package_id)
+{
+	GPtrArray *packages;
+
+	g_return_val_if_fail (GPK_IS_DEPENDENCY_GRAPH (graph), NULL);
+	g_return_val_if_fail (direction < GPK_DEPENDENCY_GRAPH_LAST, NULL);
+	packages = g_hash_table_lookup (graph->closures[direction], package_id);
+	if (packages == NULL)
+		return NULL;
+	return g_ptr_array_ref (packages);
+}
+
+void
+gpk_dependency_graph_set_size (GpkDependencyGraph *graph,
+			       const gchar *package_id,
+			       guint64 size)
+{
+	guint64 *tmp;
+
+	g_return_if_fail (GPK_IS_DEPENDENCY_GRAPH (graph));
+	tmp = g_new (guint64, 1);
+	*tmp = size;
+	g_hash_table_insert (graph->sizes, g_strdup (package_id), tmp);
+}
+
+gboolean
+gpk_dependency_graph_get_size (GpkDependencyGraph *graph,
+			       const gchar *package_id,
+			       guint64 *size)
+{
+	guint64 *tmp;
+
+	g_return_val_if_fail (GPK_IS_DEPENDENCY_GRAPH (graph), FALSE);
+	tmp = g_hash_table_lookup (graph->sizes, package_id);
+	if (tmp == NULL)
+		return FALSE;
+	if (size != NULL)
+		*size = *tmp;
+	return TRUE;
+}
+
+/**
+ * gpk_dependency_graph_get_download_size:
+ * @graph: a #GpkDependencyGraph
+ * @package_id: a package ID
+ * @missing: (out) (allow-none): the number of packages without a known size
+ *
+ * Adds up the sizes of the packages that installing @package_id would
+ * also install, using only what has already been found out.
+ *
+ * Return value: the size in bytes
+ **/
+guint64
+gpk_dependency_graph_get_download_size (GpkDependencyGraph *graph,
+					const gchar *package_id,
+					guint *missing)
+{
+	GPtrArray *closure;
+	PkPackage *package;
+	guint64 size;
+	guint64 total = 0;
+	guint i;
+	guint missing_tmp = 0;
+
+	g_return_val_if_fail (GPK_IS_DEPENDENCY_GRAPH (graph), 0);
+
+	closure = g_hash_table_lookup (graph->closures[GPK_DEPENDENCY_GRAPH_DEPENDS], package_id);
+	for (i = 0; closure != NULL && i < closure->len; i++) {
+		package = g_ptr_array_index (closure, i);
+		if (pk_package_get_info (package) == PK_INFO_ENUM_INSTALLED)
+			continue;
+		if (gpk_dependency_graph_get_size (graph, pk_package_get_id (package), &size))
+			total += size;
+		else
+			missing_tmp++;
+	}
+	if (missing != NULL)
+		*missing = missing_tmp;
+	return total;
+}
+
+/**
+ * gpk_dependency_graph_get_fan_out:
+ * @graph: a #GpkDependencyGraph
+ * @package_id: a package ID
+ * @direct: (out) (allow-none): the number of packages that need @package_id directly
+ *
+ * Return value: the number of packages that need @package_id at all
+ **/
+guint
+gpk_dependency_graph_get_fan_out (GpkDependencyGraph *graph,
+				  const gchar *package_id,
+				  guint *direct)
+{
+	GPtrArray *packages;
+
+	g_return_val_if_fail (GPK_IS_DEPENDENCY_GRAPH (graph), 0);
+
+	if (direct != NULL) {
+		packages = g_hash_table_lookup (graph->edges[GPK_DEPENDENCY_GRAPH_REQUIRED_BY], package_id);
+		*direct = packages != NULL ? packages->len : 0;
+	}
+	packages = g_hash_table_lookup (graph->closures[GPK_DEPENDENCY_GRAPH_REQUIRED_BY], package_id);
+	return packages != NULL ? packages->len : 0;
+}
+
+/**
+ * gpk_dependency_graph_invalidate:
+ * @graph: a #GpkDependencyGraph
+ *
+ * Forgets everything, for instance when packages have been installed.
+ **/
+void
+gpk_dependency_graph_invalidate (GpkDependencyGraph *graph)
+{
+	guint i;
+
+	g_return_if_fail (GPK_IS_DEPENDENCY_GRAPH (graph));
+	for (i = 0; i < GPK_DEPENDENCY_GRAPH_LAST; i++) {
+		g_hash_table_remove_all (graph->edges[i]);
+		g_hash_table_remove_all (graph->closures[i]);
+	}
+	g_hash_table_remove_all (graph->sizes);
+}
+
+static void
+gpk_dependency_graph_finalize (GObject *object)
+{
+	GpkDependencyGraph *graph = GPK_DEPENDENCY_GRAPH (object);
+	guint i;
+
+	for (i = 0; i < GPK_DEPENDENCY_GRAPH_LAST; i++) {
+		g_hash_table_unref (graph->edges[i]);
+		g_hash_table_unref (graph->closures[i]);
+	}
+	g_hash_table_unref (graph->sizes);
+
+	G_OBJECT_CLASS (gpk_dependency_graph_parent_class)->finalize (object);
+}
+
+static void
+gpk_dependency_graph_class_init (GpkDependencyGraphClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gpk_dependency_graph_finalize;
+}
+
+static void
+gpk_dependency_graph_init (GpkDependencyGraph *graph)
+{
+	guint i;
+
+	for (i = 0; i < GPK_DEPENDENCY_GRAPH_LAST; i++) {
+		graph->edges[i] = g_hash_table_new_full (g_str_hash, g_str_equal,
+							 g_free, (GDestroyNotify) g_ptr_array_unref);
+		graph->closures[i] = g_hash_table_new_full (g_str_hash, g_str_equal,
+							    g_free, (GDestroyNotify) g_ptr_array_unref);
+	}
+	graph->sizes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+}
+
+GpkDependencyGraph *
+gpk_dependency_graph_new (void)
+{
+	return g_object_new (GPK_TYPE_DEPENDENCY_GRAPH, NULL);
+}
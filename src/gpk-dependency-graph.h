@@ -0,0 +1,70 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __GPK_DEPENDENCY_GRAPH_H
+#define __GPK_DEPENDENCY_GRAPH_H
+
+#include <glib-object.h>
+#include <packagekit-glib2/packagekit.h>
+
+G_BEGIN_DECLS
+
+#define GPK_TYPE_DEPENDENCY_GRAPH (gpk_dependency_graph_get_type ())
+G_DECLARE_FINAL_TYPE (GpkDependencyGraph, gpk_dependency_graph, GPK, DEPENDENCY_GRAPH, GObject)
+
+typedef enum {
+	GPK_DEPENDENCY_GRAPH_DEPENDS,		/* what a package needs */
+	GPK_DEPENDENCY_GRAPH_REQUIRED_BY,	/* what needs a package */
+	GPK_DEPENDENCY_GRAPH_LAST
+} GpkDependencyGraphDirection;
+
+GpkDependencyGraph *gpk_dependency_graph_new		(void);
+void		 gpk_dependency_graph_set_edges		(GpkDependencyGraph	*graph,
+							 GpkDependencyGraphDirection direction,
+							 const gchar		*package_id,
+							 GPtrArray		*packages);
+GPtrArray	*gpk_dependency_graph_get_edges		(GpkDependencyGraph	*graph,
+							 GpkDependencyGraphDirection direction,
+							 const gchar		*package_id);
+void		 gpk_dependency_graph_set_closure	(GpkDependencyGraph	*graph,
+							 GpkDependencyGraphDirection direction,
+							 const gchar		*package_id,
+							 GPtrArray		*packages);
+GPtrArray	*gpk_dependency_graph_get_closure	(GpkDependencyGraph	*graph,
+							 GpkDependencyGraphDirection direction,
+							 const gchar		*package_id);
+void		 gpk_dependency_graph_set_size		(GpkDependencyGraph	*graph,
+							 const gchar		*package_id,
+							 guint64		 size);
+gboolean	 gpk_dependency_graph_get_size		(GpkDependencyGraph	*graph,
+							 const gchar		*package_id,
+							 guint64		*size);
+guint64		 gpk_dependency_graph_get_download_size	(GpkDependencyGraph	*graph,
+							 const gchar		*package_id,
+							 guint			*missing);
+guint		 gpk_dependency_graph_get_fan_out	(GpkDependencyGraph	*graph,
+							 const gchar		*package_id,
+							 guint			*direct);
+void		 gpk_dependency_graph_invalidate	(GpkDependencyGraph	*graph);
+
+G_END_DECLS
+
+#endif /* __GPK_DEPENDENCY_GRAPH_H */
@@ -29,6 +29,7 @@
 #include "gpk-common.h"
 #include "gpk-dialog.h"
 #include "gpk-enum.h"
+#include "gpk-file-model.h"
 
 enum {
 	GPK_DIALOG_STORE_IMAGE,
@@ -66,7 +67,29 @@ gpk_dialog_package_id_name_join_locale (gchar **package_ids)
 	return text;
 }
 
-static GtkListStore *
+static gchar *
+gpk_dialog_package_get_text (PkPackage *item, const gchar **icon)
+{
+	PkInfoEnum info;
+	g_autofree gchar *package_id = NULL;
+	g_autofree gchar *summary = NULL;
+
+	g_object_get (item,
+		      "info", &info,
+		      "package-id", &package_id,
+		      "summary", &summary,
+		      NULL);
+	*icon = gpk_info_enum_to_icon_name (info);
+	return gpk_package_id_format_twoline (NULL, package_id, summary);
+}
+
+/**
+ * gpk_dialog_package_array_to_list_store:
+ * @array: (element-type PkPackage): the packages
+ *
+ * Return value: (transfer full): a new store with one row for each package
+ **/
+GtkListStore *
 gpk_dialog_package_array_to_list_store (GPtrArray *array)
 {
 	GtkListStore *store;
@@ -74,32 +97,20 @@ gpk_dialog_package_array_to_list_store (GPtrArray *array)
 	PkPackage *item;
 	const gchar *icon;
 	guint i;
-	PkInfoEnum info;
 
-	store = gtk_list_store_new (GPK_DIALOG_STORE_LAST, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
+	store = gtk_list_store_new (GPK_DIALOG_STORE_LAST, G_TYPE_STRING, GPK_TYPE_PACKAGE_ATOM, G_TYPE_STRING);
 
 	/* add each well */
 	for (i = 0; i < array->len; i++) {
-		g_auto(GStrv) split = NULL;
 		g_autofree gchar *text = NULL;
-		g_autofree gchar *package_id = NULL;
-		g_autofree gchar *summary = NULL;
+		g_autoptr(GpkPackageAtom) atom = NULL;
 		item = g_ptr_array_index (array, i);
-		g_object_get (item,
-			      "info", &info,
-			      "package-id", &package_id,
-			      "summary", &summary,
-			      NULL);
-		text = gpk_package_id_format_twoline (NULL, package_id, summary);
-
-		/* get the icon */
-		split = pk_package_id_split (package_id);
-		icon = gpk_info_enum_to_icon_name (info);
-
+		text = gpk_dialog_package_get_text (item, &icon);
+		atom = gpk_package_atom_intern (pk_package_get_id (item));
 		gtk_list_store_append (store, &iter);
 		gtk_list_store_set (store, &iter,
 				    GPK_DIALOG_STORE_IMAGE, icon,
-				    GPK_DIALOG_STORE_ID, package_id,
+				    GPK_DIALOG_STORE_ID, atom,
 				    GPK_DIALOG_STORE_TEXT, text,
 				    -1);
 	}
@@ -107,6 +118,37 @@ gpk_dialog_package_array_to_list_store (GPtrArray *array)
 	return store;
 }
 
+static void
+gpk_dialog_package_tree_append (GtkTreeStore *store, GtkTreeIter *parent, GPtrArray *array)
+{
+	GtkTreeIter iter;
+	GtkTreeIter child;
+	PkPackage *item;
+	const gchar *icon;
+	guint i;
+
+	for (i = 0; i < array->len; i++) {
+		g_autofree gchar *text = NULL;
+		g_autoptr(GpkPackageAtom) atom = NULL;
+		item = g_ptr_array_index (array, i);
+		text = gpk_dialog_package_get_text (item, &icon);
+		atom = gpk_package_atom_intern (pk_package_get_id (item));
+		gtk_tree_store_append (store, &iter, parent);
+		gtk_tree_store_set (store, &iter,
+				    GPK_DIALOG_STORE_IMAGE, icon,
+				    GPK_DIALOG_STORE_ID, atom,
+				    GPK_DIALOG_STORE_TEXT, text,
+				    -1);
+
+		/* so it can be expanded, the real children are added later */
+		gtk_tree_store_append (store, &child, &iter);
+		gtk_tree_store_set (store, &child,
+				    /* TRANSLATORS: shown while we find out what is below a package */
+				    GPK_DIALOG_STORE_TEXT, _("Loading…"),
+				    -1);
+	}
+}
+
 static gboolean
 gpk_dialog_treeview_for_package_list (GtkTreeView *treeview)
 {
@@ -190,49 +232,226 @@ gpk_dialog_embed_package_list_widget (GtkDialog *dialog, GPtrArray *array)
 	return TRUE;
 }
 
+static void
+gpk_dialog_file_list_loaded_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GtkTreeView) treeview = GTK_TREE_VIEW (user_data);
+	g_autoptr(GpkFileModel) model = NULL;
+	g_autoptr(GError) error = NULL;
+
+	model = gpk_file_model_new_finish (res, &error);
+	if (model == NULL) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("failed to sort files: %s", error->message);
+		return;
+	}
+
+	/* the filter box needs the unfiltered model to go back to */
+	g_object_set_data_full (G_OBJECT (treeview), "gpk-file-model",
+				g_object_ref (model), g_object_unref);
+	gtk_tree_view_set_model (treeview, GTK_TREE_MODEL (model));
+}
+
+static void
+gpk_dialog_file_list_search_changed_cb (GtkSearchEntry *entry, GtkTreeView *treeview)
+{
+	GpkFileModel *model;
+	const gchar *text;
+	g_autoptr(GpkFileModel) filtered = NULL;
+
+	/* not loaded yet */
+	model = g_object_get_data (G_OBJECT (treeview), "gpk-file-model");
+	if (model == NULL)
+		return;
+
+	text = gtk_entry_get_text (GTK_ENTRY (entry));
+	if (text[0] == '\0') {
+		gtk_tree_view_set_model (treeview, GTK_TREE_MODEL (model));
+		return;
+	}
+
+	/* narrow down what is shown now, which is quicker as the text grows */
+	filtered = gpk_file_model_new_filtered (GPK_FILE_MODEL (gtk_tree_view_get_model (treeview)), text);
+	gtk_tree_view_set_model (treeview, GTK_TREE_MODEL (filtered));
+}
+
+/**
+ * gpk_dialog_embed_package_tree_widget:
+ * @dialog: a #GtkDialog
+ * @array: the #PkPackage objects to show at the top level
+ *
+ * Adds a tree of packages that can each be expanded. Connect to
+ * #GtkTreeView::test-expand-row and use
+ * gpk_dialog_package_tree_set_children() to fill in each row.
+ *
+ * Return value: (transfer none): the #GtkTreeView
+ **/
+GtkTreeView *
+gpk_dialog_embed_package_tree_widget (GtkDialog *dialog, GPtrArray *array)
+{
+	GtkWidget *scroll;
+	GtkWidget *widget;
+	g_autoptr(GtkTreeStore) store = NULL;
+	GtkTreeView *treeview;
+	const guint row_height = 48;
+
+	store = gtk_tree_store_new (GPK_DIALOG_STORE_LAST, G_TYPE_STRING, GPK_TYPE_PACKAGE_ATOM, G_TYPE_STRING);
+	gpk_dialog_package_tree_append (store, NULL, array);
+
+	/* create a treeview to hold the store */
+	widget = gtk_tree_view_new_with_model (GTK_TREE_MODEL (store));
+	treeview = GTK_TREE_VIEW (widget);
+	gpk_dialog_treeview_for_package_list (treeview);
+	gtk_widget_show (widget);
+
+	/* scroll the treeview */
+	scroll = gtk_scrolled_window_new (NULL, NULL);
+	gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scroll), GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+	gtk_container_add (GTK_CONTAINER (scroll), widget);
+	gtk_container_set_border_width (GTK_CONTAINER (scroll), 6);
+	gtk_widget_set_size_request (GTK_WIDGET (scroll), -1, (row_height * 5) + 8);
+	gtk_widget_show (scroll);
+
+	/* add scrolled window */
+	widget = gtk_dialog_get_content_area (GTK_DIALOG(dialog));
+	gtk_container_add_with_properties (GTK_CONTAINER (widget), scroll,
+					   "expand", TRUE,
+					   "fill", TRUE,
+					   NULL);
+	return treeview;
+}
+
+/**
+ * gpk_dialog_package_tree_get_package_id:
+ * @treeview: a #GtkTreeView from gpk_dialog_embed_package_tree_widget()
+ * @iter: a row
+ *
+ * Return value: the package ID of the row, or %NULL for a placeholder
+ **/
+gchar *
+gpk_dialog_package_tree_get_package_id (GtkTreeView *treeview, GtkTreeIter *iter)
+{
+	g_autoptr(GpkPackageAtom) atom = NULL;
+	gtk_tree_model_get (gtk_tree_view_get_model (treeview), iter,
+			    GPK_DIALOG_STORE_ID, &atom,
+			    -1);
+	if (atom == NULL)
+		return NULL;
+	return g_strdup (gpk_package_atom_get_id (atom));
+}
+
+/**
+ * gpk_dialog_package_tree_get_loaded:
+ * @treeview: a #GtkTreeView from gpk_dialog_embed_package_tree_widget()
+ * @iter: a row
+ *
+ * Return value: %TRUE if the children of the row have been set
+ **/
+gboolean
+gpk_dialog_package_tree_get_loaded (GtkTreeView *treeview, GtkTreeIter *iter)
+{
+	GtkTreeIter child;
+	GtkTreeModel *model = gtk_tree_view_get_model (treeview);
+	g_autoptr(GpkPackageAtom) atom = NULL;
+
+	if (!gtk_tree_model_iter_children (model, &child, iter))
+		return TRUE;
+	gtk_tree_model_get (model, &child, GPK_DIALOG_STORE_ID, &atom, -1);
+	return atom != NULL;
+}
+
+/**
+ * gpk_dialog_package_tree_set_children:
+ * @treeview: a #GtkTreeView from gpk_dialog_embed_package_tree_widget()
+ * @iter: a row
+ * @array: the #PkPackage objects below the row
+ *
+ * Replaces the placeholder below a row.
+ **/
+void
+gpk_dialog_package_tree_set_children (GtkTreeView *treeview, GtkTreeIter *iter, GPtrArray *array)
+{
+	GtkTreeIter child;
+	GtkTreeStore *store = GTK_TREE_STORE (gtk_tree_view_get_model (treeview));
+
+	while (gtk_tree_model_iter_children (GTK_TREE_MODEL (store), &child, iter))
+		gtk_tree_store_remove (store, &child);
+	gpk_dialog_package_tree_append (store, iter, array);
+}
+
 gboolean
-gpk_dialog_embed_file_list_widget (GtkDialog *dialog, GPtrArray *files)
+gpk_dialog_embed_file_list_widget (GtkDialog *dialog, gchar **files)
 {
+	GtkCellRenderer *renderer;
+	GtkTreeViewColumn *column;
+	GtkWidget *box;
+	GtkWidget *entry;
 	GtkWidget *scroll;
 	GtkWidget *widget;
-	GtkTextBuffer *buffer;
-	g_auto(GStrv) array = NULL;
-	g_autofree gchar *text = NULL;
+	GCancellable *cancellable;
 
-	/* split and show */
-	array = pk_ptr_array_to_strv (files);
-	text = g_strjoinv ("\n", array);
-	if (text[0] == '\0') {
-		g_free (text);
-		text = g_strdup (_("No files"));
+	box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 6);
+	gtk_container_set_border_width (GTK_CONTAINER (box), 6);
+	gtk_widget_show (box);
+
+	/* nothing to browse */
+	if (files == NULL || files[0] == NULL) {
+		widget = gtk_label_new (_("No files"));
+		gtk_box_pack_start (GTK_BOX (box), widget, TRUE, TRUE, 0);
+		gtk_widget_show (widget);
+		goto out;
 	}
 
-	/* create a text view to hold the store */
-	widget = gtk_text_view_new ();
-	gtk_text_view_set_editable (GTK_TEXT_VIEW (widget), FALSE);
-	gtk_text_view_set_left_margin (GTK_TEXT_VIEW (widget), 5);
-	gtk_text_view_set_right_margin (GTK_TEXT_VIEW (widget), 5);
+	/* create a tree view that only asks for the rows it shows */
+	widget = gtk_tree_view_new ();
+	gtk_tree_view_set_headers_visible (GTK_TREE_VIEW (widget), FALSE);
+	gtk_tree_view_set_enable_search (GTK_TREE_VIEW (widget), FALSE);
+	column = gtk_tree_view_column_new ();
+	gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_FIXED);
+	renderer = gtk_cell_renderer_pixbuf_new ();
+	gtk_tree_view_column_pack_start (column, renderer, FALSE);
+	gtk_tree_view_column_add_attribute (column, renderer, "icon-name", GPK_FILE_MODEL_COLUMN_ICON);
+	renderer = gtk_cell_renderer_text_new ();
+	gtk_tree_view_column_pack_start (column, renderer, TRUE);
+	gtk_tree_view_column_add_attribute (column, renderer, "text", GPK_FILE_MODEL_COLUMN_NAME);
+	gtk_tree_view_append_column (GTK_TREE_VIEW (widget), column);
+	gtk_tree_view_set_fixed_height_mode (GTK_TREE_VIEW (widget), TRUE);
+	gtk_widget_show (widget);
+
+	/* filter as the user types */
+	entry = gtk_search_entry_new ();
+	/* TRANSLATORS: placeholder in the box that filters the file list */
+	gtk_entry_set_placeholder_text (GTK_ENTRY (entry), _("Filter files"));
+	g_signal_connect (entry, "search-changed",
+			  G_CALLBACK (gpk_dialog_file_list_search_changed_cb), widget);
+	gtk_box_pack_start (GTK_BOX (box), entry, FALSE, FALSE, 0);
+	gtk_widget_show (entry);
 
 	/* scroll the treeview */
 	scroll = gtk_scrolled_window_new (NULL, NULL);
 	gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scroll),
-					GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+					GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+	gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (scroll), GTK_SHADOW_IN);
 	gtk_container_add (GTK_CONTAINER (scroll), widget);
+	gtk_box_pack_start (GTK_BOX (box), scroll, TRUE, TRUE, 0);
 	gtk_widget_show (scroll);
 
-	/* set in buffer */
-	buffer = gtk_text_buffer_new (NULL);
-	gtk_text_buffer_set_text (buffer, text, -1);
-	gtk_text_view_set_buffer (GTK_TEXT_VIEW (widget), buffer);
-	gtk_widget_show (widget);
-
+	/* sort in a thread, as some packages have hundreds of thousands */
+	cancellable = g_cancellable_new ();
+	g_signal_connect_swapped (widget, "destroy",
+				  G_CALLBACK (g_cancellable_cancel), cancellable);
+	g_object_set_data_full (G_OBJECT (widget), "gpk-file-model-cancellable",
+				cancellable, g_object_unref);
+	gpk_file_model_new_async (files, cancellable,
+				  gpk_dialog_file_list_loaded_cb,
+				  g_object_ref (widget));
+out:
 	/* add some spacing to conform to the GNOME HIG */
-	gtk_container_set_border_width (GTK_CONTAINER (scroll), 6);
-	gtk_widget_set_size_request (GTK_WIDGET (scroll), -1, 300);
+	gtk_widget_set_size_request (box, -1, 300);
 
-	/* add scrolled window */
+	/* add the box */
 	widget = gtk_dialog_get_content_area (GTK_DIALOG(dialog));
-	gtk_box_pack_start (GTK_BOX (widget), scroll, TRUE, TRUE, 0);
+	gtk_box_pack_start (GTK_BOX (widget), box, TRUE, TRUE, 0);
 
 	return TRUE;
 }
@@ -28,10 +28,20 @@
 
 G_BEGIN_DECLS
 
+GtkListStore	*gpk_dialog_package_array_to_list_store	(GPtrArray	*array);
 gboolean	 gpk_dialog_embed_package_list_widget	(GtkDialog	*dialog,
 							 GPtrArray	*array);
+GtkTreeView	*gpk_dialog_embed_package_tree_widget	(GtkDialog	*dialog,
+							 GPtrArray	*array);
+gchar		*gpk_dialog_package_tree_get_package_id	(GtkTreeView	*treeview,
+							 GtkTreeIter	*iter);
+gboolean	 gpk_dialog_package_tree_get_loaded	(GtkTreeView	*treeview,
+							 GtkTreeIter	*iter);
+void		 gpk_dialog_package_tree_set_children	(GtkTreeView	*treeview,
+							 GtkTreeIter	*iter,
+							 GPtrArray	*array);
 gboolean	 gpk_dialog_embed_file_list_widget	(GtkDialog	*dialog,
-							 GPtrArray	*files);
+							 gchar		**files);
 gboolean	 gpk_dialog_embed_do_not_show_widget	(GtkDialog	*dialog,
 							 const gchar	*key);
 gchar		*gpk_dialog_package_id_name_join_locale	(gchar		**package_ids);
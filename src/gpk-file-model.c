@@ -0,0 +1,544 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <gtk/gtk.h>
+
+#include "gpk-common.h"
+#include "gpk-file-model.h"
+
+typedef struct _GpkFileModelNode GpkFileModelNode;
+
+/* a directory or file, covering the range of sorted paths below it */
+struct _GpkFileModelNode {
+	GpkFileModelNode	*parent;
+	GPtrArray		*children;	/* of GpkFileModelNode, NULL until needed */
+	guint			 start;
+	guint			 end;
+	guint			 offset;	/* of the name in the path */
+	guint			 len;		/* of the name */
+	guint			 index;		/* in parent->children */
+	gboolean		 is_dir;
+};
+
+struct _GpkFileModel
+{
+	GObject			 parent_instance;
+	GPtrArray		*paths;		/* sorted, and shared with filtered models */
+	GpkFileModelNode	*root;		/* NULL when filtered */
+	GArray			*matches;	/* of guint, NULL unless filtered */
+	gchar			*filter;	/* lowercase */
+	gint			 stamp;
+};
+
+static void gpk_file_model_tree_model_init (GtkTreeModelIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (GpkFileModel, gpk_file_model, G_TYPE_OBJECT,
+			 G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_MODEL,
+						gpk_file_model_tree_model_init))
+
+static void
+gpk_file_model_node_free (GpkFileModelNode *node)
+{
+	if (node->children != NULL)
+		g_ptr_array_unref (node->children);
+	g_free (node);
+}
+
+/* sort so that everything in a directory is together, even when a
+ * sibling has the directory name as a prefix, e.g. "bin" and "bin-x" */
+static gint
+gpk_file_model_path_cmp (gconstpointer a, gconstpointer b)
+{
+	const guchar *p1 = *((const guchar **) a);
+	const guchar *p2 = *((const guchar **) b);
+	guint c1;
+	guint c2;
+
+	while (*p1 != '\0' && *p1 == *p2) {
+		p1++;
+		p2++;
+	}
+	c1 = *p1 == '/' ? 1 : *p1;
+	c2 = *p2 == '/' ? 1 : *p2;
+	return (gint) c1 - (gint) c2;
+}
+
+static GPtrArray *
+gpk_file_model_sort_paths (gchar **files)
+{
+	GPtrArray *paths;
+	guint i;
+
+	paths = g_ptr_array_new_with_free_func (g_free);
+	for (i = 0; files != NULL && files[i] != NULL; i++) {
+		if (files[i][0] != '/') {
+			g_debug ("ignoring relative path %s", files[i]);
+			continue;
+		}
+		g_ptr_array_add (paths, g_strdup (files[i]));
+	}
+	g_ptr_array_sort (paths, gpk_file_model_path_cmp);
+	return paths;
+}
+
+static GPtrArray *
+gpk_file_model_node_get_children (GpkFileModel *model, GpkFileModelNode *node)
+{
+	GpkFileModelNode *child;
+	const gchar *name;
+	const gchar *path;
+	guint offset;
+	guint i;
+	guint j;
+	gsize len;
+
+	/* only work out what is in a directory when it is expanded */
+	if (node->children != NULL)
+		return node->children;
+	node->children = g_ptr_array_new_with_free_func ((GDestroyNotify) gpk_file_model_node_free);
+	if (!node->is_dir)
+		return node->children;
+
+	offset = node->offset + node->len + 1;
+	for (i = node->start; i < node->end; i = j) {
+		path = g_ptr_array_index (model->paths, i);
+		j = i + 1;
+
+		/* the directory itself */
+		if (strlen (path) <= offset)
+			continue;
+
+		/* everything with the same name at this depth */
+		name = path + offset;
+		len = strcspn (name, "/");
+		child = g_new0 (GpkFileModelNode, 1);
+		child->parent = node;
+		child->start = i;
+		child->offset = offset;
+		child->len = len;
+		child->index = node->children->len;
+		child->is_dir = name[len] == '/';
+		for (; j < node->end; j++) {
+			path = g_ptr_array_index (model->paths, j);
+			if (strncmp (path + offset, name, len) != 0)
+				break;
+			if (path[offset + len] == '/')
+				child->is_dir = TRUE;
+			else if (path[offset + len] != '\0')
+				break;
+		}
+		child->end = j;
+		g_ptr_array_add (node->children, child);
+	}
+	return node->children;
+}
+
+static void
+gpk_file_model_set_iter (GpkFileModel *model, GtkTreeIter *iter, gpointer data)
+{
+	iter->stamp = model->stamp;
+	iter->user_data = data;
+	iter->user_data2 = NULL;
+	iter->user_data3 = NULL;
+}
+
+static GtkTreeModelFlags
+gpk_file_model_get_flags (GtkTreeModel *tree_model)
+{
+	GpkFileModel *model = GPK_FILE_MODEL (tree_model);
+	if (model->matches != NULL)
+		return GTK_TREE_MODEL_LIST_ONLY | GTK_TREE_MODEL_ITERS_PERSIST;
+	return GTK_TREE_MODEL_ITERS_PERSIST;
+}
+
+static gint
+gpk_file_model_get_n_columns (GtkTreeModel *tree_model)
+{
+	return GPK_FILE_MODEL_COLUMN_LAST;
+}
+
+static GType
+gpk_file_model_get_column_type (GtkTreeModel *tree_model, gint index)
+{
+	switch (index) {
+	case GPK_FILE_MODEL_COLUMN_ICON:
+	case GPK_FILE_MODEL_COLUMN_NAME:
+	case GPK_FILE_MODEL_COLUMN_PATH:
+		return G_TYPE_STRING;
+	default:
+		return G_TYPE_INVALID;
+	}
+}
+
+static gboolean
+gpk_file_model_iter_nth_child (GtkTreeModel *tree_model, GtkTreeIter *iter,
+			       GtkTreeIter *parent, gint n)
+{
+	GpkFileModel *model = GPK_FILE_MODEL (tree_model);
+	GpkFileModelNode *node;
+	GPtrArray *children;
+
+	/* a list of the matching paths */
+	if (model->matches != NULL) {
+		if (parent != NULL || n < 0 || (guint) n >= model->matches->len) {
+			iter->stamp = 0;
+			return FALSE;
+		}
+		gpk_file_model_set_iter (model, iter, GUINT_TO_POINTER (n));
+		return TRUE;
+	}
+
+	node = parent != NULL ? parent->user_data : model->root;
+	children = gpk_file_model_node_get_children (model, node);
+	if (n < 0 || (guint) n >= children->len) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+	gpk_file_model_set_iter (model, iter, g_ptr_array_index (children, n));
+	return TRUE;
+}
+
+static gboolean
+gpk_file_model_get_iter (GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreePath *path)
+{
+	GtkTreeIter parent;
+	gint *indices;
+	gint depth;
+	gint i;
+
+	indices = gtk_tree_path_get_indices_with_depth (path, &depth);
+	for (i = 0; i < depth; i++) {
+		if (!gpk_file_model_iter_nth_child (tree_model, iter,
+						    i > 0 ? &parent : NULL, indices[i]))
+			return FALSE;
+		parent = *iter;
+	}
+	return depth > 0;
+}
+
+static GtkTreePath *
+gpk_file_model_get_path (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	GpkFileModel *model = GPK_FILE_MODEL (tree_model);
+	GpkFileModelNode *node;
+	GtkTreePath *path;
+
+	g_return_val_if_fail (iter->stamp == model->stamp, NULL);
+	if (model->matches != NULL)
+		return gtk_tree_path_new_from_indices (GPOINTER_TO_UINT (iter->user_data), -1);
+	path = gtk_tree_path_new ();
+	for (node = iter->user_data; node != model->root; node = node->parent)
+		gtk_tree_path_prepend_index (path, node->index);
+	return path;
+}
+
+static void
+gpk_file_model_get_value (GtkTreeModel *tree_model, GtkTreeIter *iter,
+			  gint column, GValue *value)
+{
+	GpkFileModel *model = GPK_FILE_MODEL (tree_model);
+	GpkFileModelNode *node = NULL;
+	const gchar *path;
+
+	g_return_if_fail (iter->stamp == model->stamp);
+	if (model->matches != NULL) {
+		path = g_ptr_array_index (model->paths,
+					  g_array_index (model->matches, guint,
+							 GPOINTER_TO_UINT (iter->user_data)));
+	} else {
+		node = iter->user_data;
+		path = g_ptr_array_index (model->paths, node->start);
+	}
+
+	g_value_init (value, gpk_file_model_get_column_type (tree_model, column));
+	switch (column) {
+	case GPK_FILE_MODEL_COLUMN_ICON:
+		if (node != NULL && node->is_dir)
+			g_value_set_static_string (value, "folder");
+		else
+			g_value_set_static_string (value, "text-x-generic");
+		break;
+	case GPK_FILE_MODEL_COLUMN_NAME:
+		if (node != NULL)
+			g_value_take_string (value, g_strndup (path + node->offset, node->len));
+		else
+			g_value_set_string (value, path);
+		break;
+	case GPK_FILE_MODEL_COLUMN_PATH:
+		if (node != NULL)
+			g_value_take_string (value, g_strndup (path, node->offset + node->len));
+		else
+			g_value_set_string (value, path);
+		break;
+	default:
+		g_warning ("invalid column %i", column);
+		break;
+	}
+}
+
+static gboolean
+gpk_file_model_iter_next (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	GpkFileModel *model = GPK_FILE_MODEL (tree_model);
+	GpkFileModelNode *node;
+	guint index;
+
+	g_return_val_if_fail (iter->stamp == model->stamp, FALSE);
+	if (model->matches != NULL) {
+		index = GPOINTER_TO_UINT (iter->user_data) + 1;
+		if (index >= model->matches->len) {
+			iter->stamp = 0;
+			return FALSE;
+		}
+		gpk_file_model_set_iter (model, iter, GUINT_TO_POINTER (index));
+		return TRUE;
+	}
+	node = iter->user_data;
+	if (node->index + 1 >= node->parent->children->len) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+	gpk_file_model_set_iter (model, iter, g_ptr_array_index (node->parent->children, node->index + 1));
+	return TRUE;
+}
+
+static gboolean
+gpk_file_model_iter_children (GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreeIter *parent)
+{
+	return gpk_file_model_iter_nth_child (tree_model, iter, parent, 0);
+}
+
+static gboolean
+gpk_file_model_iter_has_child (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	GpkFileModel *model = GPK_FILE_MODEL (tree_model);
+	GpkFileModelNode *node;
+
+	if (model->matches != NULL)
+		return FALSE;
+	node = iter->user_data;
+	return node->is_dir;
+}
+
+static gint
+gpk_file_model_iter_n_children (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	GpkFileModel *model = GPK_FILE_MODEL (tree_model);
+
+	if (model->matches != NULL)
+		return iter == NULL ? (gint) model->matches->len : 0;
+	return gpk_file_model_node_get_children (model, iter != NULL ? iter->user_data : model->root)->len;
+}
+
+static gboolean
+gpk_file_model_iter_parent (GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreeIter *child)
+{
+	GpkFileModel *model = GPK_FILE_MODEL (tree_model);
+	GpkFileModelNode *node;
+
+	if (model->matches != NULL) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+	node = child->user_data;
+	if (node->parent == model->root) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+	gpk_file_model_set_iter (model, iter, node->parent);
+	return TRUE;
+}
+
+static GpkFileModel *
+gpk_file_model_new_for_paths (GPtrArray *paths)
+{
+	GpkFileModel *model;
+
+	model = g_object_new (GPK_TYPE_FILE_MODEL, NULL);
+	model->paths = g_ptr_array_ref (paths);
+	model->root = g_new0 (GpkFileModelNode, 1);
+	model->root->end = paths->len;
+	model->root->is_dir = TRUE;
+	return model;
+}
+
+/**
+ * gpk_file_model_new:
+ * @files: the files in a package
+ *
+ * Creates a tree of the directories and files. The contents of each
+ * directory are only looked at when it is expanded.
+ **/
+GpkFileModel *
+gpk_file_model_new (gchar **files)
+{
+	g_autoptr(GPtrArray) paths = NULL;
+	paths = gpk_file_model_sort_paths (files);
+	return gpk_file_model_new_for_paths (paths);
+}
+
+static void
+gpk_file_model_sort_thread_cb (GTask *task, gpointer source_object,
+			       gpointer task_data, GCancellable *cancellable)
+{
+	g_task_return_pointer (task, gpk_file_model_sort_paths (task_data),
+			       (GDestroyNotify) g_ptr_array_unref);
+}
+
+/**
+ * gpk_file_model_new_async:
+ * @files: the files in a package
+ * @cancellable: a #GCancellable, or %NULL
+ * @callback: called when the model has been created
+ * @user_data: data for @callback
+ *
+ * Like gpk_file_model_new(), but sorts a large list of files in a thread.
+ **/
+void
+gpk_file_model_new_async (gchar **files,
+			  GCancellable *cancellable,
+			  GAsyncReadyCallback callback,
+			  gpointer user_data)
+{
+	g_autoptr(GTask) task = NULL;
+
+	task = g_task_new (NULL, cancellable, callback, user_data);
+	g_task_set_task_data (task, g_strdupv (files), (GDestroyNotify) g_strfreev);
+	g_task_run_in_thread (task, gpk_file_model_sort_thread_cb);
+}
+
+GpkFileModel *
+gpk_file_model_new_finish (GAsyncResult *res, GError **error)
+{
+	g_autoptr(GPtrArray) paths = NULL;
+
+	paths = g_task_propagate_pointer (G_TASK (res), error);
+	if (paths == NULL)
+		return NULL;
+	return gpk_file_model_new_for_paths (paths);
+}
+
+/**
+ * gpk_file_model_new_filtered:
+ * @model: a #GpkFileModel, which may itself be filtered
+ * @text: the text to search for, ignoring case
+ *
+ * Creates a flat list of the paths containing @text. If @model was
+ * filtered with a part of @text only its matches are searched, so
+ * typing into a filter box gets quicker with each character.
+ **/
+GpkFileModel *
+gpk_file_model_new_filtered (GpkFileModel *model, const gchar *text)
+{
+	GpkFileModel *filtered;
+	const gchar *path;
+	gboolean narrow;
+	guint i;
+	guint idx;
+	guint len;
+
+	g_return_val_if_fail (GPK_IS_FILE_MODEL (model), NULL);
+	g_return_val_if_fail (text != NULL, NULL);
+
+	filtered = g_object_new (GPK_TYPE_FILE_MODEL, NULL);
+	filtered->paths = g_ptr_array_ref (model->paths);
+	filtered->filter = g_ascii_strdown (text, -1);
+	filtered->matches = g_array_new (FALSE, FALSE, sizeof (guint));
+
+	/* narrow down the last matches if we can */
+	narrow = model->matches != NULL && strstr (filtered->filter, model->filter) != NULL;
+	len = narrow ? model->matches->len : model->paths->len;
+	for (i = 0; i < len; i++) {
+		idx = narrow ? g_array_index (model->matches, guint, i) : i;
+		path = g_ptr_array_index (model->paths, idx);
+		if (gpk_ascii_strcasestr (path, filtered->filter))
+			g_array_append_val (filtered->matches, idx);
+	}
+	return filtered;
+}
+
+/**
+ * gpk_file_model_get_size:
+ * @model: a #GpkFileModel
+ *
+ * Return value: the number of matching paths, or every path if not filtered
+ **/
+guint
+gpk_file_model_get_size (GpkFileModel *model)
+{
+	g_return_val_if_fail (GPK_IS_FILE_MODEL (model), 0);
+	if (model->matches != NULL)
+		return model->matches->len;
+	return model->paths->len;
+}
+
+static void
+gpk_file_model_tree_model_init (GtkTreeModelIface *iface)
+{
+	iface->get_flags = gpk_file_model_get_flags;
+	iface->get_n_columns = gpk_file_model_get_n_columns;
+	iface->get_column_type = gpk_file_model_get_column_type;
+	iface->get_iter = gpk_file_model_get_iter;
+	iface->get_path = gpk_file_model_get_path;
+	iface->get_value = gpk_file_model_get_value;
+	iface->iter_next = gpk_file_model_iter_next;
+	iface->iter_children = gpk_file_model_iter_children;
+	iface->iter_has_child = gpk_file_model_iter_has_child;
+	iface->iter_n_children = gpk_file_model_iter_n_children;
+	iface->iter_nth_child = gpk_file_model_iter_nth_child;
+	iface->iter_parent = gpk_file_model_iter_parent;
+}
+
+static void
+gpk_file_model_finalize (GObject *object)
+{
+	GpkFileModel *model = GPK_FILE_MODEL (object);
+
+	if (model->root != NULL)
+		gpk_file_model_node_free (model->root);
+	if (model->matches != NULL)
+		g_array_unref (model->matches);
+	if (model->paths != NULL)
+		g_ptr_array_unref (model->paths);
+	g_free (model->filter);
+
+	G_OBJECT_CLASS (gpk_file_model_parent_class)->finalize (object);
+}
+
+static void
+gpk_file_model_class_init (GpkFileModelClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gpk_file_model_finalize;
+}
+
+static void
+gpk_file_model_init (GpkFileModel *model)
+{
+	do {
+		model->stamp = g_random_int ();
+	} while (model->stamp == 0);
+}
@@ -0,0 +1,53 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __GPK_FILE_MODEL_H
+#define __GPK_FILE_MODEL_H
+
+#include <glib-object.h>
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define GPK_TYPE_FILE_MODEL (gpk_file_model_get_type ())
+G_DECLARE_FINAL_TYPE (GpkFileModel, gpk_file_model, GPK, FILE_MODEL, GObject)
+
+typedef enum {
+	GPK_FILE_MODEL_COLUMN_ICON,
+	GPK_FILE_MODEL_COLUMN_NAME,		/* basename, or the path when filtered */
+	GPK_FILE_MODEL_COLUMN_PATH,
+	GPK_FILE_MODEL_COLUMN_LAST
+} GpkFileModelColumn;
+
+GpkFileModel	*gpk_file_model_new			(gchar			**files);
+void		 gpk_file_model_new_async		(gchar			**files,
+							 GCancellable		*cancellable,
+							 GAsyncReadyCallback	 callback,
+							 gpointer		 user_data);
+GpkFileModel	*gpk_file_model_new_finish		(GAsyncResult		*res,
+							 GError			**error);
+GpkFileModel	*gpk_file_model_new_filtered		(GpkFileModel		*model,
+							 const gchar		*text);
+guint		 gpk_file_model_get_size		(GpkFileModel		*model);
+
+G_END_DECLS
+
+#endif /* __GPK_FILE_MODEL_H */
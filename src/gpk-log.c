@@ -143,79 +143,6 @@ gpk_log_get_localised_date (const gchar *timespec)
 	return g_strdup (buffer);
 }
 
-static gchar *
-gpk_log_get_type_line (gchar **array, PkInfoEnum info)
-{
-	guint i;
-	guint size;
-	PkInfoEnum info_local;
-	const gchar *info_text;
-	GString *string;
-	g_autofree gchar *text = NULL;
-	gchar *whole;
-
-	string = g_string_new ("");
-	size = g_strv_length (array);
-	info_text = gpk_info_enum_to_localised_past (info);
-
-	/* find all of this type */
-	for (i = 0; i < size; i++) {
-		g_auto(GStrv) sections = NULL;
-		sections = g_strsplit (array[i], "\t", 0);
-		info_local = pk_info_enum_from_string (sections[0]);
-		if (info_local == info) {
-			g_autofree gchar *str = NULL;
-			str = gpk_package_id_format_oneline (sections[1], NULL);
-			g_string_append_printf (string, "%s, ", str);
-		}
-	}
-
-	/* nothing, so return NULL */
-	if (string->len == 0) {
-		g_string_free (string, TRUE);
-		return NULL;
-	}
-
-	/* remove last comma space */
-	g_string_set_size (string, string->len - 2);
-
-	/* add a nice header, and make text italic */
-	text = g_string_free (string, FALSE);
-	whole = g_strdup_printf ("<b>%s</b>: %s\n", info_text, text);
-	return whole;
-}
-
-static gchar *
-gpk_log_get_details_localised (const gchar *timespec, const gchar *data)
-{
-	GString *string;
-	gchar *text;
-	g_auto(GStrv) array = NULL;
-
-	string = g_string_new ("");
-	array = g_strsplit (data, "\n", 0);
-
-	/* get each type */
-	text = gpk_log_get_type_line (array, PK_INFO_ENUM_INSTALLING);
-	if (text != NULL)
-		g_string_append (string, text);
-	g_free (text);
-	text = gpk_log_get_type_line (array, PK_INFO_ENUM_REMOVING);
-	if (text != NULL)
-		g_string_append (string, text);
-	g_free (text);
-	text = gpk_log_get_type_line (array, PK_INFO_ENUM_UPDATING);
-	if (text != NULL)
-		g_string_append (string, text);
-	g_free (text);
-
-	/* remove last \n */
-	if (string->len > 0)
-		g_string_set_size (string, string->len - 1);
-
-	return g_string_free (string, FALSE);
-}
-
 static void
 gpk_log_treeview_size_allocate_cb (GtkWidget *widget, GtkAllocation *allocation, GtkCellRenderer *cell)
 {
@@ -313,67 +240,6 @@ gpk_log_treeview_clicked_cb (GtkTreeSelection *selection, gpointer data)
 	}
 }
 
-static gboolean
-gpk_log_filter (PkTransactionPast *item)
-{
-	gboolean ret = FALSE;
-	guint i;
-	guint length;
-	g_auto(GStrv) packages = NULL;
-	g_autofree gchar *tid = NULL;
-	gboolean succeeded;
-	g_autofree gchar *cmdline = NULL;
-	g_autofree gchar *data = NULL;
-
-	/* get data */
-	g_object_get (item,
-		      "tid", &tid,
-		      "succeeded", &succeeded,
-		      "cmdline", &cmdline,
-		      "data", &data,
-		      NULL);
-
-	/* only show transactions that succeeded */
-	if (!succeeded) {
-		g_debug ("tid %s did not succeed, so not adding", tid);
-		return FALSE;
-	}
-
-	if (filter == NULL)
-		return TRUE;
-
-	/* matches cmdline */
-	if (cmdline != NULL && g_strrstr (cmdline, filter) != NULL)
-		ret = TRUE;
-
-	/* look in all the data for the filter string */
-	packages = g_strsplit (data, "\n", 0);
-	length = g_strv_length (packages);
-	for (i = 0; i < length; i++) {
-		g_auto(GStrv) split = NULL;
-		g_auto(GStrv) sections = NULL;
-		sections = g_strsplit (packages[i], "\t", 0);
-
-		/* check if type matches filter */
-		if (g_strrstr (sections[0], filter) != NULL)
-			ret = TRUE;
-
-		/* check to see if package name, version or arch matches */
-		split = pk_package_id_split (sections[1]);
-		if (g_strrstr (split[0], filter) != NULL)
-			ret = TRUE;
-		if (split[1] != NULL && g_strrstr (split[1], filter) != NULL)
-			ret = TRUE;
-		if (split[2] != NULL && g_strrstr (split[2], filter) != NULL)
-			ret = TRUE;
-
-		/* shortcut for speed */
-		if (ret)
-			break;
-	}
-	return ret;
-}
-
 static void
 gpk_log_add_item (PkTransactionPast *item)
 {
@@ -462,6 +328,8 @@ gpk_log_add_item (PkTransactionPast *item)
 			    GPK_LOG_COLUMN_USER, username,
 			    GPK_LOG_COLUMN_TOOL, tool,
 			    GPK_LOG_COLUMN_ACTIVE, TRUE, -1);
+	if (count == 0)
+		gpk_profile_mark ("first-row");
 
 	/* spin the gui */
 	if (count++ % 10 == 0)
@@ -499,7 +367,7 @@ gpk_log_refilter (void)
 	/* go through the list, adding and removing the items as required */
 	for (i = 0; i < transactions->len; i++) {
 		item = g_ptr_array_index (transactions, i);
-		ret = gpk_log_filter (item);
+		ret = gpk_log_filter (item, filter);
 		if (ret)
 			gpk_log_add_item (item);
 	}
@@ -535,6 +403,7 @@ gpk_log_get_old_transactions_cb (GObject *object, GAsyncResult *res, gpointer us
 		g_ptr_array_unref (transactions);
 	transactions = pk_results_get_transaction_array (results);
 	gpk_log_refilter ();
+	gpk_profile_mark ("complete");
 }
 
 static void
@@ -669,6 +538,7 @@ int
 main (int argc, char *argv[])
 {
 	gboolean ret;
+	gboolean allow_privileged = FALSE;
 	gint status = 1;
 	GOptionContext *context;
 	g_autoptr(GtkApplication) application = NULL;
@@ -680,6 +550,9 @@ main (int argc, char *argv[])
 		{ "parent-window", 'p', 0, G_OPTION_ARG_INT, &xid,
 		  /* TRANSLATORS: we can make this modal (stay on top of) another window */
 		  _("Set the parent window to make this modal"), NULL },
+		{ "allow-privileged", '\0', G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_NONE, &allow_privileged,
+		  /* TRANSLATORS: developer option, for running from automated tests */
+		  _("Do not warn when running as a privileged user"), NULL },
 		{ NULL}
 	};
 
@@ -690,6 +563,7 @@ main (int argc, char *argv[])
 	textdomain (GETTEXT_PACKAGE);
 
 	gtk_init (&argc, &argv);
+	gpk_profile_init ();
 
 	context = g_option_context_new (NULL);
 	g_option_context_set_summary (context, _("Software Log Viewer"));
@@ -700,7 +574,7 @@ main (int argc, char *argv[])
 	g_option_context_free (context);
 
 	/* are we running privileged */
-	ret = gpk_check_privileged_user (_("Log viewer"), TRUE);
+	ret = gpk_check_privileged_user (_("Log viewer"), !allow_privileged);
 	if (!ret)
 		goto out;
 
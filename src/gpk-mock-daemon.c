@@ -0,0 +1,973 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <packagekit-glib2/packagekit.h>
+
+#include "gpk-mock-daemon.h"
+
+/* how many signals are sent each time the main loop is idle */
+#define GPK_MOCK_DAEMON_EMIT_BATCH	500
+
+#define GPK_MOCK_DAEMON_PATH		"/org/freedesktop/PackageKit"
+#define GPK_MOCK_DAEMON_NAME		"org.freedesktop.PackageKit"
+#define GPK_MOCK_DAEMON_IFACE_TRANSACTION "org.freedesktop.PackageKit.Transaction"
+
+/* only what the tools call, the real daemon has a few more */
+static const gchar gpk_mock_daemon_xml[] =
+"<node>"
+"  <interface name='org.freedesktop.PackageKit'>"
+"    <property name='VersionMajor' type='u' access='read'/>"
+"    <property name='VersionMinor' type='u' access='read'/>"
+"    <property name='VersionMicro' type='u' access='read'/>"
+"    <property name='BackendName' type='s' access='read'/>"
+"    <property name='BackendDescription' type='s' access='read'/>"
+"    <property name='BackendAuthor' type='s' access='read'/>"
+"    <property name='Roles' type='t' access='read'/>"
+"    <property name='Groups' type='t' access='read'/>"
+"    <property name='Filters' type='t' access='read'/>"
+"    <property name='MimeTypes' type='as' access='read'/>"
+"    <property name='Locked' type='b' access='read'/>"
+"    <property name='NetworkState' type='u' access='read'/>"
+"    <property name='DistroId' type='s' access='read'/>"
+"    <method name='CanAuthorize'>"
+"      <arg type='s' name='action_id' direction='in'/>"
+"      <arg type='u' name='result' direction='out'/>"
+"    </method>"
+"    <method name='CreateTransaction'>"
+"      <arg type='o' name='object_path' direction='out'/>"
+"    </method>"
+"    <method name='GetTimeSinceAction'>"
+"      <arg type='u' name='role' direction='in'/>"
+"      <arg type='u' name='seconds' direction='out'/>"
+"    </method>"
+"    <method name='GetTransactionList'>"
+"      <arg type='ao' name='transactions' direction='out'/>"
+"    </method>"
+"    <method name='GetDaemonState'>"
+"      <arg type='s' name='state' direction='out'/>"
+"    </method>"
+"    <method name='StateHasChanged'>"
+"      <arg type='s' name='reason' direction='in'/>"
+"    </method>"
+"    <method name='SuggestDaemonQuit'/>"
+"    <method name='SetProxy'>"
+"      <arg type='s' name='proxy_http' direction='in'/>"
+"      <arg type='s' name='proxy_https' direction='in'/>"
+"      <arg type='s' name='proxy_ftp' direction='in'/>"
+"      <arg type='s' name='proxy_socks' direction='in'/>"
+"      <arg type='s' name='no_proxy' direction='in'/>"
+"      <arg type='s' name='pac' direction='in'/>"
+"    </method>"
+"    <signal name='TransactionListChanged'>"
+"      <arg type='as' name='transactions'/>"
+"    </signal>"
+"    <signal name='RepoListChanged'/>"
+"    <signal name='UpdatesChanged'/>"
+"  </interface>"
+"  <interface name='org.freedesktop.PackageKit.Transaction'>"
+"    <property name='Role' type='u' access='read'/>"
+"    <property name='Status' type='u' access='read'/>"
+"    <property name='LastPackage' type='s' access='read'/>"
+"    <property name='Uid' type='u' access='read'/>"
+"    <property name='Percentage' type='u' access='read'/>"
+"    <property name='AllowCancel' type='b' access='read'/>"
+"    <property name='CallerActive' type='b' access='read'/>"
+"    <property name='ElapsedTime' type='u' access='read'/>"
+"    <property name='RemainingTime' type='u' access='read'/>"
+"    <property name='Speed' type='u' access='read'/>"
+"    <property name='DownloadSizeRemaining' type='t' access='read'/>"
+"    <property name='TransactionFlags' type='t' access='read'/>"
+"    <method name='SetHints'><arg type='as' direction='in'/></method>"
+"    <method name='Cancel'/>"
+"    <method name='GetCategories'/>"
+"    <method name='GetDetails'><arg type='as' direction='in'/></method>"
+"    <method name='GetFiles'><arg type='as' direction='in'/></method>"
+"    <method name='GetPackages'><arg type='t' direction='in'/></method>"
+"    <method name='GetUpdates'><arg type='t' direction='in'/></method>"
+"    <method name='GetUpdateDetail'><arg type='as' direction='in'/></method>"
+"    <method name='GetOldTransactions'><arg type='u' direction='in'/></method>"
+"    <method name='GetRepoList'><arg type='t' direction='in'/></method>"
+"    <method name='GetDistroUpgrades'/>"
+"    <method name='RepoEnable'>"
+"      <arg type='s' direction='in'/><arg type='b' direction='in'/>"
+"    </method>"
+"    <method name='RefreshCache'><arg type='b' direction='in'/></method>"
+"    <method name='Resolve'>"
+"      <arg type='t' direction='in'/><arg type='as' direction='in'/>"
+"    </method>"
+"    <method name='SearchNames'>"
+"      <arg type='t' direction='in'/><arg type='as' direction='in'/>"
+"    </method>"
+"    <method name='SearchDetails'>"
+"      <arg type='t' direction='in'/><arg type='as' direction='in'/>"
+"    </method>"
+"    <method name='SearchFiles'>"
+"      <arg type='t' direction='in'/><arg type='as' direction='in'/>"
+"    </method>"
+"    <method name='SearchGroups'>"
+"      <arg type='t' direction='in'/><arg type='as' direction='in'/>"
+"    </method>"
+"    <method name='DependsOn'>"
+"      <arg type='t' direction='in'/><arg type='as' direction='in'/>"
+"      <arg type='b' direction='in'/>"
+"    </method>"
+"    <method name='RequiredBy'>"
+"      <arg type='t' direction='in'/><arg type='as' direction='in'/>"
+"      <arg type='b' direction='in'/>"
+"    </method>"
+"    <method name='InstallPackages'>"
+"      <arg type='t' direction='in'/><arg type='as' direction='in'/>"
+"    </method>"
+"    <method name='RemovePackages'>"
+"      <arg type='t' direction='in'/><arg type='as' direction='in'/>"
+"      <arg type='b' direction='in'/><arg type='b' direction='in'/>"
+"    </method>"
+"    <method name='UpdatePackages'>"
+"      <arg type='t' direction='in'/><arg type='as' direction='in'/>"
+"    </method>"
+"    <signal name='Category'>"
+"      <arg type='s'/><arg type='s'/><arg type='s'/><arg type='s'/><arg type='s'/>"
+"    </signal>"
+"    <signal name='Details'><arg type='a{sv}'/></signal>"
+"    <signal name='ErrorCode'><arg type='u'/><arg type='s'/></signal>"
+"    <signal name='Files'><arg type='s'/><arg type='as'/></signal>"
+"    <signal name='Finished'><arg type='u'/><arg type='u'/></signal>"
+"    <signal name='Package'><arg type='u'/><arg type='s'/><arg type='s'/></signal>"
+"    <signal name='RepoDetail'><arg type='s'/><arg type='s'/><arg type='b'/></signal>"
+"    <signal name='Transaction'>"
+"      <arg type='o'/><arg type='s'/><arg type='b'/><arg type='u'/>"
+"      <arg type='u'/><arg type='s'/><arg type='u'/><arg type='s'/>"
+"    </signal>"
+"    <signal name='UpdateDetail'>"
+"      <arg type='s'/><arg type='as'/><arg type='as'/><arg type='as'/>"
+"      <arg type='as'/><arg type='as'/><arg type='u'/><arg type='s'/>"
+"      <arg type='s'/><arg type='u'/><arg type='s'/><arg type='s'/>"
+"    </signal>"
+"    <signal name='Destroy'/>"
+"  </interface>"
+"</node>";
+
+/* package names are made from these so that searches find a few */
+static const gchar *gpk_mock_daemon_prefixes[] = {
+	"gnome-", "lib", "python3-", "perl-", "texlive-", "kernel-",
+	"rust-", "golang-", "ghc-", "xorg-x11-", NULL };
+
+static const gchar *gpk_mock_daemon_repos[] = {
+	"fedora", "updates", "updates-testing", "fedora-debuginfo", NULL };
+
+struct _GpkMockDaemon
+{
+	GObject			 parent_instance;
+	GDBusConnection		*connection;
+	GDBusNodeInfo		*introspection;
+	GPtrArray		*transactions;	/* of GpkMockTransaction */
+	guint			 registration_id;
+	guint			 owner_id;
+	guint			 tid;
+	guint			 packages;
+	guint			 history;
+	guint			 updates;
+};
+
+typedef struct {
+	GpkMockDaemon		*daemon;	/* not ref'd */
+	gchar			*path;
+	guint			 registration_id;
+	PkRoleEnum		 role;
+	PkStatusEnum		 status;
+	GPtrArray		*signals;	/* of GpkMockSignal */
+	guint			 signals_sent;
+	guint			 idle_id;
+	GTimer			*timer;
+	gboolean		 cancelled;
+} GpkMockTransaction;
+
+typedef struct {
+	const gchar		*name;
+	GVariant		*parameters;
+} GpkMockSignal;
+
+G_DEFINE_TYPE (GpkMockDaemon, gpk_mock_daemon, G_TYPE_OBJECT)
+
+static void
+gpk_mock_signal_free (GpkMockSignal *signal)
+{
+	g_variant_unref (signal->parameters);
+	g_free (signal);
+}
+
+static void
+gpk_mock_transaction_free (GpkMockTransaction *transaction)
+{
+	if (transaction->idle_id != 0)
+		g_source_remove (transaction->idle_id);
+	if (transaction->registration_id != 0)
+		g_dbus_connection_unregister_object (transaction->daemon->connection,
+						     transaction->registration_id);
+	g_ptr_array_unref (transaction->signals);
+	g_timer_destroy (transaction->timer);
+	g_free (transaction->path);
+	g_free (transaction);
+}
+
+static void
+gpk_mock_transaction_add (GpkMockTransaction *transaction,
+			  const gchar *name, GVariant *parameters)
+{
+	GpkMockSignal *signal = g_new0 (GpkMockSignal, 1);
+	signal->name = name;
+	signal->parameters = g_variant_ref_sink (parameters);
+	g_ptr_array_add (transaction->signals, signal);
+}
+
+static gchar *
+gpk_mock_daemon_get_name (guint idx)
+{
+	guint n = G_N_ELEMENTS (gpk_mock_daemon_prefixes) - 1;
+	return g_strdup_printf ("%spkg%05u", gpk_mock_daemon_prefixes[idx % n], idx);
+}
+
+static gchar *
+gpk_mock_daemon_get_package_id (guint idx, guint release)
+{
+	guint n = G_N_ELEMENTS (gpk_mock_daemon_repos) - 1;
+	g_autofree gchar *name = gpk_mock_daemon_get_name (idx);
+	return g_strdup_printf ("%s;1.%u-%u.fc25;%s;%s", name, idx % 7, release,
+				idx % 3 == 0 ? "noarch" : "x86_64",
+				idx % 10 == 0 ? "installed" : gpk_mock_daemon_repos[idx % n]);
+}
+
+static PkInfoEnum
+gpk_mock_daemon_get_info (guint idx)
+{
+	return idx % 10 == 0 ? PK_INFO_ENUM_INSTALLED : PK_INFO_ENUM_AVAILABLE;
+}
+
+static guint
+gpk_mock_daemon_get_index (const gchar *package_id)
+{
+	const gchar *tmp = strstr (package_id, "pkg");
+	if (tmp == NULL)
+		return 0;
+	return (guint) g_ascii_strtoull (tmp + 3, NULL, 10);
+}
+
+static void
+gpk_mock_transaction_add_package (GpkMockTransaction *transaction,
+				  guint idx, PkBitfield filters)
+{
+	PkInfoEnum info = gpk_mock_daemon_get_info (idx);
+	g_autofree gchar *package_id = NULL;
+	g_autofree gchar *summary = NULL;
+
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED) &&
+	    info != PK_INFO_ENUM_INSTALLED)
+		return;
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED) &&
+	    info == PK_INFO_ENUM_INSTALLED)
+		return;
+	package_id = gpk_mock_daemon_get_package_id (idx, 1);
+	summary = g_strdup_printf ("Synthetic package number %u", idx);
+	gpk_mock_transaction_add (transaction, "Package",
+				  g_variant_new ("(uss)", info, package_id, summary));
+}
+
+static void
+gpk_mock_transaction_search (GpkMockTransaction *transaction,
+			     PkBitfield filters, const gchar **values,
+			     gboolean exact)
+{
+	GpkMockDaemon *daemon = transaction->daemon;
+	guint i;
+	guint j;
+
+	for (i = 0; i < daemon->packages; i++) {
+		g_autofree gchar *name = gpk_mock_daemon_get_name (i);
+		for (j = 0; values[j] != NULL; j++) {
+			if (exact ? g_strcmp0 (name, values[j]) == 0 :
+				    strstr (name, values[j]) != NULL) {
+				gpk_mock_transaction_add_package (transaction, i, filters);
+				break;
+			}
+		}
+	}
+}
+
+static void
+gpk_mock_transaction_get_details (GpkMockTransaction *transaction,
+				  const gchar **package_ids)
+{
+	GVariantBuilder builder;
+	guint i;
+	guint idx;
+
+	for (i = 0; package_ids[i] != NULL; i++) {
+		idx = gpk_mock_daemon_get_index (package_ids[i]);
+		g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+		g_variant_builder_add (&builder, "{sv}", "package-id",
+				       g_variant_new_string (package_ids[i]));
+		g_variant_builder_add (&builder, "{sv}", "summary",
+				       g_variant_new_take_string (g_strdup_printf ("Synthetic package number %u", idx)));
+		g_variant_builder_add (&builder, "{sv}", "description",
+				       g_variant_new_take_string (g_strdup_printf ("This package was made up by the mock "
+										   "daemon so the tools have something "
+										   "to show. It is number %u.", idx)));
+		g_variant_builder_add (&builder, "{sv}", "url",
+				       g_variant_new_string ("https://www.freedesktop.org/software/PackageKit/"));
+		g_variant_builder_add (&builder, "{sv}", "license",
+				       g_variant_new_string ("GPLv2+"));
+		g_variant_builder_add (&builder, "{sv}", "group",
+				       g_variant_new_uint32 (1 + idx % (PK_GROUP_ENUM_LAST - 1)));
+		g_variant_builder_add (&builder, "{sv}", "size",
+				       g_variant_new_uint64 (1024 * (1 + idx % 4096)));
+		gpk_mock_transaction_add (transaction, "Details",
+					  g_variant_new ("(a{sv})", &builder));
+	}
+}
+
+static void
+gpk_mock_transaction_get_files (GpkMockTransaction *transaction,
+				const gchar **package_ids)
+{
+	guint i;
+	guint j;
+
+	for (i = 0; package_ids[i] != NULL; i++) {
+		g_autoptr(GPtrArray) files = g_ptr_array_new_with_free_func (g_free);
+		g_auto(GStrv) split = pk_package_id_split (package_ids[i]);
+		if (split == NULL)
+			continue;
+		for (j = 0; j < 20; j++) {
+			g_ptr_array_add (files, g_strdup_printf ("/usr/share/%s/file%02u",
+								 split[PK_PACKAGE_ID_NAME], j));
+		}
+		g_ptr_array_add (files, NULL);
+		gpk_mock_transaction_add (transaction, "Files",
+					  g_variant_new ("(s^as)", package_ids[i],
+							 (gchar **) files->pdata));
+	}
+}
+
+static void
+gpk_mock_transaction_get_updates (GpkMockTransaction *transaction)
+{
+	GpkMockDaemon *daemon = transaction->daemon;
+	PkInfoEnum info;
+	guint i;
+
+	for (i = 0; i < daemon->updates; i++) {
+		g_autofree gchar *package_id = gpk_mock_daemon_get_package_id (i * 10, 2);
+		g_autofree gchar *summary = g_strdup_printf ("Synthetic package number %u", i * 10);
+		if (i % 20 == 0)
+			info = PK_INFO_ENUM_SECURITY;
+		else if (i % 3 == 0)
+			info = PK_INFO_ENUM_BUGFIX;
+		else
+			info = PK_INFO_ENUM_NORMAL;
+		gpk_mock_transaction_add (transaction, "Package",
+					  g_variant_new ("(uss)", info, package_id, summary));
+	}
+}
+
+static void
+gpk_mock_transaction_get_update_detail (GpkMockTransaction *transaction,
+					const gchar **package_ids)
+{
+	const gchar *empty[] = { NULL };
+	guint i;
+	guint j;
+
+	for (i = 0; package_ids[i] != NULL; i++) {
+		g_autoptr(GString) changelog = g_string_new (NULL);
+		g_autofree gchar *updates = NULL;
+		guint idx = gpk_mock_daemon_get_index (package_ids[i]);
+		const gchar *updates_array[] = { NULL, NULL };
+		const gchar *urls[] = { "https://bugzilla.redhat.com/1", NULL };
+
+		/* a long changelog, like the real ones */
+		for (j = 0; j < 30; j++) {
+			g_string_append_printf (changelog,
+						"* Mon Oct 10 2016 Packager <packager@example.com> - 1.%u-%u\n"
+						"- Fix bug %u found in the last release\n\n",
+						idx % 7, 30 - j, idx * 30 + j);
+		}
+		updates = gpk_mock_daemon_get_package_id (idx, 1);
+		updates_array[0] = updates;
+		gpk_mock_transaction_add (transaction, "UpdateDetail",
+					  g_variant_new ("(s^as^as^as^as^asussuss)",
+							 package_ids[i],
+							 updates_array, empty,
+							 urls, urls, empty,
+							 (guint32) (idx % 50 == 0 ? PK_RESTART_ENUM_SYSTEM : PK_RESTART_ENUM_NONE),
+							 "This update fixes a few bugs.",
+							 changelog->str,
+							 (guint32) PK_UPDATE_STATE_ENUM_STABLE,
+							 "2016-10-10T09:00:00Z",
+							 "2016-10-11T09:00:00Z"));
+	}
+}
+
+static void
+gpk_mock_transaction_get_old_transactions (GpkMockTransaction *transaction, guint number)
+{
+	GpkMockDaemon *daemon = transaction->daemon;
+	guint i;
+	guint j;
+	guint max = daemon->history;
+
+	if (number > 0 && number < max)
+		max = number;
+	for (i = 0; i < max; i++) {
+		g_autoptr(GString) data = g_string_new (NULL);
+		g_autofree gchar *tid = NULL;
+		g_autofree gchar *timespec = NULL;
+		g_autoptr(GDateTime) dt = NULL;
+
+		/* a few packages each */
+		for (j = 0; j < 1 + i % 5; j++) {
+			g_autofree gchar *package_id = NULL;
+			package_id = gpk_mock_daemon_get_package_id ((i * 5 + j) % MAX (daemon->packages, 1), 1);
+			g_string_append_printf (data, "%s\t%s\n",
+						pk_info_enum_to_string (j % 2 == 0 ? PK_INFO_ENUM_INSTALLING :
+											 PK_INFO_ENUM_UPDATING),
+						package_id);
+		}
+		if (data->len > 0)
+			g_string_truncate (data, data->len - 1);
+		tid = g_strdup_printf ("/%u_mock", i + 1);
+		dt = g_date_time_new_from_unix_utc (1476000000 - (gint64) i * 3600);
+		timespec = g_date_time_format (dt, "%FT%TZ");
+		gpk_mock_transaction_add (transaction, "Transaction",
+					  g_variant_new ("(osbuusus)", tid, timespec,
+							 i % 50 != 0,
+							 (guint32) (i % 4 == 0 ? PK_ROLE_ENUM_UPDATE_PACKAGES : PK_ROLE_ENUM_INSTALL_PACKAGES),
+							 (guint32) (1000 + i % 60000),
+							 data->str, (guint32) 1000,
+							 "/usr/bin/gpk-application"));
+	}
+}
+
+static void
+gpk_mock_transaction_get_repo_list (GpkMockTransaction *transaction)
+{
+	guint i;
+
+	for (i = 0; gpk_mock_daemon_repos[i] != NULL; i++) {
+		g_autofree gchar *description = NULL;
+		description = g_strdup_printf ("Fedora 25 - %s", gpk_mock_daemon_repos[i]);
+		gpk_mock_transaction_add (transaction, "RepoDetail",
+					  g_variant_new ("(ssb)", gpk_mock_daemon_repos[i],
+							 description, i < 2));
+	}
+}
+
+static void
+gpk_mock_transaction_get_categories (GpkMockTransaction *transaction)
+{
+	guint i;
+	guint j;
+
+	for (i = 0; i < 8; i++) {
+		g_autofree gchar *parent = g_strdup_printf ("parent%u", i);
+		g_autofree gchar *name = g_strdup_printf ("Category %u", i);
+		gpk_mock_transaction_add (transaction, "Category",
+					  g_variant_new ("(sssss)", "", parent, name,
+							 "A made up category", "folder"));
+		for (j = 0; j < 6; j++) {
+			g_autofree gchar *cat_id = g_strdup_printf ("@category%u_%u", i, j);
+			g_autofree gchar *cat_name = g_strdup_printf ("Subcategory %u", j);
+			gpk_mock_transaction_add (transaction, "Category",
+						  g_variant_new ("(sssss)", parent, cat_id, cat_name,
+								 "A made up subcategory", "folder"));
+		}
+	}
+}
+
+static void
+gpk_mock_transaction_get_related (GpkMockTransaction *transaction, const gchar **package_ids)
+{
+	GpkMockDaemon *daemon = transaction->daemon;
+	guint i;
+	guint j;
+	guint idx;
+
+	if (daemon->packages == 0)
+		return;
+	for (i = 0; package_ids[i] != NULL; i++) {
+		idx = gpk_mock_daemon_get_index (package_ids[i]);
+		for (j = 1; j <= 5; j++)
+			gpk_mock_transaction_add_package (transaction, (idx * 7 + j) % daemon->packages, 0);
+	}
+}
+
+static void
+gpk_mock_transaction_search_groups (GpkMockTransaction *transaction, const gchar **values)
+{
+	GpkMockDaemon *daemon = transaction->daemon;
+	guint i;
+	guint step;
+
+	/* every value returns a slice of the catalog */
+	step = MAX (g_strv_length ((gchar **) values), 1) * 20;
+	for (i = 0; i < daemon->packages; i += step)
+		gpk_mock_transaction_add_package (transaction, i, 0);
+}
+
+static gboolean
+gpk_mock_transaction_emit_cb (gpointer user_data)
+{
+	GpkMockTransaction *transaction = user_data;
+	GpkMockDaemon *daemon = transaction->daemon;
+	GpkMockSignal *signal;
+	PkExitEnum exit_enum;
+	guint i;
+
+	for (i = 0; i < GPK_MOCK_DAEMON_EMIT_BATCH && !transaction->cancelled; i++) {
+		if (transaction->signals_sent >= transaction->signals->len)
+			break;
+		signal = g_ptr_array_index (transaction->signals, transaction->signals_sent++);
+		g_dbus_connection_emit_signal (daemon->connection, NULL,
+					       transaction->path,
+					       GPK_MOCK_DAEMON_IFACE_TRANSACTION,
+					       signal->name, signal->parameters, NULL);
+	}
+	if (!transaction->cancelled &&
+	    transaction->signals_sent < transaction->signals->len)
+		return G_SOURCE_CONTINUE;
+
+	/* all done */
+	exit_enum = transaction->cancelled ? PK_EXIT_ENUM_CANCELLED : PK_EXIT_ENUM_SUCCESS;
+	transaction->status = PK_STATUS_ENUM_FINISHED;
+	g_dbus_connection_emit_signal (daemon->connection, NULL,
+				       transaction->path,
+				       GPK_MOCK_DAEMON_IFACE_TRANSACTION,
+				       "Finished",
+				       g_variant_new ("(uu)", exit_enum,
+						      (guint32) (g_timer_elapsed (transaction->timer, NULL) * 1000)),
+				       NULL);
+	g_dbus_connection_emit_signal (daemon->connection, NULL,
+				       transaction->path,
+				       GPK_MOCK_DAEMON_IFACE_TRANSACTION,
+				       "Destroy", NULL, NULL);
+	transaction->idle_id = 0;
+	g_ptr_array_remove (daemon->transactions, transaction);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gpk_mock_transaction_method_call (GDBusConnection *connection,
+				  const gchar *sender,
+				  const gchar *object_path,
+				  const gchar *interface_name,
+				  const gchar *method_name,
+				  GVariant *parameters,
+				  GDBusMethodInvocation *invocation,
+				  gpointer user_data)
+{
+	GpkMockTransaction *transaction = user_data;
+	PkBitfield filters = 0;
+	guint32 number = 0;
+	g_autofree const gchar **values = NULL;
+
+	if (g_strcmp0 (method_name, "SetHints") == 0) {
+		g_dbus_method_invocation_return_value (invocation, NULL);
+		return;
+	}
+	if (g_strcmp0 (method_name, "Cancel") == 0) {
+		transaction->cancelled = TRUE;
+		g_dbus_method_invocation_return_value (invocation, NULL);
+		return;
+	}
+
+	/* everything else starts the transaction */
+	if (transaction->idle_id != 0) {
+		g_dbus_method_invocation_return_error (invocation,
+						       G_DBUS_ERROR,
+						       G_DBUS_ERROR_FAILED,
+						       "transaction already running");
+		return;
+	}
+	if (g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(t)"))) {
+		g_variant_get (parameters, "(t)", &filters);
+	} else if (g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(u)"))) {
+		g_variant_get (parameters, "(u)", &number);
+	} else if (g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(as)"))) {
+		g_variant_get (parameters, "(^a&s)", &values);
+	} else if (g_str_has_prefix (g_variant_get_type_string (parameters), "(tas")) {
+		g_variant_get_child (parameters, 0, "t", &filters);
+		g_variant_get_child (parameters, 1, "^a&s", &values);
+	}
+	if (values == NULL)
+		values = g_new0 (const gchar *, 1);
+
+	if (g_strcmp0 (method_name, "SearchNames") == 0 ||
+	    g_strcmp0 (method_name, "SearchDetails") == 0 ||
+	    g_strcmp0 (method_name, "SearchFiles") == 0) {
+		transaction->role = PK_ROLE_ENUM_SEARCH_NAME;
+		gpk_mock_transaction_search (transaction, filters, values, FALSE);
+	} else if (g_strcmp0 (method_name, "Resolve") == 0) {
+		transaction->role = PK_ROLE_ENUM_RESOLVE;
+		gpk_mock_transaction_search (transaction, filters, values, TRUE);
+	} else if (g_strcmp0 (method_name, "SearchGroups") == 0) {
+		transaction->role = PK_ROLE_ENUM_SEARCH_GROUP;
+		gpk_mock_transaction_search_groups (transaction, values);
+	} else if (g_strcmp0 (method_name, "GetPackages") == 0) {
+		guint i;
+		transaction->role = PK_ROLE_ENUM_GET_PACKAGES;
+		for (i = 0; i < transaction->daemon->packages; i++)
+			gpk_mock_transaction_add_package (transaction, i, filters);
+	} else if (g_strcmp0 (method_name, "GetDetails") == 0) {
+		transaction->role = PK_ROLE_ENUM_GET_DETAILS;
+		gpk_mock_transaction_get_details (transaction, values);
+	} else if (g_strcmp0 (method_name, "GetFiles") == 0) {
+		transaction->role = PK_ROLE_ENUM_GET_FILES;
+		gpk_mock_transaction_get_files (transaction, values);
+	} else if (g_strcmp0 (method_name, "GetUpdates") == 0) {
+		transaction->role = PK_ROLE_ENUM_GET_UPDATES;
+		gpk_mock_transaction_get_updates (transaction);
+	} else if (g_strcmp0 (method_name, "GetUpdateDetail") == 0) {
+		transaction->role = PK_ROLE_ENUM_GET_UPDATE_DETAIL;
+		gpk_mock_transaction_get_update_detail (transaction, values);
+	} else if (g_strcmp0 (method_name, "GetOldTransactions") == 0) {
+		transaction->role = PK_ROLE_ENUM_GET_OLD_TRANSACTIONS;
+		gpk_mock_transaction_get_old_transactions (transaction, number);
+	} else if (g_strcmp0 (method_name, "GetRepoList") == 0) {
+		transaction->role = PK_ROLE_ENUM_GET_REPO_LIST;
+		gpk_mock_transaction_get_repo_list (transaction);
+	} else if (g_strcmp0 (method_name, "GetCategories") == 0) {
+		transaction->role = PK_ROLE_ENUM_GET_CATEGORIES;
+		gpk_mock_transaction_get_categories (transaction);
+	} else if (g_strcmp0 (method_name, "DependsOn") == 0 ||
+		   g_strcmp0 (method_name, "RequiredBy") == 0) {
+		transaction->role = PK_ROLE_ENUM_DEPENDS_ON;
+		gpk_mock_transaction_get_related (transaction, values);
+	} else {
+		/* installs, removes and refreshes just succeed */
+		g_debug ("mock daemon: nothing to do for %s", method_name);
+	}
+
+	transaction->status = PK_STATUS_ENUM_RUNNING;
+	g_timer_start (transaction->timer);
+	transaction->idle_id = g_idle_add (gpk_mock_transaction_emit_cb, transaction);
+	g_source_set_name_by_id (transaction->idle_id, "[GpkMockDaemon] emit");
+	g_dbus_method_invocation_return_value (invocation, NULL);
+}
+
+static GVariant *
+gpk_mock_transaction_get_property (GDBusConnection *connection,
+				   const gchar *sender,
+				   const gchar *object_path,
+				   const gchar *interface_name,
+				   const gchar *property_name,
+				   GError **error,
+				   gpointer user_data)
+{
+	GpkMockTransaction *transaction = user_data;
+
+	if (g_strcmp0 (property_name, "Role") == 0)
+		return g_variant_new_uint32 (transaction->role);
+	if (g_strcmp0 (property_name, "Status") == 0)
+		return g_variant_new_uint32 (transaction->status);
+	if (g_strcmp0 (property_name, "LastPackage") == 0)
+		return g_variant_new_string ("");
+	if (g_strcmp0 (property_name, "Uid") == 0)
+		return g_variant_new_uint32 (1000);
+	if (g_strcmp0 (property_name, "Percentage") == 0)
+		return g_variant_new_uint32 (101);
+	if (g_strcmp0 (property_name, "AllowCancel") == 0)
+		return g_variant_new_boolean (TRUE);
+	if (g_strcmp0 (property_name, "CallerActive") == 0)
+		return g_variant_new_boolean (TRUE);
+	if (g_strcmp0 (property_name, "DownloadSizeRemaining") == 0 ||
+	    g_strcmp0 (property_name, "TransactionFlags") == 0)
+		return g_variant_new_uint64 (0);
+	return g_variant_new_uint32 (0);
+}
+
+static const GDBusInterfaceVTable gpk_mock_transaction_vtable = {
+	gpk_mock_transaction_method_call,
+	gpk_mock_transaction_get_property,
+	NULL
+};
+
+static gchar *
+gpk_mock_daemon_create_transaction (GpkMockDaemon *daemon, GError **error)
+{
+	GDBusInterfaceInfo *info;
+	GpkMockTransaction *transaction;
+
+	transaction = g_new0 (GpkMockTransaction, 1);
+	transaction->daemon = daemon;
+	transaction->path = g_strdup_printf ("/%u_mock", ++daemon->tid);
+	transaction->role = PK_ROLE_ENUM_UNKNOWN;
+	transaction->status = PK_STATUS_ENUM_WAIT;
+	transaction->signals = g_ptr_array_new_with_free_func ((GDestroyNotify) gpk_mock_signal_free);
+	transaction->timer = g_timer_new ();
+	info = g_dbus_node_info_lookup_interface (daemon->introspection,
+						  GPK_MOCK_DAEMON_IFACE_TRANSACTION);
+	transaction->registration_id =
+		g_dbus_connection_register_object (daemon->connection,
+						   transaction->path, info,
+						   &gpk_mock_transaction_vtable,
+						   transaction, NULL, error);
+	if (transaction->registration_id == 0) {
+		gpk_mock_transaction_free (transaction);
+		return NULL;
+	}
+	g_ptr_array_add (daemon->transactions, transaction);
+	return g_strdup (transaction->path);
+}
+
+static void
+gpk_mock_daemon_method_call (GDBusConnection *connection,
+			     const gchar *sender,
+			     const gchar *object_path,
+			     const gchar *interface_name,
+			     const gchar *method_name,
+			     GVariant *parameters,
+			     GDBusMethodInvocation *invocation,
+			     gpointer user_data)
+{
+	GpkMockDaemon *daemon = GPK_MOCK_DAEMON (user_data);
+
+	if (g_strcmp0 (method_name, "CreateTransaction") == 0) {
+		GError *error = NULL;
+		g_autofree gchar *path = NULL;
+		path = gpk_mock_daemon_create_transaction (daemon, &error);
+		if (path == NULL) {
+			g_dbus_method_invocation_take_error (invocation, error);
+			return;
+		}
+		g_dbus_method_invocation_return_value (invocation,
+						       g_variant_new ("(o)", path));
+		return;
+	}
+	if (g_strcmp0 (method_name, "CanAuthorize") == 0) {
+		g_dbus_method_invocation_return_value (invocation,
+						       g_variant_new ("(u)", PK_AUTHORIZE_ENUM_YES));
+		return;
+	}
+	if (g_strcmp0 (method_name, "GetTimeSinceAction") == 0) {
+		g_dbus_method_invocation_return_value (invocation,
+						       g_variant_new ("(u)", 60));
+		return;
+	}
+	if (g_strcmp0 (method_name, "GetTransactionList") == 0) {
+		const gchar *empty[] = { NULL };
+		g_dbus_method_invocation_return_value (invocation,
+						       g_variant_new ("(^ao)", empty));
+		return;
+	}
+	if (g_strcmp0 (method_name, "GetDaemonState") == 0) {
+		g_dbus_method_invocation_return_value (invocation,
+						       g_variant_new ("(s)", "mock"));
+		return;
+	}
+	g_dbus_method_invocation_return_value (invocation, NULL);
+}
+
+static GVariant *
+gpk_mock_daemon_get_property (GDBusConnection *connection,
+			      const gchar *sender,
+			      const gchar *object_path,
+			      const gchar *interface_name,
+			      const gchar *property_name,
+			      GError **error,
+			      gpointer user_data)
+{
+	if (g_strcmp0 (property_name, "VersionMajor") == 0)
+		return g_variant_new_uint32 (1);
+	if (g_strcmp0 (property_name, "VersionMinor") == 0)
+		return g_variant_new_uint32 (1);
+	if (g_strcmp0 (property_name, "VersionMicro") == 0)
+		return g_variant_new_uint32 (4);
+	if (g_strcmp0 (property_name, "BackendName") == 0)
+		return g_variant_new_string ("mock");
+	if (g_strcmp0 (property_name, "BackendDescription") == 0)
+		return g_variant_new_string ("Synthetic data for profiling");
+	if (g_strcmp0 (property_name, "BackendAuthor") == 0)
+		return g_variant_new_string ("Richard Hughes <richard@hughsie.com>");
+	if (g_strcmp0 (property_name, "Roles") == 0)
+		return g_variant_new_uint64 (pk_bitfield_from_enums (PK_ROLE_ENUM_GET_CATEGORIES,
+								     PK_ROLE_ENUM_DEPENDS_ON,
+								     PK_ROLE_ENUM_GET_DETAILS,
+								     PK_ROLE_ENUM_GET_FILES,
+								     PK_ROLE_ENUM_REQUIRED_BY,
+								     PK_ROLE_ENUM_GET_PACKAGES,
+								     PK_ROLE_ENUM_GET_UPDATE_DETAIL,
+								     PK_ROLE_ENUM_GET_UPDATES,
+								     PK_ROLE_ENUM_INSTALL_PACKAGES,
+								     PK_ROLE_ENUM_REFRESH_CACHE,
+								     PK_ROLE_ENUM_REMOVE_PACKAGES,
+								     PK_ROLE_ENUM_REPO_ENABLE,
+								     PK_ROLE_ENUM_RESOLVE,
+								     PK_ROLE_ENUM_SEARCH_DETAILS,
+								     PK_ROLE_ENUM_SEARCH_FILE,
+								     PK_ROLE_ENUM_SEARCH_GROUP,
+								     PK_ROLE_ENUM_SEARCH_NAME,
+								     PK_ROLE_ENUM_UPDATE_PACKAGES,
+								     PK_ROLE_ENUM_GET_REPO_LIST,
+								     PK_ROLE_ENUM_GET_OLD_TRANSACTIONS,
+								     -1));
+	if (g_strcmp0 (property_name, "Groups") == 0)
+		return g_variant_new_uint64 (pk_bitfield_from_enums (PK_GROUP_ENUM_ACCESSIBILITY,
+								     PK_GROUP_ENUM_ADMIN_TOOLS,
+								     PK_GROUP_ENUM_DESKTOP_GNOME,
+								     PK_GROUP_ENUM_GAMES,
+								     PK_GROUP_ENUM_GRAPHICS,
+								     PK_GROUP_ENUM_PROGRAMMING,
+								     PK_GROUP_ENUM_SYSTEM,
+								     -1));
+	if (g_strcmp0 (property_name, "Filters") == 0)
+		return g_variant_new_uint64 (pk_bitfield_from_enums (PK_FILTER_ENUM_INSTALLED,
+								     PK_FILTER_ENUM_NOT_INSTALLED,
+								     PK_FILTER_ENUM_ARCH,
+								     PK_FILTER_ENUM_NEWEST,
+								     PK_FILTER_ENUM_BASENAME,
+								     -1));
+	if (g_strcmp0 (property_name, "MimeTypes") == 0) {
+		const gchar *mime_types[] = { "application/x-rpm", NULL };
+		return g_variant_new_strv (mime_types, -1);
+	}
+	if (g_strcmp0 (property_name, "Locked") == 0)
+		return g_variant_new_boolean (FALSE);
+	if (g_strcmp0 (property_name, "NetworkState") == 0)
+		return g_variant_new_uint32 (PK_NETWORK_ENUM_ONLINE);
+	if (g_strcmp0 (property_name, "DistroId") == 0)
+		return g_variant_new_string ("fedora;25;x86_64");
+	g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_PROPERTY,
+		     "no property %s", property_name);
+	return NULL;
+}
+
+static const GDBusInterfaceVTable gpk_mock_daemon_vtable = {
+	gpk_mock_daemon_method_call,
+	gpk_mock_daemon_get_property,
+	NULL
+};
+
+/**
+ * gpk_mock_daemon_set_size:
+ * @daemon: a #GpkMockDaemon
+ * @packages: the number of packages in the catalog
+ * @history: the number of old transactions
+ * @updates: the number of updates, each with a changelog
+ *
+ * Sets how much synthetic data is sent to the tools. This can be changed
+ * between runs without restarting the daemon.
+ **/
+void
+gpk_mock_daemon_set_size (GpkMockDaemon *daemon, guint packages,
+			  guint history, guint updates)
+{
+	g_return_if_fail (GPK_IS_MOCK_DAEMON (daemon));
+	daemon->packages = packages;
+	daemon->history = history;
+	daemon->updates = MIN (updates, packages / 10);
+}
+
+/**
+ * gpk_mock_daemon_start:
+ * @daemon: a #GpkMockDaemon
+ * @connection: a connection to a private bus, e.g. from #GTestDBus
+ * @error: a #GError, or %NULL
+ *
+ * Exports the daemon on @connection and takes the PackageKit bus name so
+ * that the tools talk to it rather than to the real system daemon.
+ *
+ * Return value: %TRUE for success
+ **/
+gboolean
+gpk_mock_daemon_start (GpkMockDaemon *daemon, GDBusConnection *connection, GError **error)
+{
+	GDBusInterfaceInfo *info;
+
+	g_return_val_if_fail (GPK_IS_MOCK_DAEMON (daemon), FALSE);
+	g_return_val_if_fail (daemon->connection == NULL, FALSE);
+
+	daemon->introspection = g_dbus_node_info_new_for_xml (gpk_mock_daemon_xml, error);
+	if (daemon->introspection == NULL)
+		return FALSE;
+	daemon->connection = g_object_ref (connection);
+	info = g_dbus_node_info_lookup_interface (daemon->introspection,
+						  GPK_MOCK_DAEMON_NAME);
+	daemon->registration_id =
+		g_dbus_connection_register_object (connection,
+						   GPK_MOCK_DAEMON_PATH, info,
+						   &gpk_mock_daemon_vtable,
+						   daemon, NULL, error);
+	if (daemon->registration_id == 0)
+		return FALSE;
+	daemon->owner_id = g_bus_own_name_on_connection (connection,
+							 GPK_MOCK_DAEMON_NAME,
+							 G_BUS_NAME_OWNER_FLAGS_NONE,
+							 NULL, NULL, NULL, NULL);
+	return TRUE;
+}
+
+static void
+gpk_mock_daemon_finalize (GObject *object)
+{
+	GpkMockDaemon *daemon = GPK_MOCK_DAEMON (object);
+
+	g_ptr_array_unref (daemon->transactions);
+	if (daemon->owner_id != 0)
+		g_bus_unown_name (daemon->owner_id);
+	if (daemon->registration_id != 0)
+		g_dbus_connection_unregister_object (daemon->connection,
+						     daemon->registration_id);
+	if (daemon->introspection != NULL)
+		g_dbus_node_info_unref (daemon->introspection);
+	if (daemon->connection != NULL)
+		g_object_unref (daemon->connection);
+
+	G_OBJECT_CLASS (gpk_mock_daemon_parent_class)->finalize (object);
+}
+
+static void
+gpk_mock_daemon_class_init (GpkMockDaemonClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gpk_mock_daemon_finalize;
+}
+
+static void
+gpk_mock_daemon_init (GpkMockDaemon *daemon)
+{
+	daemon->transactions = g_ptr_array_new_with_free_func ((GDestroyNotify) gpk_mock_transaction_free);
+	daemon->packages = 1000;
+	daemon->history = 5000;
+	daemon->updates = 500;
+}
+
+/**
+ * gpk_mock_daemon_new:
+ *
+ * Return value: a new #GpkMockDaemon
+ **/
+GpkMockDaemon *
+gpk_mock_daemon_new (void)
+{
+	return g_object_new (GPK_TYPE_MOCK_DAEMON, NULL);
+}
@@ -0,0 +1,43 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __GPK_MOCK_DAEMON_H
+#define __GPK_MOCK_DAEMON_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define GPK_TYPE_MOCK_DAEMON (gpk_mock_daemon_get_type ())
+G_DECLARE_FINAL_TYPE (GpkMockDaemon, gpk_mock_daemon, GPK, MOCK_DAEMON, GObject)
+
+GpkMockDaemon	*gpk_mock_daemon_new			(void);
+void		 gpk_mock_daemon_set_size		(GpkMockDaemon		*daemon,
+							 guint			 packages,
+							 guint			 history,
+							 guint			 updates);
+gboolean	 gpk_mock_daemon_start			(GpkMockDaemon		*daemon,
+							 GDBusConnection	*connection,
+							 GError			**error);
+
+G_END_DECLS
+
+#endif /* __GPK_MOCK_DAEMON_H */
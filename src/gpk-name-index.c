@@ -0,0 +1,366 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "gpk-name-index.h"
+
+/* longer names are not indexed, as the distance is worked out in 64 bits */
+#define GPK_NAME_INDEX_MAX_LEN		64
+
+/*
+ * The names are kept in a BK-tree. Every child is at a known edit distance
+ * from its parent, so by the triangle inequality a search for names within
+ * k of the text only has to visit the children whose distance from their
+ * parent is within k of the distance from the text to that parent.
+ */
+typedef struct {
+	guint32			 name;		/* offset into the strings */
+	guint32			 child;		/* first child + 1, or 0 */
+	guint32			 sibling;	/* next child of the parent + 1, or 0 */
+	guint8			 distance;	/* from the parent */
+	guint8			 len;
+} GpkNameIndexNode;
+
+typedef struct {
+	guint64			 peq[256];	/* bit i is set if the character is at i */
+	guint			 len;
+} GpkNameIndexPattern;
+
+typedef struct {
+	guint32			 node;
+	guint			 distance;
+} GpkNameIndexMatch;
+
+struct _GpkNameIndex
+{
+	GObject			 parent_instance;
+	GArray			*nodes;		/* of GpkNameIndexNode, the first is the root */
+	GString			*strings;	/* lowercase names, NUL terminated */
+};
+
+G_DEFINE_TYPE (GpkNameIndex, gpk_name_index, G_TYPE_OBJECT)
+
+static void
+gpk_name_index_pattern_init (GpkNameIndexPattern *pattern, const gchar *text, guint len)
+{
+	guint i;
+
+	memset (pattern->peq, 0, sizeof (pattern->peq));
+	for (i = 0; i < len; i++)
+		pattern->peq[(guint8) text[i]] |= G_GUINT64_CONSTANT (1) << i;
+	pattern->len = len;
+}
+
+static guint
+gpk_name_index_distance (const GpkNameIndexPattern *pattern, const gchar *text, guint len)
+{
+	guint64 eq;
+	guint64 last;
+	guint64 mh;
+	guint64 mv = 0;
+	guint64 ph;
+	guint64 pv = G_MAXUINT64;
+	guint64 xh;
+	guint64 xv;
+	guint distance;
+	guint j;
+
+	/* Levenshtein distance using Myers' bit-parallel algorithm, where each
+	 * column of the matrix is kept as the differences down it */
+	distance = pattern->len;
+	last = G_GUINT64_CONSTANT (1) << (pattern->len - 1);
+	for (j = 0; j < len; j++) {
+		eq = pattern->peq[(guint8) text[j]];
+		xv = eq | mv;
+		xh = (((eq & pv) + pv) ^ pv) | eq;
+		ph = mv | ~(xh | pv);
+		mh = pv & xh;
+		if (ph & last)
+			distance++;
+		else if (mh & last)
+			distance--;
+		ph = (ph << 1) | 1;
+		mh <<= 1;
+		pv = mh | ~(xv | ph);
+		mv = ph & xv;
+	}
+	return distance;
+}
+
+static void
+gpk_name_index_add (GpkNameIndex *index, const gchar *name)
+{
+	GpkNameIndexNode node = { 0 };
+	GpkNameIndexNode *parent;
+	GpkNameIndexPattern pattern;
+	GpkNameIndexNode *child = NULL;
+	guint distance;
+	guint i;
+	guint len;
+	guint32 idx = 0;
+	guint32 next;
+
+	len = strlen (name);
+	if (len == 0 || len > GPK_NAME_INDEX_MAX_LEN)
+		return;
+	node.name = index->strings->len;
+	node.len = (guint8) len;
+	for (i = 0; i < len; i++)
+		g_string_append_c (index->strings, g_ascii_tolower (name[i]));
+	g_string_append_c (index->strings, '\0');
+	gpk_name_index_pattern_init (&pattern, index->strings->str + node.name, len);
+	if (index->nodes->len == 0) {
+		g_array_append_val (index->nodes, node);
+		return;
+	}
+
+	/* go down the children at the same distance until there is none */
+	while (TRUE) {
+		parent = &g_array_index (index->nodes, GpkNameIndexNode, idx);
+		distance = gpk_name_index_distance (&pattern,
+						    index->strings->str + parent->name,
+						    parent->len);
+		if (distance == 0) {
+			g_string_truncate (index->strings, node.name);
+			return;
+		}
+		for (next = parent->child; next != 0; next = child->sibling) {
+			child = &g_array_index (index->nodes, GpkNameIndexNode, next - 1);
+			if (child->distance == distance)
+				break;
+		}
+		if (next == 0) {
+			node.distance = (guint8) distance;
+			node.sibling = parent->child;
+			parent->child = index->nodes->len + 1;
+			g_array_append_val (index->nodes, node);
+			return;
+		}
+		idx = next - 1;
+	}
+}
+
+/**
+ * gpk_name_index_new:
+ * @names: package names, which may have duplicates
+ *
+ * Creates an index for finding the names that are close to a mistyped one.
+ **/
+GpkNameIndex *
+gpk_name_index_new (gchar **names)
+{
+	GpkNameIndex *index;
+	guint i;
+	guint j;
+	guint len;
+	guint32 tmp;
+	g_autofree guint32 *order = NULL;
+	g_autoptr(GRand) rand = NULL;
+
+	index = g_object_new (GPK_TYPE_NAME_INDEX, NULL);
+
+	/* sorted names make a lopsided tree, so add them in a fixed random order */
+	len = g_strv_length (names);
+	order = g_new (guint32, len);
+	for (i = 0; i < len; i++)
+		order[i] = i;
+	rand = g_rand_new_with_seed (len);
+	for (i = len; i > 1; i--) {
+		j = (guint) g_rand_int_range (rand, 0, (gint32) i);
+		tmp = order[i - 1];
+		order[i - 1] = order[j];
+		order[j] = tmp;
+	}
+	for (i = 0; i < len; i++)
+		gpk_name_index_add (index, names[order[i]]);
+	return index;
+}
+
+static void
+gpk_name_index_new_thread_cb (GTask *task, gpointer source_object,
+			      gpointer task_data, GCancellable *cancellable)
+{
+	g_task_return_pointer (task, gpk_name_index_new (task_data),
+			       (GDestroyNotify) g_object_unref);
+}
+
+/**
+ * gpk_name_index_new_async:
+ * @names: package names, which may have duplicates
+ * @cancellable: a #GCancellable, or %NULL
+ * @callback: called when the index has been created
+ * @user_data: data for @callback
+ *
+ * Like gpk_name_index_new(), but builds the index in a thread.
+ **/
+void
+gpk_name_index_new_async (gchar **names,
+			  GCancellable *cancellable,
+			  GAsyncReadyCallback callback,
+			  gpointer user_data)
+{
+	g_autoptr(GTask) task = NULL;
+
+	task = g_task_new (NULL, cancellable, callback, user_data);
+	g_task_set_task_data (task, g_strdupv (names), (GDestroyNotify) g_strfreev);
+	g_task_run_in_thread (task, gpk_name_index_new_thread_cb);
+}
+
+GpkNameIndex *
+gpk_name_index_new_finish (GAsyncResult *res, GError **error)
+{
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+guint
+gpk_name_index_get_size (GpkNameIndex *index)
+{
+	g_return_val_if_fail (GPK_IS_NAME_INDEX (index), 0);
+	return index->nodes->len;
+}
+
+static gint
+gpk_name_index_match_sort_cb (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	GpkNameIndex *index = GPK_NAME_INDEX (user_data);
+	const GpkNameIndexMatch *match_a = a;
+	const GpkNameIndexMatch *match_b = b;
+	const GpkNameIndexNode *node_a;
+	const GpkNameIndexNode *node_b;
+
+	if (match_a->distance != match_b->distance)
+		return match_a->distance < match_b->distance ? -1 : 1;
+	node_a = &g_array_index (index->nodes, GpkNameIndexNode, match_a->node);
+	node_b = &g_array_index (index->nodes, GpkNameIndexNode, match_b->node);
+	return strcmp (index->strings->str + node_a->name,
+		       index->strings->str + node_b->name);
+}
+
+/**
+ * gpk_name_index_search:
+ * @index: a #GpkNameIndex
+ * @text: the text that was searched for
+ * @max_distance: the most single character edits from @text
+ * @max_results: the most names to return
+ *
+ * Finds the names that differ from @text, ignoring case, by no more than
+ * @max_distance insertions, deletions or substitutions.
+ *
+ * Return value: (transfer full): lowercase names, the closest first
+ **/
+gchar **
+gpk_name_index_search (GpkNameIndex *index,
+		       const gchar *text,
+		       guint max_distance,
+		       guint max_results)
+{
+	GpkNameIndexMatch match;
+	GpkNameIndexNode *child;
+	GpkNameIndexNode *node;
+	GpkNameIndexPattern pattern;
+	gchar **results;
+	guint distance;
+	guint i;
+	guint len;
+	guint32 idx;
+	guint32 next;
+	g_autofree gchar *needle = NULL;
+	g_autoptr(GArray) matches = NULL;
+	g_autoptr(GArray) stack = NULL;
+
+	g_return_val_if_fail (GPK_IS_NAME_INDEX (index), NULL);
+	g_return_val_if_fail (text != NULL, NULL);
+
+	needle = g_ascii_strdown (text, -1);
+	len = strlen (needle);
+	if (index->nodes->len == 0 || len == 0 || len > GPK_NAME_INDEX_MAX_LEN)
+		return g_new0 (gchar *, 1);
+
+	gpk_name_index_pattern_init (&pattern, needle, len);
+	matches = g_array_new (FALSE, FALSE, sizeof (GpkNameIndexMatch));
+	stack = g_array_sized_new (FALSE, FALSE, sizeof (guint32), 64);
+	idx = 0;
+	g_array_append_val (stack, idx);
+	while (stack->len > 0) {
+		idx = g_array_index (stack, guint32, stack->len - 1);
+		g_array_set_size (stack, stack->len - 1);
+		node = &g_array_index (index->nodes, GpkNameIndexNode, idx);
+		distance = gpk_name_index_distance (&pattern,
+						    index->strings->str + node->name,
+						    node->len);
+
+		/* the text itself is no suggestion */
+		if (distance > 0 && distance <= max_distance) {
+			match.node = idx;
+			match.distance = distance;
+			g_array_append_val (matches, match);
+		}
+		for (next = node->child; next != 0; next = child->sibling) {
+			child = &g_array_index (index->nodes, GpkNameIndexNode, next - 1);
+			if (child->distance + max_distance < distance ||
+			    child->distance > distance + max_distance)
+				continue;
+			idx = next - 1;
+			g_array_append_val (stack, idx);
+		}
+	}
+
+	/* the closest first, then in name order so the result is stable */
+	g_array_sort_with_data (matches, gpk_name_index_match_sort_cb, index);
+	len = MIN (matches->len, max_results);
+	results = g_new0 (gchar *, len + 1);
+	for (i = 0; i < len; i++) {
+		match = g_array_index (matches, GpkNameIndexMatch, i);
+		node = &g_array_index (index->nodes, GpkNameIndexNode, match.node);
+		results[i] = g_strdup (index->strings->str + node->name);
+	}
+	return results;
+}
+
+static void
+gpk_name_index_finalize (GObject *object)
+{
+	GpkNameIndex *index = GPK_NAME_INDEX (object);
+
+	g_array_unref (index->nodes);
+	g_string_free (index->strings, TRUE);
+
+	G_OBJECT_CLASS (gpk_name_index_parent_class)->finalize (object);
+}
+
+static void
+gpk_name_index_class_init (GpkNameIndexClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gpk_name_index_finalize;
+}
+
+static void
+gpk_name_index_init (GpkNameIndex *index)
+{
+	index->nodes = g_array_new (FALSE, FALSE, sizeof (GpkNameIndexNode));
+	index->strings = g_string_new (NULL);
+}
@@ -0,0 +1,47 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __GPK_NAME_INDEX_H
+#define __GPK_NAME_INDEX_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define GPK_TYPE_NAME_INDEX (gpk_name_index_get_type ())
+G_DECLARE_FINAL_TYPE (GpkNameIndex, gpk_name_index, GPK, NAME_INDEX, GObject)
+
+GpkNameIndex	*gpk_name_index_new			(gchar			**names);
+void		 gpk_name_index_new_async		(gchar			**names,
+							 GCancellable		*cancellable,
+							 GAsyncReadyCallback	 callback,
+							 gpointer		 user_data);
+GpkNameIndex	*gpk_name_index_new_finish		(GAsyncResult		*res,
+							 GError			**error);
+guint		 gpk_name_index_get_size		(GpkNameIndex		*index);
+gchar		**gpk_name_index_search			(GpkNameIndex		*index,
+							 const gchar		*text,
+							 guint			 max_distance,
+							 guint			 max_results);
+
+G_END_DECLS
+
+#endif /* __GPK_NAME_INDEX_H */
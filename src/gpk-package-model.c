@@ -0,0 +1,1889 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <gtk/gtk.h>
+#include <packagekit-glib2/packagekit.h>
+
+#include "gpk-common.h"
+#include "gpk-enum.h"
+#include "gpk-package-model.h"
+
+/* the number of recently drawn rows we keep the markup for */
+#define GPK_PACKAGE_MODEL_CACHE_SIZE	128
+
+/* rows checked by each thread when the facets change */
+#define GPK_PACKAGE_MODEL_FACET_CHUNK	8192
+
+/* how well a package matches the search, the best match is used */
+#define GPK_PACKAGE_MODEL_SCORE_EXACT		1000
+#define GPK_PACKAGE_MODEL_SCORE_PREFIX		600
+#define GPK_PACKAGE_MODEL_SCORE_NAME		300
+#define GPK_PACKAGE_MODEL_SCORE_SUMMARY		100
+
+/* added to any match, so these win a tie */
+#define GPK_PACKAGE_MODEL_SCORE_INSTALLED	50
+#define GPK_PACKAGE_MODEL_SCORE_NATIVE		20
+
+typedef struct {
+	PkPackage		*package;	/* NULL for a message row */
+	GpkPackageAtom		*atom;		/* of the package ID */
+	gchar			*message;
+	gchar			*suggestion;	/* the search a message row runs */
+	gchar			*icon_name;
+	gchar			*name_key;	/* collation key, made when added */
+	gchar			*version_key;	/* made the first time it is sorted by */
+	gchar			*repo_key;
+	guint64			 size;		/* G_MAXUINT64 if not known */
+	guint			 index;
+	guint			 serial;	/* the order rows were added in */
+	guint			 score;		/* relevance to the search */
+	guint8			 state;
+	guint8			 match;		/* GpkPackageMatch, if searched in several ways */
+	guint			 visible:1;	/* in rows, and index is valid */
+	guint			 facet_ok:1;	/* passes the facets of the row itself */
+	guint			 superseded:1;	/* a newer version was added */
+	guint			 dropped:1;
+	guint			 hiding:1;	/* still in rows until they are next removed */
+} GpkPackageModelRow;
+
+typedef struct {
+	GpkPackageModelRow	*row;
+	GString			*markup;	/* reused for each row drawn */
+} GpkPackageModelCacheItem;
+
+struct _GpkPackageModel
+{
+	GObject			 parent_instance;
+	GPtrArray		*all;		/* of GpkPackageModelRow, owned */
+	GPtrArray		*rows;		/* of GpkPackageModelRow, the ones shown */
+	GHashTable		*ids;		/* GpkPackageAtom:GpkPackageModelRow */
+	GHashTable		*newest;	/* name;arch;installed:GpkPackageModelRow */
+	PkBitfield		 facets;
+	gchar			*native_arch;
+	gchar			**search;	/* lowercase words, or NULL */
+	GpkPackageModelRow	*best;		/* highest score shown */
+	guint			 count_installed;
+	guint			 count_available;
+	GpkPackageFormatter	*formatter;
+	GtkStyleContext		*style;		/* or NULL */
+	gulong			 style_changed_id;
+	gboolean		 installed_sensitive;
+	gboolean		 available_sensitive;
+	gint			 stamp;
+	gint			 sort_column_id;
+	GtkSortType		 sort_order;
+	guint			 sorted_len;	/* rows at the start that are in order */
+	guint			 sort_id;
+	guint			 serial_next;
+	GpkPackageModelCacheItem cache[GPK_PACKAGE_MODEL_CACHE_SIZE];
+};
+
+static void gpk_package_model_tree_model_init (GtkTreeModelIface *iface);
+static void gpk_package_model_tree_sortable_init (GtkTreeSortableIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (GpkPackageModel, gpk_package_model, G_TYPE_OBJECT,
+			 G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_MODEL,
+						gpk_package_model_tree_model_init)
+			 G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_SORTABLE,
+						gpk_package_model_tree_sortable_init))
+
+const gchar *
+gpk_package_state_get_icon (PkBitfield state)
+{
+	if (state == 0)
+		return gpk_info_enum_to_icon_name (PK_INFO_ENUM_AVAILABLE);
+
+	if (state == pk_bitfield_value (GPK_PACKAGE_STATE_INSTALLED))
+		return gpk_info_enum_to_icon_name (PK_INFO_ENUM_INSTALLED);
+
+	if (state == pk_bitfield_value (GPK_PACKAGE_STATE_IN_LIST))
+		return gpk_info_enum_to_icon_name (PK_INFO_ENUM_INSTALLING);
+
+	if (state == pk_bitfield_from_enums (GPK_PACKAGE_STATE_INSTALLED, GPK_PACKAGE_STATE_IN_LIST, -1))
+		return gpk_info_enum_to_icon_name (PK_INFO_ENUM_REMOVING);
+
+	if (state == pk_bitfield_value (GPK_PACKAGE_STATE_COLLECTION))
+		return gpk_info_enum_to_icon_name (PK_INFO_ENUM_COLLECTION_AVAILABLE);
+
+	if (state == pk_bitfield_from_enums (GPK_PACKAGE_STATE_INSTALLED, GPK_PACKAGE_STATE_COLLECTION, -1))
+		return gpk_info_enum_to_icon_name (PK_INFO_ENUM_COLLECTION_INSTALLED);
+
+	if (state == pk_bitfield_from_enums (GPK_PACKAGE_STATE_IN_LIST, GPK_PACKAGE_STATE_INSTALLED, GPK_PACKAGE_STATE_COLLECTION, -1))
+		return gpk_info_enum_to_icon_name (PK_INFO_ENUM_REMOVING); // need new icon
+
+	if (state == pk_bitfield_from_enums (GPK_PACKAGE_STATE_IN_LIST, GPK_PACKAGE_STATE_COLLECTION, -1))
+		return gpk_info_enum_to_icon_name (PK_INFO_ENUM_INSTALLING); // need new icon
+
+	return NULL;
+}
+
+gboolean
+gpk_package_state_get_checkbox (PkBitfield state)
+{
+	PkBitfield state_local;
+
+	/* remove any we don't care about */
+	state_local = state;
+	pk_bitfield_remove (state_local, GPK_PACKAGE_STATE_COLLECTION);
+
+	/* installed or in array */
+	if (state_local == pk_bitfield_value (GPK_PACKAGE_STATE_INSTALLED) ||
+	    state_local == pk_bitfield_value (GPK_PACKAGE_STATE_IN_LIST))
+		return TRUE;
+	return FALSE;
+}
+
+static void
+gpk_package_model_row_free (GpkPackageModelRow *row)
+{
+	if (row->package != NULL)
+		g_object_unref (row->package);
+	if (row->atom != NULL)
+		gpk_package_atom_unref (row->atom);
+	g_free (row->message);
+	g_free (row->suggestion);
+	g_free (row->icon_name);
+	g_free (row->name_key);
+	g_free (row->version_key);
+	g_free (row->repo_key);
+	g_free (row);
+}
+
+static GpkPackageModelRow *
+gpk_package_model_lookup (GpkPackageModel *model, const gchar *package_id)
+{
+	GpkPackageAtom *atom;
+
+	/* if nothing holds the atom, no row can have it */
+	atom = gpk_package_atom_lookup (package_id);
+	if (atom == NULL)
+		return NULL;
+	return g_hash_table_lookup (model->ids, atom);
+}
+
+static void
+gpk_package_model_cache_invalidate (GpkPackageModel *model)
+{
+	guint i;
+	for (i = 0; i < GPK_PACKAGE_MODEL_CACHE_SIZE; i++)
+		model->cache[i].row = NULL;
+}
+
+static void
+gpk_package_model_append_match (GString *markup, PkBitfield match)
+{
+	const gchar *fields[GPK_PACKAGE_MATCH_LAST + 1] = { NULL };
+	guint i = 0;
+	g_autofree gchar *joined = NULL;
+
+	if (pk_bitfield_contain (match, GPK_PACKAGE_MATCH_NAME))
+		/* TRANSLATORS: the search text was found in the package name */
+		fields[i++] = _("name");
+	if (pk_bitfield_contain (match, GPK_PACKAGE_MATCH_DETAILS))
+		/* TRANSLATORS: the search text was found in the package description */
+		fields[i++] = _("description");
+	if (pk_bitfield_contain (match, GPK_PACKAGE_MATCH_FILE))
+		/* TRANSLATORS: the search text was found in a file in the package */
+		fields[i++] = _("files");
+	joined = g_strjoinv (", ", (gchar **) fields);
+	g_string_append (markup, " <small>");
+	/* TRANSLATORS: where the search text was found, e.g. "matched name, files" */
+	g_string_append_printf (markup, _("matched %s"), joined);
+	g_string_append (markup, "</small>");
+}
+
+static const gchar *
+gpk_package_model_get_markup (GpkPackageModel *model, GpkPackageModelRow *row)
+{
+	GpkPackageModelCacheItem *item;
+
+	/* drawn recently */
+	item = &model->cache[row->index % GPK_PACKAGE_MODEL_CACHE_SIZE];
+	if (item->row == row)
+		return item->markup->str;
+
+	/* use two lines, and only remember it if that worked */
+	if (item->markup == NULL)
+		item->markup = g_string_new (NULL);
+	g_string_truncate (item->markup, 0);
+	item->row = NULL;
+	if (!gpk_package_formatter_append (model->formatter, item->markup,
+					   pk_package_get_id (row->package),
+					   pk_package_get_summary (row->package)))
+		return NULL;
+	if (row->match != 0)
+		gpk_package_model_append_match (item->markup, row->match);
+	item->row = row;
+	return item->markup->str;
+}
+
+static gboolean
+gpk_package_model_get_checkbox_visible (GpkPackageModel *model, GpkPackageModelRow *row)
+{
+	/* we never show the checkbox for the search helper */
+	if (row->package == NULL)
+		return FALSE;
+	if (pk_bitfield_contain (row->state, GPK_PACKAGE_STATE_INSTALLED))
+		return model->installed_sensitive;
+	return model->available_sensitive;
+}
+
+static void
+gpk_package_model_set_iter (GpkPackageModel *model, GtkTreeIter *iter, GpkPackageModelRow *row)
+{
+	iter->stamp = model->stamp;
+	iter->user_data = row;
+	iter->user_data2 = NULL;
+	iter->user_data3 = NULL;
+}
+
+static GtkTreeModelFlags
+gpk_package_model_get_flags (GtkTreeModel *tree_model)
+{
+	return GTK_TREE_MODEL_LIST_ONLY | GTK_TREE_MODEL_ITERS_PERSIST;
+}
+
+static gint
+gpk_package_model_get_n_columns (GtkTreeModel *tree_model)
+{
+	return GPK_PACKAGE_MODEL_COLUMN_LAST;
+}
+
+static GType
+gpk_package_model_get_column_type (GtkTreeModel *tree_model, gint index)
+{
+	switch (index) {
+	case GPK_PACKAGE_MODEL_COLUMN_STATE:
+		return G_TYPE_UINT64;
+	case GPK_PACKAGE_MODEL_COLUMN_CHECKBOX:
+	case GPK_PACKAGE_MODEL_COLUMN_CHECKBOX_VISIBLE:
+		return G_TYPE_BOOLEAN;
+	case GPK_PACKAGE_MODEL_COLUMN_IMAGE:
+	case GPK_PACKAGE_MODEL_COLUMN_TEXT:
+	case GPK_PACKAGE_MODEL_COLUMN_ID:
+	case GPK_PACKAGE_MODEL_COLUMN_SUMMARY:
+	case GPK_PACKAGE_MODEL_COLUMN_VERSION:
+	case GPK_PACKAGE_MODEL_COLUMN_REPO:
+	case GPK_PACKAGE_MODEL_COLUMN_SIZE:
+	case GPK_PACKAGE_MODEL_COLUMN_SUGGESTION:
+		return G_TYPE_STRING;
+	default:
+		return G_TYPE_INVALID;
+	}
+}
+
+static gboolean
+gpk_package_model_get_iter (GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreePath *path)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (tree_model);
+	gint index;
+
+	if (gtk_tree_path_get_depth (path) != 1)
+		return FALSE;
+	index = gtk_tree_path_get_indices (path)[0];
+	if (index < 0 || (guint) index >= model->rows->len)
+		return FALSE;
+	gpk_package_model_set_iter (model, iter, g_ptr_array_index (model->rows, index));
+	return TRUE;
+}
+
+static GtkTreePath *
+gpk_package_model_get_path (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (tree_model);
+	GpkPackageModelRow *row;
+
+	g_return_val_if_fail (iter->stamp == model->stamp, NULL);
+	row = iter->user_data;
+	return gtk_tree_path_new_from_indices (row->index, -1);
+}
+
+static void
+gpk_package_model_get_value (GtkTreeModel *tree_model, GtkTreeIter *iter,
+			     gint column, GValue *value)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (tree_model);
+	GpkPackageModelRow *row;
+
+	g_return_if_fail (iter->stamp == model->stamp);
+	row = iter->user_data;
+
+	g_value_init (value, gpk_package_model_get_column_type (tree_model, column));
+	switch (column) {
+	case GPK_PACKAGE_MODEL_COLUMN_IMAGE:
+		if (row->package == NULL)
+			g_value_set_string (value, row->icon_name);
+		else
+			g_value_set_static_string (value, gpk_package_state_get_icon (row->state));
+		break;
+	case GPK_PACKAGE_MODEL_COLUMN_STATE:
+		g_value_set_uint64 (value, row->state);
+		break;
+	case GPK_PACKAGE_MODEL_COLUMN_CHECKBOX:
+		g_value_set_boolean (value, row->package != NULL &&
+					    gpk_package_state_get_checkbox (row->state));
+		break;
+	case GPK_PACKAGE_MODEL_COLUMN_CHECKBOX_VISIBLE:
+		g_value_set_boolean (value, gpk_package_model_get_checkbox_visible (model, row));
+		break;
+	case GPK_PACKAGE_MODEL_COLUMN_TEXT:
+		if (row->package == NULL)
+			g_value_set_string (value, row->message);
+		else
+			g_value_set_string (value, gpk_package_model_get_markup (model, row));
+		break;
+	case GPK_PACKAGE_MODEL_COLUMN_ID:
+		if (row->atom != NULL)
+			g_value_set_string (value, gpk_package_atom_get_id (row->atom));
+		break;
+	case GPK_PACKAGE_MODEL_COLUMN_SUMMARY:
+		if (row->package != NULL)
+			g_value_set_string (value, pk_package_get_summary (row->package));
+		break;
+	case GPK_PACKAGE_MODEL_COLUMN_VERSION:
+		if (row->package != NULL)
+			g_value_set_string (value, pk_package_get_version (row->package));
+		break;
+	case GPK_PACKAGE_MODEL_COLUMN_REPO:
+		if (row->package != NULL)
+			g_value_set_string (value, pk_package_get_data (row->package));
+		break;
+	case GPK_PACKAGE_MODEL_COLUMN_SIZE:
+		if (row->package != NULL && row->size != G_MAXUINT64)
+			g_value_take_string (value, g_format_size (row->size));
+		break;
+	case GPK_PACKAGE_MODEL_COLUMN_SUGGESTION:
+		g_value_set_string (value, row->suggestion);
+		break;
+	default:
+		g_warning ("invalid column %i", column);
+		break;
+	}
+}
+
+static gboolean
+gpk_package_model_iter_next (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (tree_model);
+	GpkPackageModelRow *row;
+
+	g_return_val_if_fail (iter->stamp == model->stamp, FALSE);
+	row = iter->user_data;
+	if (row->index + 1 >= model->rows->len) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+	gpk_package_model_set_iter (model, iter, g_ptr_array_index (model->rows, row->index + 1));
+	return TRUE;
+}
+
+static gboolean
+gpk_package_model_iter_previous (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (tree_model);
+	GpkPackageModelRow *row;
+
+	g_return_val_if_fail (iter->stamp == model->stamp, FALSE);
+	row = iter->user_data;
+	if (row->index == 0) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+	gpk_package_model_set_iter (model, iter, g_ptr_array_index (model->rows, row->index - 1));
+	return TRUE;
+}
+
+static gboolean
+gpk_package_model_iter_nth_child (GtkTreeModel *tree_model, GtkTreeIter *iter,
+				  GtkTreeIter *parent, gint n)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (tree_model);
+
+	/* this is a list, nodes have no children */
+	if (parent != NULL || n < 0 || (guint) n >= model->rows->len) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+	gpk_package_model_set_iter (model, iter, g_ptr_array_index (model->rows, n));
+	return TRUE;
+}
+
+static gboolean
+gpk_package_model_iter_children (GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreeIter *parent)
+{
+	return gpk_package_model_iter_nth_child (tree_model, iter, parent, 0);
+}
+
+static gboolean
+gpk_package_model_iter_has_child (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	return FALSE;
+}
+
+static gint
+gpk_package_model_iter_n_children (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (tree_model);
+	if (iter == NULL)
+		return model->rows->len;
+	return 0;
+}
+
+static gboolean
+gpk_package_model_iter_parent (GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreeIter *child)
+{
+	iter->stamp = 0;
+	return FALSE;
+}
+
+static const gchar *
+gpk_package_model_str (const gchar *text)
+{
+	return text != NULL ? text : "";
+}
+
+static gboolean
+gpk_package_model_is_sorted (GpkPackageModel *model)
+{
+	return model->sort_column_id != GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID &&
+	       model->sort_column_id != GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID;
+}
+
+/* with no column to sort by, search results are kept in relevance order */
+static gboolean
+gpk_package_model_is_ranked (GpkPackageModel *model)
+{
+	return model->search != NULL && !gpk_package_model_is_sorted (model);
+}
+
+/* the default order is by name, unless there is a search to rank against */
+static gboolean
+gpk_package_model_is_named (GpkPackageModel *model)
+{
+	return model->sort_column_id == GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID &&
+	       model->search == NULL;
+}
+
+/* the rows are kept in the order of a column, or of their names */
+static gboolean
+gpk_package_model_is_ordered (GpkPackageModel *model)
+{
+	return gpk_package_model_is_sorted (model) || gpk_package_model_is_named (model);
+}
+
+static gint
+gpk_package_model_compare (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (user_data);
+	const GpkPackageModelRow *row1 = *((const GpkPackageModelRow **) a);
+	const GpkPackageModelRow *row2 = *((const GpkPackageModelRow **) b);
+	gint rc = 0;
+
+	if (gpk_package_model_is_ranked (model)) {
+		if ((row1->package == NULL) != (row2->package == NULL))
+			return row1->package == NULL ? -1 : 1;
+		if (row1->score != row2->score)
+			return row1->score > row2->score ? -1 : 1;
+	}
+
+	/* the search helpers stay at the top */
+	if (gpk_package_model_is_ordered (model) &&
+	    (row1->package == NULL) != (row2->package == NULL))
+		return row1->package == NULL ? -1 : 1;
+
+	if (gpk_package_model_is_ordered (model) && row1->package != NULL) {
+		switch (model->sort_column_id) {
+		case GPK_PACKAGE_MODEL_COLUMN_VERSION:
+			rc = strcmp (row1->version_key, row2->version_key);
+			break;
+		case GPK_PACKAGE_MODEL_COLUMN_REPO:
+			rc = strcmp (row1->repo_key, row2->repo_key);
+			break;
+		case GPK_PACKAGE_MODEL_COLUMN_STATE:
+			rc = (gint) row1->state - (gint) row2->state;
+			break;
+		case GPK_PACKAGE_MODEL_COLUMN_SIZE:
+			if (row1->size != row2->size)
+				rc = row1->size < row2->size ? -1 : 1;
+			break;
+		default:
+			break;
+		}
+		if (rc == 0)
+			rc = strcmp (row1->name_key, row2->name_key);
+		if (model->sort_order == GTK_SORT_DESCENDING)
+			rc = -rc;
+	}
+
+	/* keep the order they were added in */
+	if (rc == 0 && row1->serial != row2->serial)
+		rc = row1->serial < row2->serial ? -1 : 1;
+	return rc;
+}
+
+/* the keys only some columns need are made the first time they are sorted by */
+static void
+gpk_package_model_ensure_keys (GpkPackageModel *model, guint start)
+{
+	GpkPackageModelRow *row;
+	guint i;
+
+	for (i = start; i < model->rows->len; i++) {
+		row = g_ptr_array_index (model->rows, i);
+		if (row->package == NULL)
+			continue;
+		if (model->sort_column_id == GPK_PACKAGE_MODEL_COLUMN_VERSION && row->version_key == NULL)
+			row->version_key = g_utf8_collate_key_for_filename (gpk_package_model_str (pk_package_get_version (row->package)), -1);
+		if (model->sort_column_id == GPK_PACKAGE_MODEL_COLUMN_REPO && row->repo_key == NULL)
+			row->repo_key = g_utf8_collate_key (gpk_package_model_str (pk_package_get_data (row->package)), -1);
+	}
+}
+
+/**
+ * gpk_package_model_remove_hiding:
+ *
+ * Takes every row marked as hiding out of the view in one pass. The rows
+ * that stay are moved up and numbered first, and the view is then told
+ * about the deletions from the last to the first, so each path it is
+ * given is still the one it has for that row.
+ **/
+static void
+gpk_package_model_remove_hiding (GpkPackageModel *model)
+{
+	GpkPackageModelRow *row;
+	GtkTreePath *path;
+	guint i;
+	guint len = 0;
+	guint sorted_len = 0;
+	g_autoptr(GArray) removed = NULL;
+
+	removed = g_array_new (FALSE, FALSE, sizeof (guint));
+	for (i = 0; i < model->rows->len; i++) {
+		row = g_ptr_array_index (model->rows, i);
+		if (row->hiding) {
+			row->hiding = FALSE;
+			row->visible = FALSE;
+			if (model->best == row)
+				model->best = NULL;
+			g_array_append_val (removed, i);
+			continue;
+		}
+		if (i < model->sorted_len)
+			sorted_len++;
+		row->index = len;
+		model->rows->pdata[len++] = row;
+	}
+	if (removed->len == 0)
+		return;
+	g_ptr_array_set_size (model->rows, (gint) len);
+	model->sorted_len = sorted_len;
+	gpk_package_model_cache_invalidate (model);
+
+	for (i = removed->len; i > 0; i--) {
+		path = gtk_tree_path_new_from_indices (g_array_index (removed, guint, i - 1), -1);
+		gtk_tree_model_row_deleted (GTK_TREE_MODEL (model), path);
+		gtk_tree_path_free (path);
+	}
+}
+
+/**
+ * gpk_package_model_sort:
+ *
+ * Takes out the rows waiting to be hidden, then puts the rows added since
+ * the last sort in order and merges them into the rows that were already
+ * sorted, so streaming results in only costs a linear pass each time.
+ **/
+static void
+gpk_package_model_sort (GpkPackageModel *model)
+{
+	GpkPackageModelRow **merged;
+	GpkPackageModelRow **rows;
+	GpkPackageModelRow *row;
+	GtkTreePath *path;
+	gboolean changed = FALSE;
+	gint *new_order;
+	guint i, j, k;
+	guint len;
+
+	if (model->sort_id != 0) {
+		g_source_remove (model->sort_id);
+		model->sort_id = 0;
+	}
+	gpk_package_model_remove_hiding (model);
+	len = model->rows->len;
+	if (model->sorted_len >= len)
+		return;
+
+	/* sort the new rows on their own */
+	gpk_package_model_ensure_keys (model, model->sorted_len);
+	rows = (GpkPackageModelRow **) model->rows->pdata;
+	g_qsort_with_data (rows + model->sorted_len, len - model->sorted_len,
+			   sizeof (gpointer), gpk_package_model_compare, model);
+
+	/* merge them with the rows already in order */
+	merged = g_new (GpkPackageModelRow *, len);
+	i = 0;
+	j = model->sorted_len;
+	for (k = 0; k < len; k++) {
+		if (j >= len ||
+		    (i < model->sorted_len &&
+		     gpk_package_model_compare (&rows[i], &rows[j], model) <= 0))
+			merged[k] = rows[i++];
+		else
+			merged[k] = rows[j++];
+	}
+
+	/* tell the view where each row came from */
+	new_order = g_new (gint, len);
+	for (k = 0; k < len; k++) {
+		row = merged[k];
+		new_order[k] = row->index;
+		if (row->index != k)
+			changed = TRUE;
+		row->index = k;
+		rows[k] = row;
+	}
+	model->sorted_len = len;
+	if (changed) {
+		path = gtk_tree_path_new ();
+		gtk_tree_model_rows_reordered (GTK_TREE_MODEL (model), path, NULL, new_order);
+		gtk_tree_path_free (path);
+	}
+	g_free (new_order);
+	g_free (merged);
+}
+
+static gboolean
+gpk_package_model_sort_cb (gpointer user_data)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (user_data);
+	model->sort_id = 0;
+	gpk_package_model_sort (model);
+	return G_SOURCE_REMOVE;
+}
+
+/* rows are hidden and put in order before the view is next drawn */
+static void
+gpk_package_model_sort_idle (GpkPackageModel *model)
+{
+	if (model->sort_id != 0)
+		return;
+	model->sort_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+					  gpk_package_model_sort_cb, model, NULL);
+	g_source_set_name_by_id (model->sort_id, "[GpkPackageModel] sort");
+}
+
+static void
+gpk_package_model_sort_later (GpkPackageModel *model)
+{
+	if (!gpk_package_model_is_ordered (model) && !gpk_package_model_is_ranked (model))
+		return;
+	gpk_package_model_sort_idle (model);
+}
+
+/* subpackages that are hidden when only showing the main packages */
+static const gchar *gpk_package_model_subpackage_suffixes[] = {
+	"-common", "-data", "-dbg", "-debuginfo", "-debugsource", "-dev",
+	"-devel", "-doc", "-docs", "-libs", "-static", "-tests", NULL };
+
+static gboolean
+gpk_package_model_is_subpackage (const gchar *name)
+{
+	guint i;
+	for (i = 0; gpk_package_model_subpackage_suffixes[i] != NULL; i++) {
+		if (g_str_has_suffix (name, gpk_package_model_subpackage_suffixes[i]))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* the facets that only need the row itself, so are safe to do in a thread */
+static void
+gpk_package_model_facet_row (GpkPackageModel *model, GpkPackageModelRow *row)
+{
+	const gchar *arch;
+
+	row->facet_ok = TRUE;
+	if (row->package == NULL)
+		return;
+	if (pk_bitfield_contain (model->facets, PK_FILTER_ENUM_NEWEST) && row->version_key == NULL)
+		row->version_key = g_utf8_collate_key_for_filename (gpk_package_model_str (pk_package_get_version (row->package)), -1);
+	if (pk_bitfield_contain (model->facets, PK_FILTER_ENUM_ARCH) && model->native_arch != NULL) {
+		arch = gpk_package_model_str (pk_package_get_arch (row->package));
+		if (arch[0] != '\0' &&
+		    g_strcmp0 (arch, "noarch") != 0 &&
+		    g_strcmp0 (arch, "all") != 0 &&
+		    g_strcmp0 (arch, model->native_arch) != 0)
+			row->facet_ok = FALSE;
+	}
+	if (pk_bitfield_contain (model->facets, PK_FILTER_ENUM_BASENAME) &&
+	    gpk_package_model_is_subpackage (gpk_package_model_str (pk_package_get_name (row->package))))
+		row->facet_ok = FALSE;
+}
+
+static gboolean
+gpk_package_model_row_is_installed (GpkPackageModelRow *row)
+{
+	return pk_bitfield_contain (row->state, GPK_PACKAGE_STATE_INSTALLED);
+}
+
+/* installed and available versions are each cut down to the newest */
+static gchar *
+gpk_package_model_newest_key (GpkPackageModelRow *row)
+{
+	return g_strdup_printf ("%s;%s;%i",
+				gpk_package_model_str (pk_package_get_name (row->package)),
+				gpk_package_model_str (pk_package_get_arch (row->package)),
+				gpk_package_model_row_is_installed (row));
+}
+
+/* what the view would show if the installed facets were not set */
+static void
+gpk_package_model_count_row (GpkPackageModel *model, GpkPackageModelRow *row, gint delta)
+{
+	if (gpk_package_model_row_is_installed (row))
+		model->count_installed += delta;
+	else
+		model->count_available += delta;
+}
+
+static gboolean
+gpk_package_model_row_wanted (GpkPackageModel *model, GpkPackageModelRow *row)
+{
+	if (row->package == NULL)
+		return TRUE;
+	if (!row->facet_ok || row->superseded)
+		return FALSE;
+	if (pk_bitfield_contain (model->facets, PK_FILTER_ENUM_INSTALLED))
+		return gpk_package_model_row_is_installed (row);
+	if (pk_bitfield_contain (model->facets, PK_FILTER_ENUM_NOT_INSTALLED))
+		return !gpk_package_model_row_is_installed (row);
+	return TRUE;
+}
+
+static guint
+gpk_package_model_score_word (const gchar *name, const gchar *summary, const gchar *word)
+{
+	if (g_ascii_strcasecmp (name, word) == 0)
+		return GPK_PACKAGE_MODEL_SCORE_EXACT;
+	if (g_ascii_strncasecmp (name, word, strlen (word)) == 0)
+		return GPK_PACKAGE_MODEL_SCORE_PREFIX;
+	if (gpk_ascii_strcasestr (name, word))
+		return GPK_PACKAGE_MODEL_SCORE_NAME;
+	if (gpk_ascii_strcasestr (summary, word))
+		return GPK_PACKAGE_MODEL_SCORE_SUMMARY;
+	return 0;
+}
+
+/* done once, when the row is added or the search changes */
+static void
+gpk_package_model_score_row (GpkPackageModel *model, GpkPackageModelRow *row)
+{
+	const gchar *arch;
+	const gchar *name;
+	const gchar *summary;
+	guint i;
+
+	row->score = 0;
+	if (row->package == NULL || model->search == NULL)
+		return;
+	name = gpk_package_model_str (pk_package_get_name (row->package));
+	summary = gpk_package_model_str (pk_package_get_summary (row->package));
+	for (i = 0; model->search[i] != NULL; i++)
+		row->score = MAX (row->score, gpk_package_model_score_word (name, summary, model->search[i]));
+	if (gpk_package_model_row_is_installed (row))
+		row->score += GPK_PACKAGE_MODEL_SCORE_INSTALLED;
+	arch = gpk_package_model_str (pk_package_get_arch (row->package));
+	if (g_strcmp0 (arch, model->native_arch) == 0 ||
+	    g_strcmp0 (arch, "noarch") == 0 ||
+	    g_strcmp0 (arch, "all") == 0)
+		row->score += GPK_PACKAGE_MODEL_SCORE_NATIVE;
+}
+
+static void
+gpk_package_model_update_best (GpkPackageModel *model, GpkPackageModelRow *row)
+{
+	if (row->package == NULL || row->hiding)
+		return;
+	if (model->best == NULL || row->score > model->best->score)
+		model->best = row;
+}
+
+static void
+gpk_package_model_find_best (GpkPackageModel *model)
+{
+	guint i;
+	model->best = NULL;
+	for (i = 0; i < model->rows->len; i++)
+		gpk_package_model_update_best (model, g_ptr_array_index (model->rows, i));
+}
+
+/* removes one row from the view when next idle, keeping it in the
+ * backing array, so the rows after it are only moved up once a batch */
+static void
+gpk_package_model_hide_row (GpkPackageModel *model, GpkPackageModelRow *row)
+{
+	if (!row->visible || row->hiding)
+		return;
+	row->hiding = TRUE;
+	if (model->best == row)
+		model->best = NULL;
+	gpk_package_model_sort_idle (model);
+}
+
+/* new rows go at the end, and are merged into place when idle */
+static void
+gpk_package_model_show_row (GpkPackageModel *model, GpkPackageModelRow *row)
+{
+	GtkTreeIter iter;
+	GtkTreePath *path;
+
+	/* still in the view, so only keep it there */
+	if (row->hiding) {
+		row->hiding = FALSE;
+		gpk_package_model_update_best (model, row);
+		return;
+	}
+	row->visible = TRUE;
+	gpk_package_model_update_best (model, row);
+	row->index = model->rows->len;
+	g_ptr_array_add (model->rows, row);
+
+	gpk_package_model_set_iter (model, &iter, row);
+	path = gtk_tree_path_new_from_indices (row->index, -1);
+	gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &iter);
+	gtk_tree_path_free (path);
+}
+
+/* a newer version of the same package replaces the one in the view */
+static void
+gpk_package_model_facet_newest (GpkPackageModel *model, GpkPackageModelRow *row)
+{
+	GpkPackageModelRow *best;
+	g_autofree gchar *key = NULL;
+
+	row->superseded = FALSE;
+	if (row->package == NULL || !row->facet_ok)
+		return;
+	if (!pk_bitfield_contain (model->facets, PK_FILTER_ENUM_NEWEST)) {
+		gpk_package_model_count_row (model, row, 1);
+		return;
+	}
+	key = gpk_package_model_newest_key (row);
+	best = g_hash_table_lookup (model->newest, key);
+	if (best != NULL && strcmp (best->version_key, row->version_key) >= 0) {
+		row->superseded = TRUE;
+		return;
+	}
+	if (best != NULL) {
+		best->superseded = TRUE;
+		gpk_package_model_count_row (model, best, -1);
+		gpk_package_model_hide_row (model, best);
+	}
+	gpk_package_model_count_row (model, row, 1);
+	g_hash_table_insert (model->newest, g_steal_pointer (&key), row);
+}
+
+/* the newest of the rows left with @key takes the place of @gone */
+static void
+gpk_package_model_newest_promote (GpkPackageModel *model,
+				  GpkPackageModelRow *gone,
+				  const gchar *key)
+{
+	GpkPackageModelRow *best = NULL;
+	GpkPackageModelRow *row;
+	const gchar *name = pk_package_get_name (gone->package);
+	guint i;
+
+	for (i = 0; i < model->all->len; i++) {
+		g_autofree gchar *tmp = NULL;
+
+		row = g_ptr_array_index (model->all, i);
+		if (row == gone || row->package == NULL || !row->facet_ok || !row->superseded)
+			continue;
+		if (g_strcmp0 (pk_package_get_name (row->package), name) != 0)
+			continue;
+		if (best != NULL && strcmp (best->version_key, row->version_key) >= 0)
+			continue;
+		tmp = gpk_package_model_newest_key (row);
+		if (g_strcmp0 (tmp, key) == 0)
+			best = row;
+	}
+	if (best == NULL)
+		return;
+	best->superseded = FALSE;
+	gpk_package_model_count_row (model, best, 1);
+	g_hash_table_insert (model->newest, g_strdup (key), best);
+	if (gpk_package_model_row_wanted (model, best)) {
+		gpk_package_model_show_row (model, best);
+		gpk_package_model_sort_later (model);
+	}
+}
+
+typedef struct {
+	GpkPackageModel		*model;
+	guint			 start;
+	guint			 end;
+} GpkPackageModelChunk;
+
+static void
+gpk_package_model_facet_chunk_cb (gpointer data, gpointer user_data)
+{
+	GpkPackageModelChunk *chunk = (GpkPackageModelChunk *) data;
+	guint i;
+	for (i = chunk->start; i < chunk->end; i++)
+		gpk_package_model_facet_row (chunk->model, g_ptr_array_index (chunk->model->all, i));
+}
+
+/* splits the rows between threads when there are enough to be worth it */
+static void
+gpk_package_model_facet_rows (GpkPackageModel *model)
+{
+	GpkPackageModelChunk *chunks;
+	GThreadPool *pool;
+	guint n_chunks;
+	guint i;
+	guint len = model->all->len;
+
+	n_chunks = (len + GPK_PACKAGE_MODEL_FACET_CHUNK - 1) / GPK_PACKAGE_MODEL_FACET_CHUNK;
+	chunks = g_new0 (GpkPackageModelChunk, MAX (n_chunks, 1));
+	for (i = 0; i < n_chunks; i++) {
+		chunks[i].model = model;
+		chunks[i].start = i * GPK_PACKAGE_MODEL_FACET_CHUNK;
+		chunks[i].end = MIN (len, chunks[i].start + GPK_PACKAGE_MODEL_FACET_CHUNK);
+	}
+	if (n_chunks < 2) {
+		for (i = 0; i < n_chunks; i++)
+			gpk_package_model_facet_chunk_cb (&chunks[i], NULL);
+		g_free (chunks);
+		return;
+	}
+	pool = g_thread_pool_new (gpk_package_model_facet_chunk_cb, NULL,
+				  (gint) MIN (n_chunks, g_get_num_processors ()),
+				  FALSE, NULL);
+	for (i = 0; i < n_chunks; i++)
+		g_thread_pool_push (pool, &chunks[i], NULL);
+	g_thread_pool_free (pool, FALSE, TRUE);
+	g_free (chunks);
+}
+
+/**
+ * gpk_package_model_refilter:
+ *
+ * Works out which of the backing rows are shown from scratch. The rows
+ * are checked on their own in parallel, then the newest versions are
+ * picked, and then the view is replaced in one go.
+ **/
+static void
+gpk_package_model_refilter (GpkPackageModel *model)
+{
+	GpkPackageModelRow *row;
+	GtkTreePath *path;
+	guint i;
+
+	if (model->sort_id != 0) {
+		g_source_remove (model->sort_id);
+		model->sort_id = 0;
+	}
+
+	/* remove from the end so no other rows move */
+	gpk_package_model_cache_invalidate (model);
+	while (model->rows->len > 0) {
+		i = model->rows->len - 1;
+		row = g_ptr_array_index (model->rows, i);
+		row->visible = FALSE;
+		row->hiding = FALSE;
+		g_ptr_array_remove_index (model->rows, i);
+		path = gtk_tree_path_new_from_indices (i, -1);
+		gtk_tree_model_row_deleted (GTK_TREE_MODEL (model), path);
+		gtk_tree_path_free (path);
+	}
+
+	/* decide, and then show them in the order they will be sorted in */
+	gpk_package_model_facet_rows (model);
+	g_hash_table_remove_all (model->newest);
+	model->count_installed = 0;
+	model->count_available = 0;
+	for (i = 0; i < model->all->len; i++)
+		gpk_package_model_facet_newest (model, g_ptr_array_index (model->all, i));
+	for (i = 0; i < model->all->len; i++) {
+		row = g_ptr_array_index (model->all, i);
+		if (gpk_package_model_row_wanted (model, row))
+			g_ptr_array_add (model->rows, row);
+	}
+	if (gpk_package_model_is_ordered (model) || gpk_package_model_is_ranked (model)) {
+		gpk_package_model_ensure_keys (model, 0);
+		g_qsort_with_data (model->rows->pdata, model->rows->len,
+				   sizeof (gpointer), gpk_package_model_compare, model);
+	}
+	model->sorted_len = model->rows->len;
+	gpk_package_model_find_best (model);
+	for (i = 0; i < model->rows->len; i++) {
+		GtkTreeIter iter;
+		row = g_ptr_array_index (model->rows, i);
+		row->visible = TRUE;
+		row->index = i;
+		gpk_package_model_set_iter (model, &iter, row);
+		path = gtk_tree_path_new_from_indices (i, -1);
+		gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &iter);
+		gtk_tree_path_free (path);
+	}
+}
+
+/**
+ * gpk_package_model_set_facets:
+ * @model: a #GpkPackageModel
+ * @facets: a bitfield of %PK_FILTER_ENUM_NEWEST, %PK_FILTER_ENUM_ARCH,
+ *	    %PK_FILTER_ENUM_BASENAME, %PK_FILTER_ENUM_INSTALLED and
+ *	    %PK_FILTER_ENUM_NOT_INSTALLED
+ *
+ * Sets which of the packages that were added are shown, so the same
+ * results can be looked at differently without asking the daemon again.
+ **/
+void
+gpk_package_model_set_facets (GpkPackageModel *model, PkBitfield facets)
+{
+	g_return_if_fail (GPK_IS_PACKAGE_MODEL (model));
+	if (model->facets == facets)
+		return;
+	model->facets = facets;
+	gpk_package_model_refilter (model);
+}
+
+PkBitfield
+gpk_package_model_get_facets (GpkPackageModel *model)
+{
+	g_return_val_if_fail (GPK_IS_PACKAGE_MODEL (model), 0);
+	return model->facets;
+}
+
+/**
+ * gpk_package_model_set_native_arch:
+ * @arch: (allow-none): the architecture the backend uses for this machine
+ *
+ * Sets what %PK_FILTER_ENUM_ARCH keeps; until it is known every package
+ * is shown.
+ **/
+void
+gpk_package_model_set_native_arch (GpkPackageModel *model, const gchar *arch)
+{
+	guint i;
+
+	g_return_if_fail (GPK_IS_PACKAGE_MODEL (model));
+	if (g_strcmp0 (model->native_arch, arch) == 0)
+		return;
+	g_free (model->native_arch);
+	model->native_arch = g_strdup (arch);
+
+	/* native packages win a tie */
+	for (i = 0; i < model->all->len; i++)
+		gpk_package_model_score_row (model, g_ptr_array_index (model->all, i));
+	if (pk_bitfield_contain (model->facets, PK_FILTER_ENUM_ARCH)) {
+		gpk_package_model_refilter (model);
+		return;
+	}
+	gpk_package_model_find_best (model);
+	if (gpk_package_model_is_ranked (model)) {
+		model->sorted_len = 0;
+		gpk_package_model_sort (model);
+	}
+}
+
+/**
+ * gpk_package_model_get_facet_counts:
+ * @installed: (out) (allow-none): the number of installed packages
+ * @available: (out) (allow-none): the number of available packages
+ *
+ * Gets how many packages pass the facets, ignoring the installed ones, so
+ * the user can see what they would get by changing them.
+ **/
+void
+gpk_package_model_get_facet_counts (GpkPackageModel *model, guint *installed, guint *available)
+{
+	g_return_if_fail (GPK_IS_PACKAGE_MODEL (model));
+	if (installed != NULL)
+		*installed = model->count_installed;
+	if (available != NULL)
+		*available = model->count_available;
+}
+
+static void
+gpk_package_model_append_row (GpkPackageModel *model, GpkPackageModelRow *row)
+{
+	row->serial = model->serial_next++;
+	g_ptr_array_add (model->all, row);
+
+	/* kept for when the facets change */
+	gpk_package_model_facet_row (model, row);
+	gpk_package_model_facet_newest (model, row);
+	if (!gpk_package_model_row_wanted (model, row))
+		return;
+	gpk_package_model_show_row (model, row);
+	gpk_package_model_sort_later (model);
+}
+
+/**
+ * gpk_package_model_add_package:
+ * @model: a #GpkPackageModel
+ * @package: a #PkPackage, which is reffed
+ * @state: a #GpkPackageState bitfield
+ *
+ * Appends a package row. The markup is only generated when the row is drawn,
+ * and if the model is sorted the row is moved into place soon after.
+ **/
+void
+gpk_package_model_add_package (GpkPackageModel *model, PkPackage *package, PkBitfield state)
+{
+	GpkPackageModelRow *row;
+
+	g_return_if_fail (GPK_IS_PACKAGE_MODEL (model));
+	g_return_if_fail (PK_IS_PACKAGE (package));
+
+	row = g_new0 (GpkPackageModelRow, 1);
+	row->package = g_object_ref (package);
+	row->state = (guint8) state;
+	row->size = G_MAXUINT64;
+	row->name_key = g_utf8_collate_key (gpk_package_model_str (pk_package_get_name (package)), -1);
+	row->atom = gpk_package_atom_intern (pk_package_get_id (package));
+	if (row->atom != NULL && !g_hash_table_contains (model->ids, row->atom))
+		g_hash_table_insert (model->ids, row->atom, row);
+	gpk_package_model_score_row (model, row);
+	gpk_package_model_append_row (model, row);
+}
+
+/**
+ * gpk_package_model_add_message:
+ * @model: a #GpkPackageModel
+ * @icon_name: an icon name
+ * @text: the markup to show
+ *
+ * Appends a row that is not a package, for instance the welcome text.
+ **/
+void
+gpk_package_model_add_message (GpkPackageModel *model, const gchar *icon_name, const gchar *text)
+{
+	GpkPackageModelRow *row;
+
+	g_return_if_fail (GPK_IS_PACKAGE_MODEL (model));
+
+	row = g_new0 (GpkPackageModelRow, 1);
+	row->icon_name = g_strdup (icon_name);
+	row->message = g_strdup (text);
+	gpk_package_model_append_row (model, row);
+}
+
+/**
+ * gpk_package_model_add_suggestion:
+ * @model: a #GpkPackageModel
+ * @icon_name: an icon name
+ * @text: the markup to show
+ * @search: the text to search for when the row is clicked
+ *
+ * Appends a message row that offers a different search.
+ **/
+void
+gpk_package_model_add_suggestion (GpkPackageModel *model,
+				  const gchar *icon_name,
+				  const gchar *text,
+				  const gchar *search)
+{
+	GpkPackageModelRow *row;
+
+	g_return_if_fail (GPK_IS_PACKAGE_MODEL (model));
+	g_return_if_fail (search != NULL);
+
+	row = g_new0 (GpkPackageModelRow, 1);
+	row->icon_name = g_strdup (icon_name);
+	row->message = g_strdup (text);
+	row->suggestion = g_strdup (search);
+	gpk_package_model_append_row (model, row);
+}
+
+void
+gpk_package_model_clear (GpkPackageModel *model)
+{
+	GtkTreePath *path;
+	guint index;
+
+	g_return_if_fail (GPK_IS_PACKAGE_MODEL (model));
+
+	/* remove from the end so no other rows move */
+	if (model->sort_id != 0) {
+		g_source_remove (model->sort_id);
+		model->sort_id = 0;
+	}
+	model->sorted_len = 0;
+	model->serial_next = 0;
+	model->count_installed = 0;
+	model->count_available = 0;
+	model->best = NULL;
+	g_hash_table_remove_all (model->ids);
+	g_hash_table_remove_all (model->newest);
+	gpk_package_model_cache_invalidate (model);
+	while (model->rows->len > 0) {
+		index = model->rows->len - 1;
+		g_ptr_array_remove_index (model->rows, index);
+		path = gtk_tree_path_new_from_indices (index, -1);
+		gtk_tree_model_row_deleted (GTK_TREE_MODEL (model), path);
+		gtk_tree_path_free (path);
+	}
+	g_ptr_array_set_size (model->all, 0);
+
+	/* invalidate all the iters handed out */
+	do {
+		model->stamp = g_random_int ();
+	} while (model->stamp == 0);
+}
+
+static gboolean
+gpk_package_model_newest_dropped_cb (gpointer key, gpointer value, gpointer user_data)
+{
+	GpkPackageModelRow *row = (GpkPackageModelRow *) value;
+	return row->dropped;
+}
+
+/**
+ * gpk_package_model_retain:
+ * @model: a #GpkPackageModel
+ * @func: called for each row, with %NULL for message rows
+ * @user_data: data for @func
+ *
+ * Removes every row that @func does not want to keep, which allows a set
+ * of results to be narrowed without asking the daemon again.
+ **/
+void
+gpk_package_model_retain (GpkPackageModel *model,
+			  GpkPackageModelFilterFunc func,
+			  gpointer user_data)
+{
+	GpkPackageModelRow *row;
+	guint i;
+
+	g_return_if_fail (GPK_IS_PACKAGE_MODEL (model));
+
+	/* removing rows keeps the order, so start from a sorted model */
+	if (gpk_package_model_is_ordered (model) || gpk_package_model_is_ranked (model))
+		gpk_package_model_sort (model);
+
+	/* hidden rows are asked about too, as the facets might change */
+	for (i = 0; i < model->all->len; i++) {
+		row = g_ptr_array_index (model->all, i);
+		row->dropped = !func (row->package, user_data);
+		if (row->dropped && row->visible)
+			row->hiding = TRUE;
+		if (row->dropped &&
+		    row->atom != NULL &&
+		    g_hash_table_lookup (model->ids, row->atom) == row)
+			g_hash_table_remove (model->ids, row->atom);
+	}
+	g_hash_table_foreach_remove (model->newest, gpk_package_model_newest_dropped_cb, NULL);
+	gpk_package_model_remove_hiding (model);
+	gpk_package_model_find_best (model);
+
+	/* free what was dropped, keeping the order of the rest */
+	model->count_installed = 0;
+	model->count_available = 0;
+	for (i = model->all->len; i > 0; i--) {
+		row = g_ptr_array_index (model->all, i - 1);
+		if (row->dropped) {
+			g_ptr_array_remove_index (model->all, i - 1);
+			continue;
+		}
+		if (row->package != NULL && row->facet_ok && !row->superseded)
+			gpk_package_model_count_row (model, row, 1);
+	}
+}
+
+guint
+gpk_package_model_get_size (GpkPackageModel *model)
+{
+	g_return_val_if_fail (GPK_IS_PACKAGE_MODEL (model), 0);
+	return model->rows->len;
+}
+
+/**
+ * gpk_package_model_get_package:
+ *
+ * Return value: (transfer none): the package for the row, or %NULL for a message
+ **/
+PkPackage *
+gpk_package_model_get_package (GpkPackageModel *model, GtkTreeIter *iter)
+{
+	GpkPackageModelRow *row;
+	g_return_val_if_fail (GPK_IS_PACKAGE_MODEL (model), NULL);
+	g_return_val_if_fail (iter->stamp == model->stamp, NULL);
+	row = iter->user_data;
+	return row->package;
+}
+
+PkBitfield
+gpk_package_model_get_state (GpkPackageModel *model, GtkTreeIter *iter)
+{
+	GpkPackageModelRow *row;
+	g_return_val_if_fail (GPK_IS_PACKAGE_MODEL (model), 0);
+	g_return_val_if_fail (iter->stamp == model->stamp, 0);
+	row = iter->user_data;
+	return row->state;
+}
+
+void
+gpk_package_model_set_state (GpkPackageModel *model, GtkTreeIter *iter, PkBitfield state)
+{
+	GpkPackageModelRow *row;
+	GtkTreePath *path;
+
+	g_return_if_fail (GPK_IS_PACKAGE_MODEL (model));
+	g_return_if_fail (iter->stamp == model->stamp);
+
+	/* nothing to do */
+	row = iter->user_data;
+	if (row->state == (guint8) state)
+		return;
+	if (row->package != NULL && row->facet_ok && !row->superseded) {
+		gpk_package_model_count_row (model, row, -1);
+		row->state = (guint8) state;
+		gpk_package_model_count_row (model, row, 1);
+	}
+	row->state = (guint8) state;
+
+	path = gtk_tree_path_new_from_indices (row->index, -1);
+	gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, iter);
+	gtk_tree_path_free (path);
+
+	/* the row might have to move */
+	if (model->sort_column_id == GPK_PACKAGE_MODEL_COLUMN_STATE) {
+		model->sorted_len = 0;
+		gpk_package_model_sort_later (model);
+	}
+}
+
+/* name;version;arch, as the data part differs once installed */
+static gchar *
+gpk_package_model_strip_data (const gchar *package_id)
+{
+	const gchar *tmp = strrchr (package_id, ';');
+	if (tmp == NULL)
+		return NULL;
+	return g_strndup (package_id, (gsize) (tmp - package_id));
+}
+
+static gboolean
+gpk_package_model_set_row_installed (GpkPackageModel *model, GpkPackageModelRow *row, gboolean installed)
+{
+	GtkTreeIter iter;
+	GtkTreePath *path;
+	PkBitfield state = row->state;
+	gboolean superseded = row->superseded;
+	g_autofree gchar *key = NULL;
+
+	if (installed)
+		pk_bitfield_add (state, GPK_PACKAGE_STATE_INSTALLED);
+	else
+		pk_bitfield_remove (state, GPK_PACKAGE_STATE_INSTALLED);
+	pk_bitfield_remove (state, GPK_PACKAGE_STATE_IN_LIST);
+	if (row->state == (guint8) state)
+		return FALSE;
+	if (row->facet_ok && !row->superseded)
+		gpk_package_model_count_row (model, row, -1);
+
+	/* it is now the newest of the installed versions, or of the others */
+	if (row->facet_ok && pk_bitfield_contain (model->facets, PK_FILTER_ENUM_NEWEST)) {
+		key = gpk_package_model_newest_key (row);
+		if (g_hash_table_lookup (model->newest, key) == row)
+			g_hash_table_remove (model->newest, key);
+		else
+			g_clear_pointer (&key, g_free);
+	}
+	row->state = (guint8) state;
+	gpk_package_model_facet_newest (model, row);
+	if (key != NULL)
+		gpk_package_model_newest_promote (model, row, key);
+
+	/* installed packages win a tie */
+	gpk_package_model_score_row (model, row);
+	if (row->visible) {
+		gpk_package_model_set_iter (model, &iter, row);
+		path = gtk_tree_path_new_from_indices (row->index, -1);
+		gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, &iter);
+		gtk_tree_path_free (path);
+	}
+
+	/* a newer version is already installed, or this one now shows */
+	if (row->superseded) {
+		gpk_package_model_hide_row (model, row);
+	} else if (superseded && gpk_package_model_row_wanted (model, row)) {
+		gpk_package_model_show_row (model, row);
+		gpk_package_model_sort_later (model);
+	}
+	return TRUE;
+}
+
+/**
+ * gpk_package_model_set_installed:
+ * @model: a #GpkPackageModel
+ * @package_ids: the packages that were installed or removed
+ * @installed: if the packages are now installed
+ *
+ * Changes the rows of packages a transaction has installed or removed, and
+ * takes them out of the queue. Packages are found by name, version and arch
+ * if there is no row with the exact ID, as the data part of the ID changes
+ * when a package is installed.
+ *
+ * Rows are not hidden by the installed facets until these are next set,
+ * so the view does not jump about, but they are moved if sorted by state
+ * or ranked against a search, as being installed wins a tie.
+ *
+ * Return value: the number of rows that changed
+ **/
+guint
+gpk_package_model_set_installed (GpkPackageModel *model, gchar **package_ids, gboolean installed)
+{
+	GpkPackageModelRow *row;
+	g_autoptr(GHashTable) missing = NULL;
+	guint changed = 0;
+	guint i;
+
+	g_return_val_if_fail (GPK_IS_PACKAGE_MODEL (model), 0);
+	g_return_val_if_fail (package_ids != NULL, 0);
+
+	missing = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	for (i = 0; package_ids[i] != NULL; i++) {
+		gchar *key;
+
+		row = gpk_package_model_lookup (model, package_ids[i]);
+		if (row != NULL) {
+			if (gpk_package_model_set_row_installed (model, row, installed))
+				changed++;
+			continue;
+		}
+		key = gpk_package_model_strip_data (package_ids[i]);
+		if (key != NULL)
+			g_hash_table_add (missing, key);
+	}
+
+	/* one pass over the rows, however many were not found */
+	for (i = 0; i < model->all->len && g_hash_table_size (missing) > 0; i++) {
+		g_autofree gchar *key = NULL;
+
+		row = g_ptr_array_index (model->all, i);
+		if (row->atom == NULL)
+			continue;
+		key = gpk_package_model_strip_data (gpk_package_atom_get_id (row->atom));
+		if (key == NULL || !g_hash_table_contains (missing, key))
+			continue;
+		if (gpk_package_model_set_row_installed (model, row, installed))
+			changed++;
+	}
+
+	/* the rows might have to move */
+	if (changed == 0)
+		return 0;
+	gpk_package_model_find_best (model);
+	if (model->sort_column_id == GPK_PACKAGE_MODEL_COLUMN_STATE ||
+	    gpk_package_model_is_ranked (model)) {
+		model->sorted_len = 0;
+		gpk_package_model_sort_later (model);
+	}
+	return changed;
+}
+
+/**
+ * gpk_package_model_set_size:
+ * @model: a #GpkPackageModel
+ * @package_id: a package ID
+ * @size: the size in bytes
+ *
+ * Sets the size shown for a package, which is not known when the row is
+ * added as it is only part of the details.
+ **/
+void
+gpk_package_model_set_size (GpkPackageModel *model, const gchar *package_id, guint64 size)
+{
+	GpkPackageModelRow *row;
+	GtkTreeIter iter;
+	GtkTreePath *path;
+
+	g_return_if_fail (GPK_IS_PACKAGE_MODEL (model));
+
+	/* not shown, or nothing to do */
+	row = gpk_package_model_lookup (model, package_id);
+	if (row == NULL || row->size == size)
+		return;
+	row->size = size;
+	if (!row->visible)
+		return;
+
+	gpk_package_model_set_iter (model, &iter, row);
+	path = gtk_tree_path_new_from_indices (row->index, -1);
+	gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, &iter);
+	gtk_tree_path_free (path);
+
+	/* the row might have to move */
+	if (model->sort_column_id == GPK_PACKAGE_MODEL_COLUMN_SIZE) {
+		model->sorted_len = 0;
+		gpk_package_model_sort_later (model);
+	}
+}
+
+/**
+ * gpk_package_model_set_match:
+ * @model: a #GpkPackageModel
+ * @package_id: a package ID
+ * @match: a #GpkPackageMatch bitfield
+ *
+ * Sets where a search that was made in several ways found the package,
+ * which is shown after the package name.
+ **/
+void
+gpk_package_model_set_match (GpkPackageModel *model, const gchar *package_id, PkBitfield match)
+{
+	GpkPackageModelCacheItem *item;
+	GpkPackageModelRow *row;
+	GtkTreeIter iter;
+	GtkTreePath *path;
+
+	g_return_if_fail (GPK_IS_PACKAGE_MODEL (model));
+
+	/* not added yet, or nothing to do */
+	row = gpk_package_model_lookup (model, package_id);
+	if (row == NULL || row->match == (guint8) match)
+		return;
+	row->match = (guint8) match;
+	if (!row->visible)
+		return;
+
+	/* the markup has to be made again */
+	item = &model->cache[row->index % GPK_PACKAGE_MODEL_CACHE_SIZE];
+	if (item->row == row)
+		item->row = NULL;
+	gpk_package_model_set_iter (model, &iter, row);
+	path = gtk_tree_path_new_from_indices (row->index, -1);
+	gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, &iter);
+	gtk_tree_path_free (path);
+}
+
+/**
+ * gpk_package_model_set_sensitive:
+ * @model: a #GpkPackageModel
+ * @installed: if installed packages can be toggled
+ * @available: if available packages can be toggled
+ *
+ * Sets which checkboxes are visible. As this would change every row no
+ * signals are emitted, and the caller should redraw the view.
+ **/
+void
+gpk_package_model_set_sensitive (GpkPackageModel *model, gboolean installed, gboolean available)
+{
+	g_return_if_fail (GPK_IS_PACKAGE_MODEL (model));
+	model->installed_sensitive = installed;
+	model->available_sensitive = available;
+}
+
+void
+gpk_package_model_set_style (GpkPackageModel *model, GtkStyleContext *style)
+{
+	g_return_if_fail (GPK_IS_PACKAGE_MODEL (model));
+	if (model->style != NULL) {
+		g_signal_handler_disconnect (model->style, model->style_changed_id);
+		g_clear_object (&model->style);
+	}
+	gpk_package_formatter_free (model->formatter);
+	model->formatter = gpk_package_formatter_new (style);
+	gpk_package_model_cache_invalidate (model);
+
+	/* the formatter looks up the colour again, so the markup made
+	 * with the old one cannot be used either */
+	if (style != NULL) {
+		model->style = g_object_ref (style);
+		model->style_changed_id =
+			g_signal_connect_swapped (style, "changed",
+						  G_CALLBACK (gpk_package_model_cache_invalidate),
+						  model);
+	}
+}
+
+gboolean
+gpk_package_model_find_by_id (GpkPackageModel *model, const gchar *package_id, GtkTreeIter *iter)
+{
+	GpkPackageModelRow *row;
+
+	g_return_val_if_fail (GPK_IS_PACKAGE_MODEL (model), FALSE);
+	g_return_val_if_fail (package_id != NULL, FALSE);
+
+	row = gpk_package_model_lookup (model, package_id);
+	if (row == NULL || !row->visible)
+		return FALSE;
+	if (iter != NULL)
+		gpk_package_model_set_iter (model, iter, row);
+	return TRUE;
+}
+
+/**
+ * gpk_package_model_find_by_atom:
+ *
+ * Like gpk_package_model_find_by_id(), but without hashing the ID again.
+ **/
+gboolean
+gpk_package_model_find_by_atom (GpkPackageModel *model, GpkPackageAtom *atom, GtkTreeIter *iter)
+{
+	GpkPackageModelRow *row;
+
+	g_return_val_if_fail (GPK_IS_PACKAGE_MODEL (model), FALSE);
+	g_return_val_if_fail (atom != NULL, FALSE);
+
+	row = g_hash_table_lookup (model->ids, atom);
+	if (row == NULL || !row->visible)
+		return FALSE;
+	if (iter != NULL)
+		gpk_package_model_set_iter (model, iter, row);
+	return TRUE;
+}
+
+/**
+ * gpk_package_model_find_by_name:
+ *
+ * Finds the first row with a package name exactly matching @name.
+ **/
+gboolean
+gpk_package_model_find_by_name (GpkPackageModel *model, const gchar *name, GtkTreeIter *iter)
+{
+	GpkPackageModelRow *row;
+	guint i;
+
+	g_return_val_if_fail (GPK_IS_PACKAGE_MODEL (model), FALSE);
+
+	if (name == NULL)
+		return FALSE;
+	for (i = 0; i < model->rows->len; i++) {
+		row = g_ptr_array_index (model->rows, i);
+		if (row->package == NULL)
+			continue;
+		if (g_strcmp0 (pk_package_get_name (row->package), name) != 0)
+			continue;
+		if (iter != NULL)
+			gpk_package_model_set_iter (model, iter, row);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/**
+ * gpk_package_model_find_exact_match:
+ *
+ * Finds the shown row whose package name is exactly the search text, which
+ * is remembered as the rows are added so no rows need to be checked.
+ **/
+gboolean
+gpk_package_model_find_exact_match (GpkPackageModel *model, GtkTreeIter *iter)
+{
+	g_return_val_if_fail (GPK_IS_PACKAGE_MODEL (model), FALSE);
+
+	if (model->best == NULL || model->best->score < GPK_PACKAGE_MODEL_SCORE_EXACT)
+		return FALSE;
+	if (iter != NULL)
+		gpk_package_model_set_iter (model, iter, model->best);
+	return TRUE;
+}
+
+/**
+ * gpk_package_model_set_search:
+ * @model: a #GpkPackageModel
+ * @text: (allow-none): the words that were searched for
+ *
+ * Sets what the packages are scored against. An exact name beats a name
+ * prefix, which beats a part of the name, which beats the summary, and
+ * installed and native packages win a tie. Unless sorted by a column the
+ * rows are then kept in order of their score as they are added, and in
+ * the default order they go back to being sorted by name with no search.
+ **/
+void
+gpk_package_model_set_search (GpkPackageModel *model, const gchar *text)
+{
+	guint i;
+	g_autofree gchar *tmp = NULL;
+
+	g_return_if_fail (GPK_IS_PACKAGE_MODEL (model));
+
+	g_strfreev (model->search);
+	model->search = NULL;
+	if (text != NULL && text[0] != '\0') {
+		tmp = g_ascii_strdown (text, -1);
+		model->search = g_strsplit (tmp, " ", -1);
+	}
+
+	/* the rows already added are scored again */
+	for (i = 0; i < model->all->len; i++)
+		gpk_package_model_score_row (model, g_ptr_array_index (model->all, i));
+	gpk_package_model_find_best (model);
+	if (gpk_package_model_is_ranked (model) || gpk_package_model_is_named (model)) {
+		model->sorted_len = 0;
+		gpk_package_model_sort (model);
+	}
+}
+
+static void
+gpk_package_model_tree_model_init (GtkTreeModelIface *iface)
+{
+	iface->get_flags = gpk_package_model_get_flags;
+	iface->get_n_columns = gpk_package_model_get_n_columns;
+	iface->get_column_type = gpk_package_model_get_column_type;
+	iface->get_iter = gpk_package_model_get_iter;
+	iface->get_path = gpk_package_model_get_path;
+	iface->get_value = gpk_package_model_get_value;
+	iface->iter_next = gpk_package_model_iter_next;
+	iface->iter_previous = gpk_package_model_iter_previous;
+	iface->iter_children = gpk_package_model_iter_children;
+	iface->iter_has_child = gpk_package_model_iter_has_child;
+	iface->iter_n_children = gpk_package_model_iter_n_children;
+	iface->iter_nth_child = gpk_package_model_iter_nth_child;
+	iface->iter_parent = gpk_package_model_iter_parent;
+}
+
+static gboolean
+gpk_package_model_get_sort_column_id (GtkTreeSortable *sortable,
+				      gint *sort_column_id,
+				      GtkSortType *order)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (sortable);
+	if (sort_column_id != NULL)
+		*sort_column_id = model->sort_column_id;
+	if (order != NULL)
+		*order = model->sort_order;
+	return gpk_package_model_is_sorted (model);
+}
+
+static void
+gpk_package_model_set_sort_column_id (GtkTreeSortable *sortable,
+				      gint sort_column_id,
+				      GtkSortType order)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (sortable);
+
+	/* nothing to do */
+	if (model->sort_column_id == sort_column_id && model->sort_order == order)
+		return;
+	model->sort_column_id = sort_column_id;
+	model->sort_order = order;
+	gtk_tree_sortable_sort_column_changed (sortable);
+
+	/* unsorted is the order the rows were added in, and the default is
+	 * by name, or by relevance when there is a search */
+	model->sorted_len = 0;
+	gpk_package_model_sort (model);
+}
+
+static void
+gpk_package_model_set_sort_func (GtkTreeSortable *sortable,
+				 gint sort_column_id,
+				 GtkTreeIterCompareFunc sort_func,
+				 gpointer user_data,
+				 GDestroyNotify destroy)
+{
+	g_warning ("custom sort functions are not supported");
+}
+
+static void
+gpk_package_model_set_default_sort_func (GtkTreeSortable *sortable,
+					 GtkTreeIterCompareFunc sort_func,
+					 gpointer user_data,
+					 GDestroyNotify destroy)
+{
+	g_warning ("custom sort functions are not supported");
+}
+
+static gboolean
+gpk_package_model_has_default_sort_func (GtkTreeSortable *sortable)
+{
+	return TRUE;
+}
+
+static void
+gpk_package_model_tree_sortable_init (GtkTreeSortableIface *iface)
+{
+	iface->get_sort_column_id = gpk_package_model_get_sort_column_id;
+	iface->set_sort_column_id = gpk_package_model_set_sort_column_id;
+	iface->set_sort_func = gpk_package_model_set_sort_func;
+	iface->set_default_sort_func = gpk_package_model_set_default_sort_func;
+	iface->has_default_sort_func = gpk_package_model_has_default_sort_func;
+}
+
+static void
+gpk_package_model_finalize (GObject *object)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (object);
+	guint i;
+
+	if (model->sort_id != 0)
+		g_source_remove (model->sort_id);
+
+	for (i = 0; i < GPK_PACKAGE_MODEL_CACHE_SIZE; i++) {
+		if (model->cache[i].markup != NULL)
+			g_string_free (model->cache[i].markup, TRUE);
+	}
+	g_hash_table_unref (model->ids);
+	g_hash_table_unref (model->newest);
+	g_ptr_array_unref (model->rows);
+	g_ptr_array_unref (model->all);
+	g_free (model->native_arch);
+	g_strfreev (model->search);
+	if (model->style != NULL) {
+		g_signal_handler_disconnect (model->style, model->style_changed_id);
+		g_object_unref (model->style);
+	}
+	gpk_package_formatter_free (model->formatter);
+
+	G_OBJECT_CLASS (gpk_package_model_parent_class)->finalize (object);
+}
+
+static void
+gpk_package_model_class_init (GpkPackageModelClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gpk_package_model_finalize;
+}
+
+static void
+gpk_package_model_init (GpkPackageModel *model)
+{
+	model->all = g_ptr_array_new_with_free_func ((GDestroyNotify) gpk_package_model_row_free);
+	model->rows = g_ptr_array_new ();
+	model->ids = g_hash_table_new (g_direct_hash, g_direct_equal);
+	model->newest = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	model->formatter = gpk_package_formatter_new (NULL);
+	model->installed_sensitive = TRUE;
+	model->available_sensitive = TRUE;
+	model->sort_column_id = GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID;
+	model->sort_order = GTK_SORT_ASCENDING;
+	do {
+		model->stamp = g_random_int ();
+	} while (model->stamp == 0);
+}
+
+GpkPackageModel *
+gpk_package_model_new (void)
+{
+	return g_object_new (GPK_TYPE_PACKAGE_MODEL, NULL);
+}
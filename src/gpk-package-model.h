@@ -0,0 +1,133 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __GPK_PACKAGE_MODEL_H
+#define __GPK_PACKAGE_MODEL_H
+
+#include <glib-object.h>
+#include <gtk/gtk.h>
+#include <packagekit-glib2/packagekit.h>
+
+#include "gpk-common.h"
+
+G_BEGIN_DECLS
+
+#define GPK_TYPE_PACKAGE_MODEL (gpk_package_model_get_type ())
+G_DECLARE_FINAL_TYPE (GpkPackageModel, gpk_package_model, GPK, PACKAGE_MODEL, GObject)
+
+typedef enum {
+	GPK_PACKAGE_STATE_INSTALLED,
+	GPK_PACKAGE_STATE_IN_LIST,
+	GPK_PACKAGE_STATE_COLLECTION,
+	GPK_PACKAGE_STATE_UNKNOWN
+} GpkPackageState;
+
+/* where a search found the package */
+typedef enum {
+	GPK_PACKAGE_MATCH_NAME,
+	GPK_PACKAGE_MATCH_DETAILS,
+	GPK_PACKAGE_MATCH_FILE,
+	GPK_PACKAGE_MATCH_LAST
+} GpkPackageMatch;
+
+typedef enum {
+	GPK_PACKAGE_MODEL_COLUMN_IMAGE,
+	GPK_PACKAGE_MODEL_COLUMN_STATE,			/* state of the item */
+	GPK_PACKAGE_MODEL_COLUMN_CHECKBOX,		/* what we show in the checkbox */
+	GPK_PACKAGE_MODEL_COLUMN_CHECKBOX_VISIBLE,	/* visible */
+	GPK_PACKAGE_MODEL_COLUMN_TEXT,
+	GPK_PACKAGE_MODEL_COLUMN_ID,
+	GPK_PACKAGE_MODEL_COLUMN_SUMMARY,
+	GPK_PACKAGE_MODEL_COLUMN_VERSION,
+	GPK_PACKAGE_MODEL_COLUMN_REPO,
+	GPK_PACKAGE_MODEL_COLUMN_SIZE,			/* formatted, if known */
+	GPK_PACKAGE_MODEL_COLUMN_SUGGESTION,		/* the search to run instead */
+	GPK_PACKAGE_MODEL_COLUMN_LAST
+} GpkPackageModelColumn;
+
+typedef gboolean (*GpkPackageModelFilterFunc)		(PkPackage		*package,
+							 gpointer		 user_data);
+
+GpkPackageModel	*gpk_package_model_new			(void);
+void		 gpk_package_model_set_style		(GpkPackageModel	*model,
+							 GtkStyleContext	*style);
+void		 gpk_package_model_set_sensitive	(GpkPackageModel	*model,
+							 gboolean		 installed,
+							 gboolean		 available);
+void		 gpk_package_model_clear		(GpkPackageModel	*model);
+void		 gpk_package_model_retain		(GpkPackageModel	*model,
+							 GpkPackageModelFilterFunc func,
+							 gpointer		 user_data);
+void		 gpk_package_model_add_package		(GpkPackageModel	*model,
+							 PkPackage		*package,
+							 PkBitfield		 state);
+void		 gpk_package_model_add_message		(GpkPackageModel	*model,
+							 const gchar		*icon_name,
+							 const gchar		*text);
+void		 gpk_package_model_add_suggestion	(GpkPackageModel	*model,
+							 const gchar		*icon_name,
+							 const gchar		*text,
+							 const gchar		*search);
+void		 gpk_package_model_set_facets		(GpkPackageModel	*model,
+							 PkBitfield		 facets);
+PkBitfield	 gpk_package_model_get_facets		(GpkPackageModel	*model);
+void		 gpk_package_model_set_native_arch	(GpkPackageModel	*model,
+							 const gchar		*arch);
+void		 gpk_package_model_get_facet_counts	(GpkPackageModel	*model,
+							 guint			*installed,
+							 guint			*available);
+guint		 gpk_package_model_get_size		(GpkPackageModel	*model);
+PkPackage	*gpk_package_model_get_package		(GpkPackageModel	*model,
+							 GtkTreeIter		*iter);
+PkBitfield	 gpk_package_model_get_state		(GpkPackageModel	*model,
+							 GtkTreeIter		*iter);
+void		 gpk_package_model_set_state		(GpkPackageModel	*model,
+							 GtkTreeIter		*iter,
+							 PkBitfield		 state);
+guint		 gpk_package_model_set_installed	(GpkPackageModel	*model,
+							 gchar			**package_ids,
+							 gboolean		 installed);
+void		 gpk_package_model_set_match		(GpkPackageModel	*model,
+							 const gchar		*package_id,
+							 PkBitfield		 match);
+void		 gpk_package_model_set_size		(GpkPackageModel	*model,
+							 const gchar		*package_id,
+							 guint64		 size);
+gboolean	 gpk_package_model_find_by_id		(GpkPackageModel	*model,
+							 const gchar		*package_id,
+							 GtkTreeIter		*iter);
+gboolean	 gpk_package_model_find_by_atom		(GpkPackageModel	*model,
+							 GpkPackageAtom		*atom,
+							 GtkTreeIter		*iter);
+gboolean	 gpk_package_model_find_by_name		(GpkPackageModel	*model,
+							 const gchar		*name,
+							 GtkTreeIter		*iter);
+gboolean	 gpk_package_model_find_exact_match	(GpkPackageModel	*model,
+							 GtkTreeIter		*iter);
+void		 gpk_package_model_set_search		(GpkPackageModel	*model,
+							 const gchar		*text);
+
+const gchar	*gpk_package_state_get_icon		(PkBitfield		 state);
+gboolean	 gpk_package_state_get_checkbox		(PkBitfield		 state);
+
+G_END_DECLS
+
+#endif /* __GPK_PACKAGE_MODEL_H */
@@ -0,0 +1,355 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <gio/gunixinputstream.h>
+#include <glib-unix.h>
+
+#include "gpk-mock-daemon.h"
+
+/* the fd the tools write their profile lines to */
+#define GPK_PERF_TEST_PROFILE_FD	3
+
+typedef struct {
+	const gchar		*tool;
+	guint			 packages;
+	gdouble			 first_row;	/* ms, or -1 */
+	gdouble			 complete;	/* ms, or -1 */
+	guint			 stalls;
+	gint64			 stall_max;	/* ms */
+	glong			 peak_rss;	/* kB */
+	gboolean		 timed_out;
+} GpkPerfResult;
+
+typedef struct {
+	GMainLoop		*loop;
+	GDataInputStream	*stream;
+	GCancellable		*cancellable;
+	GpkPerfResult		*result;
+	gboolean		 timed_out;
+} GpkPerfRun;
+
+static void
+gpk_perf_test_read_line_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GpkPerfRun *run = user_data;
+	GpkPerfResult *result = run->result;
+	gdouble *target = NULL;
+	g_autofree gchar *line = NULL;
+	g_auto(GStrv) split = NULL;
+	g_autoptr(GError) error = NULL;
+
+	line = g_data_input_stream_read_line_finish (run->stream, res, NULL, &error);
+	if (line == NULL) {
+		/* the tool exited, or we gave up on it */
+		if (error != NULL && !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("failed to read profile: %s", error->message);
+		g_main_loop_quit (run->loop);
+		return;
+	}
+
+	/* event ms stalls stall-max rss */
+	split = g_strsplit (line, " ", -1);
+	if (g_strv_length (split) != 5) {
+		g_warning ("invalid profile line: %s", line);
+	} else {
+		if (g_strcmp0 (split[0], "first-row") == 0)
+			target = &result->first_row;
+		else if (g_strcmp0 (split[0], "complete") == 0)
+			target = &result->complete;
+		if (target != NULL && *target < 0)
+			*target = g_ascii_strtod (split[1], NULL);
+		result->stalls = (guint) g_ascii_strtoull (split[2], NULL, 10);
+		result->stall_max = g_ascii_strtoll (split[3], NULL, 10);
+		result->peak_rss = (glong) g_ascii_strtoll (split[4], NULL, 10);
+	}
+
+	/* nothing more to wait for */
+	if (result->complete >= 0) {
+		g_main_loop_quit (run->loop);
+		return;
+	}
+	g_data_input_stream_read_line_async (run->stream, G_PRIORITY_DEFAULT,
+					     run->cancellable,
+					     gpk_perf_test_read_line_cb, run);
+}
+
+static gboolean
+gpk_perf_test_timeout_cb (gpointer user_data)
+{
+	GpkPerfRun *run = user_data;
+	run->timed_out = TRUE;
+	g_cancellable_cancel (run->cancellable);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gpk_perf_test_rmdir (const gchar *path)
+{
+	const gchar *name;
+	g_autoptr(GDir) dir = NULL;
+
+	dir = g_dir_open (path, 0, NULL);
+	if (dir != NULL) {
+		while ((name = g_dir_read_name (dir)) != NULL) {
+			g_autofree gchar *child = g_build_filename (path, name, NULL);
+			if (g_file_test (child, G_FILE_TEST_IS_DIR) &&
+			    !g_file_test (child, G_FILE_TEST_IS_SYMLINK))
+				gpk_perf_test_rmdir (child);
+			else
+				g_unlink (child);
+		}
+	}
+	g_rmdir (path);
+}
+
+static gboolean
+gpk_perf_test_run_tool (const gchar *address, const gchar *tool, const gchar *search,
+			guint timeout, GpkPerfResult *result, GError **error)
+{
+	GpkPerfRun run;
+	gboolean ret;
+	gint fds[2];
+	guint timeout_id;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *tmpdir = NULL;
+	g_autofree gchar *cache = NULL;
+	g_autofree gchar *config = NULL;
+	g_autoptr(GInputStream) pipe_stream = NULL;
+	g_autoptr(GPtrArray) argv = NULL;
+	g_autoptr(GSubprocess) subprocess = NULL;
+	g_autoptr(GSubprocessLauncher) launcher = NULL;
+
+	/* a clean cache each time, so nothing is loaded from disk */
+	tmpdir = g_dir_make_tmp ("gpk-perf-test-XXXXXX", error);
+	if (tmpdir == NULL)
+		return FALSE;
+	cache = g_build_filename (tmpdir, "cache", NULL);
+	config = g_build_filename (tmpdir, "config", NULL);
+
+	if (!g_unix_open_pipe (fds, FD_CLOEXEC, error)) {
+		gpk_perf_test_rmdir (tmpdir);
+		return FALSE;
+	}
+	launcher = g_subprocess_launcher_new (G_SUBPROCESS_FLAGS_NONE);
+	g_subprocess_launcher_setenv (launcher, "DBUS_SYSTEM_BUS_ADDRESS", address, TRUE);
+	g_subprocess_launcher_setenv (launcher, "DBUS_SESSION_BUS_ADDRESS", address, TRUE);
+	g_subprocess_launcher_setenv (launcher, "GSETTINGS_BACKEND", "memory", TRUE);
+	g_subprocess_launcher_setenv (launcher, "XDG_CACHE_HOME", cache, TRUE);
+	g_subprocess_launcher_setenv (launcher, "XDG_CONFIG_HOME", config, TRUE);
+	g_subprocess_launcher_setenv (launcher, "GPK_PROFILE_FD",
+				      G_STRINGIFY (GPK_PERF_TEST_PROFILE_FD), TRUE);
+	g_subprocess_launcher_take_fd (launcher, fds[1], GPK_PERF_TEST_PROFILE_FD);
+	filename = g_build_filename (GPK_PERF_TEST_BUILDDIR, tool, NULL);
+	argv = g_ptr_array_new_with_free_func (g_free);
+	g_ptr_array_add (argv, g_strdup (filename));
+	/* the tools refuse to start as root without a reply to the warning,
+	 * so ask them not to show it when we are being run that way */
+	if (getuid () == 0 && g_strcmp0 (tool, "gpk-prefs") != 0)
+		g_ptr_array_add (argv, g_strdup ("--allow-privileged"));
+	/* the installer has no results until it is asked for some */
+	if (search != NULL && g_strcmp0 (tool, "gpk-application") == 0)
+		g_ptr_array_add (argv, g_strdup_printf ("--search=%s", search));
+	g_ptr_array_add (argv, NULL);
+	subprocess = g_subprocess_launcher_spawnv (launcher, (const gchar * const *) argv->pdata, error);
+	g_clear_object (&launcher);
+	if (subprocess == NULL) {
+		close (fds[0]);
+		gpk_perf_test_rmdir (tmpdir);
+		return FALSE;
+	}
+
+	/* wait for the tool to say it is done, serving the daemon meanwhile */
+	pipe_stream = g_unix_input_stream_new (fds[0], TRUE);
+	run.loop = g_main_loop_new (NULL, FALSE);
+	run.stream = g_data_input_stream_new (pipe_stream);
+	run.cancellable = g_cancellable_new ();
+	run.result = result;
+	run.timed_out = FALSE;
+	timeout_id = g_timeout_add_seconds (timeout, gpk_perf_test_timeout_cb, &run);
+	g_data_input_stream_read_line_async (run.stream, G_PRIORITY_DEFAULT,
+					     run.cancellable,
+					     gpk_perf_test_read_line_cb, &run);
+	g_main_loop_run (run.loop);
+	if (!run.timed_out)
+		g_source_remove (timeout_id);
+	result->timed_out = run.timed_out;
+
+	/* the tools run until closed */
+	g_subprocess_send_signal (subprocess, SIGTERM);
+	ret = g_subprocess_wait (subprocess, NULL, error);
+	gpk_perf_test_rmdir (tmpdir);
+
+	g_main_loop_unref (run.loop);
+	g_object_unref (run.stream);
+	g_object_unref (run.cancellable);
+	return ret;
+}
+
+static void
+gpk_perf_test_report_append (GString *report, GpkPerfResult *result)
+{
+	g_string_append_printf (report,
+				"    {\n"
+				"      \"tool\": \"%s\",\n"
+				"      \"packages\": %u,\n"
+				"      \"time_to_first_row_ms\": %.1f,\n"
+				"      \"time_to_complete_ms\": %.1f,\n"
+				"      \"peak_rss_kb\": %ld,\n"
+				"      \"main_loop_stalls\": %u,\n"
+				"      \"main_loop_stall_max_ms\": %" G_GINT64_FORMAT ",\n"
+				"      \"timed_out\": %s\n"
+				"    }",
+				result->tool, result->packages,
+				result->first_row, result->complete,
+				result->peak_rss, result->stalls,
+				result->stall_max,
+				result->timed_out ? "true" : "false");
+}
+
+int
+main (int argc, char *argv[])
+{
+	GOptionContext *context;
+	guint i;
+	guint j;
+	guint history = 5000;
+	guint timeout = 120;
+	guint updates = 500;
+	gboolean first = TRUE;
+	gboolean ret = TRUE;
+	const gchar *tools_default[] = { "gpk-application", "gpk-update-viewer",
+					 "gpk-log", "gpk-prefs", NULL };
+	g_autofree gchar *output = NULL;
+	g_autofree gchar *search = NULL;
+	g_autofree gchar *sizes = NULL;
+	g_auto(GStrv) sizes_split = NULL;
+	g_auto(GStrv) tools = NULL;
+	g_autoptr(GDBusConnection) connection = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GpkMockDaemon) daemon = NULL;
+	g_autoptr(GString) report = NULL;
+	g_autoptr(GTestDBus) bus = NULL;
+
+	const GOptionEntry options[] = {
+		{ "packages", '\0', 0, G_OPTION_ARG_STRING, &sizes,
+		  "Catalog sizes to test, comma separated", NULL },
+		{ "history", '\0', 0, G_OPTION_ARG_INT, &history,
+		  "Number of old transactions", NULL },
+		{ "updates", '\0', 0, G_OPTION_ARG_INT, &updates,
+		  "Number of updates", NULL },
+		{ "timeout", '\0', 0, G_OPTION_ARG_INT, &timeout,
+		  "Seconds to wait for each tool", NULL },
+		{ "search", '\0', 0, G_OPTION_ARG_STRING, &search,
+		  "Text the installer searches for, 'gnome' by default", NULL },
+		{ "output", 'o', 0, G_OPTION_ARG_FILENAME, &output,
+		  "Write the report to a file rather than stdout", NULL },
+		{ G_OPTION_REMAINING, '\0', 0, G_OPTION_ARG_STRING_ARRAY, &tools,
+		  "Tools to run", NULL },
+		{ NULL}
+	};
+
+	context = g_option_context_new (NULL);
+	g_option_context_set_summary (context, "Profile the tools against a mock daemon");
+	g_option_context_add_main_entries (context, options, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_option_context_free (context);
+		return 1;
+	}
+	g_option_context_free (context);
+
+	/* the tools need a display */
+	if (g_getenv ("DISPLAY") == NULL && g_getenv ("WAYLAND_DISPLAY") == NULL) {
+		g_print ("no display, skipping\n");
+		return 77;
+	}
+
+	/* the tools talk to the private bus for both session and system */
+	bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+	g_test_dbus_up (bus);
+	connection = g_dbus_connection_new_for_address_sync (g_test_dbus_get_bus_address (bus),
+							     G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+							     G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+							     NULL, NULL, &error);
+	if (connection == NULL) {
+		g_printerr ("failed to connect to the test bus: %s\n", error->message);
+		g_test_dbus_down (bus);
+		return 1;
+	}
+	daemon = gpk_mock_daemon_new ();
+	if (!gpk_mock_daemon_start (daemon, connection, &error)) {
+		g_printerr ("failed to start mock daemon: %s\n", error->message);
+		g_test_dbus_down (bus);
+		return 1;
+	}
+
+	sizes_split = g_strsplit (sizes != NULL ? sizes : "1000", ",", -1);
+	report = g_string_new ("{\n  \"results\": [\n");
+	for (i = 0; sizes_split[i] != NULL; i++) {
+		guint packages = (guint) g_ascii_strtoull (sizes_split[i], NULL, 10);
+		gpk_mock_daemon_set_size (daemon, packages, history, updates);
+		for (j = 0; (tools != NULL ? tools[j] : tools_default[j]) != NULL; j++) {
+			GpkPerfResult result = { NULL, packages, -1, -1, 0, 0, 0, FALSE };
+			g_autoptr(GError) error_local = NULL;
+
+			result.tool = tools != NULL ? tools[j] : tools_default[j];
+			if (!gpk_perf_test_run_tool (g_test_dbus_get_bus_address (bus),
+						     result.tool,
+						     search != NULL ? search : "gnome",
+						     timeout, &result, &error_local)) {
+				g_printerr ("failed to run %s: %s\n", result.tool, error_local->message);
+				ret = FALSE;
+				continue;
+			}
+			if (result.timed_out) {
+				g_printerr ("%s did not finish with %u packages\n", result.tool, packages);
+				ret = FALSE;
+			}
+			if (!first)
+				g_string_append (report, ",\n");
+			first = FALSE;
+			gpk_perf_test_report_append (report, &result);
+		}
+	}
+	g_string_append (report, "\n  ]\n}\n");
+
+	if (output != NULL) {
+		if (!g_file_set_contents (output, report->str, -1, &error)) {
+			g_printerr ("failed to write report: %s\n", error->message);
+			ret = FALSE;
+		}
+	} else {
+		g_print ("%s", report->str);
+	}
+
+	g_clear_object (&daemon);
+	g_clear_object (&connection);
+	g_test_dbus_down (bus);
+	return ret ? 0 : 1;
+}
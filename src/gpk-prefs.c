@@ -347,6 +347,8 @@ gpk_prefs_get_repo_list_cb (GObject *object, GAsyncResult *res, GpkPrefsPrivate
 				    GPK_COLUMN_ACTIVE, TRUE,
 				    GPK_COLUMN_SENSITIVE, TRUE,
 				    -1);
+		if (i == 0)
+			gpk_profile_mark ("first-row");
 	}
 
 	/* remove the items that are not now present */
@@ -354,6 +356,7 @@ gpk_prefs_get_repo_list_cb (GObject *object, GAsyncResult *res, GpkPrefsPrivate
 
 	/* sort */
 	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE(priv->list_store), GPK_COLUMN_TEXT, GTK_SORT_ASCENDING);
+	gpk_profile_mark ("complete");
 }
 
 static void
@@ -552,6 +555,7 @@ main (int argc, char *argv[])
 	textdomain (GETTEXT_PACKAGE);
 
 	gtk_init (&argc, &argv);
+	gpk_profile_init ();
 
 	priv = g_new0 (GpkPrefsPrivate, 1);
 	priv->cancellable = g_cancellable_new ();
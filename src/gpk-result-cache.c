@@ -0,0 +1,236 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <packagekit-glib2/packagekit.h>
+
+#include "gpk-result-cache.h"
+
+/* a rough guess at what a PkPackage costs on top of its strings */
+#define GPK_RESULT_CACHE_PACKAGE_OVERHEAD	192 /* bytes */
+
+typedef struct {
+	gchar			*key;
+	GPtrArray		*packages;	/* of PkPackage */
+	gsize			 size;
+	GList			 link;		/* in GpkResultCache->lru */
+} GpkResultCacheItem;
+
+struct _GpkResultCache
+{
+	GObject			 parent_instance;
+	GHashTable		*items;		/* key:GpkResultCacheItem */
+	GQueue			 lru;		/* most recently used first */
+	gsize			 size;
+	gsize			 max_size;
+};
+
+G_DEFINE_TYPE (GpkResultCache, gpk_result_cache, G_TYPE_OBJECT)
+
+static void
+gpk_result_cache_item_free (GpkResultCacheItem *item)
+{
+	g_free (item->key);
+	g_ptr_array_unref (item->packages);
+	g_free (item);
+}
+
+static gsize
+gpk_result_cache_estimate_size (const gchar *key, GPtrArray *packages)
+{
+	PkPackage *package;
+	const gchar *summary;
+	gsize size;
+	guint i;
+
+	size = sizeof (GpkResultCacheItem) + strlen (key) + 1;
+	for (i = 0; i < packages->len; i++) {
+		package = g_ptr_array_index (packages, i);
+		size += GPK_RESULT_CACHE_PACKAGE_OVERHEAD;
+		size += strlen (pk_package_get_id (package)) + 1;
+		summary = pk_package_get_summary (package);
+		if (summary != NULL)
+			size += strlen (summary) + 1;
+	}
+	return size;
+}
+
+static void
+gpk_result_cache_remove_item (GpkResultCache *cache, GpkResultCacheItem *item)
+{
+	g_queue_unlink (&cache->lru, &item->link);
+	cache->size -= item->size;
+	g_hash_table_remove (cache->items, item->key);
+}
+
+static void
+gpk_result_cache_evict (GpkResultCache *cache)
+{
+	GpkResultCacheItem *item;
+
+	/* drop the least recently used until we fit */
+	while (cache->size > cache->max_size && cache->lru.tail != NULL) {
+		item = cache->lru.tail->data;
+		g_debug ("evicting %s from the result cache", item->key);
+		gpk_result_cache_remove_item (cache, item);
+	}
+}
+
+/**
+ * gpk_result_cache_set_max_size:
+ * @cache: a #GpkResultCache
+ * @max_size: the memory budget in bytes, or 0 to disable the cache
+ *
+ * Sets the memory budget, evicting old results if required.
+ **/
+void
+gpk_result_cache_set_max_size (GpkResultCache *cache, gsize max_size)
+{
+	g_return_if_fail (GPK_IS_RESULT_CACHE (cache));
+	cache->max_size = max_size;
+	gpk_result_cache_evict (cache);
+}
+
+gsize
+gpk_result_cache_get_size (GpkResultCache *cache)
+{
+	g_return_val_if_fail (GPK_IS_RESULT_CACHE (cache), 0);
+	return cache->size;
+}
+
+/**
+ * gpk_result_cache_lookup:
+ * @cache: a #GpkResultCache
+ * @key: the key the results were inserted with
+ *
+ * Return value: (transfer container): an array of #PkPackage, or %NULL
+ **/
+GPtrArray *
+gpk_result_cache_lookup (GpkResultCache *cache, const gchar *key)
+{
+	GpkResultCacheItem *item;
+
+	g_return_val_if_fail (GPK_IS_RESULT_CACHE (cache), NULL);
+	g_return_val_if_fail (key != NULL, NULL);
+
+	item = g_hash_table_lookup (cache->items, key);
+	if (item == NULL)
+		return NULL;
+
+	/* now the most recently used */
+	g_queue_unlink (&cache->lru, &item->link);
+	g_queue_push_head_link (&cache->lru, &item->link);
+	return g_ptr_array_ref (item->packages);
+}
+
+/**
+ * gpk_result_cache_insert:
+ * @cache: a #GpkResultCache
+ * @key: a key that describes the search
+ * @packages: an array of #PkPackage
+ *
+ * Adds the results of a search, replacing any with the same key. Results
+ * larger than the whole memory budget are not added.
+ **/
+void
+gpk_result_cache_insert (GpkResultCache *cache, const gchar *key, GPtrArray *packages)
+{
+	GpkResultCacheItem *item;
+	gsize size;
+
+	g_return_if_fail (GPK_IS_RESULT_CACHE (cache));
+	g_return_if_fail (key != NULL);
+	g_return_if_fail (packages != NULL);
+
+	item = g_hash_table_lookup (cache->items, key);
+	if (item != NULL)
+		gpk_result_cache_remove_item (cache, item);
+
+	/* would evict everything else and still not fit */
+	size = gpk_result_cache_estimate_size (key, packages);
+	if (size > cache->max_size) {
+		g_debug ("not caching %s as %" G_GSIZE_FORMAT " bytes", key, size);
+		return;
+	}
+
+	item = g_new0 (GpkResultCacheItem, 1);
+	item->key = g_strdup (key);
+	item->packages = g_ptr_array_ref (packages);
+	item->size = size;
+	item->link.data = item;
+	g_hash_table_insert (cache->items, item->key, item);
+	g_queue_push_head_link (&cache->lru, &item->link);
+	cache->size += size;
+	gpk_result_cache_evict (cache);
+}
+
+/**
+ * gpk_result_cache_invalidate:
+ * @cache: a #GpkResultCache
+ *
+ * Removes all the results, for instance when packages have been
+ * installed or the repositories have changed.
+ **/
+void
+gpk_result_cache_invalidate (GpkResultCache *cache)
+{
+	g_return_if_fail (GPK_IS_RESULT_CACHE (cache));
+	g_queue_init (&cache->lru);
+	g_hash_table_remove_all (cache->items);
+	cache->size = 0;
+}
+
+static void
+gpk_result_cache_finalize (GObject *object)
+{
+	GpkResultCache *cache = GPK_RESULT_CACHE (object);
+
+	g_hash_table_unref (cache->items);
+
+	G_OBJECT_CLASS (gpk_result_cache_parent_class)->finalize (object);
+}
+
+static void
+gpk_result_cache_class_init (GpkResultCacheClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gpk_result_cache_finalize;
+}
+
+static void
+gpk_result_cache_init (GpkResultCache *cache)
+{
+	cache->items = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+					      (GDestroyNotify) gpk_result_cache_item_free);
+	g_queue_init (&cache->lru);
+}
+
+GpkResultCache *
+gpk_result_cache_new (gsize max_size)
+{
+	GpkResultCache *cache;
+	cache = g_object_new (GPK_TYPE_RESULT_CACHE, NULL);
+	cache->max_size = max_size;
+	return cache;
+}
@@ -0,0 +1,45 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __GPK_RESULT_CACHE_H
+#define __GPK_RESULT_CACHE_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GPK_TYPE_RESULT_CACHE (gpk_result_cache_get_type ())
+G_DECLARE_FINAL_TYPE (GpkResultCache, gpk_result_cache, GPK, RESULT_CACHE, GObject)
+
+GpkResultCache	*gpk_result_cache_new			(gsize			 max_size);
+void		 gpk_result_cache_set_max_size		(GpkResultCache		*cache,
+							 gsize			 max_size);
+gsize		 gpk_result_cache_get_size		(GpkResultCache		*cache);
+GPtrArray	*gpk_result_cache_lookup		(GpkResultCache		*cache,
+							 const gchar		*key);
+void		 gpk_result_cache_insert		(GpkResultCache		*cache,
+							 const gchar		*key,
+							 GPtrArray		*packages);
+void		 gpk_result_cache_invalidate		(GpkResultCache		*cache);
+
+G_END_DECLS
+
+#endif /* __GPK_RESULT_CACHE_H */
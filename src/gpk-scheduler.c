@@ -0,0 +1,326 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "gpk-scheduler.h"
+
+typedef struct {
+	GpkScheduler		*scheduler;
+	GpkSchedulerKind	 kind;
+	GCancellable		*cancellable;
+	GpkSchedulerFunc	 func;
+	GAsyncReadyCallback	 callback;
+	gpointer		 user_data;
+	GDestroyNotify		 destroy;
+} GpkSchedulerRequest;
+
+struct _GpkScheduler
+{
+	GObject			 parent_instance;
+	GQueue			 queue;		/* of GpkSchedulerRequest, by kind */
+	GPtrArray		*running;	/* of GpkSchedulerRequest */
+	guint			 max_running;
+};
+
+G_DEFINE_TYPE (GpkScheduler, gpk_scheduler, G_TYPE_OBJECT)
+
+static gboolean
+gpk_scheduler_kind_is_background (GpkSchedulerKind kind)
+{
+	return kind >= GPK_SCHEDULER_KIND_PREFETCH;
+}
+
+static gboolean
+gpk_scheduler_kind_is_replaced (GpkSchedulerKind kind)
+{
+	return kind < GPK_SCHEDULER_KIND_GRAPH;
+}
+
+static void
+gpk_scheduler_request_free (GpkSchedulerRequest *request)
+{
+	g_object_unref (request->cancellable);
+	g_free (request);
+}
+
+static void
+gpk_scheduler_request_drop (GpkSchedulerRequest *request)
+{
+	/* never started, so the callback is never going to free this */
+	if (request->destroy != NULL)
+		request->destroy (request->user_data);
+	gpk_scheduler_request_free (request);
+}
+
+static void gpk_scheduler_run (GpkScheduler *scheduler);
+
+static void
+gpk_scheduler_ready_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GpkSchedulerRequest *request = user_data;
+	g_autoptr(GpkScheduler) scheduler = request->scheduler;
+
+	/* the slot is free, even if the request was replaced */
+	g_ptr_array_remove (scheduler->running, request);
+	request->callback (source, res, request->user_data);
+	gpk_scheduler_request_free (request);
+	gpk_scheduler_run (scheduler);
+}
+
+/* the parts of a search do not wait for background requests */
+static guint
+gpk_scheduler_get_running_for (GpkScheduler *scheduler, GpkSchedulerKind kind)
+{
+	GpkSchedulerRequest *request;
+	guint i;
+	guint running = 0;
+
+	if (kind != GPK_SCHEDULER_KIND_SEARCH)
+		return scheduler->running->len;
+	for (i = 0; i < scheduler->running->len; i++) {
+		request = g_ptr_array_index (scheduler->running, i);
+		if (!gpk_scheduler_kind_is_background (request->kind))
+			running++;
+	}
+	return running;
+}
+
+static void
+gpk_scheduler_run (GpkScheduler *scheduler)
+{
+	GpkSchedulerRequest *request;
+
+	while (scheduler->queue.head != NULL) {
+		request = scheduler->queue.head->data;
+		if (gpk_scheduler_get_running_for (scheduler, request->kind) >= scheduler->max_running)
+			return;
+
+		/* always leave a slot for what the user is waiting for */
+		if (gpk_scheduler_kind_is_background (request->kind) &&
+		    scheduler->running->len + 1 >= scheduler->max_running &&
+		    scheduler->max_running > 1)
+			return;
+
+		/* running requests keep the scheduler alive until the callback */
+		g_queue_pop_head (&scheduler->queue);
+		g_ptr_array_add (scheduler->running, request);
+		g_object_ref (scheduler);
+		request->func (request->cancellable,
+			       gpk_scheduler_ready_cb, request,
+			       request->user_data);
+	}
+}
+
+/**
+ * gpk_scheduler_push:
+ * @scheduler: a #GpkScheduler
+ * @kind: a #GpkSchedulerKind
+ * @func: called with a cancellable and a callback to start the request
+ * @callback: called when the request has finished
+ * @user_data: data for @func and @callback
+ * @destroy: frees @user_data if the request is dropped before it starts
+ *
+ * Adds a request, starting it now if there is a free slot. Searches can
+ * also use the slots taken by background requests, so these never hold
+ * up what the user is waiting for. @func must start exactly one async
+ * operation that finishes with the callback it is given. Any older request of the same kind is cancelled, unless
+ * @kind is a background kind or %GPK_SCHEDULER_KIND_GRAPH.
+ *
+ * Return value: (transfer none): the cancellable for the request
+ **/
+GCancellable *
+gpk_scheduler_push (GpkScheduler *scheduler,
+		    GpkSchedulerKind kind,
+		    GpkSchedulerFunc func,
+		    GAsyncReadyCallback callback,
+		    gpointer user_data,
+		    GDestroyNotify destroy)
+{
+	return gpk_scheduler_push_full (scheduler, kind, GPK_SCHEDULER_FLAG_NONE,
+					func, callback, user_data, destroy);
+}
+
+/**
+ * gpk_scheduler_push_full:
+ * @scheduler: a #GpkScheduler
+ * @kind: a #GpkSchedulerKind
+ * @flags: #GpkSchedulerFlags
+ * @func: called with a cancellable and a callback to start the request
+ * @callback: called when the request has finished
+ * @user_data: data for @func and @callback
+ * @destroy: frees @user_data if the request is dropped before it starts
+ *
+ * Like gpk_scheduler_push(), but with %GPK_SCHEDULER_FLAG_KEEP the older
+ * requests of the same kind are left alone, so one request can be made of
+ * several transactions that run at the same time.
+ *
+ * Return value: (transfer none): the cancellable for the request
+ **/
+GCancellable *
+gpk_scheduler_push_full (GpkScheduler *scheduler,
+			 GpkSchedulerKind kind,
+			 GpkSchedulerFlags flags,
+			 GpkSchedulerFunc func,
+			 GAsyncReadyCallback callback,
+			 gpointer user_data,
+			 GDestroyNotify destroy)
+{
+	GpkSchedulerRequest *request;
+	GpkSchedulerRequest *tmp;
+	GCancellable *cancellable;
+	GList *l;
+
+	g_return_val_if_fail (GPK_IS_SCHEDULER (scheduler), NULL);
+	g_return_val_if_fail (kind < GPK_SCHEDULER_KIND_LAST, NULL);
+	g_return_val_if_fail (func != NULL, NULL);
+	g_return_val_if_fail (callback != NULL, NULL);
+
+	/* the latest one wins */
+	if (gpk_scheduler_kind_is_replaced (kind) &&
+	    (flags & GPK_SCHEDULER_FLAG_KEEP) == 0)
+		gpk_scheduler_cancel (scheduler, kind);
+
+	request = g_new0 (GpkSchedulerRequest, 1);
+	request->scheduler = scheduler;
+	request->kind = kind;
+	request->cancellable = g_cancellable_new ();
+	request->func = func;
+	request->callback = callback;
+	request->user_data = user_data;
+	request->destroy = destroy;
+	cancellable = request->cancellable;
+
+	/* after everything at the same or a higher priority */
+	for (l = scheduler->queue.tail; l != NULL; l = l->prev) {
+		tmp = l->data;
+		if (tmp->kind <= kind)
+			break;
+	}
+	if (l != NULL)
+		g_queue_insert_after (&scheduler->queue, l, request);
+	else
+		g_queue_push_head (&scheduler->queue, request);
+
+	gpk_scheduler_run (scheduler);
+	return cancellable;
+}
+
+/**
+ * gpk_scheduler_cancel:
+ * @scheduler: a #GpkScheduler
+ * @kind: a #GpkSchedulerKind
+ *
+ * Cancels the running requests of this kind, and drops the queued ones.
+ * Running requests still finish with their callback.
+ **/
+void
+gpk_scheduler_cancel (GpkScheduler *scheduler, GpkSchedulerKind kind)
+{
+	GpkSchedulerRequest *request;
+	GList *l;
+	GList *next;
+	guint i;
+
+	g_return_if_fail (GPK_IS_SCHEDULER (scheduler));
+
+	for (i = 0; i < scheduler->running->len; i++) {
+		request = g_ptr_array_index (scheduler->running, i);
+		if (request->kind == kind)
+			g_cancellable_cancel (request->cancellable);
+	}
+	for (l = scheduler->queue.head; l != NULL; l = next) {
+		next = l->next;
+		request = l->data;
+		if (request->kind != kind)
+			continue;
+		g_queue_delete_link (&scheduler->queue, l);
+		gpk_scheduler_request_drop (request);
+	}
+}
+
+/**
+ * gpk_scheduler_cancel_all:
+ * @scheduler: a #GpkScheduler
+ *
+ * Cancels every request, for instance when quitting.
+ **/
+void
+gpk_scheduler_cancel_all (GpkScheduler *scheduler)
+{
+	guint i;
+
+	g_return_if_fail (GPK_IS_SCHEDULER (scheduler));
+	for (i = 0; i < GPK_SCHEDULER_KIND_LAST; i++)
+		gpk_scheduler_cancel (scheduler, i);
+}
+
+guint
+gpk_scheduler_get_running (GpkScheduler *scheduler)
+{
+	g_return_val_if_fail (GPK_IS_SCHEDULER (scheduler), 0);
+	return scheduler->running->len;
+}
+
+guint
+gpk_scheduler_get_queued (GpkScheduler *scheduler)
+{
+	g_return_val_if_fail (GPK_IS_SCHEDULER (scheduler), 0);
+	return scheduler->queue.length;
+}
+
+static void
+gpk_scheduler_finalize (GObject *object)
+{
+	GpkScheduler *scheduler = GPK_SCHEDULER (object);
+
+	/* running requests hold a reference, so only queued ones are left */
+	g_queue_foreach (&scheduler->queue, (GFunc) gpk_scheduler_request_drop, NULL);
+	g_queue_clear (&scheduler->queue);
+	g_ptr_array_unref (scheduler->running);
+
+	G_OBJECT_CLASS (gpk_scheduler_parent_class)->finalize (object);
+}
+
+static void
+gpk_scheduler_class_init (GpkSchedulerClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gpk_scheduler_finalize;
+}
+
+static void
+gpk_scheduler_init (GpkScheduler *scheduler)
+{
+	g_queue_init (&scheduler->queue);
+	scheduler->running = g_ptr_array_new ();
+}
+
+GpkScheduler *
+gpk_scheduler_new (guint max_running)
+{
+	GpkScheduler *scheduler;
+	scheduler = g_object_new (GPK_TYPE_SCHEDULER, NULL);
+	scheduler->max_running = MAX (max_running, 1);
+	return scheduler;
+}
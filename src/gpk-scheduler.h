@@ -0,0 +1,78 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __GPK_SCHEDULER_H
+#define __GPK_SCHEDULER_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define GPK_TYPE_SCHEDULER (gpk_scheduler_get_type ())
+G_DECLARE_FINAL_TYPE (GpkScheduler, gpk_scheduler, GPK, SCHEDULER, GObject)
+
+/* in order of priority, a newer request replaces an older one of the same
+ * kind unless it is a background kind or a graph query */
+typedef enum {
+	GPK_SCHEDULER_KIND_SEARCH,
+	GPK_SCHEDULER_KIND_DETAILS,
+	GPK_SCHEDULER_KIND_FILES,
+	GPK_SCHEDULER_KIND_DEPENDS,
+	GPK_SCHEDULER_KIND_REQUIRES,
+	GPK_SCHEDULER_KIND_GRAPH,		/* never replaced */
+	GPK_SCHEDULER_KIND_PREFETCH,		/* background */
+	GPK_SCHEDULER_KIND_INDEX,		/* background */
+	GPK_SCHEDULER_KIND_LAST
+} GpkSchedulerKind;
+
+typedef enum {
+	GPK_SCHEDULER_FLAG_NONE		= 0,
+	GPK_SCHEDULER_FLAG_KEEP		= 1 << 0,	/* do not replace older requests */
+} GpkSchedulerFlags;
+
+typedef void	(*GpkSchedulerFunc)			(GCancellable		*cancellable,
+							 GAsyncReadyCallback	 callback,
+							 gpointer		 callback_data,
+							 gpointer		 user_data);
+
+GpkScheduler	*gpk_scheduler_new			(guint			 max_running);
+GCancellable	*gpk_scheduler_push			(GpkScheduler		*scheduler,
+							 GpkSchedulerKind	 kind,
+							 GpkSchedulerFunc	 func,
+							 GAsyncReadyCallback	 callback,
+							 gpointer		 user_data,
+							 GDestroyNotify		 destroy);
+GCancellable	*gpk_scheduler_push_full		(GpkScheduler		*scheduler,
+							 GpkSchedulerKind	 kind,
+							 GpkSchedulerFlags	 flags,
+							 GpkSchedulerFunc	 func,
+							 GAsyncReadyCallback	 callback,
+							 gpointer		 user_data,
+							 GDestroyNotify		 destroy);
+void		 gpk_scheduler_cancel			(GpkScheduler		*scheduler,
+							 GpkSchedulerKind	 kind);
+void		 gpk_scheduler_cancel_all		(GpkScheduler		*scheduler);
+guint		 gpk_scheduler_get_running		(GpkScheduler		*scheduler);
+guint		 gpk_scheduler_get_queued		(GpkScheduler		*scheduler);
+
+G_END_DECLS
+
+#endif /* __GPK_SCHEDULER_H */
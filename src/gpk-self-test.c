@@ -19,13 +19,24 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <string.h>
 #include <glib.h>
 #include <glib-object.h>
+#include <glib/gstdio.h>
 
+#include "gpk-catalog.h"
+#include "gpk-category-tree.h"
 #include "gpk-common.h"
+#include "gpk-dependency-graph.h"
 #include "gpk-enum.h"
 #include "gpk-error.h"
+#include "gpk-file-model.h"
+#include "gpk-name-index.h"
+#include "gpk-package-model.h"
+#include "gpk-result-cache.h"
+#include "gpk-scheduler.h"
 #include "gpk-task.h"
+#include "gpk-trigram-index.h"
 
 static void
 gpk_test_enum_func (void)
@@ -169,6 +180,1196 @@ gpk_test_common_func (void)
 	g_free (text);
 }
 
+static void
+gpk_test_package_formatter_func (void)
+{
+	const gchar *summaries[] = { NULL, "", "dude", "a <b> & 'c' \"d\"", "\x01tab\tthing\xc2\x85", NULL };
+	const gchar *ids[] = { "simon;0.0.1;i386;data", "simon;0.0.1;x86_64;data",
+			       "simon;;;data", "simon;0.0.1;noarch;data", NULL };
+	guint i;
+	guint j;
+	g_autoptr(GArray) offsets = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(GString) string = NULL;
+	g_autoptr(GpkPackageFormatter) formatter = NULL;
+
+	/* the same as the one-off function, and the same escaping as GLib */
+	formatter = gpk_package_formatter_new (NULL);
+	string = g_string_new (NULL);
+	for (i = 0; ids[i] != NULL; i++) {
+		for (j = 0; j < G_N_ELEMENTS (summaries); j++) {
+			g_autofree gchar *text = NULL;
+			text = gpk_package_id_format_twoline (NULL, ids[i], summaries[j]);
+			g_string_truncate (string, 0);
+			g_assert (gpk_package_formatter_append (formatter, string, ids[i], summaries[j]));
+			g_assert_cmpstr (string->str, ==, text);
+		}
+	}
+	g_string_truncate (string, 0);
+	g_assert (gpk_package_formatter_append (formatter, string, "simon;1;;data", "a<b"));
+	g_assert_cmpstr (string->str, ==, "a&lt;b\n<span color=\"gray\">simon-1</span>");
+	g_string_truncate (string, 0);
+	g_assert (gpk_package_formatter_append (formatter, string, "simon;1;;data", "\x01\xc2\x85"));
+	g_assert_cmpstr (string->str, ==, "&#x1;&#x85;\n<span color=\"gray\">simon-1</span>");
+
+	/* invalid IDs leave the buffer alone */
+	g_string_assign (string, "keep");
+	g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "*could not parse*");
+	g_assert (!gpk_package_formatter_append (formatter, string, "simon;0.0.1;i386", NULL));
+	g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "*could not parse*");
+	g_assert (!gpk_package_formatter_append (formatter, string, ";0.0.1;i386;data", NULL));
+	g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "*could not parse*");
+	g_assert (!gpk_package_formatter_append (formatter, string, "a;b;c;d;e", NULL));
+	g_test_assert_expected_messages ();
+	g_assert_cmpstr (string->str, ==, "keep");
+
+	/* many at once */
+	packages = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (i = 0; ids[i] != NULL; i++) {
+		PkPackage *package = pk_package_new ();
+		g_assert (pk_package_set_id (package, ids[i], NULL));
+		g_object_set (package, "summary", "dude", NULL);
+		g_ptr_array_add (packages, package);
+	}
+	g_string_truncate (string, 0);
+	offsets = g_array_new (FALSE, FALSE, sizeof (gsize));
+	gpk_package_formatter_append_packages (formatter, packages, string, offsets);
+	g_assert_cmpint (offsets->len, ==, packages->len);
+	for (i = 0; ids[i] != NULL; i++) {
+		g_autofree gchar *text = NULL;
+		text = gpk_package_id_format_twoline (NULL, ids[i], "dude");
+		g_assert_cmpstr (string->str + g_array_index (offsets, gsize, i), ==, text);
+	}
+}
+
+static void
+gpk_test_package_atom_func (void)
+{
+	GpkPackageAtom *atom1;
+	GpkPackageAtom *atom2;
+	GpkPackageAtom *atom3;
+	guint count;
+	g_autofree gchar *package_id = NULL;
+	g_autoptr(GtkListStore) store = NULL;
+	GtkTreeIter iter;
+
+	/* the same ID is the same atom */
+	count = gpk_package_atom_get_count ();
+	g_assert (gpk_package_atom_lookup ("simon;0.0.1;i386;data") == NULL);
+	atom1 = gpk_package_atom_intern ("simon;0.0.1;i386;data");
+	package_id = g_strdup ("simon;0.0.1;i386;data");
+	atom2 = gpk_package_atom_intern (package_id);
+	g_assert (atom1 != NULL);
+	g_assert (atom1 == atom2);
+	g_assert (gpk_package_atom_lookup (package_id) == atom1);
+	g_assert_cmpint (gpk_package_atom_get_count (), ==, count + 1);
+	g_assert_cmpstr (gpk_package_atom_get_id (atom1), ==, "simon;0.0.1;i386;data");
+	g_assert_cmpstr (gpk_package_atom_get_name (atom1), ==, "simon");
+	g_assert_cmpstr (gpk_package_atom_get_version (atom1), ==, "0.0.1");
+	g_assert_cmpstr (gpk_package_atom_get_arch (atom1), ==, "i386");
+	g_assert_cmpstr (gpk_package_atom_get_data (atom1), ==, "data");
+
+	/* different ID, empty sections */
+	atom3 = gpk_package_atom_intern ("simon;;;");
+	g_assert (atom3 != atom1);
+	g_assert_cmpstr (gpk_package_atom_get_version (atom3), ==, "");
+	g_assert_cmpstr (gpk_package_atom_get_data (atom3), ==, "");
+	gpk_package_atom_unref (atom3);
+
+	/* stored in a model without copying */
+	store = gtk_list_store_new (1, GPK_TYPE_PACKAGE_ATOM);
+	gtk_list_store_append (store, &iter);
+	gtk_list_store_set (store, &iter, 0, atom1, -1);
+	gpk_package_atom_unref (atom1);
+	gpk_package_atom_unref (atom2);
+	g_assert (gpk_package_atom_lookup (package_id) != NULL);
+	gtk_list_store_clear (store);
+
+	/* gone when the last user has gone */
+	g_assert (gpk_package_atom_lookup (package_id) == NULL);
+	g_assert_cmpint (gpk_package_atom_get_count (), ==, count);
+
+	/* invalid */
+	g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "*could not parse*");
+	g_assert (gpk_package_atom_intern ("simon;0.0.1") == NULL);
+	g_test_assert_expected_messages ();
+}
+
+static void
+gpk_test_package_formatter_perf_func (void)
+{
+	guint i;
+	gdouble elapsed_before;
+	gdouble elapsed_after;
+	g_autoptr(GArray) offsets = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(GString) arena = NULL;
+	g_autoptr(GtkStyleContext) style = NULL;
+	g_autoptr(GpkPackageFormatter) formatter = NULL;
+
+	/* something like a real distribution */
+	packages = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (i = 0; i < 50000; i++) {
+		PkPackage *package = pk_package_new ();
+		g_autofree gchar *package_id = NULL;
+		package_id = g_strdup_printf ("pack%u;1.0.%u-1.fc25;x86_64;fedora", i, i);
+		g_assert (pk_package_set_id (package, package_id, NULL));
+		g_object_set (package, "summary", "A package & its <friends>", NULL);
+		g_ptr_array_add (packages, package);
+	}
+	style = gtk_style_context_new ();
+
+	/* one string at a time */
+	g_test_timer_start ();
+	for (i = 0; i < packages->len; i++) {
+		PkPackage *package = g_ptr_array_index (packages, i);
+		g_autofree gchar *text = NULL;
+		text = gpk_package_id_format_twoline (style,
+						      pk_package_get_id (package),
+						      pk_package_get_summary (package));
+	}
+	elapsed_before = g_test_timer_elapsed ();
+
+	/* all at once into one buffer */
+	g_test_timer_start ();
+	formatter = gpk_package_formatter_new (style);
+	arena = g_string_new (NULL);
+	offsets = g_array_new (FALSE, FALSE, sizeof (gsize));
+	gpk_package_formatter_append_packages (formatter, packages, arena, offsets);
+	elapsed_after = g_test_timer_elapsed ();
+	g_assert_cmpint (offsets->len, ==, packages->len);
+
+	g_test_message ("one at a time: %.3fus per row",
+			elapsed_before * 1000000 / packages->len);
+	g_test_minimized_result (elapsed_after, "formatter: %.3fus per row",
+				 elapsed_after * 1000000 / packages->len);
+}
+
+static gboolean
+gpk_test_package_model_retain_cb (PkPackage *package, gpointer user_data)
+{
+	return package != NULL;
+}
+
+static void
+gpk_test_package_model_func (void)
+{
+	GtkTreeIter iter;
+	GtkTreePath *path;
+	PkBitfield state;
+	gboolean ret;
+	g_autofree gchar *package_id = NULL;
+	g_autofree gchar *text = NULL;
+	g_autofree gchar *text_cached = NULL;
+	g_autoptr(GpkPackageModel) model = NULL;
+	g_autoptr(PkPackage) package = NULL;
+
+	model = gpk_package_model_new ();
+	gpk_package_model_add_message (model, "system-search", "hello");
+	package = pk_package_new ();
+	ret = pk_package_set_id (package, "simon;0.0.1;i386;data", NULL);
+	g_assert (ret);
+	pk_package_set_summary (package, "dude");
+	gpk_package_model_add_package (model, package,
+				       pk_bitfield_value (GPK_PACKAGE_STATE_INSTALLED));
+	g_assert_cmpint (gpk_package_model_get_size (model), ==, 2);
+
+	/* message rows have no package */
+	ret = gtk_tree_model_get_iter_first (GTK_TREE_MODEL (model), &iter);
+	g_assert (ret);
+	gtk_tree_model_get (GTK_TREE_MODEL (model), &iter,
+			    GPK_PACKAGE_MODEL_COLUMN_ID, &package_id,
+			    GPK_PACKAGE_MODEL_COLUMN_TEXT, &text,
+			    -1);
+	g_assert_cmpstr (package_id, ==, NULL);
+	g_assert_cmpstr (text, ==, "hello");
+	g_clear_pointer (&text, g_free);
+
+	/* the markup is generated when asked for */
+	ret = gpk_package_model_find_by_name (model, "simon", &iter);
+	g_assert (ret);
+	gtk_tree_model_get (GTK_TREE_MODEL (model), &iter,
+			    GPK_PACKAGE_MODEL_COLUMN_TEXT, &text,
+			    GPK_PACKAGE_MODEL_COLUMN_STATE, &state,
+			    -1);
+	g_assert_cmpstr (text, ==, "dude\n<span color=\"gray\">simon-0.0.1 (32-bit)</span>");
+	g_assert_cmpint (state, ==, pk_bitfield_value (GPK_PACKAGE_STATE_INSTALLED));
+	g_clear_pointer (&text, g_free);
+
+	/* where a search in several ways found it */
+	gpk_package_model_set_match (model, "simon;0.0.1;i386;data",
+				     pk_bitfield_from_enums (GPK_PACKAGE_MATCH_NAME,
+							     GPK_PACKAGE_MATCH_FILE, -1));
+	gtk_tree_model_get (GTK_TREE_MODEL (model), &iter,
+			    GPK_PACKAGE_MODEL_COLUMN_TEXT, &text,
+			    -1);
+	g_assert_cmpstr (text, ==, "dude\n<span color=\"gray\">simon-0.0.1 (32-bit)</span>"
+			 " <small>matched name, files</small>");
+
+	/* and the same markup again, from the cache */
+	gtk_tree_model_get (GTK_TREE_MODEL (model), &iter,
+			    GPK_PACKAGE_MODEL_COLUMN_TEXT, &text_cached,
+			    -1);
+	g_assert_cmpstr (text_cached, ==, text);
+	g_clear_pointer (&text_cached, g_free);
+
+	/* change state */
+	pk_bitfield_add (state, GPK_PACKAGE_STATE_IN_LIST);
+	gpk_package_model_set_state (model, &iter, state);
+	ret = gpk_package_model_find_by_id (model, "simon;0.0.1;i386;data", &iter);
+	g_assert (ret);
+	g_assert_cmpint (gpk_package_model_get_state (model, &iter), ==, state);
+
+	/* only keep the packages */
+	gpk_package_model_retain (model, gpk_test_package_model_retain_cb, NULL);
+	g_assert_cmpint (gpk_package_model_get_size (model), ==, 1);
+	ret = gpk_package_model_find_by_id (model, "simon;0.0.1;i386;data", &iter);
+	g_assert (ret);
+	path = gtk_tree_model_get_path (GTK_TREE_MODEL (model), &iter);
+	g_assert_cmpint (gtk_tree_path_get_indices (path)[0], ==, 0);
+	gtk_tree_path_free (path);
+
+	gpk_package_model_clear (model);
+	g_assert_cmpint (gpk_package_model_get_size (model), ==, 0);
+	g_assert (!gpk_package_model_find_by_id (model, "simon;0.0.1;i386;data", NULL));
+}
+
+static void
+gpk_test_package_model_add (GpkPackageModel *model, const gchar *package_id)
+{
+	gboolean ret;
+	g_autoptr(PkPackage) package = NULL;
+
+	package = pk_package_new ();
+	ret = pk_package_set_id (package, package_id, NULL);
+	g_assert (ret);
+	gpk_package_model_add_package (model, package, 0);
+}
+
+static gchar *
+gpk_test_package_model_get_order (GpkPackageModel *model)
+{
+	GtkTreeIter iter;
+	GString *str = g_string_new (NULL);
+	gboolean valid;
+
+	valid = gtk_tree_model_get_iter_first (GTK_TREE_MODEL (model), &iter);
+	while (valid) {
+		PkPackage *package = gpk_package_model_get_package (model, &iter);
+		if (str->len > 0)
+			g_string_append (str, ",");
+		g_string_append (str, pk_package_get_name (package));
+		valid = gtk_tree_model_iter_next (GTK_TREE_MODEL (model), &iter);
+	}
+	return g_string_free (str, FALSE);
+}
+
+static void
+gpk_test_package_model_sort_func (void)
+{
+	gint sort_column_id;
+	GtkSortType order;
+	gboolean ret;
+	g_autofree gchar *text = NULL;
+	g_autoptr(GpkPackageModel) model = NULL;
+
+	model = gpk_package_model_new ();
+	gpk_test_package_model_add (model, "gamma;1.9;i386;fedora");
+	gpk_test_package_model_add (model, "alpha;1.10;i386;updates");
+	gpk_test_package_model_add (model, "beta;2.0;i386;fedora");
+	ret = gtk_tree_sortable_get_sort_column_id (GTK_TREE_SORTABLE (model), &sort_column_id, &order);
+	g_assert (!ret);
+
+	/* sorted straight away */
+	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (model),
+					      GPK_PACKAGE_MODEL_COLUMN_TEXT,
+					      GTK_SORT_ASCENDING);
+	text = gpk_test_package_model_get_order (model);
+	g_assert_cmpstr (text, ==, "alpha,beta,gamma");
+	g_clear_pointer (&text, g_free);
+
+	/* new rows are merged in when idle */
+	gpk_test_package_model_add (model, "delta;0.1;i386;updates");
+	gpk_test_package_model_add (model, "aardvark;3.0;i386;fedora");
+	while (g_main_context_iteration (NULL, FALSE));
+	text = gpk_test_package_model_get_order (model);
+	g_assert_cmpstr (text, ==, "aardvark,alpha,beta,delta,gamma");
+	g_clear_pointer (&text, g_free);
+
+	/* numbers in versions are compared as numbers */
+	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (model),
+					      GPK_PACKAGE_MODEL_COLUMN_VERSION,
+					      GTK_SORT_DESCENDING);
+	text = gpk_test_package_model_get_order (model);
+	g_assert_cmpstr (text, ==, "aardvark,beta,alpha,gamma,delta");
+	g_clear_pointer (&text, g_free);
+
+	/* unknown sizes go last */
+	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (model),
+					      GPK_PACKAGE_MODEL_COLUMN_SIZE,
+					      GTK_SORT_ASCENDING);
+	gpk_package_model_set_size (model, "gamma;1.9;i386;fedora", 10);
+	gpk_package_model_set_size (model, "beta;2.0;i386;fedora", 20);
+	while (g_main_context_iteration (NULL, FALSE));
+	text = gpk_test_package_model_get_order (model);
+	g_assert_cmpstr (text, ==, "gamma,beta,aardvark,alpha,delta");
+	g_clear_pointer (&text, g_free);
+
+	/* back to the order they were added in */
+	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (model),
+					      GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID,
+					      GTK_SORT_ASCENDING);
+	text = gpk_test_package_model_get_order (model);
+	g_assert_cmpstr (text, ==, "gamma,alpha,beta,delta,aardvark");
+	g_clear_pointer (&text, g_free);
+
+	/* the default is by name with no search, and by relevance with one */
+	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (model),
+					      GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID,
+					      GTK_SORT_ASCENDING);
+	text = gpk_test_package_model_get_order (model);
+	g_assert_cmpstr (text, ==, "aardvark,alpha,beta,delta,gamma");
+	g_clear_pointer (&text, g_free);
+	gpk_package_model_set_search (model, "gamma");
+	text = gpk_test_package_model_get_order (model);
+	g_assert (g_str_has_prefix (text, "gamma,"));
+	g_clear_pointer (&text, g_free);
+	gpk_package_model_set_search (model, NULL);
+	gpk_test_package_model_add (model, "epsilon;1.0;i386;fedora");
+	while (g_main_context_iteration (NULL, FALSE));
+	text = gpk_test_package_model_get_order (model);
+	g_assert_cmpstr (text, ==, "aardvark,alpha,beta,delta,epsilon,gamma");
+}
+
+static void
+gpk_test_package_model_installed_func (void)
+{
+	GtkTreeIter iter;
+	guint installed;
+	guint available;
+	gboolean ret;
+	const gchar *added[] = { "alpha;1.0;i386;fedora", "beta;2.0;i386;fedora", NULL };
+	const gchar *removed[] = { "gamma;1.9;i386;installed", NULL };
+	g_autoptr(GpkPackageModel) model = NULL;
+
+	model = gpk_package_model_new ();
+	gpk_test_package_model_add (model, "alpha;1.0;i386;fedora");
+	gpk_test_package_model_add (model, "beta;2.0;i386;updates");
+	gpk_test_package_model_add (model, "gamma;1.9;i386;fedora");
+	ret = gpk_package_model_find_by_id (model, "gamma;1.9;i386;fedora", &iter);
+	g_assert (ret);
+	gpk_package_model_set_state (model, &iter,
+				     pk_bitfield_from_enums (GPK_PACKAGE_STATE_INSTALLED,
+							     GPK_PACKAGE_STATE_IN_LIST, -1));
+
+	/* found by ID, or by name, version and arch */
+	g_assert_cmpint (gpk_package_model_set_installed (model, (gchar **) added, TRUE), ==, 2);
+	g_assert_cmpint (gpk_package_model_set_installed (model, (gchar **) removed, FALSE), ==, 1);
+	g_assert_cmpint (gpk_package_model_set_installed (model, (gchar **) added, TRUE), ==, 0);
+	ret = gpk_package_model_find_by_id (model, "beta;2.0;i386;updates", &iter);
+	g_assert (ret);
+	g_assert_cmpint (gpk_package_model_get_state (model, &iter), ==,
+			 pk_bitfield_value (GPK_PACKAGE_STATE_INSTALLED));
+	ret = gpk_package_model_find_by_id (model, "gamma;1.9;i386;fedora", &iter);
+	g_assert (ret);
+	g_assert_cmpint (gpk_package_model_get_state (model, &iter), ==, 0);
+	gpk_package_model_get_facet_counts (model, &installed, &available);
+	g_assert_cmpint (installed, ==, 2);
+	g_assert_cmpint (available, ==, 1);
+}
+
+static void
+gpk_test_package_model_rank_func (void)
+{
+	GtkTreeIter iter;
+	gboolean ret;
+	const gchar *shell[] = { "gnome-shell;1.0;i386;fedora", NULL };
+	g_autofree gchar *text = NULL;
+	g_autoptr(GpkPackageModel) model = NULL;
+	g_autoptr(PkPackage) package = NULL;
+
+	model = gpk_package_model_new ();
+	gpk_package_model_set_search (model, "Gnome");
+
+	/* put in order before the view is next drawn */
+	gpk_test_package_model_add (model, "libgnome-extra;1.0;i386;fedora");
+	gpk_test_package_model_add (model, "gnome-shell;1.0;i386;fedora");
+	package = pk_package_new ();
+	ret = pk_package_set_id (package, "eog;1.0;i386;fedora", NULL);
+	g_assert (ret);
+	pk_package_set_summary (package, "An image viewer for GNOME");
+	gpk_package_model_add_package (model, package, 0);
+	ret = gpk_package_model_find_exact_match (model, &iter);
+	g_assert (!ret);
+	gpk_test_package_model_add (model, "gnome;1.0;i386;fedora");
+	while (g_main_context_iteration (NULL, FALSE));
+	text = gpk_test_package_model_get_order (model);
+	g_assert_cmpstr (text, ==, "gnome,gnome-shell,libgnome-extra,eog");
+	g_clear_pointer (&text, g_free);
+	ret = gpk_package_model_find_exact_match (model, &iter);
+	g_assert (ret);
+	g_assert_cmpstr (pk_package_get_name (gpk_package_model_get_package (model, &iter)), ==, "gnome");
+
+	/* installed packages win a tie */
+	g_clear_object (&package);
+	package = pk_package_new ();
+	ret = pk_package_set_id (package, "gnome-session;1.0;i386;installed", NULL);
+	g_assert (ret);
+	gpk_package_model_add_package (model, package, pk_bitfield_value (GPK_PACKAGE_STATE_INSTALLED));
+	while (g_main_context_iteration (NULL, FALSE));
+	text = gpk_test_package_model_get_order (model);
+	g_assert_cmpstr (text, ==, "gnome,gnome-session,gnome-shell,libgnome-extra,eog");
+	g_clear_pointer (&text, g_free);
+
+	/* and move up when they are installed */
+	g_assert_cmpint (gpk_package_model_set_installed (model, (gchar **) shell, TRUE), ==, 1);
+	while (g_main_context_iteration (NULL, FALSE));
+	text = gpk_test_package_model_get_order (model);
+	g_assert_cmpstr (text, ==, "gnome,gnome-shell,gnome-session,libgnome-extra,eog");
+	g_clear_pointer (&text, g_free);
+
+	/* a column sort still wins */
+	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (model),
+					      GPK_PACKAGE_MODEL_COLUMN_TEXT,
+					      GTK_SORT_ASCENDING);
+	text = gpk_test_package_model_get_order (model);
+	g_assert_cmpstr (text, ==, "eog,gnome,gnome-session,gnome-shell,libgnome-extra");
+	g_clear_pointer (&text, g_free);
+	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (model),
+					      GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID,
+					      GTK_SORT_ASCENDING);
+
+	/* scored again when the text changes */
+	gpk_package_model_set_search (model, "gnome-shell");
+	text = gpk_test_package_model_get_order (model);
+	g_assert_cmpstr (text, ==, "gnome-shell,gnome-session,libgnome-extra,eog,gnome");
+	g_clear_pointer (&text, g_free);
+
+	/* no search keeps the order they were added in */
+	gpk_package_model_set_search (model, NULL);
+	ret = gpk_package_model_find_exact_match (model, NULL);
+	g_assert (!ret);
+}
+
+static gchar *
+gpk_test_package_model_get_versions (GpkPackageModel *model)
+{
+	GtkTreeIter iter;
+	GString *str = g_string_new (NULL);
+	gboolean valid;
+
+	valid = gtk_tree_model_get_iter_first (GTK_TREE_MODEL (model), &iter);
+	while (valid) {
+		PkPackage *package = gpk_package_model_get_package (model, &iter);
+		if (str->len > 0)
+			g_string_append (str, ",");
+		g_string_append_printf (str, "%s-%s.%s",
+					pk_package_get_name (package),
+					pk_package_get_version (package),
+					pk_package_get_arch (package));
+		valid = gtk_tree_model_iter_next (GTK_TREE_MODEL (model), &iter);
+	}
+	return g_string_free (str, FALSE);
+}
+
+static void
+gpk_test_package_model_facets_func (void)
+{
+	const gchar *newest[] = { "foo;2.0;x86_64;updates", NULL };
+	guint installed;
+	guint available;
+	guint i;
+	g_autofree gchar *text = NULL;
+	g_autoptr(GpkPackageModel) model = NULL;
+	g_autoptr(PkPackage) package = NULL;
+
+	model = gpk_package_model_new ();
+	gpk_package_model_set_native_arch (model, "x86_64");
+	gpk_test_package_model_add (model, "foo;1.9;x86_64;fedora");
+	gpk_test_package_model_add (model, "foo;1.10;x86_64;updates");
+	gpk_test_package_model_add (model, "foo;1.10;i686;updates");
+	gpk_test_package_model_add (model, "foo-devel;1.10;x86_64;updates");
+	package = pk_package_new ();
+	g_assert (pk_package_set_id (package, "foo;1.9;x86_64;installed", NULL));
+	gpk_package_model_add_package (model, package,
+				       pk_bitfield_value (GPK_PACKAGE_STATE_INSTALLED));
+	g_assert_cmpint (gpk_package_model_get_size (model), ==, 5);
+	gpk_package_model_get_facet_counts (model, &installed, &available);
+	g_assert_cmpint (installed, ==, 1);
+	g_assert_cmpint (available, ==, 4);
+
+	/* the installed version is kept as well as the newest available */
+	gpk_package_model_set_facets (model, pk_bitfield_value (PK_FILTER_ENUM_NEWEST));
+	text = gpk_test_package_model_get_versions (model);
+	g_assert_cmpstr (text, ==, "foo-1.10.x86_64,foo-1.10.i686,foo-devel-1.10.x86_64,foo-1.9.x86_64");
+	g_clear_pointer (&text, g_free);
+	gpk_package_model_get_facet_counts (model, &installed, &available);
+	g_assert_cmpint (installed, ==, 1);
+	g_assert_cmpint (available, ==, 3);
+
+	/* newer versions replace what is shown as they arrive */
+	gpk_test_package_model_add (model, "foo;2.0;x86_64;updates");
+	gpk_test_package_model_add (model, "foo;1.0;x86_64;fedora");
+	while (g_main_context_iteration (NULL, FALSE));
+	text = gpk_test_package_model_get_versions (model);
+	g_assert_cmpstr (text, ==, "foo-1.10.i686,foo-devel-1.10.x86_64,foo-1.9.x86_64,foo-2.0.x86_64");
+	g_clear_pointer (&text, g_free);
+	g_assert (!gpk_package_model_find_by_id (model, "foo;1.10;x86_64;updates", NULL));
+
+	/* installing moves it to the installed versions, and back again */
+	g_assert_cmpint (gpk_package_model_set_installed (model, (gchar **) newest, TRUE), ==, 1);
+	while (g_main_context_iteration (NULL, FALSE));
+	text = gpk_test_package_model_get_versions (model);
+	g_assert_cmpstr (text, ==, "foo-1.10.i686,foo-devel-1.10.x86_64,foo-2.0.x86_64,foo-1.10.x86_64");
+	g_clear_pointer (&text, g_free);
+	gpk_package_model_get_facet_counts (model, &installed, &available);
+	g_assert_cmpint (installed, ==, 1);
+	g_assert_cmpint (available, ==, 3);
+	g_assert_cmpint (gpk_package_model_set_installed (model, (gchar **) newest, FALSE), ==, 1);
+	while (g_main_context_iteration (NULL, FALSE));
+	text = gpk_test_package_model_get_versions (model);
+	g_assert_cmpstr (text, ==, "foo-1.10.i686,foo-devel-1.10.x86_64,foo-2.0.x86_64,foo-1.9.x86_64");
+	g_clear_pointer (&text, g_free);
+	gpk_package_model_get_facet_counts (model, &installed, &available);
+	g_assert_cmpint (installed, ==, 1);
+	g_assert_cmpint (available, ==, 3);
+
+	/* more facets */
+	gpk_package_model_set_facets (model, pk_bitfield_from_enums (PK_FILTER_ENUM_NEWEST,
+								     PK_FILTER_ENUM_ARCH,
+								     PK_FILTER_ENUM_BASENAME, -1));
+	text = gpk_test_package_model_get_versions (model);
+	g_assert_cmpstr (text, ==, "foo-1.9.x86_64,foo-2.0.x86_64");
+	g_clear_pointer (&text, g_free);
+	gpk_package_model_set_facets (model, pk_bitfield_value (PK_FILTER_ENUM_INSTALLED));
+	text = gpk_test_package_model_get_versions (model);
+	g_assert_cmpstr (text, ==, "foo-1.9.x86_64");
+	g_clear_pointer (&text, g_free);
+	gpk_package_model_get_facet_counts (model, &installed, &available);
+	g_assert_cmpint (installed, ==, 1);
+	g_assert_cmpint (available, ==, 6);
+
+	/* nothing hidden, and enough rows to be split between threads */
+	gpk_package_model_set_facets (model, 0);
+	g_assert_cmpint (gpk_package_model_get_size (model), ==, 7);
+	for (i = 0; i < 20000; i++) {
+		g_autofree gchar *package_id = g_strdup_printf ("pkg%u;1.%u;x86_64;fedora", i % 100, i);
+		gpk_test_package_model_add (model, package_id);
+	}
+	gpk_package_model_set_facets (model, pk_bitfield_value (PK_FILTER_ENUM_NEWEST));
+	g_assert_cmpint (gpk_package_model_get_size (model), ==, 100 + 4);
+	g_assert (gpk_package_model_find_by_id (model, "pkg42;1.19942;x86_64;fedora", NULL));
+}
+
+static GPtrArray *
+gpk_test_result_cache_array_new (const gchar *package_id)
+{
+	GPtrArray *array;
+	PkPackage *package;
+	gboolean ret;
+
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	package = pk_package_new ();
+	ret = pk_package_set_id (package, package_id, NULL);
+	g_assert (ret);
+	g_ptr_array_add (array, package);
+	return array;
+}
+
+static void
+gpk_test_result_cache_func (void)
+{
+	g_autoptr(GpkResultCache) cache = NULL;
+	g_autoptr(GPtrArray) array1 = NULL;
+	g_autoptr(GPtrArray) array2 = NULL;
+	g_autoptr(GPtrArray) array3 = NULL;
+	g_autoptr(GPtrArray) tmp = NULL;
+	gsize size;
+
+	array1 = gpk_test_result_cache_array_new ("one;0.0.1;i386;data");
+	array2 = gpk_test_result_cache_array_new ("two;0.0.1;i386;data");
+	array3 = gpk_test_result_cache_array_new ("three;0.0.1;i386;data");
+
+	/* only room for two */
+	cache = gpk_result_cache_new (G_MAXSIZE);
+	gpk_result_cache_insert (cache, "1", array1);
+	size = gpk_result_cache_get_size (cache);
+	g_assert_cmpint (size, >, 0);
+	gpk_result_cache_set_max_size (cache, size * 2 + 16);
+	gpk_result_cache_insert (cache, "2", array2);
+
+	/* use the oldest so the other one is evicted */
+	tmp = gpk_result_cache_lookup (cache, "1");
+	g_assert (tmp == array1);
+	g_clear_pointer (&tmp, g_ptr_array_unref);
+	gpk_result_cache_insert (cache, "3", array3);
+	tmp = gpk_result_cache_lookup (cache, "2");
+	g_assert (tmp == NULL);
+	tmp = gpk_result_cache_lookup (cache, "1");
+	g_assert (tmp == array1);
+	g_clear_pointer (&tmp, g_ptr_array_unref);
+
+	/* too big to cache at all */
+	gpk_result_cache_set_max_size (cache, 1);
+	g_assert_cmpint (gpk_result_cache_get_size (cache), ==, 0);
+	gpk_result_cache_insert (cache, "1", array1);
+	tmp = gpk_result_cache_lookup (cache, "1");
+	g_assert (tmp == NULL);
+
+	/* remove everything */
+	gpk_result_cache_set_max_size (cache, G_MAXSIZE);
+	gpk_result_cache_insert (cache, "1", array1);
+	gpk_result_cache_invalidate (cache);
+	g_assert_cmpint (gpk_result_cache_get_size (cache), ==, 0);
+	tmp = gpk_result_cache_lookup (cache, "1");
+	g_assert (tmp == NULL);
+}
+
+typedef struct {
+	GCancellable		*cancellable;
+	GAsyncReadyCallback	 callback;
+	gpointer		 callback_data;
+	guint			 started;
+	guint			 finished;
+	guint			 dropped;
+} GpkTestRequest;
+
+static void
+gpk_test_scheduler_start (GCancellable *cancellable,
+			  GAsyncReadyCallback callback, gpointer callback_data,
+			  GpkTestRequest *request)
+{
+	request->cancellable = cancellable;
+	request->callback = callback;
+	request->callback_data = callback_data;
+	request->started++;
+}
+
+static void
+gpk_test_scheduler_ready_cb (GObject *source, GAsyncResult *res, GpkTestRequest *request)
+{
+	request->finished++;
+}
+
+static void
+gpk_test_scheduler_drop (GpkTestRequest *request)
+{
+	request->dropped++;
+}
+
+static void
+gpk_test_scheduler_push (GpkScheduler *scheduler, GpkSchedulerKind kind, GpkTestRequest *request)
+{
+	gpk_scheduler_push (scheduler, kind,
+			    (GpkSchedulerFunc) gpk_test_scheduler_start,
+			    (GAsyncReadyCallback) gpk_test_scheduler_ready_cb,
+			    request, (GDestroyNotify) gpk_test_scheduler_drop);
+}
+
+static PkCategory *
+gpk_test_category_new (const gchar *parent_id, const gchar *cat_id)
+{
+	return g_object_new (PK_TYPE_CATEGORY,
+			     "parent-id", parent_id,
+			     "cat-id", cat_id,
+			     "name", cat_id,
+			     NULL);
+}
+
+static void
+gpk_test_category_tree_func (void)
+{
+	GNode *node;
+	gboolean ret;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GpkCategoryTree) tree = NULL;
+	g_autoptr(GpkCategoryTree) tree2 = NULL;
+
+	/* children before their parents, three deep, and a loop */
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_ptr_array_add (array, gpk_test_category_new ("gnome", "gnome-games"));
+	g_ptr_array_add (array, gpk_test_category_new ("gnome-games", "gnome-games-cards"));
+	g_ptr_array_add (array, gpk_test_category_new (NULL, "gnome"));
+	g_ptr_array_add (array, gpk_test_category_new ("gnome", "gnome-office"));
+	g_ptr_array_add (array, gpk_test_category_new ("missing", "kde"));
+	g_ptr_array_add (array, gpk_test_category_new ("loop2", "loop1"));
+	g_ptr_array_add (array, gpk_test_category_new ("loop1", "loop2"));
+	tree = gpk_category_tree_new ();
+	gpk_category_tree_set_categories (tree, array);
+	g_assert_cmpint (gpk_category_tree_get_size (tree), ==, 7);
+	node = gpk_category_tree_get_root (tree);
+	g_assert_cmpint (g_node_n_nodes (node, G_TRAVERSE_ALL), ==, 8);
+	g_assert_cmpint (g_node_n_children (node), ==, 3);
+	node = g_node_first_child (node);
+	g_assert_cmpstr (pk_category_get_id (node->data), ==, "gnome");
+	g_assert_cmpint (g_node_n_children (node), ==, 2);
+	node = g_node_first_child (node);
+	g_assert_cmpstr (pk_category_get_id (node->data), ==, "gnome-games");
+	node = g_node_first_child (node);
+	g_assert_cmpstr (pk_category_get_id (node->data), ==, "gnome-games-cards");
+	g_assert_cmpint (g_node_depth (node), ==, 4);
+
+	/* the same tree comes back */
+	filename = g_build_filename (g_get_tmp_dir (), "gpk-self-test-categories", NULL);
+	ret = gpk_category_tree_save (tree, filename, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	tree2 = gpk_category_tree_new ();
+	ret = gpk_category_tree_load (tree2, filename, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert (gpk_category_tree_equal (tree, tree2));
+	g_unlink (filename);
+
+	/* a change is noticed */
+	g_ptr_array_remove_index (array, 1);
+	gpk_category_tree_set_categories (tree2, array);
+	g_assert (!gpk_category_tree_equal (tree, tree2));
+}
+
+static void
+gpk_test_dependency_graph_func (void)
+{
+	guint direct = 0;
+	guint missing = 0;
+	g_autoptr(GpkDependencyGraph) graph = NULL;
+	g_autoptr(GPtrArray) array1 = NULL;
+	g_autoptr(GPtrArray) array2 = NULL;
+	g_autoptr(GPtrArray) edges = NULL;
+
+	/* nothing known yet */
+	graph = gpk_dependency_graph_new ();
+	edges = gpk_dependency_graph_get_edges (graph, GPK_DEPENDENCY_GRAPH_DEPENDS, "gimp;2.8;x86_64;fedora");
+	g_assert (edges == NULL);
+
+	/* gimp needs babl directly, and gegl through babl */
+	array1 = gpk_test_result_cache_array_new ("babl;0.1;x86_64;fedora");
+	gpk_dependency_graph_set_edges (graph, GPK_DEPENDENCY_GRAPH_DEPENDS, "gimp;2.8;x86_64;fedora", array1);
+	array2 = gpk_test_result_cache_array_new ("gegl;0.3;x86_64;fedora");
+	g_ptr_array_add (array2, g_object_ref (g_ptr_array_index (array1, 0)));
+	gpk_dependency_graph_set_closure (graph, GPK_DEPENDENCY_GRAPH_DEPENDS, "gimp;2.8;x86_64;fedora", array2);
+	edges = gpk_dependency_graph_get_edges (graph, GPK_DEPENDENCY_GRAPH_DEPENDS, "gimp;2.8;x86_64;fedora");
+	g_assert (edges != NULL);
+	g_assert_cmpint (edges->len, ==, 1);
+
+	/* only the sizes we know about are added */
+	gpk_dependency_graph_set_size (graph, "gegl;0.3;x86_64;fedora", 1000);
+	g_assert_cmpint (gpk_dependency_graph_get_download_size (graph, "gimp;2.8;x86_64;fedora", &missing), ==, 1000);
+	g_assert_cmpint (missing, ==, 1);
+	gpk_dependency_graph_set_size (graph, "babl;0.1;x86_64;fedora", 24);
+	g_assert_cmpint (gpk_dependency_graph_get_download_size (graph, "gimp;2.8;x86_64;fedora", &missing), ==, 1024);
+	g_assert_cmpint (missing, ==, 0);
+
+	/* the other way */
+	gpk_dependency_graph_set_edges (graph, GPK_DEPENDENCY_GRAPH_REQUIRED_BY, "babl;0.1;x86_64;fedora", array1);
+	gpk_dependency_graph_set_closure (graph, GPK_DEPENDENCY_GRAPH_REQUIRED_BY, "babl;0.1;x86_64;fedora", array2);
+	g_assert_cmpint (gpk_dependency_graph_get_fan_out (graph, "babl;0.1;x86_64;fedora", &direct), ==, 2);
+	g_assert_cmpint (direct, ==, 1);
+
+	/* forgotten after a transaction */
+	gpk_dependency_graph_invalidate (graph);
+	g_assert_cmpint (gpk_dependency_graph_get_fan_out (graph, "babl;0.1;x86_64;fedora", &direct), ==, 0);
+	g_assert_cmpint (direct, ==, 0);
+}
+
+static void
+gpk_test_scheduler_func (void)
+{
+	GpkTestRequest req[6] = { { NULL } };
+	g_autoptr(GpkScheduler) scheduler = NULL;
+
+	/* a background request leaves the last slot free */
+	scheduler = gpk_scheduler_new (2);
+	gpk_test_scheduler_push (scheduler, GPK_SCHEDULER_KIND_PREFETCH, &req[0]);
+	gpk_test_scheduler_push (scheduler, GPK_SCHEDULER_KIND_PREFETCH, &req[1]);
+	g_assert_cmpint (req[0].started, ==, 1);
+	g_assert_cmpint (req[1].started, ==, 0);
+	gpk_test_scheduler_push (scheduler, GPK_SCHEDULER_KIND_SEARCH, &req[2]);
+	g_assert_cmpint (req[2].started, ==, 1);
+	g_assert_cmpint (gpk_scheduler_get_running (scheduler), ==, 2);
+
+	/* searches do not wait for background requests, only for each other */
+	gpk_scheduler_push_full (scheduler, GPK_SCHEDULER_KIND_SEARCH, GPK_SCHEDULER_FLAG_KEEP,
+				 (GpkSchedulerFunc) gpk_test_scheduler_start,
+				 (GAsyncReadyCallback) gpk_test_scheduler_ready_cb,
+				 &req[3], (GDestroyNotify) gpk_test_scheduler_drop);
+	g_assert_cmpint (req[3].started, ==, 1);
+	g_assert_cmpint (gpk_scheduler_get_running (scheduler), ==, 3);
+	gpk_scheduler_push_full (scheduler, GPK_SCHEDULER_KIND_SEARCH, GPK_SCHEDULER_FLAG_KEEP,
+				 (GpkSchedulerFunc) gpk_test_scheduler_start,
+				 (GAsyncReadyCallback) gpk_test_scheduler_ready_cb,
+				 &req[4], (GDestroyNotify) gpk_test_scheduler_drop);
+	g_assert_cmpint (req[4].started, ==, 0);
+
+	/* a newer search cancels the running ones, and drops the one that
+	 * never started rather than cancelling it */
+	gpk_test_scheduler_push (scheduler, GPK_SCHEDULER_KIND_SEARCH, &req[5]);
+	g_assert (g_cancellable_is_cancelled (req[2].cancellable));
+	g_assert (g_cancellable_is_cancelled (req[3].cancellable));
+	g_assert_cmpint (req[4].dropped, ==, 1);
+	g_assert_cmpint (req[5].started, ==, 0);
+	g_assert_cmpint (gpk_scheduler_get_queued (scheduler), ==, 2);
+	req[2].callback (NULL, NULL, req[2].callback_data);
+	g_assert_cmpint (req[2].finished, ==, 1);
+	g_assert_cmpint (req[5].started, ==, 1);
+	req[3].callback (NULL, NULL, req[3].callback_data);
+	g_assert_cmpint (req[1].started, ==, 0);
+
+	/* the prefetch only starts when nothing else is waiting */
+	req[0].callback (NULL, NULL, req[0].callback_data);
+	g_assert_cmpint (req[1].started, ==, 0);
+	req[5].callback (NULL, NULL, req[5].callback_data);
+	g_assert_cmpint (req[1].started, ==, 1);
+	req[1].callback (NULL, NULL, req[1].callback_data);
+	g_assert_cmpint (gpk_scheduler_get_running (scheduler), ==, 0);
+	g_assert_cmpint (gpk_scheduler_get_queued (scheduler), ==, 0);
+
+	/* searches that are parts of the same request run side by side */
+	memset (req, 0, sizeof (req));
+	gpk_test_scheduler_push (scheduler, GPK_SCHEDULER_KIND_SEARCH, &req[0]);
+	gpk_scheduler_push_full (scheduler, GPK_SCHEDULER_KIND_SEARCH, GPK_SCHEDULER_FLAG_KEEP,
+				 (GpkSchedulerFunc) gpk_test_scheduler_start,
+				 (GAsyncReadyCallback) gpk_test_scheduler_ready_cb,
+				 &req[1], (GDestroyNotify) gpk_test_scheduler_drop);
+	g_assert_cmpint (req[0].started, ==, 1);
+	g_assert_cmpint (req[1].started, ==, 1);
+	g_assert (!g_cancellable_is_cancelled (req[0].cancellable));
+
+	/* but a new search still replaces all of them */
+	gpk_test_scheduler_push (scheduler, GPK_SCHEDULER_KIND_SEARCH, &req[2]);
+	g_assert (g_cancellable_is_cancelled (req[0].cancellable));
+	g_assert (g_cancellable_is_cancelled (req[1].cancellable));
+	req[0].callback (NULL, NULL, req[0].callback_data);
+	req[1].callback (NULL, NULL, req[1].callback_data);
+	g_assert_cmpint (req[2].started, ==, 1);
+	req[2].callback (NULL, NULL, req[2].callback_data);
+	g_assert_cmpint (gpk_scheduler_get_running (scheduler), ==, 0);
+}
+
+static void
+gpk_test_file_model_func (void)
+{
+	gchar *files[] = { "/usr/bin/foo",
+			   "/usr/bin-x",
+			   "/usr/bin/bar",
+			   "/etc/foo.conf",
+			   "/usr/bin",
+			   NULL };
+	GtkTreeIter iter;
+	GtkTreeModel *tree_model;
+	g_autofree gchar *name = NULL;
+	g_autofree gchar *path = NULL;
+	g_autoptr(GpkFileModel) filtered = NULL;
+	g_autoptr(GpkFileModel) model = NULL;
+	g_autoptr(GpkFileModel) narrowed = NULL;
+
+	/* only the top level to start with */
+	model = gpk_file_model_new (files);
+	tree_model = GTK_TREE_MODEL (model);
+	g_assert_cmpint (gpk_file_model_get_size (model), ==, 5);
+	g_assert_cmpint (gtk_tree_model_iter_n_children (tree_model, NULL), ==, 2);
+
+	/* a directory and a file that shares its prefix */
+	g_assert (gtk_tree_model_get_iter_from_string (tree_model, &iter, "1:0"));
+	g_assert (gtk_tree_model_iter_has_child (tree_model, &iter));
+	gtk_tree_model_get (tree_model, &iter,
+			    GPK_FILE_MODEL_COLUMN_NAME, &name,
+			    GPK_FILE_MODEL_COLUMN_PATH, &path,
+			    -1);
+	g_assert_cmpstr (name, ==, "bin");
+	g_assert_cmpstr (path, ==, "/usr/bin");
+	g_assert_cmpint (gtk_tree_model_iter_n_children (tree_model, &iter), ==, 2);
+	g_clear_pointer (&name, g_free);
+	g_assert (gtk_tree_model_get_iter_from_string (tree_model, &iter, "1:1"));
+	g_assert (!gtk_tree_model_iter_has_child (tree_model, &iter));
+	gtk_tree_model_get (tree_model, &iter,
+			    GPK_FILE_MODEL_COLUMN_NAME, &name,
+			    -1);
+	g_assert_cmpstr (name, ==, "bin-x");
+
+	/* filter, and then narrow that down */
+	filtered = gpk_file_model_new_filtered (model, "BIN/");
+	g_assert_cmpint (gpk_file_model_get_size (filtered), ==, 2);
+	narrowed = gpk_file_model_new_filtered (filtered, "bin/f");
+	g_assert_cmpint (gpk_file_model_get_size (narrowed), ==, 1);
+	g_assert_cmpint (gtk_tree_model_iter_n_children (GTK_TREE_MODEL (narrowed), NULL), ==, 1);
+}
+
+static void
+gpk_test_catalog_func (void)
+{
+	const gchar *package_ids[] = { "gnome-power-manager;2.6.19;i386;fedora",
+				       "gnome-packagekit;3.22.0;x86_64;fedora",
+				       "PackageKit;1.1.5;x86_64;installed",
+				       "power;0.1;noarch;fedora",
+				       NULL };
+	gboolean ret;
+	gchar *values[] = { "Power", NULL };
+	guint i;
+	PkPackage *package;
+	g_autofree gchar *filename = NULL;
+	g_auto(GStrv) names = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(GpkCatalog) catalog = NULL;
+
+	packages = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (i = 0; package_ids[i] != NULL; i++) {
+		package = pk_package_new ();
+		ret = pk_package_set_id (package, package_ids[i], NULL);
+		g_assert (ret);
+		pk_package_set_summary (package, "dave");
+		g_ptr_array_add (packages, package);
+	}
+
+	filename = g_build_filename (g_get_tmp_dir (), "gpk-self-test-catalog", NULL);
+	ret = gpk_catalog_write (filename, packages, 0, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	catalog = gpk_catalog_new ();
+	ret = gpk_catalog_load (catalog, filename, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (gpk_catalog_get_size (catalog), ==, 4);
+	g_assert_cmpint (gpk_catalog_get_age (catalog), <, 60);
+
+	/* anywhere in the name */
+	array = gpk_catalog_search_names (catalog, values);
+	g_assert_cmpint (array->len, ==, 2);
+	package = g_ptr_array_index (array, 0);
+	g_assert_cmpstr (pk_package_get_id (package), ==, package_ids[0]);
+	g_assert_cmpstr (pk_package_get_summary (package), ==, "dave");
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	/* at the start of the name, in name order */
+	array = gpk_catalog_search_prefix (catalog, "GNOME-P");
+	g_assert_cmpint (array->len, ==, 2);
+	package = g_ptr_array_index (array, 0);
+	g_assert_cmpstr (pk_package_get_id (package), ==, package_ids[1]);
+	g_clear_pointer (&array, g_ptr_array_unref);
+	array = gpk_catalog_search_prefix (catalog, "zzz");
+	g_assert_cmpint (array->len, ==, 0);
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	/* paged, in name order */
+	array = gpk_catalog_get_page (catalog, 0, 2);
+	g_assert_cmpint (array->len, ==, 2);
+	package = g_ptr_array_index (array, 0);
+	g_assert_cmpstr (pk_package_get_id (package), ==, package_ids[1]);
+	package = g_ptr_array_index (array, 1);
+	g_assert_cmpstr (pk_package_get_id (package), ==, package_ids[0]);
+	g_clear_pointer (&array, g_ptr_array_unref);
+	array = gpk_catalog_get_page (catalog, 3, 100);
+	g_assert_cmpint (array->len, ==, 1);
+	package = g_ptr_array_index (array, 0);
+	g_assert_cmpstr (pk_package_get_id (package), ==, package_ids[3]);
+	g_clear_pointer (&array, g_ptr_array_unref);
+	array = gpk_catalog_get_page (catalog, 4, 100);
+	g_assert_cmpint (array->len, ==, 0);
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	/* just the names */
+	names = gpk_catalog_get_names (catalog);
+	g_assert_cmpint (g_strv_length (names), ==, 4);
+	g_assert_cmpstr (names[0], ==, "gnome-packagekit");
+	g_assert_cmpstr (names[2], ==, "PackageKit");
+
+	/* not a catalog */
+	ret = g_file_set_contents (filename, "hello", -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	ret = gpk_catalog_load (catalog, filename, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert (!ret);
+	g_unlink (filename);
+}
+
+static void
+gpk_test_trigram_index_func (void)
+{
+	PkPackage *package;
+	gboolean ret;
+	gchar *values1[] = { "Editor", "text", NULL };
+	gchar *values2[] = { "vi", NULL };
+	gchar *values3[] = { "txet", NULL };
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GHashTable) keep = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GpkTrigramIndex) index = NULL;
+	g_autoptr(GpkTrigramIndex) index2 = NULL;
+
+	index = gpk_trigram_index_new ();
+	gpk_trigram_index_add (index, "vim;8.0;x86_64;installed", "The VIM editor",
+			       "VIM is a text editor that is upwards compatible with vi.");
+	gpk_trigram_index_add (index, "gedit;3.22;x86_64;fedora", "Text editor for GNOME",
+			       "gedit is the official text editor of the GNOME desktop.");
+	gpk_trigram_index_add (index, "gimp;2.8;x86_64;fedora", "Image editor", NULL);
+	g_assert_cmpint (gpk_trigram_index_get_size (index), ==, 3);
+
+	/* every term, in any field, ignoring case */
+	array = gpk_trigram_index_search (index, values1);
+	g_assert_cmpint (array->len, ==, 2);
+	package = g_ptr_array_index (array, 0);
+	g_assert_cmpstr (pk_package_get_id (package), ==, "vim;8.0;x86_64;installed");
+	g_assert_cmpint (pk_package_get_info (package), ==, PK_INFO_ENUM_INSTALLED);
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	/* too short for a trigram */
+	array = gpk_trigram_index_search (index, values2);
+	g_assert_cmpint (array->len, ==, 1);
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	/* all the trigrams would not be found */
+	array = gpk_trigram_index_search (index, values3);
+	g_assert_cmpint (array->len, ==, 0);
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	/* replaced, then removed */
+	gpk_trigram_index_add (index, "vim;8.0;x86_64;installed", "The VIM editor", NULL);
+	array = gpk_trigram_index_search (index, values1);
+	g_assert_cmpint (array->len, ==, 1);
+	g_clear_pointer (&array, g_ptr_array_unref);
+	keep = g_hash_table_new (g_str_hash, g_str_equal);
+	g_hash_table_add (keep, "gedit;3.22;x86_64;fedora");
+	gpk_trigram_index_prune (index, keep);
+	g_assert_cmpint (gpk_trigram_index_get_size (index), ==, 1);
+	g_assert (gpk_trigram_index_contains (index, "gedit;3.22;x86_64;fedora"));
+
+	/* save and load */
+	filename = g_build_filename (g_get_tmp_dir (), "gpk-self-test-details-index", NULL);
+	ret = gpk_trigram_index_save (index, filename, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	index2 = gpk_trigram_index_new ();
+	ret = gpk_trigram_index_load (index2, filename, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	array = gpk_trigram_index_search (index2, values1);
+	g_assert_cmpint (array->len, ==, 1);
+	g_clear_pointer (&array, g_ptr_array_unref);
+	g_unlink (filename);
+}
+
+static void
+gpk_test_trigram_index_perf_func (void)
+{
+	gchar *values[] = { "library", "pack42", NULL };
+	guint cnt = 0;
+	guint i;
+	gdouble elapsed_index;
+	gdouble elapsed_scan;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GPtrArray) texts = NULL;
+	g_autoptr(GpkTrigramIndex) index = NULL;
+
+	/* something like a real distribution */
+	index = gpk_trigram_index_new ();
+	texts = g_ptr_array_new_with_free_func (g_free);
+	for (i = 0; i < 50000; i++) {
+		g_autofree gchar *package_id = NULL;
+		g_autofree gchar *description = NULL;
+		package_id = g_strdup_printf ("pack%u;1.0;x86_64;fedora", i);
+		description = g_strdup_printf ("This is the %s for package number %u, "
+					       "which is used by many other packages.",
+					       i % 3 == 0 ? "library" : "program", i);
+		gpk_trigram_index_add (index, package_id, "A package", description);
+		g_ptr_array_add (texts, g_strdup_printf ("pack%u\na package\n%s", i, description));
+	}
+
+	/* what the backend does */
+	g_test_timer_start ();
+	for (i = 0; i < texts->len; i++) {
+		const gchar *text = g_ptr_array_index (texts, i);
+		if (strstr (text, values[0]) != NULL &&
+		    strstr (text, values[1]) != NULL)
+			cnt++;
+	}
+	elapsed_scan = g_test_timer_elapsed ();
+
+	g_test_timer_start ();
+	array = gpk_trigram_index_search (index, values);
+	elapsed_index = g_test_timer_elapsed ();
+	g_assert_cmpint (array->len, >, 0);
+	g_test_message ("linear scan: %.3fms, %u results", elapsed_scan * 1000, cnt);
+	g_assert_cmpint (array->len, ==, cnt);
+	g_test_minimized_result (elapsed_index, "trigram index: %.3fms, %u results",
+				 elapsed_index * 1000, array->len);
+}
+
+static void
+gpk_test_name_index_func (void)
+{
+	gchar *names[] = { "firefox", "Firefox", "gimp", "vim", "gvim",
+			   "inkscape", "thunderbird", "", NULL };
+	g_auto(GStrv) results = NULL;
+	g_autoptr(GpkNameIndex) index = NULL;
+
+	/* duplicates are only added once */
+	index = gpk_name_index_new (names);
+	g_assert_cmpint (gpk_name_index_get_size (index), ==, 6);
+
+	/* two letters the wrong way round */
+	results = gpk_name_index_search (index, "fierfox", 2, 5);
+	g_assert_cmpint (g_strv_length (results), ==, 1);
+	g_assert_cmpstr (results[0], ==, "firefox");
+	g_clear_pointer (&results, g_strfreev);
+
+	/* the closest first, but never the text itself */
+	results = gpk_name_index_search (index, "VIM", 2, 5);
+	g_assert_cmpint (g_strv_length (results), ==, 2);
+	g_assert_cmpstr (results[0], ==, "gvim");
+	g_assert_cmpstr (results[1], ==, "gimp");
+	g_clear_pointer (&results, g_strfreev);
+	results = gpk_name_index_search (index, "vim", 2, 1);
+	g_assert_cmpint (g_strv_length (results), ==, 1);
+	g_clear_pointer (&results, g_strfreev);
+	results = gpk_name_index_search (index, "vim", 0, 5);
+	g_assert_cmpint (g_strv_length (results), ==, 0);
+	g_clear_pointer (&results, g_strfreev);
+
+	/* nothing is close */
+	results = gpk_name_index_search (index, "inkscrape-dev", 2, 5);
+	g_assert_cmpint (g_strv_length (results), ==, 0);
+}
+
+static void
+gpk_test_name_index_perf_func (void)
+{
+	const gchar *prefixes[] = { "", "lib", "python3-", "perl-", "gnome-", NULL };
+	const gchar *suffixes[] = { "", "-devel", "-doc", "-libs", NULL };
+	gdouble elapsed;
+	guint i;
+	g_autoptr(GPtrArray) names = NULL;
+	g_auto(GStrv) results = NULL;
+	g_autoptr(GpkNameIndex) index = NULL;
+
+	/* something like a real distribution */
+	names = g_ptr_array_new_with_free_func (g_free);
+	for (i = 0; i < 60000; i++) {
+		g_ptr_array_add (names, g_strdup_printf ("%spack%u%s",
+							 prefixes[i % 5],
+							 i / 20,
+							 suffixes[(i / 5) % 4]));
+	}
+	g_ptr_array_add (names, NULL);
+	g_test_timer_start ();
+	index = gpk_name_index_new ((gchar **) names->pdata);
+	g_test_message ("built: %.3fms, %u names",
+			g_test_timer_elapsed () * 1000,
+			gpk_name_index_get_size (index));
+
+	g_test_timer_start ();
+	results = gpk_name_index_search (index, "pyhton3-pack42-devel", 2, 3);
+	elapsed = g_test_timer_elapsed ();
+	g_assert_cmpint (g_strv_length (results), >, 0);
+	g_assert_cmpstr (results[0], ==, "python3-pack42-devel");
+	g_test_minimized_result (elapsed, "name index: %.3fms", elapsed * 1000);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -177,6 +1378,27 @@ main (int argc, char **argv)
 
 	g_test_add_func ("/gnome-packagekit/enum", gpk_test_enum_func);
 	g_test_add_func ("/gnome-packagekit/common", gpk_test_common_func);
+	g_test_add_func ("/gnome-packagekit/package-formatter", gpk_test_package_formatter_func);
+	g_test_add_func ("/gnome-packagekit/package-atom", gpk_test_package_atom_func);
+	g_test_add_func ("/gnome-packagekit/package-model", gpk_test_package_model_func);
+	g_test_add_func ("/gnome-packagekit/package-model-sort", gpk_test_package_model_sort_func);
+	g_test_add_func ("/gnome-packagekit/package-model-facets", gpk_test_package_model_facets_func);
+	g_test_add_func ("/gnome-packagekit/package-model-rank", gpk_test_package_model_rank_func);
+	g_test_add_func ("/gnome-packagekit/package-model-installed", gpk_test_package_model_installed_func);
+	g_test_add_func ("/gnome-packagekit/result-cache", gpk_test_result_cache_func);
+	g_test_add_func ("/gnome-packagekit/scheduler", gpk_test_scheduler_func);
+	g_test_add_func ("/gnome-packagekit/dependency-graph", gpk_test_dependency_graph_func);
+	g_test_add_func ("/gnome-packagekit/category-tree", gpk_test_category_tree_func);
+	g_test_add_func ("/gnome-packagekit/file-model", gpk_test_file_model_func);
+	g_test_add_func ("/gnome-packagekit/catalog", gpk_test_catalog_func);
+	g_test_add_func ("/gnome-packagekit/trigram-index", gpk_test_trigram_index_func);
+	g_test_add_func ("/gnome-packagekit/name-index", gpk_test_name_index_func);
+	if (g_test_perf ())
+		g_test_add_func ("/gnome-packagekit/trigram-index-perf", gpk_test_trigram_index_perf_func);
+	if (g_test_perf ())
+		g_test_add_func ("/gnome-packagekit/package-formatter-perf", gpk_test_package_formatter_perf_func);
+	if (g_test_perf ())
+		g_test_add_func ("/gnome-packagekit/name-index-perf", gpk_test_name_index_perf_func);
 
 	return g_test_run ();
 }
@@ -43,6 +43,7 @@ struct _GpkTaskPrivate
 	GtkBuilder		*builder_signature;
 	GtkBuilder		*builder_eula;
 	guint			 request;
+	GTask			*confirm;	/* instead of request, if set */
 	const gchar		*help_id;
 };
 
@@ -61,6 +62,12 @@ static void
 gpk_task_button_accept_cb (GtkWidget *widget, GpkTask *task)
 {
 	gtk_widget_hide (GTK_WIDGET(task->priv->current_window));
+	if (task->priv->confirm != NULL) {
+		task->priv->current_window = NULL;
+		g_task_return_boolean (task->priv->confirm, TRUE);
+		g_clear_object (&task->priv->confirm);
+		return;
+	}
 	pk_task_user_accepted (PK_TASK(task), task->priv->request);
 	task->priv->request = 0;
 	task->priv->current_window = NULL;
@@ -70,6 +77,15 @@ static void
 gpk_task_button_decline_cb (GtkWidget *widget, GpkTask *task)
 {
 	gtk_widget_hide (GTK_WIDGET(task->priv->current_window));
+	if (task->priv->confirm != NULL) {
+		task->priv->current_window = NULL;
+		g_task_return_new_error (task->priv->confirm,
+					 PK_CLIENT_ERROR,
+					 PK_CLIENT_ERROR_DECLINED_SIMULATION,
+					 "user declined simulation");
+		g_clear_object (&task->priv->confirm);
+		return;
+	}
 	pk_task_user_declined (PK_TASK(task), task->priv->request);
 	task->priv->request = 0;
 	task->priv->current_window = NULL;
@@ -385,40 +401,14 @@ gpk_task_add_dialog_deps_section (PkTask *task,
 	gtk_notebook_append_page (tabbed_widget, tab_page, tab_label);
 }
 
+/* shows what else a transaction changes, and waits for a response */
 static void
-gpk_task_simulate_question (PkTask *task, guint request, PkResults *results)
+gpk_task_show_depends (PkTask *task, PkRoleEnum role, guint inputs, PkPackageSack *sack)
 {
-	gboolean ret;
-	g_autoptr(GPtrArray) array = NULL;
 	GpkTaskPrivate *priv = GPK_TASK(task)->priv;
-	PkRoleEnum role;
-	g_autoptr(PkPackageSack) sack = NULL;
-	guint inputs;
 	const gchar *title;
 	const gchar *message = NULL;
 	GtkNotebook *tabbed_widget = NULL;
-	PkBitfield transaction_flags = 0;
-
-	/* save the current request */
-	priv->request = request;
-
-	/* get data about the transaction */
-	g_object_get (results,
-		      "role", &role,
-		      "inputs", &inputs,
-		      "transaction-flags", &transaction_flags,
-		      NULL);
-
-	/* allow skipping of deps except when we remove other packages */
-	if (role != PK_ROLE_ENUM_REMOVE_PACKAGES) {
-		/* have we previously said we don't want to be shown the confirmation */
-		ret = g_settings_get_boolean (priv->settings, GPK_SETTINGS_SHOW_DEPENDS);
-		if (!ret) {
-			g_debug ("we've said we don't want the dep dialog");
-			pk_task_user_accepted (PK_TASK(task), priv->request);
-			return;
-		}
-	}
 
 	/* TRANSLATORS: title of a dependency dialog */
 	title = _("Additional confirmation required");
@@ -457,9 +447,6 @@ gpk_task_simulate_question (PkTask *task, guint request, PkResults *results)
 
 	tabbed_widget = GTK_NOTEBOOK (gtk_notebook_new ());
 
-	/* get the details for all the packages */
-	sack = pk_results_get_package_sack (results);
-
 	gpk_task_add_dialog_deps_section (task, tabbed_widget, sack,
 					  PK_INFO_ENUM_INSTALLING);
 
@@ -497,6 +484,89 @@ gpk_task_simulate_question (PkTask *task, guint request, PkResults *results)
 	gtk_widget_show_all (GTK_WIDGET(priv->current_window));
 }
 
+static void
+gpk_task_simulate_question (PkTask *task, guint request, PkResults *results)
+{
+	gboolean ret;
+	GpkTaskPrivate *priv = GPK_TASK(task)->priv;
+	PkRoleEnum role;
+	g_autoptr(PkPackageSack) sack = NULL;
+	guint inputs;
+	PkBitfield transaction_flags = 0;
+
+	/* save the current request */
+	priv->request = request;
+
+	/* get data about the transaction */
+	g_object_get (results,
+		      "role", &role,
+		      "inputs", &inputs,
+		      "transaction-flags", &transaction_flags,
+		      NULL);
+
+	/* allow skipping of deps except when we remove other packages */
+	if (role != PK_ROLE_ENUM_REMOVE_PACKAGES) {
+		/* have we previously said we don't want to be shown the confirmation */
+		ret = g_settings_get_boolean (priv->settings, GPK_SETTINGS_SHOW_DEPENDS);
+		if (!ret) {
+			g_debug ("we've said we don't want the dep dialog");
+			pk_task_user_accepted (PK_TASK(task), priv->request);
+			return;
+		}
+	}
+
+	/* get the details for all the packages */
+	sack = pk_results_get_package_sack (results);
+	gpk_task_show_depends (task, role, inputs, sack);
+}
+
+/**
+ * gpk_task_confirm_async:
+ * @task: a #GpkTask
+ * @role: the role of the transactions, or %PK_ROLE_ENUM_UNKNOWN for a mix
+ * @inputs: the number of packages that were asked for
+ * @sack: the other packages that would be changed
+ *
+ * Asks the user to confirm what was simulated outside of #PkTask, using the
+ * same dialog. This is for several transactions that are confirmed once,
+ * and then run with #PkTask:simulate turned off.
+ **/
+void
+gpk_task_confirm_async (GpkTask *task, PkRoleEnum role, guint inputs, PkPackageSack *sack,
+			GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+	GpkTaskPrivate *priv = task->priv;
+	g_autoptr(GTask) confirm = NULL;
+
+	g_return_if_fail (GPK_IS_TASK (task));
+	g_return_if_fail (PK_IS_PACKAGE_SACK (sack));
+
+	confirm = g_task_new (task, cancellable, callback, user_data);
+	if (priv->confirm != NULL || priv->current_window != NULL) {
+		g_task_return_new_error (confirm, G_IO_ERROR, G_IO_ERROR_BUSY,
+					 "already asking a question");
+		return;
+	}
+
+	/* anything that also removes packages is always confirmed */
+	if (role != PK_ROLE_ENUM_REMOVE_PACKAGES &&
+	    role != PK_ROLE_ENUM_UNKNOWN &&
+	    !g_settings_get_boolean (priv->settings, GPK_SETTINGS_SHOW_DEPENDS)) {
+		g_debug ("we've said we don't want the dep dialog");
+		g_task_return_boolean (confirm, TRUE);
+		return;
+	}
+	priv->confirm = g_steal_pointer (&confirm);
+	gpk_task_show_depends (PK_TASK (task), role, inputs, sack);
+}
+
+gboolean
+gpk_task_confirm_finish (GpkTask *task, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (g_task_is_valid (res, task), FALSE);
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
 static void
 gpk_task_setup_dialog_untrusted (GpkTask *task)
 {
@@ -636,6 +706,7 @@ gpk_task_finalize (GObject *object)
 	g_object_unref (task->priv->builder_signature);
 	g_object_unref (task->priv->builder_eula);
 	g_object_unref (task->priv->settings);
+	g_clear_object (&task->priv->confirm);
 
 	G_OBJECT_CLASS (gpk_task_parent_class)->finalize (object);
 }
@@ -54,6 +54,16 @@ GQuark		 gpk_task_error_quark		(void);
 GpkTask		*gpk_task_new			(void);
 gboolean	 gpk_task_set_parent_window	(GpkTask	*task,
 						 GtkWindow	*window);
+void		 gpk_task_confirm_async		(GpkTask	*task,
+						 PkRoleEnum	 role,
+						 guint		 inputs,
+						 PkPackageSack	*sack,
+						 GCancellable	*cancellable,
+						 GAsyncReadyCallback callback,
+						 gpointer	 user_data);
+gboolean	 gpk_task_confirm_finish	(GpkTask	*task,
+						 GAsyncResult	*res,
+						 GError		**error);
 
 G_END_DECLS
 
@@ -0,0 +1,434 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <packagekit-glib2/packagekit.h>
+
+#include "gpk-trigram-index.h"
+
+/* bump if the meaning of the saved text changes */
+#define GPK_TRIGRAM_INDEX_VERSION	1
+#define GPK_TRIGRAM_INDEX_FORMAT	"(ua(sss))"
+
+#define GPK_TRIGRAM_KEY(s)	(((guint32) (guint8) (s)[0] << 16) | \
+				 ((guint32) (guint8) (s)[1] << 8) | \
+				 ((guint32) (guint8) (s)[2]))
+
+typedef struct {
+	gchar			*package_id;
+	gchar			*summary;
+	gchar			*text;		/* lowercase name, summary and description */
+} GpkTrigramIndexDoc;
+
+struct _GpkTrigramIndex
+{
+	GObject			 parent_instance;
+	GPtrArray		*docs;		/* of GpkTrigramIndexDoc, NULL if replaced */
+	GHashTable		*ids;		/* package_id:doc index + 1 */
+	GHashTable		*postings;	/* trigram:GArray of guint32 */
+};
+
+G_DEFINE_TYPE (GpkTrigramIndex, gpk_trigram_index, G_TYPE_OBJECT)
+
+static void
+gpk_trigram_index_doc_free (GpkTrigramIndexDoc *doc)
+{
+	if (doc == NULL)
+		return;
+	g_free (doc->package_id);
+	g_free (doc->summary);
+	g_free (doc->text);
+	g_free (doc);
+}
+
+static void
+gpk_trigram_index_add_doc (GpkTrigramIndex *index, GpkTrigramIndexDoc *doc)
+{
+	GArray *postings;
+	guint32 idx;
+	guint i;
+	guint32 key;
+
+	idx = index->docs->len;
+	g_ptr_array_add (index->docs, doc);
+	g_hash_table_insert (index->ids, doc->package_id, GUINT_TO_POINTER (idx + 1));
+
+	/* the docs are only ever appended, so each posting list is sorted */
+	for (i = 0; doc->text[i] != '\0' && doc->text[i + 1] != '\0' && doc->text[i + 2] != '\0'; i++) {
+		key = GPK_TRIGRAM_KEY (doc->text + i);
+		postings = g_hash_table_lookup (index->postings, GUINT_TO_POINTER (key));
+		if (postings == NULL) {
+			postings = g_array_sized_new (FALSE, FALSE, sizeof (guint32), 4);
+			g_hash_table_insert (index->postings, GUINT_TO_POINTER (key), postings);
+		} else if (g_array_index (postings, guint32, postings->len - 1) == idx) {
+			continue;
+		}
+		g_array_append_val (postings, idx);
+	}
+}
+
+static void
+gpk_trigram_index_remove (GpkTrigramIndex *index, const gchar *package_id)
+{
+	guint idx;
+
+	/* the stale postings are ignored when searching */
+	idx = GPOINTER_TO_UINT (g_hash_table_lookup (index->ids, package_id));
+	if (idx == 0)
+		return;
+	g_hash_table_remove (index->ids, package_id);
+	gpk_trigram_index_doc_free (g_ptr_array_index (index->docs, idx - 1));
+	index->docs->pdata[idx - 1] = NULL;
+}
+
+/**
+ * gpk_trigram_index_add:
+ * @index: a #GpkTrigramIndex
+ * @package_id: a package ID
+ * @summary: the package summary, or %NULL
+ * @description: the package description from #PkDetails, or %NULL
+ *
+ * Adds a package to the index, replacing any with the same ID.
+ **/
+void
+gpk_trigram_index_add (GpkTrigramIndex *index,
+		       const gchar *package_id,
+		       const gchar *summary,
+		       const gchar *description)
+{
+	GpkTrigramIndexDoc *doc;
+	guint i;
+	g_auto(GStrv) split = NULL;
+
+	g_return_if_fail (GPK_IS_TRIGRAM_INDEX (index));
+	g_return_if_fail (package_id != NULL);
+
+	split = pk_package_id_split (package_id);
+	if (split == NULL)
+		return;
+	gpk_trigram_index_remove (index, package_id);
+
+	/* the backends match the name, summary and description */
+	doc = g_new0 (GpkTrigramIndexDoc, 1);
+	doc->package_id = g_strdup (package_id);
+	doc->summary = g_strdup (summary != NULL ? summary : "");
+	doc->text = g_strdup_printf ("%s\n%s\n%s",
+				     split[PK_PACKAGE_ID_NAME],
+				     doc->summary,
+				     description != NULL ? description : "");
+	for (i = 0; doc->text[i] != '\0'; i++)
+		doc->text[i] = g_ascii_tolower (doc->text[i]);
+	gpk_trigram_index_add_doc (index, doc);
+}
+
+gboolean
+gpk_trigram_index_contains (GpkTrigramIndex *index, const gchar *package_id)
+{
+	g_return_val_if_fail (GPK_IS_TRIGRAM_INDEX (index), FALSE);
+	return g_hash_table_contains (index->ids, package_id);
+}
+
+guint
+gpk_trigram_index_get_size (GpkTrigramIndex *index)
+{
+	g_return_val_if_fail (GPK_IS_TRIGRAM_INDEX (index), 0);
+	return g_hash_table_size (index->ids);
+}
+
+/**
+ * gpk_trigram_index_prune:
+ * @index: a #GpkTrigramIndex
+ * @package_ids: a set of package IDs to keep
+ *
+ * Removes every package not in @package_ids, and compacts the index.
+ **/
+void
+gpk_trigram_index_prune (GpkTrigramIndex *index, GHashTable *package_ids)
+{
+	GpkTrigramIndexDoc *doc;
+	guint i;
+	g_autoptr(GPtrArray) docs = NULL;
+
+	g_return_if_fail (GPK_IS_TRIGRAM_INDEX (index));
+
+	/* rebuild the postings from what is left */
+	docs = index->docs;
+	index->docs = g_ptr_array_new_with_free_func ((GDestroyNotify) gpk_trigram_index_doc_free);
+	g_hash_table_remove_all (index->ids);
+	g_hash_table_remove_all (index->postings);
+	for (i = 0; i < docs->len; i++) {
+		doc = g_ptr_array_index (docs, i);
+		if (doc == NULL || !g_hash_table_contains (package_ids, doc->package_id))
+			continue;
+		docs->pdata[i] = NULL;
+		gpk_trigram_index_add_doc (index, doc);
+	}
+}
+
+static gint
+gpk_trigram_index_postings_sort_cb (gconstpointer a, gconstpointer b)
+{
+	GArray *postings_a = *((GArray **) a);
+	GArray *postings_b = *((GArray **) b);
+	return (gint) postings_a->len - (gint) postings_b->len;
+}
+
+static void
+gpk_trigram_index_intersect (GArray *candidates, GArray *postings)
+{
+	guint i = 0;
+	guint j = 0;
+	guint len = 0;
+	guint32 a;
+	guint32 b;
+
+	/* both are sorted, so keep the common values in place */
+	while (i < candidates->len && j < postings->len) {
+		a = g_array_index (candidates, guint32, i);
+		b = g_array_index (postings, guint32, j);
+		if (a < b) {
+			i++;
+		} else if (a > b) {
+			j++;
+		} else {
+			g_array_index (candidates, guint32, len++) = a;
+			i++;
+			j++;
+		}
+	}
+	g_array_set_size (candidates, len);
+}
+
+static PkPackage *
+gpk_trigram_index_get_package (GpkTrigramIndexDoc *doc)
+{
+	g_auto(GStrv) split = NULL;
+	g_autoptr(PkPackage) package = NULL;
+
+	package = pk_package_new ();
+	if (!pk_package_set_id (package, doc->package_id, NULL))
+		return NULL;
+	split = pk_package_id_split (doc->package_id);
+	if (g_str_has_prefix (split[PK_PACKAGE_ID_DATA], "installed"))
+		pk_package_set_info (package, PK_INFO_ENUM_INSTALLED);
+	else
+		pk_package_set_info (package, PK_INFO_ENUM_AVAILABLE);
+	pk_package_set_summary (package, doc->summary);
+	return g_steal_pointer (&package);
+}
+
+/**
+ * gpk_trigram_index_search:
+ * @index: a #GpkTrigramIndex
+ * @values: search terms, which must all be found
+ *
+ * Finds packages in the same way as a PackageKit details search. Only
+ * packages that have a trigram of every term are compared with the terms.
+ *
+ * Return value: (transfer container): an array of #PkPackage
+ **/
+GPtrArray *
+gpk_trigram_index_search (GpkTrigramIndex *index, gchar **values)
+{
+	GArray *postings;
+	GpkTrigramIndexDoc *doc;
+	GPtrArray *array;
+	PkPackage *package;
+	guint i;
+	guint j;
+	guint32 idx;
+	g_auto(GStrv) needles = NULL;
+	g_autoptr(GArray) candidates = NULL;
+	g_autoptr(GPtrArray) lists = NULL;
+
+	g_return_val_if_fail (GPK_IS_TRIGRAM_INDEX (index), NULL);
+
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+
+	/* get the posting list of every trigram in every term */
+	needles = g_new0 (gchar *, g_strv_length (values) + 1);
+	lists = g_ptr_array_new ();
+	for (i = 0; values[i] != NULL; i++) {
+		needles[i] = g_ascii_strdown (values[i], -1);
+		for (j = 0; needles[i][j] != '\0' && needles[i][j + 1] != '\0' && needles[i][j + 2] != '\0'; j++) {
+			postings = g_hash_table_lookup (index->postings,
+							GUINT_TO_POINTER (GPK_TRIGRAM_KEY (needles[i] + j)));
+			if (postings == NULL)
+				return array;
+			g_ptr_array_add (lists, postings);
+		}
+	}
+
+	/* intersect the shortest first so the candidates shrink quickly */
+	g_ptr_array_sort (lists, gpk_trigram_index_postings_sort_cb);
+	if (lists->len > 0) {
+		postings = g_ptr_array_index (lists, 0);
+		candidates = g_array_sized_new (FALSE, FALSE, sizeof (guint32), postings->len);
+		g_array_append_vals (candidates, postings->data, postings->len);
+		for (i = 1; i < lists->len && candidates->len > 0; i++)
+			gpk_trigram_index_intersect (candidates, g_ptr_array_index (lists, i));
+	} else {
+		/* every term is too short to have a trigram */
+		candidates = g_array_sized_new (FALSE, FALSE, sizeof (guint32), index->docs->len);
+		for (idx = 0; idx < index->docs->len; idx++)
+			g_array_append_val (candidates, idx);
+	}
+
+	/* trigrams can match out of order, so check the real text */
+	for (i = 0; i < candidates->len; i++) {
+		doc = g_ptr_array_index (index->docs, g_array_index (candidates, guint32, i));
+		if (doc == NULL)
+			continue;
+		for (j = 0; needles[j] != NULL; j++) {
+			if (strstr (doc->text, needles[j]) == NULL)
+				break;
+		}
+		if (needles[j] != NULL)
+			continue;
+		package = gpk_trigram_index_get_package (doc);
+		if (package != NULL)
+			g_ptr_array_add (array, package);
+	}
+	return array;
+}
+
+/**
+ * gpk_trigram_index_load:
+ * @index: a #GpkTrigramIndex
+ * @filename: a file written by gpk_trigram_index_save()
+ * @error: a #GError, or %NULL
+ *
+ * Adds the packages from a saved index. Only the text is saved, and the
+ * posting lists are built again.
+ **/
+gboolean
+gpk_trigram_index_load (GpkTrigramIndex *index, const gchar *filename, GError **error)
+{
+	GpkTrigramIndexDoc *doc;
+	GVariantIter *iter = NULL;
+	const gchar *package_id;
+	const gchar *summary;
+	const gchar *text;
+	gchar *data = NULL;
+	gsize len;
+	guint32 version;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GVariant) value = NULL;
+
+	g_return_val_if_fail (GPK_IS_TRIGRAM_INDEX (index), FALSE);
+
+	if (!g_file_get_contents (filename, &data, &len, error))
+		return FALSE;
+	bytes = g_bytes_new_take (data, len);
+	value = g_variant_new_from_bytes (G_VARIANT_TYPE (GPK_TRIGRAM_INDEX_FORMAT), bytes, FALSE);
+	g_variant_ref_sink (value);
+	g_variant_get (value, "(ua(sss))", &version, &iter);
+	if (version != GPK_TRIGRAM_INDEX_VERSION) {
+		g_variant_iter_free (iter);
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			     "%s is version %u, expected %u",
+			     filename, version, (guint) GPK_TRIGRAM_INDEX_VERSION);
+		return FALSE;
+	}
+	while (g_variant_iter_next (iter, "(&s&s&s)", &package_id, &summary, &text)) {
+		if (g_hash_table_contains (index->ids, package_id))
+			continue;
+		doc = g_new0 (GpkTrigramIndexDoc, 1);
+		doc->package_id = g_strdup (package_id);
+		doc->summary = g_strdup (summary);
+		doc->text = g_strdup (text);
+		gpk_trigram_index_add_doc (index, doc);
+	}
+	g_variant_iter_free (iter);
+	return TRUE;
+}
+
+gboolean
+gpk_trigram_index_save (GpkTrigramIndex *index, const gchar *filename, GError **error)
+{
+	GVariantBuilder builder;
+	GpkTrigramIndexDoc *doc;
+	guint i;
+	g_autofree gchar *dirname = NULL;
+	g_autoptr(GVariant) value = NULL;
+
+	g_return_val_if_fail (GPK_IS_TRIGRAM_INDEX (index), FALSE);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sss)"));
+	for (i = 0; i < index->docs->len; i++) {
+		doc = g_ptr_array_index (index->docs, i);
+		if (doc == NULL)
+			continue;
+		g_variant_builder_add (&builder, "(sss)",
+				       doc->package_id, doc->summary, doc->text);
+	}
+	value = g_variant_new ("(ua(sss))", (guint32) GPK_TRIGRAM_INDEX_VERSION, &builder);
+	g_variant_ref_sink (value);
+
+	dirname = g_path_get_dirname (filename);
+	if (g_mkdir_with_parents (dirname, 0700) < 0) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+			     "failed to create %s", dirname);
+		return FALSE;
+	}
+	return g_file_set_contents (filename,
+				    g_variant_get_data (value),
+				    g_variant_get_size (value),
+				    error);
+}
+
+static void
+gpk_trigram_index_finalize (GObject *object)
+{
+	GpkTrigramIndex *index = GPK_TRIGRAM_INDEX (object);
+
+	g_hash_table_unref (index->postings);
+	g_hash_table_unref (index->ids);
+	g_ptr_array_unref (index->docs);
+
+	G_OBJECT_CLASS (gpk_trigram_index_parent_class)->finalize (object);
+}
+
+static void
+gpk_trigram_index_class_init (GpkTrigramIndexClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gpk_trigram_index_finalize;
+}
+
+static void
+gpk_trigram_index_init (GpkTrigramIndex *index)
+{
+	index->docs = g_ptr_array_new_with_free_func ((GDestroyNotify) gpk_trigram_index_doc_free);
+	index->ids = g_hash_table_new (g_str_hash, g_str_equal);
+	index->postings = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+						 NULL, (GDestroyNotify) g_array_unref);
+}
+
+GpkTrigramIndex *
+gpk_trigram_index_new (void)
+{
+	return g_object_new (GPK_TYPE_TRIGRAM_INDEX, NULL);
+}
@@ -0,0 +1,53 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __GPK_TRIGRAM_INDEX_H
+#define __GPK_TRIGRAM_INDEX_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GPK_TYPE_TRIGRAM_INDEX (gpk_trigram_index_get_type ())
+G_DECLARE_FINAL_TYPE (GpkTrigramIndex, gpk_trigram_index, GPK, TRIGRAM_INDEX, GObject)
+
+GpkTrigramIndex	*gpk_trigram_index_new			(void);
+void		 gpk_trigram_index_add			(GpkTrigramIndex	*index,
+							 const gchar		*package_id,
+							 const gchar		*summary,
+							 const gchar		*description);
+gboolean	 gpk_trigram_index_contains		(GpkTrigramIndex	*index,
+							 const gchar		*package_id);
+void		 gpk_trigram_index_prune		(GpkTrigramIndex	*index,
+							 GHashTable		*package_ids);
+guint		 gpk_trigram_index_get_size		(GpkTrigramIndex	*index);
+GPtrArray	*gpk_trigram_index_search		(GpkTrigramIndex	*index,
+							 gchar			**values);
+gboolean	 gpk_trigram_index_load			(GpkTrigramIndex	*index,
+							 const gchar		*filename,
+							 GError			**error);
+gboolean	 gpk_trigram_index_save			(GpkTrigramIndex	*index,
+							 const gchar		*filename,
+							 GError			**error);
+
+G_END_DECLS
+
+#endif /* __GPK_TRIGRAM_INDEX_H */
@@ -0,0 +1,222 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib/gi18n.h>
+#include <gtk/gtk.h>
+#include <packagekit-glib2/packagekit.h>
+
+#include "gpk-common.h"
+#include "gpk-update-tree.h"
+
+/**
+ * gpk_update_tree_store_new:
+ *
+ * Return value: an empty store with the GPK_UPDATES_COLUMN_* columns
+ **/
+GtkTreeStore *
+gpk_update_tree_store_new (void)
+{
+	return gtk_tree_store_new (GPK_UPDATES_COLUMN_LAST, G_TYPE_STRING, GPK_TYPE_PACKAGE_ATOM, G_TYPE_INT,
+				   G_TYPE_BOOLEAN, G_TYPE_BOOLEAN, G_TYPE_BOOLEAN,
+				   G_TYPE_UINT, G_TYPE_UINT, G_TYPE_UINT, G_TYPE_UINT,
+				   G_TYPE_UINT, G_TYPE_POINTER, G_TYPE_POINTER, G_TYPE_INT, G_TYPE_BOOLEAN);
+}
+
+static const gchar *
+gpk_update_tree_get_info_header (PkInfoEnum info)
+{
+	const gchar *text = NULL;
+	switch (info) {
+	case PK_INFO_ENUM_LOW:
+		/* TRANSLATORS: The type of update */
+		text = _("Trivial updates");
+		break;
+	case PK_INFO_ENUM_IMPORTANT:
+		/* TRANSLATORS: The type of update */
+		text = _("Important updates");
+		break;
+	case PK_INFO_ENUM_SECURITY:
+		/* TRANSLATORS: The type of update */
+		text = _("Security updates");
+		break;
+	case PK_INFO_ENUM_BUGFIX:
+		/* TRANSLATORS: The type of update */
+		text = _("Bug fix updates");
+		break;
+	case PK_INFO_ENUM_ENHANCEMENT:
+		/* TRANSLATORS: The type of update */
+		text = _("Enhancement updates");
+		break;
+	case PK_INFO_ENUM_BLOCKED:
+		/* TRANSLATORS: The type of update */
+		text = _("Blocked updates");
+		break;
+	default:
+		/* TRANSLATORS: The type of update, i.e. unspecified */
+		text = _("Other updates");
+	}
+	return text;
+}
+
+/**
+ * gpk_update_tree_get_parent_for_info:
+ *
+ * Finds the header row for the type of update, adding it if it is not
+ * already in the store.
+ **/
+void
+gpk_update_tree_get_parent_for_info (GtkTreeStore *store, PkInfoEnum info, GtkTreeIter *parent)
+{
+	gboolean is_package;
+	gboolean ret = FALSE;
+	gboolean valid;
+	g_autofree gchar *title = NULL;
+	GtkTreeIter iter;
+	GtkTreeModel *model = GTK_TREE_MODEL (store);
+	PkInfoEnum info_tmp;
+
+	/* get the first iter in the array */
+	valid = gtk_tree_model_get_iter_first (model, &iter);
+
+	/* smush some update states together */
+	switch (info) {
+	case PK_INFO_ENUM_ENHANCEMENT:
+	case PK_INFO_ENUM_LOW:
+		info = PK_INFO_ENUM_NORMAL;
+		break;
+	default:
+		break;
+	}
+
+	/* find out how many we should update */
+	while (valid) {
+		g_autoptr(GpkPackageAtom) atom_tmp = NULL;
+		gtk_tree_model_get (model, &iter,
+				    GPK_UPDATES_COLUMN_INFO, &info_tmp,
+				    GPK_UPDATES_COLUMN_ID, &atom_tmp,
+				    -1);
+		is_package = atom_tmp != NULL;
+
+		/* right section? */
+		if (!is_package && info_tmp == info) {
+			*parent = iter;
+			ret = TRUE;
+			break;
+		}
+
+		valid = gtk_tree_model_iter_next (model, &iter);
+	}
+
+	/* create */
+	if (!ret) {
+		title = g_strdup_printf ("<b>%s</b>",
+					 gpk_update_tree_get_info_header (info));
+		gtk_tree_store_append (store, &iter, NULL);
+		gtk_tree_store_set (store, &iter,
+				    GPK_UPDATES_COLUMN_TEXT, title,
+				    GPK_UPDATES_COLUMN_ID, NULL,
+				    GPK_UPDATES_COLUMN_INFO, info,
+				    GPK_UPDATES_COLUMN_SELECT, TRUE,
+				    GPK_UPDATES_COLUMN_VISIBLE, FALSE,
+				    GPK_UPDATES_COLUMN_CLICKABLE, FALSE,
+				    GPK_UPDATES_COLUMN_RESTART, PK_RESTART_ENUM_NONE,
+				    GPK_UPDATES_COLUMN_STATUS, PK_INFO_ENUM_UNKNOWN,
+				    GPK_UPDATES_COLUMN_SIZE, 0,
+				    GPK_UPDATES_COLUMN_SIZE_DISPLAY, 0,
+				    GPK_UPDATES_COLUMN_PERCENTAGE, 0,
+				    GPK_UPDATES_COLUMN_PULSE, -1,
+				    -1);
+		*parent = iter;
+	}
+}
+
+/**
+ * gpk_update_tree_add_packages:
+ * @can_select: %FALSE if only the whole system can be updated
+ *
+ * Adds the updates in @array under a header for each type of update,
+ * formatting all the rows in one go.
+ **/
+void
+gpk_update_tree_add_packages (GtkTreeStore *store, GtkStyleContext *style,
+			      GPtrArray *array, gboolean can_select)
+{
+	PkPackage *item;
+	const gchar *text;
+	gboolean selected;
+	gboolean sensitive;
+	GtkTreeIter iter;
+	GtkTreeIter parent;
+	guint i;
+	PkInfoEnum info;
+	g_autoptr(GArray) offsets = NULL;
+	g_autoptr(GString) markup = NULL;
+	g_autoptr(GpkPackageFormatter) formatter = NULL;
+
+	/* format all the rows in one go */
+	formatter = gpk_package_formatter_new (style);
+	markup = g_string_sized_new (array->len * 128);
+	offsets = g_array_sized_new (FALSE, FALSE, sizeof (gsize), array->len);
+	gpk_package_formatter_append_packages (formatter, array, markup, offsets);
+
+	for (i = 0; i < array->len; i++) {
+		const gchar *package_id;
+		g_autoptr(GpkPackageAtom) atom = NULL;
+		item = g_ptr_array_index (array, i);
+		info = pk_package_get_info (item);
+		package_id = pk_package_get_id (item);
+
+		/* find our parent */
+		gpk_update_tree_get_parent_for_info (store, info, &parent);
+
+		/* add to array store */
+		text = markup->str + g_array_index (offsets, gsize, i);
+		g_debug ("adding: id=%s, text=%s", package_id, text);
+		selected = (info != PK_INFO_ENUM_BLOCKED);
+
+		/* only make the checkbox selectable if:
+		 *  - we can do UpdatePackages rather than just UpdateSystem
+		 *  - the update is not blocked
+		 */
+		sensitive = selected && can_select;
+
+		/* add to model */
+		atom = gpk_package_atom_intern (package_id);
+		gtk_tree_store_append (store, &iter, &parent);
+		gtk_tree_store_set (store, &iter,
+				    GPK_UPDATES_COLUMN_TEXT, text,
+				    GPK_UPDATES_COLUMN_ID, atom,
+				    GPK_UPDATES_COLUMN_INFO, info,
+				    GPK_UPDATES_COLUMN_SELECT, selected,
+				    GPK_UPDATES_COLUMN_SENSITIVE, sensitive,
+				    GPK_UPDATES_COLUMN_VISIBLE, TRUE,
+				    GPK_UPDATES_COLUMN_CLICKABLE, selected,
+				    GPK_UPDATES_COLUMN_RESTART, PK_RESTART_ENUM_NONE,
+				    GPK_UPDATES_COLUMN_STATUS, PK_INFO_ENUM_UNKNOWN,
+				    GPK_UPDATES_COLUMN_SIZE, 0,
+				    GPK_UPDATES_COLUMN_SIZE_DISPLAY, 0,
+				    GPK_UPDATES_COLUMN_PERCENTAGE, 0,
+				    GPK_UPDATES_COLUMN_PULSE, -1,
+				    -1);
+	}
+}
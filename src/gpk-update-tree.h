@@ -0,0 +1,60 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2016 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __GPK_UPDATE_TREE_H
+#define __GPK_UPDATE_TREE_H
+
+#include <gtk/gtk.h>
+#include <packagekit-glib2/packagekit.h>
+
+G_BEGIN_DECLS
+
+enum {
+	GPK_UPDATES_COLUMN_TEXT,
+	GPK_UPDATES_COLUMN_ID,
+	GPK_UPDATES_COLUMN_INFO,
+	GPK_UPDATES_COLUMN_SELECT,
+	GPK_UPDATES_COLUMN_SENSITIVE,
+	GPK_UPDATES_COLUMN_CLICKABLE,
+	GPK_UPDATES_COLUMN_RESTART,
+	GPK_UPDATES_COLUMN_SIZE,
+	GPK_UPDATES_COLUMN_SIZE_DISPLAY,
+	GPK_UPDATES_COLUMN_PERCENTAGE,
+	GPK_UPDATES_COLUMN_STATUS,
+	GPK_UPDATES_COLUMN_DETAILS_OBJ,
+	GPK_UPDATES_COLUMN_UPDATE_DETAIL_OBJ,
+	GPK_UPDATES_COLUMN_PULSE,
+	GPK_UPDATES_COLUMN_VISIBLE,
+	GPK_UPDATES_COLUMN_LAST
+};
+
+GtkTreeStore	*gpk_update_tree_store_new		(void);
+void		 gpk_update_tree_get_parent_for_info	(GtkTreeStore		*store,
+							 PkInfoEnum		 info,
+							 GtkTreeIter		*parent);
+void		 gpk_update_tree_add_packages		(GtkTreeStore		*store,
+							 GtkStyleContext	*style,
+							 GPtrArray		*array,
+							 gboolean		 can_select);
+
+G_END_DECLS
+
+#endif /* __GPK_UPDATE_TREE_H */
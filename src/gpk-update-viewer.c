@@ -41,6 +41,7 @@
 #include "gpk-enum.h"
 #include "gpk-error.h"
 #include "gpk-task.h"
+#include "gpk-update-tree.h"
 #include "gpk-debug.h"
 
 #define GPK_UPDATE_VIEWER_AUTO_QUIT_TIMEOUT	10 /* seconds */
@@ -72,25 +73,6 @@ static	GtkApplication		*application = NULL;
 static	PkBitfield		 roles = 0;
 static	gboolean		 have_available_distro_upgrades = FALSE;
 
-enum {
-	GPK_UPDATES_COLUMN_TEXT,
-	GPK_UPDATES_COLUMN_ID,
-	GPK_UPDATES_COLUMN_INFO,
-	GPK_UPDATES_COLUMN_SELECT,
-	GPK_UPDATES_COLUMN_SENSITIVE,
-	GPK_UPDATES_COLUMN_CLICKABLE,
-	GPK_UPDATES_COLUMN_RESTART,
-	GPK_UPDATES_COLUMN_SIZE,
-	GPK_UPDATES_COLUMN_SIZE_DISPLAY,
-	GPK_UPDATES_COLUMN_PERCENTAGE,
-	GPK_UPDATES_COLUMN_STATUS,
-	GPK_UPDATES_COLUMN_DETAILS_OBJ,
-	GPK_UPDATES_COLUMN_UPDATE_DETAIL_OBJ,
-	GPK_UPDATES_COLUMN_PULSE,
-	GPK_UPDATES_COLUMN_VISIBLE,
-	GPK_UPDATES_COLUMN_LAST
-};
-
 static gboolean gpk_update_viewer_get_new_update_array (void);
 
 static gboolean
@@ -598,19 +580,17 @@ static gboolean
 gpk_update_viewer_find_iter_model_cb (GtkTreeModel *model,
 				      GtkTreePath *path,
 				      GtkTreeIter *iter,
-				      const gchar *package_id)
+				      GpkPackageAtom *atom)
 {
-	g_autofree gchar *package_id_tmp = NULL;
+	g_autoptr(GpkPackageAtom) atom_tmp = NULL;
 	GtkTreePath **_path = NULL;
 
 	gtk_tree_model_get (model, iter,
-			    GPK_UPDATES_COLUMN_ID, &package_id_tmp,
+			    GPK_UPDATES_COLUMN_ID, &atom_tmp,
 			    -1);
-	if (package_id_tmp == NULL)
-		return FALSE;
 
 	/* match on the package id */
-	if (g_strcmp0 (package_id, package_id_tmp) == 0) {
+	if (atom_tmp == atom) {
 		_path = (GtkTreePath **) g_object_get_data (G_OBJECT(model), "_path");
 		*_path = gtk_tree_path_copy (path);
 		return TRUE;
@@ -622,119 +602,19 @@ static GtkTreePath *
 gpk_update_viewer_model_get_path (GtkTreeModel *model, const gchar *package_id)
 {
 	GtkTreePath *path = NULL;
+	GpkPackageAtom *atom;
 	g_return_val_if_fail (package_id != NULL, NULL);
+
+	/* not in any model */
+	atom = gpk_package_atom_lookup (package_id);
+	if (atom == NULL)
+		return NULL;
 	g_object_set_data (G_OBJECT(model), "_path", (gpointer) &path);
-	gtk_tree_model_foreach (model, (GtkTreeModelForeachFunc) gpk_update_viewer_find_iter_model_cb, (gpointer) package_id);
+	gtk_tree_model_foreach (model, (GtkTreeModelForeachFunc) gpk_update_viewer_find_iter_model_cb, atom);
 	g_object_steal_data (G_OBJECT(model), "_path");
 	return path;
 }
 
-static const gchar *
-gpk_update_view_get_info_headers (PkInfoEnum info)
-{
-	const gchar *text = NULL;
-	switch (info) {
-	case PK_INFO_ENUM_LOW:
-		/* TRANSLATORS: The type of update */
-		text = _("Trivial updates");
-		break;
-	case PK_INFO_ENUM_IMPORTANT:
-		/* TRANSLATORS: The type of update */
-		text = _("Important updates");
-		break;
-	case PK_INFO_ENUM_SECURITY:
-		/* TRANSLATORS: The type of update */
-		text = _("Security updates");
-		break;
-	case PK_INFO_ENUM_BUGFIX:
-		/* TRANSLATORS: The type of update */
-		text = _("Bug fix updates");
-		break;
-	case PK_INFO_ENUM_ENHANCEMENT:
-		/* TRANSLATORS: The type of update */
-		text = _("Enhancement updates");
-		break;
-	case PK_INFO_ENUM_BLOCKED:
-		/* TRANSLATORS: The type of update */
-		text = _("Blocked updates");
-		break;
-	default:
-		/* TRANSLATORS: The type of update, i.e. unspecified */
-		text = _("Other updates");
-	}
-	return text;
-}
-
-static void
-gpk_update_viewer_get_parent_for_info (PkInfoEnum info, GtkTreeIter *parent)
-{
-	gboolean is_package;
-	gboolean ret = FALSE;
-	gboolean valid;
-	g_autofree gchar *title = NULL;
-	GtkTreeIter iter;
-	GtkTreeModel *model;
-	GtkTreeView *treeview;
-	PkInfoEnum info_tmp;
-
-	treeview = GTK_TREE_VIEW(gtk_builder_get_object (builder, "treeview_updates"));
-	model = gtk_tree_view_get_model (treeview);
-
-	/* get the first iter in the array */
-	valid = gtk_tree_model_get_iter_first (model, &iter);
-
-	/* smush some update states together */
-	switch (info) {
-	case PK_INFO_ENUM_ENHANCEMENT:
-	case PK_INFO_ENUM_LOW:
-		info = PK_INFO_ENUM_NORMAL;
-		break;
-	default:
-		break;
-	}
-
-	/* find out how many we should update */
-	while (valid) {
-		g_autofree gchar *package_id_tmp = NULL;
-		gtk_tree_model_get (model, &iter,
-				    GPK_UPDATES_COLUMN_INFO, &info_tmp,
-				    GPK_UPDATES_COLUMN_ID, &package_id_tmp,
-				    -1);
-		is_package = package_id_tmp != NULL;
-
-		/* right section? */
-		if (!is_package && info_tmp == info) {
-			*parent = iter;
-			ret = TRUE;
-			break;
-		}
-
-		valid = gtk_tree_model_iter_next (model, &iter);
-	}
-
-	/* create */
-	if (!ret) {
-		title = g_strdup_printf ("<b>%s</b>",
-					 gpk_update_view_get_info_headers (info));
-		gtk_tree_store_append (array_store_updates, &iter, NULL);
-		gtk_tree_store_set (array_store_updates, &iter,
-				    GPK_UPDATES_COLUMN_TEXT, title,
-				    GPK_UPDATES_COLUMN_ID, NULL,
-				    GPK_UPDATES_COLUMN_INFO, info,
-				    GPK_UPDATES_COLUMN_SELECT, TRUE,
-				    GPK_UPDATES_COLUMN_VISIBLE, FALSE,
-				    GPK_UPDATES_COLUMN_CLICKABLE, FALSE,
-				    GPK_UPDATES_COLUMN_RESTART, PK_RESTART_ENUM_NONE,
-				    GPK_UPDATES_COLUMN_STATUS, PK_INFO_ENUM_UNKNOWN,
-				    GPK_UPDATES_COLUMN_SIZE, 0,
-				    GPK_UPDATES_COLUMN_SIZE_DISPLAY, 0,
-				    GPK_UPDATES_COLUMN_PERCENTAGE, 0,
-				    GPK_UPDATES_COLUMN_PULSE, -1,
-				    -1);
-		*parent = iter;
-	}
-}
-
 static void
 gpk_update_viewer_progress_cb (PkProgress *progress,
 			       PkProgressType type,
@@ -809,16 +689,18 @@ gpk_update_viewer_progress_cb (PkProgress *progress,
 		path = gpk_update_viewer_model_get_path (model, package_id);
 		if (path == NULL) {
 			g_autofree gchar *text = NULL;
+			g_autoptr(GpkPackageAtom) atom = NULL;
 			text = gpk_package_id_format_twoline (gtk_widget_get_style_context (GTK_WIDGET (treeview)),
 							      package_id,
 							      summary);
 			g_debug ("adding: id=%s, text=%s", package_id, text);
 
 			/* add to model */
+			atom = gpk_package_atom_intern (package_id);
 			gtk_tree_store_append (array_store_updates, &iter, NULL);
 			gtk_tree_store_set (array_store_updates, &iter,
 					    GPK_UPDATES_COLUMN_TEXT, text,
-					    GPK_UPDATES_COLUMN_ID, package_id,
+					    GPK_UPDATES_COLUMN_ID, atom,
 					    GPK_UPDATES_COLUMN_INFO, info,
 					    GPK_UPDATES_COLUMN_SELECT, TRUE,
 					    GPK_UPDATES_COLUMN_VISIBLE, TRUE,
@@ -1015,7 +897,7 @@ gpk_update_viewer_get_install_package_ids (void)
 	gboolean child_valid;
 	gboolean valid;
 	gboolean update;
-	gchar *package_id;
+	GpkPackageAtom *atom;
 	GtkTreeIter child_iter;
 	GtkTreeView *treeview;
 	GtkTreeModel *model;
@@ -1033,15 +915,14 @@ gpk_update_viewer_get_install_package_ids (void)
 		gtk_tree_model_get (model, &iter,
 				    GPK_UPDATES_COLUMN_INFO, &info,
 				    GPK_UPDATES_COLUMN_SELECT, &update,
-				    GPK_UPDATES_COLUMN_ID, &package_id, -1);
+				    GPK_UPDATES_COLUMN_ID, &atom, -1);
 
 		/* if selected, and not added previously because of deps */
-		if (package_id != NULL &&
+		if (atom != NULL &&
 		    update &&
 		    gpk_update_viewer_info_is_update_enum (info))
-			g_ptr_array_add (array, package_id);
-		else
-			g_free (package_id);
+			g_ptr_array_add (array, g_strdup (gpk_package_atom_get_id (atom)));
+		g_clear_pointer (&atom, gpk_package_atom_unref);
 
 		/* do for children too */
 		child_valid = gtk_tree_model_iter_children (model, &child_iter, &iter);
@@ -1049,13 +930,14 @@ gpk_update_viewer_get_install_package_ids (void)
 			gtk_tree_model_get (model, &child_iter,
 					    GPK_UPDATES_COLUMN_INFO, &info,
 					    GPK_UPDATES_COLUMN_SELECT, &update,
-					    GPK_UPDATES_COLUMN_ID, &package_id, -1);
+					    GPK_UPDATES_COLUMN_ID, &atom, -1);
 
 			/* if selected, and not added previously because of deps */
-			if (update && gpk_update_viewer_info_is_update_enum (info))
-				g_ptr_array_add (array, package_id);
-			else
-				g_free (package_id);
+			if (atom != NULL &&
+			    update &&
+			    gpk_update_viewer_info_is_update_enum (info))
+				g_ptr_array_add (array, g_strdup (gpk_package_atom_get_id (atom)));
+			g_clear_pointer (&atom, gpk_package_atom_unref);
 
 			child_valid = gtk_tree_model_iter_next (model, &child_iter);
 		}
@@ -1158,7 +1040,7 @@ gpk_update_viewer_update_global_state_recursive (GtkTreeModel *model, GtkTreeIte
 	gboolean selected;
 	PkRestartEnum restart;
 	guint size;
-	g_autofree gchar *package_id = NULL;
+	g_autoptr(GpkPackageAtom) atom = NULL;
 	gboolean child_valid;
 	GtkTreeIter child_iter;
 
@@ -1166,9 +1048,9 @@ gpk_update_viewer_update_global_state_recursive (GtkTreeModel *model, GtkTreeIte
 			    GPK_UPDATES_COLUMN_SELECT, &selected,
 			    GPK_UPDATES_COLUMN_RESTART, &restart,
 			    GPK_UPDATES_COLUMN_SIZE, &size,
-			    GPK_UPDATES_COLUMN_ID, &package_id,
+			    GPK_UPDATES_COLUMN_ID, &atom,
 			    -1);
-	if (selected && package_id != NULL) {
+	if (selected && atom != NULL) {
 		size_total += size;
 		number_total++;
 		if (restart > restart_worst)
@@ -1374,7 +1256,7 @@ gpk_update_viewer_treeview_update_toggled (GtkCellRendererToggle *cell, gchar *p
 	GtkTreePath *path = gtk_tree_path_new_from_string (path_str);
 	gboolean update;
 	gboolean child_valid;
-	g_autofree gchar *package_id = NULL;
+	g_autoptr(GpkPackageAtom) atom = NULL;
 	GtkTreeView *treeview;
 	GtkTreeModel *model;
 
@@ -1384,12 +1266,12 @@ gpk_update_viewer_treeview_update_toggled (GtkCellRendererToggle *cell, gchar *p
 	/* get toggled iter */
 	gtk_tree_model_get_iter (model, &iter, path);
 	gtk_tree_model_get (model, &iter, GPK_UPDATES_COLUMN_SELECT, &update,
-			    GPK_UPDATES_COLUMN_ID, &package_id, -1);
+			    GPK_UPDATES_COLUMN_ID, &atom, -1);
 
 	/* unstage */
 	update ^= 1;
 
-	g_debug ("update %s[%i]", package_id, update);
+	g_debug ("update %s[%i]", atom != NULL ? gpk_package_atom_get_id (atom) : NULL, update);
 
 	/* set new value */
 	gtk_tree_store_set (GTK_TREE_STORE(model), &iter, GPK_UPDATES_COLUMN_SELECT, update, -1);
@@ -1808,7 +1690,7 @@ static void
 gpk_packages_treeview_clicked_cb (GtkTreeSelection *selection, gpointer user_data)
 {
 	gboolean ret;
-	g_autofree gchar *package_id = NULL;
+	g_autoptr(GpkPackageAtom) atom = NULL;
 	GtkTreeIter iter;
 	GtkTreeModel *model;
 	GtkWidget *widget;
@@ -1821,15 +1703,15 @@ gpk_packages_treeview_clicked_cb (GtkTreeSelection *selection, gpointer user_dat
 
 	gtk_tree_model_get (model, &iter,
 			    GPK_UPDATES_COLUMN_UPDATE_DETAIL_OBJ, &item,
-			    GPK_UPDATES_COLUMN_ID, &package_id, -1);
+			    GPK_UPDATES_COLUMN_ID, &atom, -1);
 
 	/* make 'Details' insensitive' */
 	widget = GTK_WIDGET(gtk_builder_get_object (builder, "expander1"));
-	gtk_widget_set_sensitive (widget, package_id != NULL);
+	gtk_widget_set_sensitive (widget, atom != NULL);
 
 	/* set loading text */
 	if (item != NULL) {
-		g_debug ("selected row is: %s, %p", package_id, item);
+		g_debug ("selected row is: %s, %p", atom != NULL ? gpk_package_atom_get_id (atom) : NULL, item);
 		gtk_text_buffer_set_text (text_buffer, _("Loading…"), -1);
 		gpk_update_viewer_populate_details (item);
 	} else {
@@ -1992,6 +1874,7 @@ gpk_update_viewer_get_update_detail_cb (PkClient *client, GAsyncResult *res, gpo
 					    GPK_UPDATES_COLUMN_RESTART, restart, -1);
 		}
 	}
+	gpk_profile_mark ("complete");
 }
 
 static void
@@ -2271,18 +2154,11 @@ gpk_update_viewer_get_updates_cb (PkClient *client, GAsyncResult *res, gpointer
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GPtrArray) array = NULL;
 	g_autoptr(GPtrArray) array_messages = NULL;
-	PkPackage *item;
-	gboolean selected;
-	gboolean sensitive;
-	GtkTreeIter iter;
-	GtkTreeIter parent;
-	guint i;
 	GtkTreeView *treeview;
 	GtkTreeModel *model;
 	GtkWidget *widget;
 	g_autoptr(PkError) error_code = NULL;
 	GtkWindow *window;
-	PkInfoEnum info;
 
 	/* get the results */
 	results = pk_client_generic_finish (client, res, &error);
@@ -2308,55 +2184,11 @@ gpk_update_viewer_get_updates_cb (PkClient *client, GAsyncResult *res, gpointer
 	pk_package_sack_sort (sack, PK_PACKAGE_SACK_SORT_TYPE_NAME);
 	array = pk_package_sack_get_array (sack);
 	widget = GTK_WIDGET(gtk_builder_get_object (builder, "treeview_updates"));
-	for (i = 0; i < array->len; i++) {
-		g_autofree gchar *text = NULL;
-		g_autofree gchar *package_id = NULL;
-		g_autofree gchar *summary = NULL;
-		item = g_ptr_array_index (array, i);
 
-		/* get data */
-		g_object_get (item,
-			      "info", &info,
-			      "package-id", &package_id,
-			      "summary", &summary,
-			      NULL);
-
-		/* find our parent */
-		gpk_update_viewer_get_parent_for_info (info, &parent);
-
-		/* add to array store */
-		text = gpk_package_id_format_twoline (gtk_widget_get_style_context (widget),
-						      package_id,
-						      summary);
-		g_debug ("adding: id=%s, text=%s", package_id, text);
-		selected = (info != PK_INFO_ENUM_BLOCKED);
-
-		/* only make the checkbox selectable if:
-		 *  - we can do UpdatePackages rather than just UpdateSystem
-		 *  - the update is not blocked
-		 */
-		sensitive = selected;
-		if (!pk_bitfield_contain (roles, PK_ROLE_ENUM_UPDATE_PACKAGES))
-			sensitive = FALSE;
-
-		/* add to model */
-		gtk_tree_store_append (array_store_updates, &iter, &parent);
-		gtk_tree_store_set (array_store_updates, &iter,
-				    GPK_UPDATES_COLUMN_TEXT, text,
-				    GPK_UPDATES_COLUMN_ID, package_id,
-				    GPK_UPDATES_COLUMN_INFO, info,
-				    GPK_UPDATES_COLUMN_SELECT, selected,
-				    GPK_UPDATES_COLUMN_SENSITIVE, sensitive,
-				    GPK_UPDATES_COLUMN_VISIBLE, TRUE,
-				    GPK_UPDATES_COLUMN_CLICKABLE, selected,
-				    GPK_UPDATES_COLUMN_RESTART, PK_RESTART_ENUM_NONE,
-				    GPK_UPDATES_COLUMN_STATUS, PK_INFO_ENUM_UNKNOWN,
-				    GPK_UPDATES_COLUMN_SIZE, 0,
-				    GPK_UPDATES_COLUMN_SIZE_DISPLAY, 0,
-				    GPK_UPDATES_COLUMN_PERCENTAGE, 0,
-				    GPK_UPDATES_COLUMN_PULSE, -1,
-				    -1);
-	}
+	/* add under a header for each type of update */
+	gpk_update_tree_add_packages (array_store_updates,
+				      gtk_widget_get_style_context (widget), array,
+				      pk_bitfield_contain (roles, PK_ROLE_ENUM_UPDATE_PACKAGES));
 
 	/* get the download sizes */
 	if (update_array != NULL)
@@ -2370,6 +2202,7 @@ gpk_update_viewer_get_updates_cb (PkClient *client, GAsyncResult *res, gpointer
 					      GPK_UPDATES_COLUMN_INFO,
 					      GTK_SORT_DESCENDING);
 	gtk_tree_view_expand_all (treeview);
+	gpk_profile_mark ("first-row");
 
 	/* get the download sizes */
 	if (update_array->len > 0) {
@@ -2791,10 +2624,7 @@ gpk_update_viewer_application_startup_cb (GtkApplication *_application, gpointer
 	gtk_application_add_window (application, GTK_WINDOW(main_window));
 
 	/* create array stores */
-	array_store_updates = gtk_tree_store_new (GPK_UPDATES_COLUMN_LAST, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_INT,
-						 G_TYPE_BOOLEAN, G_TYPE_BOOLEAN, G_TYPE_BOOLEAN,
-						 G_TYPE_UINT, G_TYPE_UINT, G_TYPE_UINT, G_TYPE_UINT,
-						 G_TYPE_UINT, G_TYPE_POINTER, G_TYPE_POINTER, G_TYPE_INT, G_TYPE_BOOLEAN);
+	array_store_updates = gpk_update_tree_store_new ();
 	text_buffer = gtk_text_buffer_new (NULL);
 	gtk_text_buffer_create_tag (text_buffer, "para",
 				    "pixels_above_lines", 5,
@@ -2909,6 +2739,7 @@ int
 main (int argc, char *argv[])
 {
 	gboolean program_version = FALSE;
+	gboolean allow_privileged = FALSE;
 	GOptionContext *context;
 	gboolean ret;
 	gint status = 0;
@@ -2917,6 +2748,9 @@ main (int argc, char *argv[])
 		{ "version", '\0', 0, G_OPTION_ARG_NONE, &program_version,
 		  /* TRANSLATORS: show the program version */
 		  _("Show the program version and exit"), NULL },
+		{ "allow-privileged", '\0', G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_NONE, &allow_privileged,
+		  /* TRANSLATORS: developer option, for running from automated tests */
+		  _("Do not warn when running as a privileged user"), NULL },
 		{ NULL}
 	};
 
@@ -2927,6 +2761,7 @@ main (int argc, char *argv[])
 	textdomain (GETTEXT_PACKAGE);
 
 	gtk_init (&argc, &argv);
+	gpk_profile_init ();
 
 	context = g_option_context_new (NULL);
 	g_option_context_set_summary (context, _("Update Packages"));
@@ -2946,7 +2781,7 @@ main (int argc, char *argv[])
 					   PKGDATADIR G_DIR_SEPARATOR_S "icons");
 
 	/* TRANSLATORS: title to pass to the user if there are not enough privs */
-	ret = gpk_check_privileged_user (_("Package Updater"), TRUE);
+	ret = gpk_check_privileged_user (_("Package Updater"), !allow_privileged);
 	if (!ret)
 		return 1;
 